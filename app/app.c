@@ -334,6 +334,8 @@ app_run (const gchar         *full_prog_name,
 
   g_main_loop_unref (loop);
 
+  gimp_gegl_exit (gimp);
+
   g_object_unref (gimp);
 
   gimp_debug_instances ();
@@ -391,6 +393,8 @@ app_exit_after_callback (Gimp       *gimp,
 
 #else
 
+  gimp_gegl_exit (gimp);
+
   gegl_exit ();
 
   exit (EXIT_SUCCESS);
@@ -81,6 +81,8 @@ struct _GimpCoreConfig
   GimpGrid               *default_grid;
   gint                    levels_of_undo;
   guint64                 undo_size;
+  gboolean                undo_swap;
+  guint64                 undo_swap_size;
   GimpViewSize            undo_preview_size;
   gint                    filter_history_size;
   gchar                  *plug_in_rc_path;
@@ -95,6 +97,7 @@ struct _GimpCoreConfig
   gboolean                import_promote_dither;
   gboolean                import_add_alpha;
   gchar                  *import_raw_plug_in;
+  gboolean                xcf_fast_compression;
 };
 
 struct _GimpCoreConfigClass
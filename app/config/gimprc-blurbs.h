@@ -198,6 +198,11 @@ _("Add an alpha channel to all layers of imported images.")
 #define IMPORT_RAW_PLUG_IN_BLURB \
 _("Which plug-in to use for importing raw digital camera files.")
 
+#define XCF_FAST_COMPRESSION_BLURB \
+_("When saving compressed XCF files, use the fast zstd codec instead of " \
+  "zlib.  Such files can only be opened by GIMP versions built with zstd " \
+  "support.")
+
 #define INITIAL_ZOOM_TO_FIT_BLURB \
 _("When enabled, this will ensure that the full image is visible after a " \
   "file is opened, otherwise it will be displayed with a scale of 1:1.")
@@ -624,6 +629,15 @@ _("Sets an upper limit to the memory that is used per image to keep " \
   "operations on the undo stack. Regardless of this setting, at least " \
   "as many undo-levels as configured can be undone.")
 
+#define UNDO_SWAP_BLURB \
+_("When enabled, operations on the undo stack that exceed the undo-size " \
+  "limit are moved to disk instead of being discarded.")
+
+#define UNDO_SWAP_SIZE_BLURB \
+_("Sets an upper limit to the disk space that is used per image to keep " \
+  "operations on the undo stack that exceed the undo-size limit. If this " \
+  "is zero, four times the undo-size limit is used.")
+
 #define UNDO_PREVIEW_SIZE_BLURB \
 _("Sets the size of the previews in the Undo History.")
 
@@ -81,6 +81,7 @@ gimp_convert_dither_type_get_type (void)
     { GIMP_CONVERT_DITHER_FS, "GIMP_CONVERT_DITHER_FS", "fs" },
     { GIMP_CONVERT_DITHER_FS_LOWBLEED, "GIMP_CONVERT_DITHER_FS_LOWBLEED", "fs-lowbleed" },
     { GIMP_CONVERT_DITHER_FIXED, "GIMP_CONVERT_DITHER_FIXED", "fixed" },
+    { GIMP_CONVERT_DITHER_FS_BANDED, "GIMP_CONVERT_DITHER_FS_BANDED", "fs-banded" },
     { 0, NULL, NULL }
   };
 
@@ -90,6 +91,7 @@ gimp_convert_dither_type_get_type (void)
     { GIMP_CONVERT_DITHER_FS, NC_("convert-dither-type", "Floyd-Steinberg (normal)"), NULL },
     { GIMP_CONVERT_DITHER_FS_LOWBLEED, NC_("convert-dither-type", "Floyd-Steinberg (reduced color bleeding)"), NULL },
     { GIMP_CONVERT_DITHER_FIXED, NC_("convert-dither-type", "Positioned"), NULL },
+    { GIMP_CONVERT_DITHER_FS_BANDED, NC_("convert-dither-type", "Floyd-Steinberg (in bands, faster)"), NULL },
     { 0, NULL, NULL }
   };
 
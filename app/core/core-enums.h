@@ -75,6 +75,7 @@ typedef enum
   GIMP_CONVERT_DITHER_FS,          /*< desc="Floyd-Steinberg (normal)"                 >*/
   GIMP_CONVERT_DITHER_FS_LOWBLEED, /*< desc="Floyd-Steinberg (reduced color bleeding)" >*/
   GIMP_CONVERT_DITHER_FIXED,       /*< desc="Positioned"                               >*/
+  GIMP_CONVERT_DITHER_FS_BANDED,   /*< desc="Floyd-Steinberg (in bands, faster)"       >*/
   GIMP_CONVERT_DITHER_NODESTRUCT   /*< pdb-skip, skip >*/
 } GimpConvertDitherType;
 
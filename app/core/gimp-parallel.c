@@ -0,0 +1,455 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+/*  the parallel-distribute machinery runs a function on the calling
+ *  thread plus a fixed pool of worker threads, and blocks until all
+ *  of them are done.  it is meant for splitting up a single, bounded
+ *  piece of work (a set of tiles, a range of rows, ...) and not for
+ *  running things in the background.
+ */
+
+
+typedef struct
+{
+  GimpParallelDistributeFunc func;
+  gint                       n;
+  gpointer                   user_data;
+
+  volatile gint              remaining;
+} GimpParallelDistributeTask;
+
+typedef struct
+{
+  GThread                    *thread;
+  GMutex                      mutex;
+  GCond                       cond;
+
+  gboolean                    quit;
+
+  GimpParallelDistributeTask *task;
+  gint                        i;
+} GimpParallelDistributeWorker;
+
+
+/*  local function prototypes  */
+
+static void       gimp_parallel_notify_num_processors   (GimpGeglConfig               *config);
+
+static void       gimp_parallel_set_n_threads           (gint                          n_threads);
+
+static gpointer   gimp_parallel_distribute_worker_func  (GimpParallelDistributeWorker *worker);
+
+static void       gimp_parallel_distribute_range_func   (gint                          i,
+                                                         gint                          n,
+                                                         gpointer                      user_data);
+static void       gimp_parallel_distribute_area_func    (gint                          i,
+                                                         gint                          n,
+                                                         gpointer                      user_data);
+
+
+/*  local variables  */
+
+static gint                          gimp_parallel_distribute_n_threads = 1;
+static GimpParallelDistributeWorker  gimp_parallel_distribute_workers[GIMP_PARALLEL_MAX_THREADS - 1];
+
+static GMutex                        gimp_parallel_distribute_mutex;
+static GMutex                        gimp_parallel_distribute_completion_mutex;
+static GCond                         gimp_parallel_distribute_completion_cond;
+
+static GPrivate                      gimp_parallel_distribute_busy;
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+
+  gimp_parallel_notify_num_processors (config);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  gimp_parallel_set_n_threads (1);
+}
+
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return gimp_parallel_distribute_n_threads;
+}
+
+/**
+ * gimp_parallel_distribute:
+ * @max_n:     the maximal number of sub-tasks, or -1 for no limit
+ * @func:      the function to call for each sub-task
+ * @user_data: user data passed to @func
+ *
+ * Calls @func with @i running from 0 to @n - 1 concurrently, where
+ * @n is the number of threads, clamped to @max_n.  One of the calls
+ * happens on the calling thread.  Returns once all calls returned.
+ *
+ * When called from within @func, or while another thread is already
+ * distributing work, all calls happen serially on the calling thread.
+ **/
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelDistributeTask task;
+  gint                       i;
+
+  g_return_if_fail (func != NULL);
+
+  if (max_n == 0)
+    return;
+
+  if (max_n < 0)
+    max_n = gimp_parallel_distribute_n_threads;
+  else
+    max_n = MIN (max_n, gimp_parallel_distribute_n_threads);
+
+  if (max_n == 1                                             ||
+      g_private_get (&gimp_parallel_distribute_busy)         ||
+      ! g_mutex_trylock (&gimp_parallel_distribute_mutex))
+    {
+      for (i = 0; i < max_n; i++)
+        func (i, max_n, user_data);
+
+      return;
+    }
+
+  g_private_set (&gimp_parallel_distribute_busy, GINT_TO_POINTER (TRUE));
+
+  /*  the thread count might have changed while we waited for the lock  */
+  max_n = MIN (max_n, gimp_parallel_distribute_n_threads);
+
+  task.func      = func;
+  task.n         = max_n;
+  task.user_data = user_data;
+  task.remaining = max_n - 1;
+
+  for (i = 0; i < max_n - 1; i++)
+    {
+      GimpParallelDistributeWorker *worker =
+        &gimp_parallel_distribute_workers[i];
+
+      g_mutex_lock (&worker->mutex);
+
+      worker->task = &task;
+      worker->i    = i;
+
+      g_cond_signal (&worker->cond);
+
+      g_mutex_unlock (&worker->mutex);
+    }
+
+  func (max_n - 1, max_n, user_data);
+
+  if (g_atomic_int_get (&task.remaining))
+    {
+      g_mutex_lock (&gimp_parallel_distribute_completion_mutex);
+
+      while (g_atomic_int_get (&task.remaining))
+        {
+          g_cond_wait (&gimp_parallel_distribute_completion_cond,
+                       &gimp_parallel_distribute_completion_mutex);
+        }
+
+      g_mutex_unlock (&gimp_parallel_distribute_completion_mutex);
+    }
+
+  g_private_set (&gimp_parallel_distribute_busy, NULL);
+
+  g_mutex_unlock (&gimp_parallel_distribute_mutex);
+}
+
+typedef struct
+{
+  gsize                           size;
+  GimpParallelDistributeRangeFunc func;
+  gpointer                        user_data;
+} GimpParallelDistributeRangeData;
+
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelDistributeRangeData data;
+  gint                            n;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  if (min_sub_size > 1)
+    n = MIN (size / min_sub_size, G_MAXINT);
+  else
+    n = MIN (size, G_MAXINT);
+
+  n = CLAMP (n, 1, gimp_parallel_distribute_n_threads);
+
+  if (n == 1)
+    {
+      func (0, size, user_data);
+
+      return;
+    }
+
+  data.size      = size;
+  data.func      = func;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_range_func, &data);
+}
+
+typedef struct
+{
+  const GeglRectangle            *area;
+  GimpParallelDistributeAreaFunc  func;
+  gpointer                        user_data;
+} GimpParallelDistributeAreaData;
+
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelDistributeAreaData data;
+  gsize                          n_pixels;
+  gint                           n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n_pixels = (gsize) area->width * (gsize) area->height;
+
+  if (min_sub_area > 1)
+    n = MIN (n_pixels / min_sub_area, G_MAXINT);
+  else
+    n = MIN (n_pixels, G_MAXINT);
+
+  n = CLAMP (n, 1, MAX (area->width, area->height));
+  n = MIN (n, gimp_parallel_distribute_n_threads);
+
+  if (n == 1)
+    {
+      func (area, user_data);
+
+      return;
+    }
+
+  data.area      = area;
+  data.func      = func;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n, gimp_parallel_distribute_area_func, &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  gint i;
+
+  n_threads = CLAMP (n_threads, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  g_mutex_lock (&gimp_parallel_distribute_mutex);
+
+  if (n_threads > gimp_parallel_distribute_n_threads) /* need more threads */
+    {
+      for (i = gimp_parallel_distribute_n_threads - 1; i < n_threads - 1; i++)
+        {
+          GimpParallelDistributeWorker *worker =
+            &gimp_parallel_distribute_workers[i];
+
+          g_mutex_init (&worker->mutex);
+          g_cond_init (&worker->cond);
+
+          worker->quit = FALSE;
+          worker->task = NULL;
+
+          worker->thread =
+            g_thread_new ("worker",
+                          (GThreadFunc) gimp_parallel_distribute_worker_func,
+                          worker);
+        }
+    }
+  else if (n_threads < gimp_parallel_distribute_n_threads) /* need less threads */
+    {
+      for (i = n_threads - 1; i < gimp_parallel_distribute_n_threads - 1; i++)
+        {
+          GimpParallelDistributeWorker *worker =
+            &gimp_parallel_distribute_workers[i];
+
+          g_mutex_lock (&worker->mutex);
+
+          worker->quit = TRUE;
+          g_cond_signal (&worker->cond);
+
+          g_mutex_unlock (&worker->mutex);
+        }
+
+      for (i = n_threads - 1; i < gimp_parallel_distribute_n_threads - 1; i++)
+        {
+          GimpParallelDistributeWorker *worker =
+            &gimp_parallel_distribute_workers[i];
+
+          g_thread_join (worker->thread);
+          worker->thread = NULL;
+
+          g_cond_clear (&worker->cond);
+          g_mutex_clear (&worker->mutex);
+        }
+    }
+
+  gimp_parallel_distribute_n_threads = n_threads;
+
+  g_mutex_unlock (&gimp_parallel_distribute_mutex);
+}
+
+static gpointer
+gimp_parallel_distribute_worker_func (GimpParallelDistributeWorker *worker)
+{
+  g_private_set (&gimp_parallel_distribute_busy, GINT_TO_POINTER (TRUE));
+
+  g_mutex_lock (&worker->mutex);
+
+  while (! worker->quit)
+    {
+      GimpParallelDistributeTask *task = worker->task;
+
+      if (task)
+        {
+          g_mutex_unlock (&worker->mutex);
+
+          task->func (worker->i, task->n, task->user_data);
+
+          g_mutex_lock (&worker->mutex);
+
+          worker->task = NULL;
+
+          if (g_atomic_int_dec_and_test (&task->remaining))
+            {
+              g_mutex_lock (&gimp_parallel_distribute_completion_mutex);
+
+              g_cond_signal (&gimp_parallel_distribute_completion_cond);
+
+              g_mutex_unlock (&gimp_parallel_distribute_completion_mutex);
+            }
+        }
+      else
+        {
+          g_cond_wait (&worker->cond, &worker->mutex);
+        }
+    }
+
+  g_mutex_unlock (&worker->mutex);
+
+  return NULL;
+}
+
+static void
+gimp_parallel_distribute_range_func (gint     i,
+                                     gint     n,
+                                     gpointer user_data)
+{
+  GimpParallelDistributeRangeData *data = user_data;
+  gsize                            offset;
+  gsize                            size;
+
+  offset = (2 * i       * data->size + n) / (2 * n);
+  size   = (2 * (i + 1) * data->size + n) / (2 * n) - offset;
+
+  data->func (offset, size, data->user_data);
+}
+
+static void
+gimp_parallel_distribute_area_func (gint     i,
+                                    gint     n,
+                                    gpointer user_data)
+{
+  GimpParallelDistributeAreaData *data = user_data;
+  GeglRectangle                   area;
+
+  area = *data->area;
+
+  /*  split along the longer side, so that each sub-area covers as
+   *  few tiles as possible
+   */
+  if (area.width > area.height)
+    {
+      area.x     += (2 * i       * data->area->width + n) / (2 * n);
+      area.width  = (2 * (i + 1) * data->area->width + n) / (2 * n) -
+                    (area.x - data->area->x);
+    }
+  else
+    {
+      area.y      += (2 * i       * data->area->height + n) / (2 * n);
+      area.height  = (2 * (i + 1) * data->area->height + n) / (2 * n) -
+                     (area.y - data->area->y);
+    }
+
+  data->func (&area, data->user_data);
+}
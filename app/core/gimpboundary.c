@@ -26,12 +26,19 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* minimum number of pixels per band of a parallel boundary search */
+#define MIN_PARALLEL_BAND_SIZE (256 * 256)
+
+/* number of rows per strip of a GimpBoundaryCache */
+#define CACHE_STRIP_HEIGHT 64
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -42,7 +49,9 @@ struct _GimpBoundary
   gint          num_segs;
   gint          max_segs;
 
-  /*  The array of vertical segments  */
+  /*  The array of vertical segments, NULL for a band of a parallel
+   *  search, which only collects the horizontal segments
+   */
   gint         *vert_segs;
 
   /*  The empty segment arrays */
@@ -52,10 +61,59 @@ struct _GimpBoundary
   gint          max_empty_segs;
 };
 
+typedef struct
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *region;
+  const Babl          *format;
+  GimpBoundaryType     type;
+  gint                 x1;
+  gint                 y1;
+  gint                 x2;
+  gint                 y2;
+  gfloat               threshold;
+  gint                 start;
+  gint                 end;
+
+  GimpBoundary        *bands[GIMP_PARALLEL_MAX_THREADS];
+} GenerateBoundaryData;
+
+typedef struct
+{
+  gboolean      valid;
+  GimpBoundSeg *segs;      /*  the strip's horizontal segments, in the  */
+  gint          num_segs;  /*  order a serial search finds them         */
+} GimpBoundaryStrip;
+
+struct _GimpBoundaryCache
+{
+  GeglBuffer        *buffer;
+  const Babl        *format;
+  GeglRectangle      region;
+  gint               x1;
+  gint               y1;
+  gint               x2;
+  gint               y2;
+  gfloat             threshold;
+
+  GimpBoundaryStrip *strips;
+  gint               n_strips;
+};
+
+typedef struct
+{
+  GimpBoundaryCache *cache;
+  gint               x1;      /*  the columns to search  */
+  gint               x2;
+  gint              *strips;
+  gint               n_strips;
+} GenerateStripsData;
+
 
 /*  local function prototypes  */
 
-static GimpBoundary * gimp_boundary_new        (const GeglRectangle *region);
+static GimpBoundary * gimp_boundary_new        (const GeglRectangle *region,
+                                                gboolean             vert_segs);
 static GimpBoundSeg * gimp_boundary_free       (GimpBoundary        *boundary,
                                                 gboolean             free_segs);
 
@@ -91,6 +149,26 @@ static void           make_horiz_segs          (GimpBoundary        *boundary,
                                                 gint                 empty[],
                                                 gint                 num_empty,
                                                 gint                 top);
+static void           generate_boundary_band   (GimpBoundary        *boundary,
+                                                GeglBuffer          *buffer,
+                                                const GeglRectangle *region,
+                                                const Babl          *format,
+                                                GimpBoundaryType     type,
+                                                gint                 x1,
+                                                gint                 y1,
+                                                gint                 x2,
+                                                gint                 y2,
+                                                gfloat               threshold,
+                                                gint                 start,
+                                                gint                 end,
+                                                gint                 band_start,
+                                                gint                 band_end);
+static void           generate_boundary_func   (gint                 i,
+                                                gint                 n,
+                                                gpointer             user_data);
+static void           generate_strips_func     (gint                 i,
+                                                gint                 n,
+                                                gpointer             user_data);
 static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
                                                 const GeglRectangle *region,
                                                 const Babl          *format,
@@ -245,7 +323,7 @@ gimp_boundary_sort (const GimpBoundSeg *segs,
   for (index = 0; index < num_segs; index++)
     ((GimpBoundSeg *) segs)[index].visited = FALSE;
 
-  boundary = gimp_boundary_new (NULL);
+  boundary = gimp_boundary_new (NULL, FALSE);
 
   for (index = 0; index < num_segs; index++)
     {
@@ -408,25 +486,253 @@ gimp_boundary_offset (GimpBoundSeg *segs,
     }
 }
 
+/**
+ * gimp_boundary_cache_new:
+ *
+ * Creates a cache for gimp_boundary_cache_find(), which remembers the
+ * segments of a mask in horizontal strips, so that only the strips
+ * that were invalidated by gimp_boundary_cache_invalidate() have to
+ * be searched again.
+ *
+ * Return value: the new cache.
+ **/
+GimpBoundaryCache *
+gimp_boundary_cache_new (void)
+{
+  return g_slice_new0 (GimpBoundaryCache);
+}
+
+void
+gimp_boundary_cache_free (GimpBoundaryCache *cache)
+{
+  g_return_if_fail (cache != NULL);
+
+  gimp_boundary_cache_invalidate (cache, NULL);
+
+  g_slice_free (GimpBoundaryCache, cache);
+}
+
+/**
+ * gimp_boundary_cache_invalidate:
+ * @cache: a #GimpBoundaryCache
+ * @area:  the area of the mask that changed, or %NULL
+ *
+ * Invalidates the strips of @cache whose segments depend on the
+ * pixels in @area, or all of @cache if @area is %NULL. The latter
+ * also drops the cache's reference on the mask's buffer.
+ **/
+void
+gimp_boundary_cache_invalidate (GimpBoundaryCache   *cache,
+                                const GeglRectangle *area)
+{
+  gint first, last;
+  gint i;
+
+  g_return_if_fail (cache != NULL);
+
+  if (! area)
+    {
+      for (i = 0; i < cache->n_strips; i++)
+        g_free (cache->strips[i].segs);
+
+      g_clear_pointer (&cache->strips, g_free);
+      cache->n_strips = 0;
+
+      g_clear_object (&cache->buffer);
+
+      return;
+    }
+
+  if (area->width <= 0 || area->height <= 0 || cache->n_strips == 0)
+    return;
+
+  /*  the segments of a row also depend on the rows above and below  */
+  first = area->y - 1;
+  last  = area->y + area->height;
+
+  if (last < cache->y1 || first >= cache->y2)
+    return;
+
+  first = (MAX (first, cache->y1)     - cache->y1) / CACHE_STRIP_HEIGHT;
+  last  = (MIN (last,  cache->y2 - 1) - cache->y1) / CACHE_STRIP_HEIGHT;
+
+  for (i = first; i <= last; i++)
+    {
+      g_clear_pointer (&cache->strips[i].segs, g_free);
+      cache->strips[i].num_segs = 0;
+      cache->strips[i].valid    = FALSE;
+    }
+}
+
+/**
+ * gimp_boundary_cache_find:
+ * @cache:     a #GimpBoundaryCache
+ * @buffer:    a #GeglBuffer
+ * @format:    a #Babl float format representing the component to analyze
+ * @x1:        left side of bounds
+ * @y1:        top side of bounds
+ * @x2:        right side of bounds
+ * @y2:        botton side of bounds
+ * @threshold: pixel value of boundary line
+ * @bounds:    the area outside of which no pixel is above @threshold
+ * @num_segs:  number of returned #GimpBoundSeg's
+ *
+ * Returns the same segments, in the same order, as
+ * gimp_boundary_find() with %GIMP_BOUNDARY_WITHIN_BOUNDS and no
+ * region would, reusing all strips of @cache which are still valid.
+ * Only the part of the strips intersecting @bounds is searched.
+ *
+ * When called with a different @buffer, @format, @x1, @y1, @x2, @y2
+ * or @threshold than before, or after @buffer changed its size, all
+ * of @cache is searched again.  A different @bounds keeps the strips
+ * valid.  Pixels that changed have to be passed to
+ * gimp_boundary_cache_invalidate().
+ *
+ * Return value: the boundary array.
+ **/
+GimpBoundSeg *
+gimp_boundary_cache_find (GimpBoundaryCache   *cache,
+                          GeglBuffer          *buffer,
+                          const Babl          *format,
+                          gint                 x1,
+                          gint                 y1,
+                          gint                 x2,
+                          gint                 y2,
+                          gfloat               threshold,
+                          const GeglRectangle *bounds,
+                          gint                *num_segs)
+{
+  GimpBoundary       *boundary;
+  GenerateStripsData  data;
+  gint                first, last;
+  gint                i;
+
+  g_return_val_if_fail (cache != NULL, NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (babl_format_get_bytes_per_pixel (format) ==
+                        sizeof (gfloat), NULL);
+  g_return_val_if_fail (x1 >= 0 && x2 <= gegl_buffer_get_width (buffer),
+                        NULL);
+  g_return_val_if_fail (bounds != NULL, NULL);
+  g_return_val_if_fail (num_segs != NULL, NULL);
+
+  if (buffer        != cache->buffer                      ||
+      format        != cache->format                      ||
+      x1            != cache->x1                          ||
+      y1            != cache->y1                          ||
+      x2            != cache->x2                          ||
+      y2            != cache->y2                          ||
+      threshold     != cache->threshold                   ||
+      cache->region.width  != gegl_buffer_get_width  (buffer) ||
+      cache->region.height != gegl_buffer_get_height (buffer))
+    {
+      gimp_boundary_cache_invalidate (cache, NULL);
+
+      cache->buffer        = g_object_ref (buffer);
+      cache->format        = format;
+      cache->region.x      = 0;
+      cache->region.y      = 0;
+      cache->region.width  = gegl_buffer_get_width  (buffer);
+      cache->region.height = gegl_buffer_get_height (buffer);
+      cache->x1            = x1;
+      cache->y1            = y1;
+      cache->x2            = x2;
+      cache->y2            = y2;
+      cache->threshold     = threshold;
+
+      if (y2 > y1)
+        {
+          cache->n_strips = (y2 - y1 + CACHE_STRIP_HEIGHT - 1) /
+                            CACHE_STRIP_HEIGHT;
+          cache->strips   = g_new0 (GimpBoundaryStrip, cache->n_strips);
+        }
+    }
+
+  /*  everything outside of the bounds is empty, so searching only
+   *  the bounds finds the same segments. a strip stays valid when the
+   *  bounds change, since the rows of an unchanged strip are still
+   *  empty outside of the columns it was searched in.
+   */
+  first = MAX (bounds->y, y1);
+  last  = MIN (bounds->y + bounds->height, y2) - 1;
+
+  data.x1 = MAX (bounds->x, x1);
+  data.x2 = MIN (bounds->x + bounds->width, x2);
+
+  if (data.x2 <= data.x1 || last < first)
+    {
+      *num_segs = 0;
+
+      return NULL;
+    }
+
+  first = (first - y1) / CACHE_STRIP_HEIGHT;
+  last  = (last  - y1) / CACHE_STRIP_HEIGHT;
+
+  data.cache    = cache;
+  data.strips   = g_new (gint, last - first + 1);
+  data.n_strips = 0;
+
+  for (i = first; i <= last; i++)
+    {
+      if (! cache->strips[i].valid)
+        data.strips[data.n_strips++] = i;
+    }
+
+  if (data.n_strips > 0)
+    gimp_parallel_distribute (data.n_strips, generate_strips_func, &data);
+
+  g_free (data.strips);
+
+  /*  join the strips top to bottom, just like the bands of a parallel
+   *  search
+   */
+  boundary = gimp_boundary_new (&cache->region, TRUE);
+
+  for (i = first; i <= last; i++)
+    {
+      const GimpBoundaryStrip *strip = &cache->strips[i];
+      gint                     j;
+
+      for (j = 0; j < strip->num_segs; j++)
+        {
+          const GimpBoundSeg *seg = &strip->segs[j];
+
+          process_horiz_seg (boundary,
+                             seg->x1, seg->y1, seg->x2, seg->y2,
+                             seg->open);
+        }
+    }
+
+  *num_segs = boundary->num_segs;
+
+  return gimp_boundary_free (boundary, FALSE);
+}
+
 
 /*  private functions  */
 
 static GimpBoundary *
-gimp_boundary_new (const GeglRectangle *region)
+gimp_boundary_new (const GeglRectangle *region,
+                   gboolean             vert_segs)
 {
   GimpBoundary *boundary = g_slice_new0 (GimpBoundary);
 
   if (region)
     {
-      gint i;
+      if (vert_segs)
+        {
+          gint i;
 
-      /*  array for determining the vertical line segments
-       *  which must be drawn
-       */
-      boundary->vert_segs = g_new (gint, region->width + region->x + 1);
+          /*  array for determining the vertical line segments
+           *  which must be drawn
+           */
+          boundary->vert_segs = g_new (gint, region->width + region->x + 1);
 
-      for (i = 0; i <= (region->width + region->x); i++)
-        boundary->vert_segs[i] = -1;
+          for (i = 0; i <= (region->width + region->x); i++)
+            boundary->vert_segs[i] = -1;
+        }
 
       /*  find the maximum possible number of empty segments
        *  given the current mask
@@ -612,6 +918,15 @@ process_horiz_seg (GimpBoundary *boundary,
   /*  This procedure accounts for any vertical segments that must be
       drawn to close in the horizontal segments.                     */
 
+  /*  a band of a parallel search doesn't know the vertical segments
+   *  left open above it, it's closed in when the bands are joined
+   */
+  if (! boundary->vert_segs)
+    {
+      gimp_boundary_add_seg (boundary, x1, y1, x2, y2, open);
+      return;
+    }
+
   if (boundary->vert_segs[x1] >= 0)
     {
       gimp_boundary_add_seg (boundary, x1, boundary->vert_segs[x1], x1, y1, !open);
@@ -663,69 +978,89 @@ make_horiz_segs (GimpBoundary *boundary,
     }
 }
 
-static GimpBoundary *
-generate_boundary (GeglBuffer          *buffer,
-                   const GeglRectangle *region,
-                   const Babl          *format,
-                   GimpBoundaryType     type,
-                   gint                 x1,
-                   gint                 y1,
-                   gint                 x2,
-                   gint                 y2,
-                   gfloat               threshold)
+/*  Scans the rows [band_start, band_end) of the rows [start, end) of
+ *  a boundary search, and adds the segments of these rows only. The
+ *  rows just outside the band are read as well, unless they are
+ *  outside the search too, because the segments of a row depend on
+ *  its neighbors.
+ */
+static void
+generate_boundary_band (GimpBoundary        *boundary,
+                        GeglBuffer          *buffer,
+                        const GeglRectangle *region,
+                        const Babl          *format,
+                        GimpBoundaryType     type,
+                        gint                 x1,
+                        gint                 y1,
+                        gint                 x2,
+                        gint                 y2,
+                        gfloat               threshold,
+                        gint                 start,
+                        gint                 end,
+                        gint                 band_start,
+                        gint                 band_end)
 {
-  GimpBoundary  *boundary;
   GeglRectangle  line_rect = { 0, };
+  gfloat        *line_buf;
   gfloat        *line_data;
   gint           scanline;
   gint           i;
-  gint           start, end;
   gint          *tmp_segs;
 
   gint          num_empty_n = 0;
   gint          num_empty_c = 0;
   gint          num_empty_l = 0;
 
-  boundary = gimp_boundary_new (region);
-
   line_rect.width  = gegl_buffer_get_width (buffer);
   line_rect.height = 1;
 
-  line_data = g_alloca (sizeof (gfloat) * line_rect.width);
+  /*  not g_alloca(), this might run on a worker thread's smaller stack  */
+  line_buf = line_data = g_new (gfloat, line_rect.width);
 
-  start = 0;
-  end   = 0;
+  /*  only the columns between x1 and x2 are looked at when searching
+   *  within bounds, don't read the rest of the scanlines
+   */
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS && x2 > x1)
+    {
+      line_rect.x     = x1;
+      line_rect.width = x2 - x1;
+    }
 
-  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+  /*  Find the empty segments for the previous and current scanlines  */
+  if (band_start > start)
     {
-      start = y1;
-      end   = y2;
+      line_rect.y = band_start - 1;
+      gegl_buffer_get (buffer, &line_rect, 1.0, format,
+                       line_buf + line_rect.x, GEGL_AUTO_ROWSTRIDE,
+                       GEGL_ABYSS_NONE);
+
+      find_empty_segs (region, line_data,
+                       band_start - 1, boundary->empty_segs_l,
+                       boundary->max_empty_segs, &num_empty_l,
+                       type, x1, y1, x2, y2,
+                       threshold);
     }
-  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+  else
     {
-      start = region->y;
-      end   = region->y + region->height;
+      find_empty_segs (region, NULL,
+                       band_start - 1, boundary->empty_segs_l,
+                       boundary->max_empty_segs, &num_empty_l,
+                       type, x1, y1, x2, y2,
+                       threshold);
     }
 
-  /*  Find the empty segments for the previous and current scanlines  */
-  find_empty_segs (region, NULL,
-                   start - 1, boundary->empty_segs_l,
-                   boundary->max_empty_segs, &num_empty_l,
-                   type, x1, y1, x2, y2,
-                   threshold);
-
-  line_rect.y = start;
+  line_rect.y = band_start;
   gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                   line_data, GEGL_AUTO_ROWSTRIDE,
+                   line_buf + line_rect.x, GEGL_AUTO_ROWSTRIDE,
                    GEGL_ABYSS_NONE);
 
   find_empty_segs (region, line_data,
-                   start, boundary->empty_segs_c,
+                   band_start, boundary->empty_segs_c,
                    boundary->max_empty_segs, &num_empty_c,
                    type, x1, y1, x2, y2,
                    threshold);
 
-  for (scanline = start; scanline < end; scanline++)
+  for (scanline = band_start; scanline < band_end; scanline++)
     {
       /*  find the empty segment list for the next scanline  */
       line_rect.y = scanline + 1;
@@ -733,7 +1068,7 @@ generate_boundary (GeglBuffer          *buffer,
         line_data = NULL;
       else
         gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                         line_data, GEGL_AUTO_ROWSTRIDE,
+                         line_buf + line_rect.x, GEGL_AUTO_ROWSTRIDE,
                          GEGL_ABYSS_NONE);
 
       find_empty_segs (region, line_data,
@@ -766,6 +1101,158 @@ generate_boundary (GeglBuffer          *buffer,
       boundary->empty_segs_n = tmp_segs;
     }
 
+  g_free (line_buf);
+}
+
+static void
+generate_boundary_func (gint     i,
+                        gint     n,
+                        gpointer user_data)
+{
+  GenerateBoundaryData *data = user_data;
+  GimpBoundary         *band;
+  gint                  start;
+  gint                  end;
+
+  start = data->start + (gint64) (data->end - data->start) * i       / n;
+  end   = data->start + (gint64) (data->end - data->start) * (i + 1) / n;
+
+  band = gimp_boundary_new (data->region, FALSE);
+
+  generate_boundary_band (band,
+                          data->buffer, data->region, data->format,
+                          data->type,
+                          data->x1, data->y1, data->x2, data->y2,
+                          data->threshold,
+                          data->start, data->end,
+                          start, end);
+
+  data->bands[i] = band;
+}
+
+static void
+generate_strips_func (gint     i,
+                      gint     n,
+                      gpointer user_data)
+{
+  GenerateStripsData *data  = user_data;
+  GimpBoundaryCache  *cache = data->cache;
+
+  for (; i < data->n_strips; i += n)
+    {
+      GimpBoundaryStrip *strip = &cache->strips[data->strips[i]];
+      GimpBoundary      *band;
+      gint               start;
+      gint               end;
+
+      start = cache->y1 + data->strips[i] * CACHE_STRIP_HEIGHT;
+      end   = MIN (start + CACHE_STRIP_HEIGHT, cache->y2);
+
+      band = gimp_boundary_new (&cache->region, FALSE);
+
+      generate_boundary_band (band,
+                              cache->buffer, &cache->region, cache->format,
+                              GIMP_BOUNDARY_WITHIN_BOUNDS,
+                              data->x1, cache->y1, data->x2, cache->y2,
+                              cache->threshold,
+                              cache->y1, cache->y2,
+                              start, end);
+
+      strip->num_segs = band->num_segs;
+      strip->segs     = gimp_boundary_free (band, FALSE);
+      strip->valid    = TRUE;
+    }
+}
+
+static GimpBoundary *
+generate_boundary (GeglBuffer          *buffer,
+                   const GeglRectangle *region,
+                   const Babl          *format,
+                   GimpBoundaryType     type,
+                   gint                 x1,
+                   gint                 y1,
+                   gint                 x2,
+                   gint                 y2,
+                   gfloat               threshold)
+{
+  GimpBoundary *boundary;
+  gint          start;
+  gint          end;
+  gint          max_n;
+
+  boundary = gimp_boundary_new (region, TRUE);
+
+  start = 0;
+  end   = 0;
+
+  if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+    {
+      start = y1;
+      end   = y2;
+    }
+  else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
+    {
+      start = region->y;
+      end   = region->y + region->height;
+    }
+
+  max_n = CLAMP ((gint64) MAX (end - start, 0) *
+                 gegl_buffer_get_width (buffer) /
+                 MIN_PARALLEL_BAND_SIZE,
+                 1, MIN (end - start, GIMP_PARALLEL_MAX_THREADS));
+
+  if (max_n > 1 && gimp_parallel_get_n_threads () > 1)
+    {
+      GenerateBoundaryData data = { 0, };
+      gint                 i;
+
+      data.buffer    = buffer;
+      data.region    = region;
+      data.format    = format;
+      data.type      = type;
+      data.x1        = x1;
+      data.y1        = y1;
+      data.x2        = x2;
+      data.y2        = y2;
+      data.threshold = threshold;
+      data.start     = start;
+      data.end       = end;
+
+      /*  scan horizontal bands on all threads, then join them top to
+       *  bottom, closing in their horizontal segments in the same order
+       *  a single scan would have, so the result is identical
+       */
+      gimp_parallel_distribute (max_n, generate_boundary_func, &data);
+
+      for (i = 0; i < GIMP_PARALLEL_MAX_THREADS; i++)
+        {
+          GimpBoundary *band = data.bands[i];
+          gint          j;
+
+          if (! band)
+            continue;
+
+          for (j = 0; j < band->num_segs; j++)
+            {
+              const GimpBoundSeg *seg = &band->segs[j];
+
+              process_horiz_seg (boundary,
+                                 seg->x1, seg->y1, seg->x2, seg->y2,
+                                 seg->open);
+            }
+
+          gimp_boundary_free (band, TRUE);
+        }
+    }
+  else
+    {
+      generate_boundary_band (boundary,
+                              buffer, region, format, type,
+                              x1, y1, x2, y2, threshold,
+                              start, end,
+                              start, end);
+    }
+
   return boundary;
 }
 
@@ -463,6 +463,7 @@ gimp_brush_load_abr_v12 (GDataInputStream  *input,
                          GError           **error)
 {
   GList *brush_list = NULL;
+  gint   n_skipped  = 0;
   gint   i;
 
   for (i = 0; i < abr_hdr->count; i++)
@@ -474,7 +475,7 @@ gimp_brush_load_abr_v12 (GDataInputStream  *input,
                                              file, &my_error);
 
       /*  a NULL brush without an error means an unsupported brush
-       *  type was encountered, silently skip it and try the next one
+       *  type was encountered, skip it and try the next one
        */
 
       if (brush)
@@ -486,6 +487,22 @@ gimp_brush_load_abr_v12 (GDataInputStream  *input,
           g_propagate_error (error, my_error);
           break;
         }
+      else
+        {
+          n_skipped++;
+        }
+    }
+
+  /*  this runs on the data factory's worker threads, report the
+   *  skipped brushes along with the loaded ones rather than printing
+   */
+  if (n_skipped > 0 && ! (error && *error))
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   ngettext ("Skipped %d brush of an unsupported type.",
+                             "Skipped %d brushes of an unsupported type.",
+                             n_skipped),
+                   n_skipped);
     }
 
   return brush_list;
@@ -571,7 +588,6 @@ gimp_brush_load_abr_brush_v12 (GDataInputStream  *input,
        * and get a useable brush back. It seems to support the same
        * types -akl
        */
-      g_printerr ("WARNING: computed brush unsupported, skipping.\n");
       g_seekable_seek (G_SEEKABLE (input), abr_brush_hdr.size,
                        G_SEEK_CUR, NULL, NULL);
       break;
@@ -719,7 +735,6 @@ gimp_brush_load_abr_brush_v12 (GDataInputStream  *input,
       break;
 
     default:
-      g_printerr ("WARNING: unknown brush type, skipping.\n");
       g_seekable_seek (G_SEEKABLE (input), abr_brush_hdr.size,
                        G_SEEK_CUR, NULL, NULL);
       break;
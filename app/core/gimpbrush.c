@@ -94,6 +94,8 @@ static gboolean      gimp_brush_real_want_null_motion (GimpBrush            *bru
 
 static gchar       * gimp_brush_get_checksum          (GimpTagged           *tagged);
 
+static gsize         gimp_brush_get_boundary_size     (const GimpBezierDesc *boundary);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpBrush, gimp_brush, GIMP_TYPE_DATA,
                          G_IMPLEMENT_INTERFACE (GIMP_TYPE_TAGGED,
@@ -413,13 +415,19 @@ static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
   brush->priv->mask_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          (GimpBrushCacheSizeFunc) gimp_temp_buf_get_memsize,
+                          'M', 'm');
 
   brush->priv->pixmap_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref,
+                          (GimpBrushCacheSizeFunc) gimp_temp_buf_get_memsize,
+                          'P', 'p');
 
   brush->priv->boundary_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
+    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free,
+                          (GimpBrushCacheSizeFunc) gimp_brush_get_boundary_size,
+                          'B', 'b');
 }
 
 static void
@@ -484,6 +492,12 @@ gimp_brush_get_checksum (GimpTagged *tagged)
   return checksum_string;
 }
 
+static gsize
+gimp_brush_get_boundary_size (const GimpBezierDesc *boundary)
+{
+  return sizeof (GimpBezierDesc) + boundary->num_data * sizeof (cairo_path_data_t);
+}
+
 /*  public functions  */
 
 GimpData *
@@ -682,7 +696,7 @@ gimp_brush_transform_mask (GimpBrush *brush,
       gimp_brush_cache_add (brush->priv->mask_cache,
                             (gpointer) mask,
                             op, width, height,
-                            scale, aspect_ratio, angle, effective_hardness);
+                            scale, aspect_ratio, angle, hardness);
     }
 
   return mask;
@@ -770,7 +784,7 @@ gimp_brush_transform_pixmap (GimpBrush *brush,
       gimp_brush_cache_add (brush->priv->pixmap_cache,
                             (gpointer) pixmap,
                             op, width, height,
-                            scale, aspect_ratio, angle, effective_hardness);
+                            scale, aspect_ratio, angle, hardness);
     }
 
   return pixmap;
@@ -22,6 +22,8 @@
 
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "core-types.h"
 
 #include "gimpbrushcache.h"
@@ -30,13 +32,27 @@
 #include "gimp-intl.h"
 
 
-#define MAX_CACHED_DATA 20
+/*  the memory budget of a cache, the least recently used data is
+ *  dropped when it is exceeded
+ */
+#define MAX_CACHED_SIZE (32 * 1024 * 1024)
+
+/*  the steps the transform parameters are quantized to, so that
+ *  slightly varying parameters, as produced by paint dynamics, hit
+ *  the cache.  the differences are far below what is visible in a
+ *  brush mask of the same pixel size.
+ */
+#define SCALE_STEPS        1024  /* per doubling of the scale */
+#define ASPECT_RATIO_STEPS 256   /* per unit, the range is -20..20 */
+#define ANGLE_STEPS        4096  /* per full turn */
+#define HARDNESS_STEPS     256   /* the range is 0..1 */
 
 
 enum
 {
   PROP_0,
-  PROP_DATA_DESTROY
+  PROP_DATA_DESTROY,
+  PROP_DATA_SIZE
 };
 
 
@@ -44,28 +60,47 @@ typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
 
 struct _GimpBrushCacheUnit
 {
-  gpointer  data;
-
+  /*  the key, see gimp_brush_cache_unit_init()  */
+  GeglNode *op;
   gint      width;
   gint      height;
-  gdouble   scale;
-  gdouble   aspect_ratio;
-  gdouble   angle;
-  gdouble   hardness;
-  GeglNode *op;
+  gint      scale;
+  gint      aspect_ratio;
+  gint      angle;
+  gint      hardness;
+
+  gpointer  data;
+  gsize     size;
+
+  GList     link;  /*  in the cache's LRU queue  */
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void     gimp_brush_cache_constructed  (GObject            *object);
+static void     gimp_brush_cache_finalize     (GObject            *object);
+static void     gimp_brush_cache_set_property (GObject            *object,
+                                               guint               property_id,
+                                               const GValue       *value,
+                                               GParamSpec         *pspec);
+static void     gimp_brush_cache_get_property (GObject            *object,
+                                               guint               property_id,
+                                               GValue             *value,
+                                               GParamSpec         *pspec);
+
+static void     gimp_brush_cache_unit_init    (GimpBrushCacheUnit *unit,
+                                               GeglNode           *op,
+                                               gint                width,
+                                               gint                height,
+                                               gdouble             scale,
+                                               gdouble             aspect_ratio,
+                                               gdouble             angle,
+                                               gdouble             hardness);
+static guint    gimp_brush_cache_unit_hash    (gconstpointer       key);
+static gboolean gimp_brush_cache_unit_equal   (gconstpointer       a,
+                                               gconstpointer       b);
+
+static void     gimp_brush_cache_remove_unit  (GimpBrushCache     *cache,
+                                               GimpBrushCacheUnit *unit);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -88,11 +123,22 @@ gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
                                                          NULL, NULL,
                                                          GIMP_PARAM_READWRITE |
                                                          G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DATA_SIZE,
+                                   g_param_spec_pointer ("data-size",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
-gimp_brush_cache_init (GimpBrushCache *brush)
+gimp_brush_cache_init (GimpBrushCache *cache)
 {
+  cache->units      = g_hash_table_new (gimp_brush_cache_unit_hash,
+                                        gimp_brush_cache_unit_equal);
+  cache->data_units = g_hash_table_new (NULL, NULL);
+
+  g_queue_init (&cache->lru);
 }
 
 static void
@@ -103,6 +149,7 @@ gimp_brush_cache_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
   g_assert (cache->data_destroy != NULL);
+  g_assert (cache->data_size != NULL);
 }
 
 static void
@@ -110,8 +157,16 @@ gimp_brush_cache_finalize (GObject *object)
 {
   GimpBrushCache *cache = GIMP_BRUSH_CACHE (object);
 
+  GIMP_LOG (BRUSH_CACHE,
+            "'%c' cache: %" G_GUINT64_FORMAT " hits, "
+            "%" G_GUINT64_FORMAT " misses",
+            cache->debug_hit, cache->n_hits, cache->n_misses);
+
   gimp_brush_cache_clear (cache);
 
+  g_hash_table_unref (cache->units);
+  g_hash_table_unref (cache->data_units);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -129,6 +184,10 @@ gimp_brush_cache_set_property (GObject      *object,
       cache->data_destroy = g_value_get_pointer (value);
       break;
 
+    case PROP_DATA_SIZE:
+      cache->data_size = g_value_get_pointer (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -149,6 +208,10 @@ gimp_brush_cache_get_property (GObject    *object,
       g_value_set_pointer (value, cache->data_destroy);
       break;
 
+    case PROP_DATA_SIZE:
+      g_value_set_pointer (value, cache->data_size);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -159,16 +222,19 @@ gimp_brush_cache_get_property (GObject    *object,
 /*  public functions  */
 
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
-                      gchar           debug_hit,
-                      gchar           debug_miss)
+gimp_brush_cache_new (GDestroyNotify          data_destroy,
+                      GimpBrushCacheSizeFunc  data_size,
+                      gchar                   debug_hit,
+                      gchar                   debug_miss)
 {
   GimpBrushCache *cache;
 
   g_return_val_if_fail (data_destroy != NULL, NULL);
+  g_return_val_if_fail (data_size != NULL, NULL);
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
                          "data-destroy", data_destroy,
+                         "data-size",    data_size,
                          NULL);
 
   cache->debug_hit  = debug_hit;
@@ -182,20 +248,8 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->cached_units)
-    {
-      GList *iter;
-
-      for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-        {
-          GimpBrushCacheUnit *unit = iter->data;
-
-          cache->data_destroy (unit->data);
-        }
-
-      g_list_free_full (cache->cached_units, g_free);
-      cache->cached_units = NULL;
-    }
+  while (! g_queue_is_empty (&cache->lru))
+    gimp_brush_cache_remove_unit (cache, cache->lru.head->data);
 }
 
 gconstpointer
@@ -208,37 +262,32 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
-  GList *iter;
+  GimpBrushCacheUnit  key;
+  GimpBrushCacheUnit *unit;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  gimp_brush_cache_unit_init (&key, op, width, height,
+                              scale, aspect_ratio, angle, hardness);
+
+  unit = g_hash_table_lookup (cache->units, &key);
+
+  if (unit)
     {
-      GimpBrushCacheUnit *unit = iter->data;
-
-      if (unit->data                         &&
-          unit->width        == width        &&
-          unit->height       == height       &&
-          unit->scale        == scale        &&
-          unit->aspect_ratio == aspect_ratio &&
-          unit->angle        == angle        &&
-          unit->hardness     == hardness     &&
-          unit->op           == op)
-        {
-          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-            g_printerr ("%c", cache->debug_hit);
-
-          /* Make the returned cached brush first in the list. */
-          cache->cached_units = g_list_remove_link (cache->cached_units, iter);
-          iter->next = cache->cached_units;
-          if (cache->cached_units)
-            cache->cached_units->prev = iter;
-          cache->cached_units = iter;
-
-          return (gconstpointer) unit->data;
-        }
+      cache->n_hits++;
+
+      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+        g_printerr ("%c", cache->debug_hit);
+
+      /* Make the returned cached brush the most recently used one. */
+      g_queue_unlink (&cache->lru, &unit->link);
+      g_queue_push_head_link (&cache->lru, &unit->link);
+
+      return (gconstpointer) unit->data;
     }
 
+  cache->n_misses++;
+
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
     g_printerr ("%c", cache->debug_miss);
 
@@ -256,44 +305,117 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
-  GList              *iter;
   GimpBrushCacheUnit *unit;
-  GList              *last   = NULL;
-  gint                length = 0;
+  GimpBrushCacheUnit *old;
 
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-    {
-      unit = iter->data;
+  /*  the same data may only be cached once, whatever its key, or it
+   *  would be destroyed twice
+   */
+  if (g_hash_table_contains (cache->data_units, data))
+    return;
 
-      if (data == unit->data)
-        return;
+  unit = g_slice_new0 (GimpBrushCacheUnit);
 
-      length++;
-      last = iter;
-    }
+  gimp_brush_cache_unit_init (unit, op, width, height,
+                              scale, aspect_ratio, angle, hardness);
 
-  if (length > MAX_CACHED_DATA)
-    {
-      unit = last->data;
+  /*  replace data cached under the same key
+   */
+  old = g_hash_table_lookup (cache->units, unit);
+
+  if (old)
+    gimp_brush_cache_remove_unit (cache, old);
 
-      cache->data_destroy (unit->data);
-      cache->cached_units = g_list_delete_link (cache->cached_units, last);
-      g_free (unit);
+  unit->data       = data;
+  unit->size       = cache->data_size (data);
+  unit->link.data  = unit;
+
+  g_hash_table_add (cache->units, unit);
+  g_hash_table_insert (cache->data_units, data, unit);
+  g_queue_push_head_link (&cache->lru, &unit->link);
+
+  cache->cached_size += unit->size;
+
+  /*  drop the least recently used data when over budget, but always
+   *  keep the data just added
+   */
+  while (cache->cached_size > MAX_CACHED_SIZE &&
+         cache->lru.tail != &unit->link)
+    {
+      gimp_brush_cache_remove_unit (cache, cache->lru.tail->data);
     }
+}
+
 
-  unit = g_new0 (GimpBrushCacheUnit, 1);
+/*  private functions  */
 
-  unit->data         = data;
+static void
+gimp_brush_cache_unit_init (GimpBrushCacheUnit *unit,
+                            GeglNode           *op,
+                            gint                width,
+                            gint                height,
+                            gdouble             scale,
+                            gdouble             aspect_ratio,
+                            gdouble             angle,
+                            gdouble             hardness)
+{
+  unit->op           = op;
   unit->width        = width;
   unit->height       = height;
-  unit->scale        = scale;
-  unit->aspect_ratio = aspect_ratio;
-  unit->angle        = angle;
-  unit->hardness     = hardness;
-  unit->op           = op;
+  unit->scale        = RINT (log (MAX (scale, 1e-6)) / G_LN2 * SCALE_STEPS);
+  unit->aspect_ratio = RINT (aspect_ratio * ASPECT_RATIO_STEPS);
+  unit->angle        = (gint) RINT ((angle - floor (angle)) * ANGLE_STEPS) %
+                       ANGLE_STEPS;
+  unit->hardness     = RINT (hardness * HARDNESS_STEPS);
+}
+
+static guint
+gimp_brush_cache_unit_hash (gconstpointer key)
+{
+  const GimpBrushCacheUnit *unit = key;
+  guint                     hash;
+
+  hash = g_direct_hash (unit->op);
+  hash = hash * 31 + unit->width;
+  hash = hash * 31 + unit->height;
+  hash = hash * 31 + unit->scale;
+  hash = hash * 31 + unit->aspect_ratio;
+  hash = hash * 31 + unit->angle;
+  hash = hash * 31 + unit->hardness;
+
+  return hash;
+}
+
+static gboolean
+gimp_brush_cache_unit_equal (gconstpointer a,
+                             gconstpointer b)
+{
+  const GimpBrushCacheUnit *unit_a = a;
+  const GimpBrushCacheUnit *unit_b = b;
+
+  return (unit_a->op           == unit_b->op           &&
+          unit_a->width        == unit_b->width        &&
+          unit_a->height       == unit_b->height       &&
+          unit_a->scale        == unit_b->scale        &&
+          unit_a->aspect_ratio == unit_b->aspect_ratio &&
+          unit_a->angle        == unit_b->angle        &&
+          unit_a->hardness     == unit_b->hardness);
+}
+
+static void
+gimp_brush_cache_remove_unit (GimpBrushCache     *cache,
+                              GimpBrushCacheUnit *unit)
+{
+  g_hash_table_remove (cache->units, unit);
+  g_hash_table_remove (cache->data_units, unit->data);
+  g_queue_unlink (&cache->lru, &unit->link);
+
+  cache->cached_size -= unit->size;
+
+  cache->data_destroy (unit->data);
 
-  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  g_slice_free (GimpBrushCacheUnit, unit);
 }
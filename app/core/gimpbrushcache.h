@@ -35,16 +35,25 @@
 
 typedef struct _GimpBrushCacheClass GimpBrushCacheClass;
 
+typedef gsize (* GimpBrushCacheSizeFunc) (gconstpointer data);
+
 struct _GimpBrushCache
 {
-  GimpObject      parent_instance;
+  GimpObject              parent_instance;
+
+  GDestroyNotify          data_destroy;
+  GimpBrushCacheSizeFunc  data_size;
 
-  GDestroyNotify  data_destroy;
+  GHashTable             *units;       /*  key   -> unit  */
+  GHashTable             *data_units;  /*  data  -> unit  */
+  GQueue                  lru;
+  gsize                   cached_size;
 
-  GList          *cached_units;
+  guint64                 n_hits;
+  guint64                 n_misses;
 
-  gchar           debug_hit;
-  gchar           debug_miss;
+  gchar                   debug_hit;
+  gchar                   debug_miss;
 };
 
 struct _GimpBrushCacheClass
@@ -55,9 +64,10 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void) G_GNUC_CONST;
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
-                                            gchar           debug_hit,
-                                            gchar           debug_miss);
+GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify          data_destroy,
+                                            GimpBrushCacheSizeFunc  data_size,
+                                            gchar                   debug_hit,
+                                            gchar                   debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
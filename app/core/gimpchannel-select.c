@@ -521,7 +521,8 @@ gimp_channel_select_fuzzy (GimpChannel         *channel,
                                                     select_transparent,
                                                     select_criterion,
                                                     diagonal_neighbors,
-                                                    x, y);
+                                                    x, y,
+                                                    NULL);
 
   if (! sample_merged)
     gimp_item_get_offset (GIMP_ITEM (drawable), &add_on_x, &add_on_y);
@@ -569,7 +570,8 @@ gimp_channel_select_by_color (GimpChannel         *channel,
                                                      threshold,
                                                      select_transparent,
                                                      select_criterion,
-                                                     color);
+                                                     color,
+                                                     NULL);
 
   if (! sample_merged)
     gimp_item_get_offset (GIMP_ITEM (drawable), &add_on_x, &add_on_y);
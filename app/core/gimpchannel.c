@@ -151,6 +151,11 @@ static void       gimp_channel_convert_type  (GimpDrawable      *drawable,
                                               GeglDitherMethod   mask_dither_type,
                                               gboolean           push_undo,
                                               GimpProgress      *progress);
+static void gimp_channel_update                (GimpDrawable       *drawable,
+                                                gint                x,
+                                                gint                y,
+                                                gint                width,
+                                                gint                height);
 static void gimp_channel_invalidate_boundary   (GimpDrawable       *drawable);
 static void gimp_channel_get_active_components (GimpDrawable       *drawable,
                                                 gboolean           *active);
@@ -307,6 +312,7 @@ gimp_channel_class_init (GimpChannelClass *klass)
   item_class->raise_failed         = _("Channel cannot be raised higher.");
   item_class->lower_failed         = _("Channel cannot be lowered more.");
 
+  drawable_class->update                = gimp_channel_update;
   drawable_class->convert_type          = gimp_channel_convert_type;
   drawable_class->invalidate_boundary   = gimp_channel_invalidate_boundary;
   drawable_class->get_active_components = gimp_channel_get_active_components;
@@ -352,6 +358,7 @@ gimp_channel_init (GimpChannel *channel)
   channel->segs_out       = NULL;
   channel->num_segs_in    = 0;
   channel->num_segs_out   = 0;
+  channel->boundary_cache = NULL;
   channel->empty          = FALSE;
   channel->bounds_known   = FALSE;
   channel->x1             = 0;
@@ -383,6 +390,12 @@ gimp_channel_finalize (GObject *object)
       channel->segs_out = NULL;
     }
 
+  if (channel->boundary_cache)
+    {
+      gimp_boundary_cache_free (channel->boundary_cache);
+      channel->boundary_cache = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -987,6 +1000,22 @@ gimp_channel_convert_type (GimpDrawable     *drawable,
   g_object_unref (dest_buffer);
 }
 
+static void
+gimp_channel_update (GimpDrawable *drawable,
+                     gint          x,
+                     gint          y,
+                     gint          width,
+                     gint          height)
+{
+  GimpChannel *channel = GIMP_CHANNEL (drawable);
+
+  if (channel->boundary_cache)
+    gimp_boundary_cache_invalidate (channel->boundary_cache,
+                                    GEGL_RECTANGLE (x, y, width, height));
+
+  GIMP_DRAWABLE_CLASS (parent_class)->update (drawable, x, y, width, height);
+}
+
 static void
 gimp_channel_invalidate_boundary (GimpDrawable *drawable)
 {
@@ -1080,6 +1109,9 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
 
   channel->bounds_known = FALSE;
 
+  if (channel->boundary_cache)
+    gimp_boundary_cache_invalidate (channel->boundary_cache, NULL);
+
   if (gimp_filter_peek_node (GIMP_FILTER (channel)))
     {
       const Babl *color_format;
@@ -1170,19 +1202,33 @@ gimp_channel_real_boundary (GimpChannel         *channel,
                                                   x1, y1, x2, y2,
                                                   GIMP_BOUNDARY_HALF_WAY,
                                                   &channel->num_segs_out);
-          x1 = MAX (x1, x3);
-          y1 = MAX (y1, y3);
-          x2 = MIN (x2, x4);
-          y2 = MIN (y2, y4);
 
-          if (x2 > x1 && y2 > y1)
+          if (MAX (x1, x3) < MIN (x2, x4) &&
+              MAX (y1, y3) < MIN (y2, y4))
             {
-              channel->segs_in = gimp_boundary_find (buffer, NULL,
-                                                     babl_format ("Y float"),
-                                                     GIMP_BOUNDARY_WITHIN_BOUNDS,
-                                                     x1, y1, x2, y2,
-                                                     GIMP_BOUNDARY_HALF_WAY,
-                                                     &channel->num_segs_in);
+              gint width  = gimp_item_get_width  (GIMP_ITEM (channel));
+              gint height = gimp_item_get_height (GIMP_ITEM (channel));
+
+              if (! channel->boundary_cache)
+                channel->boundary_cache = gimp_boundary_cache_new ();
+
+              /*  search the requested area rather than the mask's
+               *  bounds, which change with every edit, so the strips
+               *  outside of the edit stay valid. everything outside
+               *  of the bounds is unselected, so the segments are the
+               *  same.
+               */
+              channel->segs_in =
+                gimp_boundary_cache_find (channel->boundary_cache,
+                                          buffer,
+                                          babl_format ("Y float"),
+                                          CLAMP (x1, 0, width),
+                                          CLAMP (y1, 0, height),
+                                          CLAMP (x2, 0, width),
+                                          CLAMP (y2, 0, height),
+                                          GIMP_BOUNDARY_HALF_WAY,
+                                          &rect,
+                                          &channel->num_segs_in);
             }
           else
             {
@@ -53,6 +53,8 @@ struct _GimpChannel
   gboolean      bounds_known;      /*  recalculate the bounds?        */
   gint          x1, y1;            /*  coordinates for bounding box   */
   gint          x2, y2;            /*  lower right hand coordinate    */
+
+  GimpBoundaryCache *boundary_cache; /*  segs_in of the unchanged rows  */
 };
 
 struct _GimpChannelClass
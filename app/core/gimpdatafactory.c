@@ -33,6 +33,7 @@
 #include "core-types.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
 #include "gimpcontext.h"
 #include "gimpdata.h"
@@ -53,6 +54,27 @@ typedef void (* GimpDataForeachFunc) (GimpDataFactory *factory,
                                       gpointer         user_data);
 
 
+/*  a data file found on the data path, waiting to be loaded  */
+typedef struct
+{
+  const GimpDataFactoryLoaderEntry *loader;
+  GFile                            *file;
+  GFile                            *top_directory;
+  guint64                           mtime;
+  gboolean                          dir_writable;
+
+  GList                            *data_list;
+  GError                           *error;
+} GimpDataFactoryLoad;
+
+typedef struct
+{
+  GimpContext *context;
+  GArray      *loads;
+  gint         next;
+} GimpDataFactoryLoadBatch;
+
+
 struct _GimpDataFactoryPriv
 {
   Gimp                             *gimp;
@@ -89,18 +111,25 @@ static GFile * gimp_data_factory_get_save_dir   (GimpDataFactory     *factory,
                                                  GError             **error);
 
 static void    gimp_data_factory_load_directory (GimpDataFactory     *factory,
-                                                 GimpContext         *context,
                                                  GHashTable          *cache,
+                                                 GArray              *loads,
                                                  gboolean             dir_writable,
                                                  GFile               *directory,
                                                  GFile               *top_directory);
-static void    gimp_data_factory_load_data      (GimpDataFactory     *factory,
-                                                 GimpContext         *context,
+static void    gimp_data_factory_find_data      (GimpDataFactory     *factory,
                                                  GHashTable          *cache,
+                                                 GArray              *loads,
                                                  gboolean             dir_writable,
                                                  GFile               *file,
                                                  GFileInfo           *info,
                                                  GFile               *top_directory);
+static void    gimp_data_factory_load_func      (gint                 i,
+                                                 gint                 n,
+                                                 gpointer             user_data);
+static void    gimp_data_factory_load_data      (GimpContext         *context,
+                                                 GimpDataFactoryLoad *load);
+static void    gimp_data_factory_add_data       (GimpDataFactory     *factory,
+                                                 GimpDataFactoryLoad *load);
 
 
 G_DEFINE_TYPE (GimpDataFactory, gimp_data_factory, GIMP_TYPE_OBJECT)
@@ -323,11 +352,14 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
                              GimpContext     *context,
                              GHashTable      *cache)
 {
-  gchar *p;
-  gchar *wp;
-  GList *path;
-  GList *writable_path;
-  GList *list;
+  GimpDataFactoryLoadBatch  batch;
+  GArray                   *loads;
+  gchar                    *p;
+  gchar                    *wp;
+  GList                    *path;
+  GList                    *writable_path;
+  GList                    *list;
+  guint                     i;
 
   g_object_get (factory->priv->gimp->config,
                 factory->priv->path_property_name,     &p,
@@ -340,6 +372,8 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
   g_free (p);
   g_free (wp);
 
+  loads = g_array_new (FALSE, TRUE, sizeof (GimpDataFactoryLoad));
+
   for (list = path; list; list = g_list_next (list))
     {
       gboolean dir_writable = FALSE;
@@ -348,7 +382,7 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
                               (GCompareFunc) gimp_file_compare))
         dir_writable = TRUE;
 
-      gimp_data_factory_load_directory (factory, context, cache,
+      gimp_data_factory_load_directory (factory, cache, loads,
                                         dir_writable,
                                         list->data,
                                         list->data);
@@ -356,6 +390,31 @@ gimp_data_factory_data_load (GimpDataFactory *factory,
 
   g_list_free_full (path,          (GDestroyNotify) g_object_unref);
   g_list_free_full (writable_path, (GDestroyNotify) g_object_unref);
+
+  /*  parse the files whose loaders allow it on all threads, then add
+   *  the results in the order the files were found
+   */
+  batch.context = context;
+  batch.loads   = loads;
+  batch.next    = 0;
+
+  gimp_parallel_distribute (-1, gimp_data_factory_load_func, &batch);
+
+  for (i = 0; i < loads->len; i++)
+    {
+      GimpDataFactoryLoad *load = &g_array_index (loads,
+                                                  GimpDataFactoryLoad, i);
+
+      if (! load->loader->threadsafe)
+        gimp_data_factory_load_data (context, load);
+
+      gimp_data_factory_add_data (factory, load);
+
+      g_object_unref (load->file);
+      g_object_unref (load->top_directory);
+    }
+
+  g_array_free (loads, TRUE);
 }
 
 void
@@ -779,8 +838,8 @@ gimp_data_factory_get_save_dir (GimpDataFactory  *factory,
 
 static void
 gimp_data_factory_load_directory (GimpDataFactory *factory,
-                                  GimpContext     *context,
                                   GHashTable      *cache,
+                                  GArray          *loads,
                                   gboolean         dir_writable,
                                   GFile           *directory,
                                   GFile           *top_directory)
@@ -815,14 +874,14 @@ gimp_data_factory_load_directory (GimpDataFactory *factory,
 
           if (file_type == G_FILE_TYPE_DIRECTORY)
             {
-              gimp_data_factory_load_directory (factory, context, cache,
+              gimp_data_factory_load_directory (factory, cache, loads,
                                                 dir_writable,
                                                 child,
                                                 top_directory);
             }
           else if (file_type == G_FILE_TYPE_REGULAR)
             {
-              gimp_data_factory_load_data (factory, context, cache,
+              gimp_data_factory_find_data (factory, cache, loads,
                                            dir_writable,
                                            child, info,
                                            top_directory);
@@ -837,20 +896,18 @@ gimp_data_factory_load_directory (GimpDataFactory *factory,
 }
 
 static void
-gimp_data_factory_load_data (GimpDataFactory *factory,
-                             GimpContext     *context,
+gimp_data_factory_find_data (GimpDataFactory *factory,
                              GHashTable      *cache,
+                             GArray          *loads,
                              gboolean         dir_writable,
                              GFile           *file,
                              GFileInfo       *info,
                              GFile           *top_directory)
 {
-  const GimpDataFactoryLoaderEntry *loader    = NULL;
-  GList                            *data_list = NULL;
-  GInputStream                     *input;
+  const GimpDataFactoryLoaderEntry *loader = NULL;
+  GimpDataFactoryLoad               load   = { 0, };
   guint64                           mtime;
   gint                              i;
-  GError                           *error = NULL;
 
   for (i = 0; i < factory->priv->n_loader_entries; i++)
     {
@@ -890,23 +947,63 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
         }
     }
 
-  input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+  load.loader        = loader;
+  load.file          = g_object_ref (file);
+  load.top_directory = g_object_ref (top_directory);
+  load.mtime         = mtime;
+  load.dir_writable  = dir_writable;
+
+  g_array_append_val (loads, load);
+}
+
+static void
+gimp_data_factory_load_func (gint     i,
+                             gint     n,
+                             gpointer user_data)
+{
+  GimpDataFactoryLoadBatch *batch = user_data;
+  gint                      index;
+
+  while ((index = g_atomic_int_add (&batch->next, 1)) <
+         (gint) batch->loads->len)
+    {
+      GimpDataFactoryLoad *load = &g_array_index (batch->loads,
+                                                  GimpDataFactoryLoad, index);
+
+      if (load->loader->threadsafe)
+        gimp_data_factory_load_data (batch->context, load);
+    }
+}
+
+/*  runs the loader on load->file, and stores the loaded data and the
+ *  error in load.  this is called from several threads at once for
+ *  threadsafe loaders, so it must not touch the factory.
+ */
+static void
+gimp_data_factory_load_data (GimpContext         *context,
+                             GimpDataFactoryLoad *load)
+{
+  GInputStream *input;
+  GError       *error = NULL;
+
+  input = G_INPUT_STREAM (g_file_read (load->file, NULL, &error));
 
   if (input)
     {
-      data_list = loader->load_func (context, file, input, &error);
+      load->data_list = load->loader->load_func (context, load->file, input,
+                                                 &error);
 
       if (error)
         {
           g_prefix_error (&error,
                           _("Error loading '%s': "),
-                          gimp_file_get_utf8_name (file));
+                          gimp_file_get_utf8_name (load->file));
         }
-      else if (! data_list)
+      else if (! load->data_list)
         {
           g_set_error (&error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
                        _("Error loading '%s'"),
-                       gimp_file_get_utf8_name (file));
+                       gimp_file_get_utf8_name (load->file));
         }
 
       g_object_unref (input);
@@ -915,10 +1012,17 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
     {
       g_prefix_error (&error,
                       _("Could not open '%s' for reading: "),
-                      gimp_file_get_utf8_name (file));
+                      gimp_file_get_utf8_name (load->file));
     }
 
-  if (G_LIKELY (data_list))
+  load->error = error;
+}
+
+static void
+gimp_data_factory_add_data (GimpDataFactory     *factory,
+                            GimpDataFactoryLoad *load)
+{
+  if (G_LIKELY (load->data_list))
     {
       GList    *list;
       gchar    *uri;
@@ -926,7 +1030,7 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
       gboolean  writable  = FALSE;
       gboolean  deletable = FALSE;
 
-      uri = g_file_get_uri (file);
+      uri = g_file_get_uri (load->file);
 
       obsolete = (strstr (uri, GIMP_OBSOLETE_DATA_DIR_NAME) != 0);
 
@@ -935,16 +1039,17 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
       /* obsolete files are immutable, don't check their writability */
       if (! obsolete)
         {
-          deletable = (g_list_length (data_list) == 1 && dir_writable);
-          writable  = (deletable && loader->writable);
+          deletable = (g_list_length (load->data_list) == 1 &&
+                       load->dir_writable);
+          writable  = (deletable && load->loader->writable);
         }
 
-      for (list = data_list; list; list = g_list_next (list))
+      for (list = load->data_list; list; list = g_list_next (list))
         {
           GimpData *data = list->data;
 
-          gimp_data_set_file (data, file, writable, deletable);
-          gimp_data_set_mtime (data, mtime);
+          gimp_data_set_file (data, load->file, writable, deletable);
+          gimp_data_set_mtime (data, load->mtime);
           gimp_data_clean (data);
 
           if (obsolete)
@@ -954,7 +1059,7 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
             }
           else
             {
-              gimp_data_set_folder_tags (data, top_directory);
+              gimp_data_set_folder_tags (data, load->top_directory);
 
               gimp_container_add (factory->priv->container,
                                   GIMP_OBJECT (data));
@@ -963,17 +1068,18 @@ gimp_data_factory_load_data (GimpDataFactory *factory,
           g_object_unref (data);
         }
 
-      g_list_free (data_list);
+      g_list_free (load->data_list);
+      load->data_list = NULL;
     }
 
   /*  not else { ... } because loader->load_func() can return a list
    *  of data objects *and* an error message if loading failed after
    *  something was already loaded
    */
-  if (G_UNLIKELY (error))
+  if (G_UNLIKELY (load->error))
     {
       gimp_message (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
-                    _("Failed to load data:\n\n%s"), error->message);
-      g_clear_error (&error);
+                    _("Failed to load data:\n\n%s"), load->error->message);
+      g_clear_error (&load->error);
     }
 }
@@ -95,7 +95,8 @@ gimp_drawable_bucket_fill (GimpDrawable         *drawable,
                                                          fill_criterion,
                                                          diagonal_neighbors,
                                                          (gint) seed_x,
-                                                         (gint) seed_y);
+                                                         (gint) seed_y,
+                                                         NULL);
 
   gimp_gegl_mask_bounds (mask_buffer, &x, &y, &width, &height);
   width  -= x;
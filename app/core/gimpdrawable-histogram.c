@@ -28,13 +28,48 @@
 #include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimptilehandlervalidate.h"
 
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpdrawable-filters.h"
 #include "gimpdrawable-histogram.h"
+#include "gimpdrawable-private.h"
 #include "gimphistogram.h"
 #include "gimpimage.h"
 
 
+/*  the histogram of a whole drawable is merged from the histograms of
+ *  square, tile-aligned chunks, which are kept around until the
+ *  drawable is updated within them.  this way, recalculating the
+ *  histogram after a paint stroke only needs to look at the chunks
+ *  touched by the stroke.
+ */
+#define CHUNK_SIZE 256
+
+#define CHUNK_KEY(cx, cy) GINT_TO_POINTER (((cy) << 16) | (cx))
+
+
+typedef struct
+{
+  GeglBuffer     *buffer;
+  gboolean        linear;
+
+  GeglRectangle  *rects;
+  GimpHistogram **histograms;
+  gint            n_chunks;
+} CalculateChunksData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_drawable_calculate_histogram_cached (GimpDrawable  *drawable,
+                                                        GimpHistogram *histogram);
+static void   gimp_drawable_calculate_chunks_func      (gint           i,
+                                                        gint           n,
+                                                        gpointer       user_data);
+
+
+/*  public functions  */
+
 void
 gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
                                    GimpHistogram *histogram,
@@ -108,6 +143,15 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
       g_object_unref (processor);
       g_object_unref (node);
     }
+  else if (gimp_channel_is_empty (mask)                             &&
+           ! (with_filters && gimp_drawable_has_filters (drawable)) &&
+           x      == 0                                             &&
+           y      == 0                                             &&
+           width  == gimp_item_get_width  (GIMP_ITEM (drawable))   &&
+           height == gimp_item_get_height (GIMP_ITEM (drawable)))
+    {
+      gimp_drawable_calculate_histogram_cached (drawable, histogram);
+    }
   else
     {
       GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
@@ -169,3 +213,152 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
       g_object_unref (buffer);
     }
 }
+
+void
+gimp_drawable_invalidate_histogram (GimpDrawable *drawable,
+                                    gint          x,
+                                    gint          y,
+                                    gint          width,
+                                    gint          height)
+{
+  GimpDrawablePrivate *private;
+  const GeglRectangle *extent;
+  GeglRectangle        rect;
+  gint                 cx1, cy1;
+  gint                 cx2, cy2;
+  gint                 cx, cy;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  private = drawable->private;
+  extent  = &private->histogram_extent;
+
+  if (! private->histogram_chunks ||
+      ! g_hash_table_size (private->histogram_chunks))
+    return;
+
+  if (! gegl_rectangle_intersect (&rect,
+                                  GEGL_RECTANGLE (x, y, width, height),
+                                  extent))
+    return;
+
+  cx1 = (rect.x - extent->x)                  / CHUNK_SIZE;
+  cy1 = (rect.y - extent->y)                  / CHUNK_SIZE;
+  cx2 = (rect.x - extent->x + rect.width  - 1) / CHUNK_SIZE;
+  cy2 = (rect.y - extent->y + rect.height - 1) / CHUNK_SIZE;
+
+  for (cy = cy1; cy <= cy2; cy++)
+    {
+      for (cx = cx1; cx <= cx2; cx++)
+        g_hash_table_remove (private->histogram_chunks, CHUNK_KEY (cx, cy));
+    }
+}
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_calculate_histogram_cached (GimpDrawable  *drawable,
+                                          GimpHistogram *histogram)
+{
+  GimpDrawablePrivate *private = drawable->private;
+  GeglBuffer          *buffer  = gimp_drawable_get_buffer (drawable);
+  const GeglRectangle *extent  = gegl_buffer_get_extent (buffer);
+  const Babl          *format  = gegl_buffer_get_format (buffer);
+  gboolean             linear  = gimp_histogram_get_linear (histogram);
+  CalculateChunksData  data;
+  GHashTableIter       iter;
+  gpointer             chunk;
+  gint                 n_cols;
+  gint                 n_rows;
+  gint                 cx, cy;
+  gint                 i;
+
+  if (! private->histogram_chunks)
+    {
+      private->histogram_chunks =
+        g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                               NULL, g_object_unref);
+    }
+  else if (format != private->histogram_format ||
+           linear != private->histogram_linear ||
+           ! gegl_rectangle_equal (extent, &private->histogram_extent))
+    {
+      g_hash_table_remove_all (private->histogram_chunks);
+    }
+
+  private->histogram_format = format;
+  private->histogram_linear = linear;
+  private->histogram_extent = *extent;
+
+  n_cols = (extent->width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  n_rows = (extent->height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  data.buffer     = buffer;
+  data.linear     = linear;
+  data.rects      = g_new  (GeglRectangle,   n_cols * n_rows);
+  data.histograms = g_new0 (GimpHistogram *, n_cols * n_rows);
+  data.n_chunks   = 0;
+
+  for (cy = 0; cy < n_rows; cy++)
+    {
+      for (cx = 0; cx < n_cols; cx++)
+        {
+          if (g_hash_table_lookup (private->histogram_chunks,
+                                   CHUNK_KEY (cx, cy)))
+            continue;
+
+          gegl_rectangle_intersect (&data.rects[data.n_chunks],
+                                    GEGL_RECTANGLE (extent->x + cx * CHUNK_SIZE,
+                                                    extent->y + cy * CHUNK_SIZE,
+                                                    CHUNK_SIZE, CHUNK_SIZE),
+                                    extent);
+
+          data.n_chunks++;
+        }
+    }
+
+  gimp_parallel_distribute (data.n_chunks,
+                            gimp_drawable_calculate_chunks_func,
+                            &data);
+
+  for (i = 0; i < data.n_chunks; i++)
+    {
+      cx = (data.rects[i].x - extent->x) / CHUNK_SIZE;
+      cy = (data.rects[i].y - extent->y) / CHUNK_SIZE;
+
+      g_hash_table_insert (private->histogram_chunks,
+                           CHUNK_KEY (cx, cy), data.histograms[i]);
+    }
+
+  g_free (data.rects);
+  g_free (data.histograms);
+
+  g_object_freeze_notify (G_OBJECT (histogram));
+
+  gimp_histogram_clear_values (histogram);
+
+  g_hash_table_iter_init (&iter, private->histogram_chunks);
+
+  while (g_hash_table_iter_next (&iter, NULL, &chunk))
+    gimp_histogram_merge (histogram, chunk);
+
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
+
+static void
+gimp_drawable_calculate_chunks_func (gint     i,
+                                     gint     n,
+                                     gpointer user_data)
+{
+  CalculateChunksData *data = user_data;
+  gint                 j;
+
+  for (j = i; j < data->n_chunks; j += n)
+    {
+      data->histograms[j] = gimp_histogram_new (data->linear);
+
+      gimp_histogram_calculate (data->histograms[j], data->buffer,
+                                &data->rects[j], NULL, NULL);
+    }
+}
@@ -21,9 +21,15 @@
 #define __GIMP_DRAWABLE_HISTOGRAM_H__
 
 
-void   gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
-                                          GimpHistogram *histogram,
-                                          gboolean       with_filters);
+void   gimp_drawable_calculate_histogram  (GimpDrawable  *drawable,
+                                           GimpHistogram *histogram,
+                                           gboolean       with_filters);
+
+void   gimp_drawable_invalidate_histogram (GimpDrawable  *drawable,
+                                           gint           x,
+                                           gint           y,
+                                           gint           width,
+                                           gint           height);
 
 
 #endif /* __GIMP_HISTOGRAM_H__ */
@@ -166,6 +166,9 @@ gimp_drawable_get_sub_preview (GimpDrawable *drawable,
   scaled_x = RINT ((gdouble) src_x * scale);
   scaled_y = RINT ((gdouble) src_y * scale);
 
+  /*  the drawable might be painted on by the paint thread  */
+  gimp_drawable_paint_lock ();
+
   gegl_buffer_get (buffer,
                    GEGL_RECTANGLE (scaled_x, scaled_y, dest_width, dest_height),
                    scale,
@@ -173,6 +176,8 @@ gimp_drawable_get_sub_preview (GimpDrawable *drawable,
                    gimp_temp_buf_get_data (preview),
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
 
+  gimp_drawable_paint_unlock ();
+
   return preview;
 }
 
@@ -234,6 +239,8 @@ gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
       temp_buf = gimp_temp_buf_new (dest_width, dest_height,
                                     gimp_drawable_get_format (drawable));
 
+      gimp_drawable_paint_lock ();
+
       gegl_buffer_get (buffer,
                        GEGL_RECTANGLE (scaled_x, scaled_y,
                                        dest_width, dest_height),
@@ -242,6 +249,8 @@ gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
                        gimp_temp_buf_get_data (temp_buf),
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
 
+      gimp_drawable_paint_unlock ();
+
       src_buf  = gimp_temp_buf_create_buffer (temp_buf);
       dest_buf = gimp_pixbuf_create_buffer (pixbuf);
 
@@ -259,6 +268,8 @@ gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
     }
   else
     {
+      gimp_drawable_paint_lock ();
+
       gegl_buffer_get (buffer,
                        GEGL_RECTANGLE (scaled_x, scaled_y,
                                        dest_width, dest_height),
@@ -267,6 +278,8 @@ gimp_drawable_get_sub_pixbuf (GimpDrawable *drawable,
                        gdk_pixbuf_get_pixels (pixbuf),
                        gdk_pixbuf_get_rowstride (pixbuf),
                        GEGL_ABYSS_CLAMP);
+
+      gimp_drawable_paint_unlock ();
     }
 
   return pixbuf;
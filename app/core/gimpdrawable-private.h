@@ -33,6 +33,16 @@ struct _GimpDrawablePrivate
   GimpApplicator *fs_applicator;
 
   GeglNode       *mode_node;
+
+  GHashTable     *histogram_chunks;  /* partial histograms, see
+                                      * gimpdrawable-histogram.c
+                                      */
+  const Babl     *histogram_format;
+  gboolean        histogram_linear;
+  GeglRectangle   histogram_extent;
+
+  gint            paint_count;         /* accessed atomically */
+  cairo_region_t *paint_update_region; /* updates deferred while painting */
 };
 
 #endif /* __GIMP_DRAWABLE_PRIVATE_H__ */
@@ -37,6 +37,7 @@
 #include "gimpdrawable-combine.h"
 #include "gimpdrawable-fill.h"
 #include "gimpdrawable-floating-selection.h"
+#include "gimpdrawable-histogram.h"
 #include "gimpdrawable-preview.h"
 #include "gimpdrawable-private.h"
 #include "gimpdrawable-shadow.h"
@@ -194,6 +195,9 @@ G_DEFINE_TYPE_WITH_CODE (GimpDrawable, gimp_drawable, GIMP_TYPE_ITEM,
 
 static guint gimp_drawable_signals[LAST_SIGNAL] = { 0 };
 
+/*  held by the paint thread while it paints, see gimp_drawable_paint_lock()  */
+static GRecMutex paint_mutex;
+
 
 static void
 gimp_drawable_class_init (GimpDrawableClass *klass)
@@ -322,6 +326,10 @@ gimp_drawable_finalize (GObject *object)
   g_clear_object (&drawable->private->buffer_source_node);
   g_clear_object (&drawable->private->filter_stack);
 
+  g_clear_pointer (&drawable->private->histogram_chunks, g_hash_table_unref);
+  g_clear_pointer (&drawable->private->paint_update_region,
+                   cairo_region_destroy);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -370,6 +378,10 @@ gimp_drawable_get_memsize (GimpObject *object,
   memsize += gimp_gegl_buffer_get_memsize (gimp_drawable_get_buffer (drawable));
   memsize += gimp_gegl_buffer_get_memsize (drawable->private->shadow);
 
+  memsize += gimp_g_hash_table_get_memsize_foreach (drawable->private->histogram_chunks,
+                                                    (GimpMemsizeFunc) gimp_object_get_memsize,
+                                                    NULL);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -745,6 +757,8 @@ gimp_drawable_real_update (GimpDrawable *drawable,
                            gint          width,
                            gint          height)
 {
+  gimp_drawable_invalidate_histogram (drawable, x, y, width, height);
+
   gimp_viewable_invalidate_preview (GIMP_VIEWABLE (drawable));
 }
 
@@ -979,6 +993,28 @@ gimp_drawable_update (GimpDrawable *drawable,
   if (height == -1)
     height = gimp_item_get_height (GIMP_ITEM (drawable));
 
+  if (g_atomic_int_get (&drawable->private->paint_count) > 0)
+    {
+      /*  while painting, updates are collected and emitted by
+       *  gimp_drawable_flush_paint(), so that painting can happen
+       *  outside of the main thread
+       */
+      cairo_rectangle_int_t rect = { x, y, width, height };
+
+      gimp_drawable_paint_lock ();
+
+      if (! drawable->private->paint_update_region)
+        drawable->private->paint_update_region =
+          cairo_region_create_rectangle (&rect);
+      else
+        cairo_region_union_rectangle (drawable->private->paint_update_region,
+                                      &rect);
+
+      gimp_drawable_paint_unlock ();
+
+      return;
+    }
+
   g_signal_emit (drawable, gimp_drawable_signals[UPDATE], 0,
                  x, y, width, height);
 }
@@ -991,6 +1027,96 @@ gimp_drawable_alpha_changed (GimpDrawable *drawable)
   g_signal_emit (drawable, gimp_drawable_signals[ALPHA_CHANGED], 0);
 }
 
+void
+gimp_drawable_start_paint (GimpDrawable *drawable)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  g_atomic_int_inc (&drawable->private->paint_count);
+}
+
+gboolean
+gimp_drawable_end_paint (GimpDrawable *drawable)
+{
+  gboolean result;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (g_atomic_int_get (&drawable->private->paint_count) > 0,
+                        FALSE);
+
+  result = gimp_drawable_flush_paint (drawable);
+
+  g_atomic_int_add (&drawable->private->paint_count, -1);
+
+  return result;
+}
+
+gboolean
+gimp_drawable_flush_paint (GimpDrawable *drawable)
+{
+  cairo_region_t *region;
+  gint            n_rects;
+  gint            i;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (g_atomic_int_get (&drawable->private->paint_count) > 0,
+                        FALSE);
+
+  gimp_drawable_paint_lock ();
+
+  region = drawable->private->paint_update_region;
+  drawable->private->paint_update_region = NULL;
+
+  gimp_drawable_paint_unlock ();
+
+  if (! region)
+    return FALSE;
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_rectangle_int_t rect;
+
+      cairo_region_get_rectangle (region, i, &rect);
+
+      g_signal_emit (drawable, gimp_drawable_signals[UPDATE], 0,
+                     rect.x, rect.y, rect.width, rect.height);
+    }
+
+  cairo_region_destroy (region);
+
+  return TRUE;
+}
+
+gboolean
+gimp_drawable_is_painting (GimpDrawable *drawable)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+
+  return g_atomic_int_get (&drawable->private->paint_count) > 0;
+}
+
+/**
+ * gimp_drawable_paint_lock:
+ *
+ * Takes the lock that the paint thread holds while it paints. The
+ * main thread takes it before reading pixels of drawables that might
+ * be painted on, so it never sees a half-painted dab. The lock is
+ * recursive, and held while the projection renders.
+ **/
+void
+gimp_drawable_paint_lock (void)
+{
+  g_rec_mutex_lock (&paint_mutex);
+}
+
+void
+gimp_drawable_paint_unlock (void)
+{
+  g_rec_mutex_unlock (&paint_mutex);
+}
+
 void
 gimp_drawable_invalidate_boundary (GimpDrawable *drawable)
 {
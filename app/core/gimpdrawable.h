@@ -137,6 +137,14 @@ void            gimp_drawable_update             (GimpDrawable       *drawable,
                                                   gint                height);
 void            gimp_drawable_alpha_changed      (GimpDrawable       *drawable);
 
+void            gimp_drawable_start_paint        (GimpDrawable       *drawable);
+gboolean        gimp_drawable_end_paint          (GimpDrawable       *drawable);
+gboolean        gimp_drawable_flush_paint        (GimpDrawable       *drawable);
+gboolean        gimp_drawable_is_painting        (GimpDrawable       *drawable);
+
+void            gimp_drawable_paint_lock         (void);
+void            gimp_drawable_paint_unlock       (void);
+
 void           gimp_drawable_invalidate_boundary (GimpDrawable       *drawable);
 void         gimp_drawable_get_active_components (GimpDrawable       *drawable,
                                                   gboolean           *active);
@@ -46,6 +46,23 @@
 #include "gimpimage.h"
 #include "gimpmarshal.h"
 #include "gimpprogress.h"
+#include "gimpprojection.h"
+
+#include "gimp-log.h"
+#include "gimp-priorities.h"
+
+
+/*  the longest time an update of the preview is held back while the
+ *  previous one isn't drawn yet, in microseconds
+ */
+#define APPLY_INTERVAL (G_TIME_SPAN_SECOND / 10)
+
+/*  the factor by which the filter's input is downscaled for the coarse
+ *  pass of a preview update, and the number of pixels an update needs
+ *  to have to get a coarse pass at all
+ */
+#define COARSE_SCALE      4
+#define COARSE_MIN_PIXELS (512 * 512)
 
 
 enum
@@ -76,10 +93,26 @@ struct _GimpDrawableFilter
 
   GeglRectangle           filter_area;
 
+  guint                   apply_idle_id;
+  GeglRectangle           apply_area;
+  gboolean                apply_all;
+  gboolean                apply_rendering;  /*  last update not drawn yet  */
+  gint64                  apply_time;
+  gboolean                apply_refine;     /*  pending update refines  */
+
+  gboolean                coarse;
+  GeglRectangle           coarse_area;      /*  updated while coarse    */
+  cairo_region_t         *render_region;    /*  updated, not drawn yet  */
+
+  GimpProjection         *projection;
+  GTimer                 *preview_timer;
+
   GeglNode               *translate;
   GeglNode               *crop;
   GeglNode               *cast_before;
   GeglNode               *transform_before;
+  GeglNode               *scale_before;
+  GeglNode               *scale_after;
   GeglNode               *transform_after;
   GeglNode               *cast_after;
   GimpApplicator         *applicator;
@@ -100,6 +133,8 @@ static void       gimp_drawable_filter_sync_affect      (GimpDrawableFilter  *fi
 static void       gimp_drawable_filter_sync_mask        (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_transform   (GimpDrawableFilter  *filter);
 static void       gimp_drawable_filter_sync_gamma_hack  (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_sync_coarse      (GimpDrawableFilter  *filter,
+                                                         gboolean             coarse);
 
 static gboolean   gimp_drawable_filter_is_filtering     (GimpDrawableFilter  *filter);
 static gboolean   gimp_drawable_filter_add_filter       (GimpDrawableFilter  *filter);
@@ -107,6 +142,21 @@ static gboolean   gimp_drawable_filter_remove_filter    (GimpDrawableFilter  *fi
 
 static void       gimp_drawable_filter_update_drawable  (GimpDrawableFilter  *filter,
                                                          const GeglRectangle *area);
+static void       gimp_drawable_filter_add_render_area  (GimpDrawableFilter  *filter,
+                                                         const GeglRectangle *area);
+static gboolean   gimp_drawable_filter_apply_idle       (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_cancel_apply     (GimpDrawableFilter  *filter);
+
+static void       gimp_drawable_filter_preview_start    (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_preview_stop     (GimpDrawableFilter  *filter);
+static void       gimp_drawable_filter_projection_update
+                                                        (GimpProjection      *projection,
+                                                         gboolean             now,
+                                                         gint                 x,
+                                                         gint                 y,
+                                                         gint                 width,
+                                                         gint                 height,
+                                                         GimpDrawableFilter  *filter);
 
 static void       gimp_drawable_filter_affect_changed   (GimpImage           *image,
                                                          GimpChannelType      channel,
@@ -173,6 +223,8 @@ gimp_drawable_filter_finalize (GObject *object)
 {
   GimpDrawableFilter *drawable_filter = GIMP_DRAWABLE_FILTER (object);
 
+  g_clear_pointer (&drawable_filter->render_region, cairo_region_destroy);
+
   g_clear_object (&drawable_filter->operation);
   g_clear_object (&drawable_filter->applicator);
   g_clear_object (&drawable_filter->drawable);
@@ -223,6 +275,12 @@ gimp_drawable_filter_new (GimpDrawable *drawable,
   filter->transform_before = gegl_node_new_child (node,
                                                   "operation", "gegl:nop",
                                                   NULL);
+  filter->scale_before = gegl_node_new_child (node,
+                                              "operation", "gegl:nop",
+                                              NULL);
+  filter->scale_after = gegl_node_new_child (node,
+                                             "operation", "gegl:nop",
+                                             NULL);
   filter->transform_after = gegl_node_new_child (node,
                                                  "operation", "gegl:nop",
                                                  NULL);
@@ -239,11 +297,13 @@ gimp_drawable_filter_new (GimpDrawable *drawable,
                            filter->crop,
                            filter->cast_before,
                            filter->transform_before,
+                           filter->scale_before,
                            filter->operation,
                            NULL);
     }
 
   gegl_node_link_many (filter->operation,
+                       filter->scale_after,
                        filter->transform_after,
                        filter->cast_after,
                        NULL);
@@ -389,7 +449,62 @@ gimp_drawable_filter_apply (GimpDrawableFilter  *filter,
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (filter->drawable)));
 
   gimp_drawable_filter_add_filter (filter);
-  gimp_drawable_filter_update_drawable (filter, area);
+
+  /*  a parameter change makes a pending refinement of the previous
+   *  coarse update pointless.  the filter stays coarse, and the area
+   *  to refine grows by this update's area, until it's drawn
+   */
+  if (filter->apply_refine)
+    {
+      g_source_remove (filter->apply_idle_id);
+      filter->apply_idle_id = 0;
+      filter->apply_refine  = FALSE;
+    }
+
+  if (! area)
+    {
+      filter->apply_all = TRUE;
+    }
+  else if (! filter->apply_idle_id)
+    {
+      filter->apply_area = *area;
+    }
+  else
+    {
+      gegl_rectangle_bounding_box (&filter->apply_area,
+                                   &filter->apply_area, area);
+    }
+
+  /*  update from an idle, so that the parameter changes of e.g. a
+   *  dragged slider, which all end up here, result in one update of
+   *  all the areas passed meanwhile.  while the projection hasn't drawn
+   *  anything of the previous update yet, the next one is held back
+   *  until it has, or for at most APPLY_INTERVAL, instead of restarting
+   *  the preview's rendering before any of it was shown
+   */
+  if (! filter->apply_idle_id)
+    {
+      if (filter->apply_rendering)
+        {
+          gint64 wait = filter->apply_time + APPLY_INTERVAL -
+                        g_get_monotonic_time ();
+
+          filter->apply_idle_id =
+            g_timeout_add_full (GIMP_PRIORITY_DRAWABLE_FILTER_IDLE,
+                                (MAX (wait, 0) + 999) / 1000,
+                                (GSourceFunc) gimp_drawable_filter_apply_idle,
+                                filter, NULL);
+        }
+      else
+        {
+          filter->apply_idle_id =
+            g_idle_add_full (GIMP_PRIORITY_DRAWABLE_FILTER_IDLE,
+                             (GSourceFunc) gimp_drawable_filter_apply_idle,
+                             filter, NULL);
+        }
+
+      gimp_drawable_filter_preview_start (filter);
+    }
 }
 
 gboolean
@@ -404,6 +519,10 @@ gimp_drawable_filter_commit (GimpDrawableFilter *filter,
                         FALSE);
   g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
 
+  /*  merging renders the whole filter anyway  */
+  gimp_drawable_filter_cancel_apply (filter);
+  gimp_drawable_filter_preview_stop (filter);
+
   if (gimp_drawable_filter_is_filtering (filter))
     {
       success = gimp_drawable_merge_filter (filter->drawable,
@@ -779,6 +898,70 @@ gimp_drawable_filter_sync_gamma_hack (GimpDrawableFilter *filter)
     }
 }
 
+/*  switches the filter between processing a downscaled copy of its
+ *  input and scaling the result back up, and processing it at full
+ *  resolution.  the coarse result is exact for point operations, and an
+ *  approximation for area operations like blurs.
+ */
+static void
+gimp_drawable_filter_sync_coarse (GimpDrawableFilter *filter,
+                                  gboolean            coarse)
+{
+  if (coarse == filter->coarse)
+    return;
+
+  filter->coarse = coarse;
+
+  if (coarse)
+    {
+      gegl_node_set (filter->scale_before,
+                     "operation", "gegl:scale-ratio",
+                     "x",         1.0 / COARSE_SCALE,
+                     "y",         1.0 / COARSE_SCALE,
+                     "sampler",   GEGL_SAMPLER_NEAREST,
+                     NULL);
+
+      gegl_node_set (filter->scale_after,
+                     "operation", "gegl:scale-ratio",
+                     "x",         (gdouble) COARSE_SCALE,
+                     "y",         (gdouble) COARSE_SCALE,
+                     "sampler",   GEGL_SAMPLER_NEAREST,
+                     NULL);
+
+      /*  whatever the projection didn't draw yet is now drawn coarse
+       *  too, and needs to be refined
+       */
+      if (filter->render_region)
+        {
+          cairo_rectangle_int_t extents;
+          gint                  off_x, off_y;
+
+          gimp_item_get_offset (GIMP_ITEM (filter->drawable),
+                                &off_x, &off_y);
+
+          cairo_region_get_extents (filter->render_region, &extents);
+
+          filter->coarse_area.x      = extents.x - off_x;
+          filter->coarse_area.y      = extents.y - off_y;
+          filter->coarse_area.width  = extents.width;
+          filter->coarse_area.height = extents.height;
+        }
+    }
+  else
+    {
+      gegl_node_set (filter->scale_before,
+                     "operation", "gegl:nop",
+                     NULL);
+
+      gegl_node_set (filter->scale_after,
+                     "operation", "gegl:nop",
+                     NULL);
+
+      filter->coarse_area.width  = 0;
+      filter->coarse_area.height = 0;
+    }
+}
+
 static gboolean
 gimp_drawable_filter_is_filtering (GimpDrawableFilter *filter)
 {
@@ -810,6 +993,12 @@ gimp_drawable_filter_add_filter (GimpDrawableFilter *filter)
       gimp_drawable_add_filter (filter->drawable,
                                 GIMP_FILTER (filter));
 
+      /*  follow which of the filter's updates the projection drew  */
+      filter->projection = gimp_image_get_projection (image);
+
+      g_signal_connect (filter->projection, "update",
+                        G_CALLBACK (gimp_drawable_filter_projection_update),
+                        filter);
       g_signal_connect (image, "component-active-changed",
                         G_CALLBACK (gimp_drawable_filter_affect_changed),
                         filter);
@@ -836,6 +1025,9 @@ gimp_drawable_filter_remove_filter (GimpDrawableFilter *filter)
     {
       GimpImage *image = gimp_item_get_image (GIMP_ITEM (filter->drawable));
 
+      gimp_drawable_filter_cancel_apply (filter);
+      gimp_drawable_filter_preview_stop (filter);
+
       g_signal_handlers_disconnect_by_func (filter->drawable,
                                             gimp_drawable_filter_drawable_removed,
                                             filter);
@@ -848,6 +1040,11 @@ gimp_drawable_filter_remove_filter (GimpDrawableFilter *filter)
       g_signal_handlers_disconnect_by_func (image,
                                             gimp_drawable_filter_affect_changed,
                                             filter);
+      g_signal_handlers_disconnect_by_func (filter->projection,
+                                            gimp_drawable_filter_projection_update,
+                                            filter);
+
+      filter->projection = NULL;
 
       gimp_drawable_remove_filter (filter->drawable,
                                    GIMP_FILTER (filter));
@@ -892,6 +1089,8 @@ gimp_drawable_filter_update_drawable (GimpDrawableFilter  *filter,
   if (update_area.width  > 0 &&
       update_area.height > 0)
     {
+      gimp_drawable_filter_add_render_area (filter, &update_area);
+
       gimp_drawable_update (filter->drawable,
                             update_area.x,
                             update_area.y,
@@ -902,6 +1101,213 @@ gimp_drawable_filter_update_drawable (GimpDrawableFilter  *filter,
     }
 }
 
+/*  remembers an updated area of the drawable until the projection drew
+ *  it, and while the filter is coarse, as an area to refine
+ */
+static void
+gimp_drawable_filter_add_render_area (GimpDrawableFilter  *filter,
+                                      const GeglRectangle *area)
+{
+  GimpItem              *item  = GIMP_ITEM (filter->drawable);
+  GimpImage             *image = gimp_item_get_image (item);
+  cairo_rectangle_int_t  rect;
+  gint                   off_x, off_y;
+
+  if (! filter->projection)
+    return;
+
+  gimp_item_get_offset (item, &off_x, &off_y);
+
+  /*  the projection only draws what is inside the image  */
+  if (gimp_rectangle_intersect (area->x + off_x,
+                                area->y + off_y,
+                                area->width,
+                                area->height,
+                                0, 0,
+                                gimp_image_get_width  (image),
+                                gimp_image_get_height (image),
+                                &rect.x,
+                                &rect.y,
+                                &rect.width,
+                                &rect.height))
+    {
+      if (filter->render_region)
+        cairo_region_union_rectangle (filter->render_region, &rect);
+      else
+        filter->render_region = cairo_region_create_rectangle (&rect);
+    }
+
+  if (filter->coarse)
+    {
+      if (filter->coarse_area.width  > 0 &&
+          filter->coarse_area.height > 0)
+        {
+          gegl_rectangle_bounding_box (&filter->coarse_area,
+                                       &filter->coarse_area, area);
+        }
+      else
+        {
+          filter->coarse_area = *area;
+        }
+    }
+}
+
+static gboolean
+gimp_drawable_filter_apply_idle (GimpDrawableFilter *filter)
+{
+  GeglRectangle area   = filter->apply_area;
+  gboolean      all    = filter->apply_all;
+  gboolean      refine = filter->apply_refine;
+
+  filter->apply_idle_id = 0;
+  filter->apply_all     = FALSE;
+  filter->apply_refine  = FALSE;
+
+  if (! gimp_drawable_filter_is_filtering (filter))
+    return G_SOURCE_REMOVE;
+
+  if (refine)
+    {
+      GeglRectangle coarse_area = filter->coarse_area;
+
+      /*  the coarse update is drawn, update its area again at full
+       *  resolution.  the projection renders the visible part of it
+       *  first, like any update
+       */
+      gimp_drawable_filter_sync_coarse (filter, FALSE);
+      gimp_drawable_filter_update_drawable (filter, &coarse_area);
+    }
+  else
+    {
+      GimpItem *item = GIMP_ITEM (filter->drawable);
+      gint64    n_pixels;
+
+      if (all)
+        area = filter->filter_area;
+
+      n_pixels = (gint64) area.width * area.height;
+
+      /*  render large updates of a visible drawable coarsely first,
+       *  they are refined once the projection drew them.  stay coarse
+       *  while an earlier coarse update still needs refining
+       */
+      gimp_drawable_filter_sync_coarse (filter,
+                                        filter->coarse ||
+                                        (n_pixels >= COARSE_MIN_PIXELS &&
+                                         gimp_item_is_visible (item)   &&
+                                         gegl_node_has_pad (filter->operation,
+                                                            "input")));
+
+      gimp_drawable_filter_update_drawable (filter, all ? NULL : &area);
+
+      filter->apply_rendering = TRUE;
+      filter->apply_time      = g_get_monotonic_time ();
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gimp_drawable_filter_cancel_apply (GimpDrawableFilter *filter)
+{
+  if (filter->apply_idle_id)
+    {
+      g_source_remove (filter->apply_idle_id);
+      filter->apply_idle_id = 0;
+    }
+
+  filter->apply_all       = FALSE;
+  filter->apply_rendering = FALSE;
+  filter->apply_refine    = FALSE;
+
+  /*  merging, or removing the filter, uses the full resolution graph  */
+  gimp_drawable_filter_sync_coarse (filter, FALSE);
+
+  g_clear_pointer (&filter->render_region, cairo_region_destroy);
+}
+
+/*  with "GIMP_LOG=projection", logs how long it takes from a
+ *  parameter change until the first part of the new preview is on
+ *  the canvas
+ */
+static void
+gimp_drawable_filter_preview_start (GimpDrawableFilter *filter)
+{
+  if (! (gimp_log_flags & GIMP_LOG_PROJECTION))
+    return;
+
+  /*  if a preview is still pending, time from the earliest change  */
+  if (! filter->preview_timer)
+    filter->preview_timer = g_timer_new ();
+}
+
+static void
+gimp_drawable_filter_preview_stop (GimpDrawableFilter *filter)
+{
+  g_clear_pointer (&filter->preview_timer, g_timer_destroy);
+}
+
+static void
+gimp_drawable_filter_projection_update (GimpProjection     *projection,
+                                        gboolean            now,
+                                        gint                x,
+                                        gint                y,
+                                        gint                width,
+                                        gint                height,
+                                        GimpDrawableFilter *filter)
+{
+  if (filter->render_region)
+    {
+      cairo_rectangle_int_t rect = { x, y, width, height };
+
+      cairo_region_subtract_rectangle (filter->render_region, &rect);
+
+      if (cairo_region_is_empty (filter->render_region))
+        {
+          g_clear_pointer (&filter->render_region, cairo_region_destroy);
+
+          /*  the coarse update is drawn, refine it from an idle, not
+           *  while the projection is rendering.  a parameter change
+           *  meanwhile drops the refinement again
+           */
+          if (filter->coarse && ! filter->apply_idle_id)
+            {
+              filter->apply_refine  = TRUE;
+              filter->apply_idle_id =
+                g_idle_add_full (GIMP_PRIORITY_DRAWABLE_FILTER_IDLE,
+                                 (GSourceFunc) gimp_drawable_filter_apply_idle,
+                                 filter, NULL);
+            }
+        }
+    }
+
+  /*  only rendered areas count, not invalidated ones  */
+  if (! now || ! filter->apply_rendering)
+    return;
+
+  filter->apply_rendering = FALSE;
+
+  if (filter->preview_timer)
+    {
+      GIMP_LOG (PROJECTION, "%s: first preview after %f seconds\n",
+                gimp_object_get_name (filter),
+                g_timer_elapsed (filter->preview_timer, NULL));
+
+      gimp_drawable_filter_preview_stop (filter);
+    }
+
+  /*  the last update is on the canvas, make the one held back now  */
+  if (filter->apply_idle_id)
+    {
+      g_source_remove (filter->apply_idle_id);
+
+      filter->apply_idle_id =
+        g_idle_add_full (GIMP_PRIORITY_DRAWABLE_FILTER_IDLE,
+                         (GSourceFunc) gimp_drawable_filter_apply_idle,
+                         filter, NULL);
+    }
+}
+
 static void
 gimp_drawable_filter_affect_changed (GimpImage          *image,
                                      GimpChannelType     channel,
@@ -28,6 +28,7 @@
 #include "gimpimage.h"
 #include "gimpdrawable.h"
 #include "gimpdrawablemodundo.h"
+#include "gimpswapfile.h"
 
 
 enum
@@ -55,6 +56,11 @@ static void     gimp_drawable_mod_undo_pop          (GimpUndo            *undo,
                                                      GimpUndoAccumulator *accum);
 static void     gimp_drawable_mod_undo_free         (GimpUndo            *undo,
                                                      GimpUndoMode         undo_mode);
+static gboolean gimp_drawable_mod_undo_swap_out     (GimpUndo            *undo,
+                                                     GimpSwapFile        *swap_file,
+                                                     GError             **error);
+static gboolean gimp_drawable_mod_undo_swap_in      (GimpUndo            *undo,
+                                                     GError             **error);
 
 
 G_DEFINE_TYPE (GimpDrawableModUndo, gimp_drawable_mod_undo, GIMP_TYPE_ITEM_UNDO)
@@ -77,6 +83,8 @@ gimp_drawable_mod_undo_class_init (GimpDrawableModUndoClass *klass)
 
   undo_class->pop                = gimp_drawable_mod_undo_pop;
   undo_class->free               = gimp_drawable_mod_undo_free;
+  undo_class->swap_out           = gimp_drawable_mod_undo_swap_out;
+  undo_class->swap_in            = gimp_drawable_mod_undo_swap_in;
 
   g_object_class_install_property (object_class, PROP_COPY_BUFFER,
                                    g_param_spec_boolean ("copy-buffer",
@@ -209,6 +217,47 @@ gimp_drawable_mod_undo_free (GimpUndo     *undo,
   GimpDrawableModUndo *drawable_mod_undo = GIMP_DRAWABLE_MOD_UNDO (undo);
 
   g_clear_object (&drawable_mod_undo->buffer);
+  g_clear_pointer (&drawable_mod_undo->buffer_entry, gimp_swap_entry_free);
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gboolean
+gimp_drawable_mod_undo_swap_out (GimpUndo      *undo,
+                                 GimpSwapFile  *swap_file,
+                                 GError       **error)
+{
+  GimpDrawableModUndo *drawable_mod_undo = GIMP_DRAWABLE_MOD_UNDO (undo);
+
+  drawable_mod_undo->buffer_entry =
+    gimp_swap_file_write_buffer (swap_file, drawable_mod_undo->buffer, error);
+
+  if (! drawable_mod_undo->buffer_entry)
+    return FALSE;
+
+  g_clear_object (&drawable_mod_undo->buffer);
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_out (undo, swap_file, error);
+}
+
+static gboolean
+gimp_drawable_mod_undo_swap_in (GimpUndo  *undo,
+                                GError   **error)
+{
+  GimpDrawableModUndo *drawable_mod_undo = GIMP_DRAWABLE_MOD_UNDO (undo);
+  GError              *my_error          = NULL;
+
+  drawable_mod_undo->buffer =
+    gimp_swap_entry_read_buffer (drawable_mod_undo->buffer_entry, &my_error);
+
+  g_clear_pointer (&drawable_mod_undo->buffer_entry, gimp_swap_entry_free);
+
+  if (my_error)
+    {
+      g_propagate_error (error, my_error);
+
+      return FALSE;
+    }
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_in (undo, error);
+}
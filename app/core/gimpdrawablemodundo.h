@@ -41,6 +41,8 @@ struct _GimpDrawableModUndo
   gboolean       copy_buffer;
   gint           offset_x;
   gint           offset_y;
+
+  GimpSwapEntry *buffer_entry;  /* the buffer while swapped out */
 };
 
 struct _GimpDrawableModUndoClass
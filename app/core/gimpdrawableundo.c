@@ -28,6 +28,7 @@
 #include "gimpimage.h"
 #include "gimpdrawable.h"
 #include "gimpdrawableundo.h"
+#include "gimpswapfile.h"
 
 
 enum
@@ -57,6 +58,11 @@ static void     gimp_drawable_undo_pop          (GimpUndo            *undo,
                                                  GimpUndoAccumulator *accum);
 static void     gimp_drawable_undo_free         (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode);
+static gboolean gimp_drawable_undo_swap_out     (GimpUndo            *undo,
+                                                 GimpSwapFile        *swap_file,
+                                                 GError             **error);
+static gboolean gimp_drawable_undo_swap_in      (GimpUndo            *undo,
+                                                 GError             **error);
 
 
 G_DEFINE_TYPE (GimpDrawableUndo, gimp_drawable_undo, GIMP_TYPE_ITEM_UNDO)
@@ -79,6 +85,8 @@ gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
 
   undo_class->pop                = gimp_drawable_undo_pop;
   undo_class->free               = gimp_drawable_undo_free;
+  undo_class->swap_out           = gimp_drawable_undo_swap_out;
+  undo_class->swap_in            = gimp_drawable_undo_swap_in;
 
   g_object_class_install_property (object_class, PROP_BUFFER,
                                    g_param_spec_object ("buffer", NULL, NULL,
@@ -204,5 +212,80 @@ gimp_drawable_undo_free (GimpUndo     *undo,
   g_clear_object (&drawable_undo->buffer);
   g_clear_object (&drawable_undo->applied_buffer);
 
+  g_clear_pointer (&drawable_undo->buffer_entry,         gimp_swap_entry_free);
+  g_clear_pointer (&drawable_undo->applied_buffer_entry, gimp_swap_entry_free);
+
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gboolean
+gimp_drawable_undo_swap_out (GimpUndo      *undo,
+                             GimpSwapFile  *swap_file,
+                             GError       **error)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  drawable_undo->buffer_entry =
+    gimp_swap_file_write_buffer (swap_file, drawable_undo->buffer, error);
+
+  if (! drawable_undo->buffer_entry)
+    return FALSE;
+
+  if (drawable_undo->applied_buffer)
+    {
+      drawable_undo->applied_buffer_entry =
+        gimp_swap_file_write_buffer (swap_file, drawable_undo->applied_buffer,
+                                     error);
+
+      if (! drawable_undo->applied_buffer_entry)
+        {
+          g_clear_pointer (&drawable_undo->buffer_entry, gimp_swap_entry_free);
+
+          return FALSE;
+        }
+    }
+
+  g_clear_object (&drawable_undo->buffer);
+  g_clear_object (&drawable_undo->applied_buffer);
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_out (undo, swap_file, error);
+}
+
+static gboolean
+gimp_drawable_undo_swap_in (GimpUndo  *undo,
+                            GError   **error)
+{
+  GimpDrawableUndo *drawable_undo  = GIMP_DRAWABLE_UNDO (undo);
+  GeglBuffer       *buffer;
+  GeglBuffer       *applied_buffer = NULL;
+
+  /*  keep the swapped data until both buffers are read back, so a
+   *  failed read leaves the undo step as it was
+   */
+  buffer = gimp_swap_entry_read_buffer (drawable_undo->buffer_entry, error);
+
+  if (! buffer)
+    return FALSE;
+
+  if (drawable_undo->applied_buffer_entry)
+    {
+      applied_buffer =
+        gimp_swap_entry_read_buffer (drawable_undo->applied_buffer_entry,
+                                     error);
+
+      if (! applied_buffer)
+        {
+          g_object_unref (buffer);
+
+          return FALSE;
+        }
+    }
+
+  drawable_undo->buffer         = buffer;
+  drawable_undo->applied_buffer = applied_buffer;
+
+  g_clear_pointer (&drawable_undo->buffer_entry,         gimp_swap_entry_free);
+  g_clear_pointer (&drawable_undo->applied_buffer_entry, gimp_swap_entry_free);
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_in (undo, error);
+}
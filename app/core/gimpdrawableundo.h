@@ -41,6 +41,10 @@ struct _GimpDrawableUndo
   gint          x;
   gint          y;
 
+  /* the buffers while swapped out */
+  GimpSwapEntry *buffer_entry;
+  GimpSwapEntry *applied_buffer_entry;
+
   /* stuff for "Fade" */
   GeglBuffer             *applied_buffer;
   GimpLayerMode           paint_mode;
@@ -31,6 +31,7 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
@@ -42,6 +43,9 @@ enum
   PROP_VALUES
 };
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
 struct _GimpHistogramPrivate
 {
   gboolean  linear;
@@ -50,25 +54,40 @@ struct _GimpHistogramPrivate
   gdouble  *values;
 };
 
+typedef struct
+{
+  GimpHistogram       *histogram;
+  GeglBuffer          *buffer;
+  const GeglRectangle *buffer_rect;
+  GeglBuffer          *mask;
+  const GeglRectangle *mask_rect;
+  const Babl          *format;
+
+  GMutex               mutex;
+} CalculateData;
+
 
 /*  local function prototypes  */
 
-static void     gimp_histogram_finalize     (GObject       *object);
-static void     gimp_histogram_set_property (GObject       *object,
-                                             guint          property_id,
-                                             const GValue  *value,
-                                             GParamSpec    *pspec);
-static void     gimp_histogram_get_property (GObject       *object,
-                                             guint          property_id,
-                                             GValue        *value,
-                                             GParamSpec    *pspec);
+static void     gimp_histogram_finalize       (GObject             *object);
+static void     gimp_histogram_set_property   (GObject             *object,
+                                               guint                property_id,
+                                               const GValue        *value,
+                                               GParamSpec          *pspec);
+static void     gimp_histogram_get_property   (GObject             *object,
+                                               guint                property_id,
+                                               GValue              *value,
+                                               GParamSpec          *pspec);
+
+static gint64   gimp_histogram_get_memsize    (GimpObject          *object,
+                                               gint64              *gui_size);
 
-static gint64   gimp_histogram_get_memsize  (GimpObject    *object,
-                                             gint64        *gui_size);
+static void     gimp_histogram_alloc_values   (GimpHistogram       *histogram,
+                                               gint                 n_components,
+                                               gint                 n_bins);
 
-static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
-                                             gint           n_components,
-                                             gint           n_bins);
+static void     gimp_histogram_calculate_area (const GeglRectangle *area,
+                                               CalculateData       *calc);
 
 
 G_DEFINE_TYPE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
@@ -233,7 +252,7 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           const GeglRectangle *mask_rect)
 {
   GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
+  CalculateData         data;
   const Babl           *format;
   gint                  n_components;
   gint                  n_bins;
@@ -316,174 +335,78 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
   gimp_histogram_alloc_values (histogram, n_components, n_bins);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-
-#define VALUE(c,i) (priv->values[(c) * priv->n_bins + \
-                                 (gint) (CLAMP ((i), 0.0, 1.0) * \
-                                         (priv->n_bins - 0.0001))])
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *data   = iter->data[0];
-      gint          length = iter->length;
-      gfloat        max;
-      gfloat        luminance;
-
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
-
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (0, data[0]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 2:
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
-
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += masked;
-
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (4, luminance) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight * masked;
-
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (5, luminance) += weight * masked;
+  data.histogram   = histogram;
+  data.buffer      = buffer;
+  data.buffer_rect = buffer_rect;
+  data.mask        = mask;
+  data.mask_rect   = mask_rect;
+  data.format      = format;
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
+  g_mutex_init (&data.mutex);
 
-                  data += n_components;
-                }
-              break;
+  gimp_parallel_distribute_area (buffer_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_histogram_calculate_area,
+                                 &data);
 
-            case 2:
-              while (length--)
-                {
-                  const gdouble weight = data[1];
+  g_mutex_clear (&data.mutex);
 
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
+  g_object_notify (G_OBJECT (histogram), "values");
 
-                  data += n_components;
-                }
-              break;
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-            case 3: /* calculate separate value values */
-              while (length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
+/**
+ * gimp_histogram_merge:
+ * @histogram: a %GimpHistogram
+ * @other:     the %GimpHistogram to add to @histogram
+ *
+ * Adds the values of @other to the values of @histogram. If
+ * @histogram has no values, it gets a copy of @other's values,
+ * otherwise both need to have the same number of channels and bins.
+ **/
+void
+gimp_histogram_merge (GimpHistogram *histogram,
+                      GimpHistogram *other)
+{
+  GimpHistogramPrivate *priv;
+  GimpHistogramPrivate *other_priv;
+  gint                  n_values;
+  gint                  i;
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += 1.0;
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (GIMP_IS_HISTOGRAM (other));
 
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (4, luminance) += 1.0;
+  priv       = histogram->priv;
+  other_priv = other->priv;
 
-                  data += n_components;
-                }
-              break;
+  if (! other_priv->values)
+    return;
 
-            case 4: /* calculate separate value values */
-              while (length--)
-                {
-                  const gdouble weight = data[3];
+  if (! priv->values)
+    {
+      g_object_freeze_notify (G_OBJECT (histogram));
 
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
+      gimp_histogram_alloc_values (histogram,
+                                   other_priv->n_channels - 2,
+                                   other_priv->n_bins);
+    }
+  else
+    {
+      g_return_if_fail (priv->n_channels == other_priv->n_channels &&
+                        priv->n_bins     == other_priv->n_bins);
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-                  VALUE (0, max) += weight;
+      g_object_freeze_notify (G_OBJECT (histogram));
+    }
 
-                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
-                  VALUE (5, luminance) += weight;
+  n_values = priv->n_channels * priv->n_bins;
 
-                  data += n_components;
-                }
-              break;
-            }
-        }
-    }
+  for (i = 0; i < n_values; i++)
+    priv->values[i] += other_priv->values[i];
 
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
-
-#undef VALUE
 }
 
 void
@@ -605,6 +528,14 @@ gimp_histogram_get_component (GimpHistogram *histogram,
   return gimp_histogram_get_value (histogram, component, bin);
 }
 
+gboolean
+gimp_histogram_get_linear (GimpHistogram *histogram)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), FALSE);
+
+  return histogram->priv->linear;
+}
+
 gint
 gimp_histogram_n_channels (GimpHistogram *histogram)
 {
@@ -979,3 +910,204 @@ gimp_histogram_alloc_values (GimpHistogram *histogram,
               priv->n_channels * priv->n_bins * sizeof (gdouble));
     }
 }
+
+static void
+gimp_histogram_calculate_area (const GeglRectangle *area,
+                               CalculateData       *calc)
+{
+  GimpHistogramPrivate *priv         = calc->histogram->priv;
+  const Babl           *format       = calc->format;
+  GeglBuffer           *mask         = calc->mask;
+  gint                  n_components = babl_format_get_n_components (format);
+  gint                  n_values     = priv->n_channels * priv->n_bins;
+  gint                  n_bins       = priv->n_bins;
+  GeglBufferIterator   *iter;
+  gdouble              *values;
+  gint                  i;
+
+  /*  every sub-area is binned into its own array, which is added to
+   *  the histogram's values at the end
+   */
+  values = g_new0 (gdouble, n_values);
+
+  iter = gegl_buffer_iterator_new (calc->buffer, area, 0, format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+  if (mask)
+    {
+      GeglRectangle mask_area = *area;
+
+      mask_area.x += calc->mask_rect->x - calc->buffer_rect->x;
+      mask_area.y += calc->mask_rect->y - calc->buffer_rect->y;
+
+      gegl_buffer_iterator_add (iter, mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    }
+
+#define VALUE(c,i) (values[(c) * n_bins + \
+                           (gint) (CLAMP ((i), 0.0, 1.0) * \
+                                   (n_bins - 0.0001))])
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *data   = iter->data[0];
+      gint          length = iter->length;
+      gfloat        max;
+      gfloat        luminance;
+
+      if (mask)
+        {
+          const gfloat *mask_data = iter->data[1];
+
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (0, data[0]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight * masked;
+                  VALUE (1, data[1]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (1, data[0]) += masked;
+                  VALUE (2, data[1]) += masked;
+                  VALUE (3, data[2]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += masked;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (4, luminance) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight * masked;
+                  VALUE (2, data[1]) += weight * masked;
+                  VALUE (3, data[2]) += weight * masked;
+                  VALUE (4, data[3]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += weight * masked;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (5, luminance) += weight * masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+            }
+        }
+      else /* no mask */
+        {
+          switch (n_components)
+            {
+            case 1:
+              while (length--)
+                {
+                  VALUE (0, data[0]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 2:
+              while (length--)
+                {
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight;
+                  VALUE (1, data[1]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (length--)
+                {
+                  VALUE (1, data[0]) += 1.0;
+                  VALUE (2, data[1]) += 1.0;
+                  VALUE (3, data[2]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += 1.0;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (4, luminance) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (length--)
+                {
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight;
+                  VALUE (2, data[1]) += weight;
+                  VALUE (3, data[2]) += weight;
+                  VALUE (4, data[3]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+                  VALUE (0, max) += weight;
+
+                  luminance = GIMP_RGB_LUMINANCE (data[0], data[1], data[2]);
+                  VALUE (5, luminance) += weight;
+
+                  data += n_components;
+                }
+              break;
+            }
+        }
+    }
+
+#undef VALUE
+
+  g_mutex_lock (&calc->mutex);
+
+  for (i = 0; i < n_values; i++)
+    priv->values[i] += values[i];
+
+  g_mutex_unlock (&calc->mutex);
+
+  g_free (values);
+}
@@ -60,6 +60,9 @@ void            gimp_histogram_calculate     (GimpHistogram        *histogram,
                                               GeglBuffer           *mask,
                                               const GeglRectangle  *mask_rect);
 
+void            gimp_histogram_merge         (GimpHistogram        *histogram,
+                                              GimpHistogram        *other);
+
 void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
 
 gdouble         gimp_histogram_get_maximum   (GimpHistogram        *histogram,
@@ -90,6 +93,7 @@ gdouble         gimp_histogram_get_value     (GimpHistogram        *histogram,
 gdouble         gimp_histogram_get_component (GimpHistogram        *histogram,
                                               gint                  component,
                                               gint                  bin);
+gboolean        gimp_histogram_get_linear    (GimpHistogram        *histogram);
 gint            gimp_histogram_n_channels    (GimpHistogram        *histogram);
 gint            gimp_histogram_n_bins        (GimpHistogram        *histogram);
 
@@ -146,6 +146,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -190,6 +191,30 @@
 #define G_SCALE 24              /*  scale G (a*) distances by this much  */
 #define B_SCALE 26              /*  and B (b*) by this much              */
 
+/* the number of pixels it takes before it's worth giving a thread its
+ * own histogram to fill
+ */
+#define MIN_HISTOGRAM_BAND_SIZE (512 * 512)
+
+/* every band but the first costs a full 8 MiB histogram, so don't
+ * give out more than a few of them, regardless of the thread count
+ */
+#define MAX_HISTOGRAM_BANDS 4
+
+/* the number of histogram cells each thread sums up at least, when
+ * merging the bands' histograms
+ */
+#define MIN_HISTOGRAM_MERGE_SIZE (64 * 1024)
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+/* banded Floyd-Steinberg dithering: every band of FS_DITHER_BAND_HEIGHT
+ * rows is dithered on its own, after running the error diffusion over
+ * the last rows of the band above it, whose output is thrown away, so
+ * the error doesn't start from zero at the seam
+ */
+#define FS_DITHER_BAND_OVERLAP 16
+
 
 typedef struct _Color Color;
 typedef struct _QuantizeObj QuantizeObj;
@@ -316,20 +341,12 @@ static const Babl *rgb_to_lab_fish = NULL;
 static const Babl *lab_to_rgb_fish = NULL;
 
 static inline void
-rgb_to_unshifted_lin (const guchar  r,
-                      const guchar  g,
-                      const guchar  b,
+lab_to_unshifted_lin (const gfloat *lab,
                       gint         *hr,
                       gint         *hg,
                       gint         *hb)
 {
-  gint   or, og, ob;
-  gfloat rgb[3] = { r / 255.0, g / 255.0, b / 255.0 };
-  gfloat lab[3];
-
-  babl_process (rgb_to_lab_fish, rgb, lab, 1);
-
-  /* fprintf(stderr, " %d-%d-%d -> %0.3f,%0.3f,%0.3f ", r, g, b, sL, sa, sb);*/
+  gint or, og, ob;
 
   or = RINT(lab[0] * LRAT);
   og = RINT((lab[1] - LOWA) * ARAT);
@@ -342,6 +359,24 @@ rgb_to_unshifted_lin (const guchar  r,
   /*  fprintf(stderr, " %d:%d:%d ", *hr, *hg, *hb); */
 }
 
+static inline void
+rgb_to_unshifted_lin (const guchar  r,
+                      const guchar  g,
+                      const guchar  b,
+                      gint         *hr,
+                      gint         *hg,
+                      gint         *hb)
+{
+  gfloat rgb[3] = { r / 255.0, g / 255.0, b / 255.0 };
+  gfloat lab[3];
+
+  babl_process (rgb_to_lab_fish, rgb, lab, 1);
+
+  /* fprintf(stderr, " %d-%d-%d -> %0.3f,%0.3f,%0.3f ", r, g, b, sL, sa, sb);*/
+
+  lab_to_unshifted_lin (lab, hr, hg, hb);
+}
+
 
 static inline void
 rgb_to_lin (const guchar  r,
@@ -411,6 +446,22 @@ rgb_to_lin (const guchar  r,
   *hb = ob;
 }
 
+/*  like rgb_to_lin(), for a color that was already converted to Lab
+ *  with rgb_to_lab_fish, which is a lot faster for many pixels at once
+ */
+static inline void
+lab_to_lin (const gfloat *lab,
+            gint         *hr,
+            gint         *hg,
+            gint         *hb)
+{
+  lab_to_unshifted_lin (lab, hr, hg, hb);
+
+  *hr = RSDF (*hr);
+  *hg = GSDF (*hg);
+  *hb = BSDF (*hb);
+}
+
 
 static inline ColorFreq *
 HIST_RGB (ColorFreq  *hist_ptr,
@@ -481,6 +532,8 @@ struct _QuantizeObj
   Color         clin[256];                /* .. converted back to linear space */
   gulong        index_used_count[256];    /* how many times an index was used  */
   CFHistogram   histogram;                /* holds the histogram               */
+  gboolean      inverse_cmap_complete;    /* .. or the full inverse colormap   */
+  gboolean      want_full_inverse_cmap;   /* fill every cell, not only the used */
 
   gboolean      want_dither_alpha;
   gint          error_freedom;            /* 0=much bleed, 1=controlled bleed */
@@ -515,6 +568,18 @@ typedef struct
 
 } box, *boxptr;
 
+typedef struct
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  GeglRectangle  rect;
+  gint           offsetx;
+  gint           offsety;
+  gboolean       dither_alpha;
+  CFHistogram    histogram;
+  CFHistogram    band_histograms[MAX_HISTOGRAM_BANDS];
+} GenerateHistogramRGBData;
+
 
 static void          zero_histogram_gray     (CFHistogram   histogram);
 static void          zero_histogram_rgb      (CFHistogram   histogram);
@@ -1141,208 +1206,315 @@ generate_histogram_gray (CFHistogram  histogram,
 }
 
 
+static inline gboolean
+histogram_pixel_is_transparent (const guchar *data,
+                                gboolean      has_alpha,
+                                gboolean      dither_alpha,
+                                gint          col,
+                                gint          row)
+{
+  if (! has_alpha)
+    return FALSE;
+
+  /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
+  if (dither_alpha)
+    return data[ALPHA] < DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK];
+  else
+    return data[ALPHA] <= 127;
+}
+
+/*  Remembers the colors of layer in found_cols, until there are more
+ *  than col_limit of them and needs_quantize gets set.
+ */
 static void
-generate_histogram_rgb (CFHistogram   histogram,
-                        GimpLayer    *layer,
-                        gint          col_limit,
-                        gboolean      dither_alpha,
-                        GimpProgress *progress,
-                        gint          nth_layer,
-                        gint          n_layers)
+find_colors_rgb (GimpLayer  *layer,
+                 const Babl *format,
+                 gint        col_limit,
+                 gboolean    dither_alpha)
 {
   GeglBufferIterator *iter;
-  const Babl         *format;
   GeglRectangle      *roi;
-  ColorFreq          *colfreq;
   gint                nfc_iter;
   gint                row, col, coledge;
   gint                offsetx, offsety;
-  glong               layer_size;
-  glong               total_size = 0;
-  gint                count      = 0;
   gint                bpp;
   gboolean            has_alpha;
 
-  format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-
-  g_return_if_fail (format == babl_format ("R'G'B' u8") ||
-                    format == babl_format ("R'G'B'A u8"));
-
   bpp       = babl_format_get_bytes_per_pixel (format);
   has_alpha = babl_format_has_alpha (format);
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
-  /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
-
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
                                    NULL, 0, format,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
-  if (progress)
-    gimp_progress_set_value (progress, 0.0);
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *data   = iter->data[0];
       gint          length = iter->length;
 
-      total_size += length;
-
-      /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
+      col     = roi->x + offsetx;
+      coledge = col + roi->width;
+      row     = roi->y + offsety;
 
-      if (needs_quantize)
+      while (length--)
         {
-          if (dither_alpha)
+          if (! histogram_pixel_is_transparent (data, has_alpha, dither_alpha,
+                                                col, row))
             {
-              /* if alpha-dithering,
-                 we need to be deterministic w.r.t. offsets */
-
-              col = roi->x + offsetx;
-              coledge = col + roi->width;
-              row = roi->y + offsety;
-
-              while (length--)
+              for (nfc_iter = 0;
+                   nfc_iter < num_found_cols;
+                   nfc_iter++)
                 {
-                  gboolean transparent = FALSE;
-
-                  if (has_alpha &&
-                      data[ALPHA] <
-                      DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-                    transparent = TRUE;
+                  if ((data[RED]   == found_cols[nfc_iter][0]) &&
+                      (data[GREEN] == found_cols[nfc_iter][1]) &&
+                      (data[BLUE]  == found_cols[nfc_iter][2]))
+                    goto already_found;
+                }
 
-                  if (! transparent)
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
-                    }
+              /* Color was not in the table of
+               * existing colors
+               */
 
-                  col++;
-                  if (col == coledge)
-                    {
-                      col = roi->x + offsetx;
-                      row++;
-                    }
+              num_found_cols++;
 
-                  data += bpp;
+              if (num_found_cols > col_limit)
+                {
+                  /* There are more colors in the image than
+                   *  were allowed.  We switch to plain
+                   *  histogram calculation with a view to
+                   *  quantizing at a later stage.
+                   */
+                  needs_quantize = TRUE;
+                  /* g_print ("\nmax colors exceeded - needs quantize.\n");*/
+                  break;
                 }
-            }
-          else
-            {
-              while (length--)
+              else
                 {
-                  if ((has_alpha && ((data[ALPHA] > 127)))
-                      || (!has_alpha))
-                    {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
-                    }
-
-                  data += bpp;
+                  /* Remember the new color we just found.
+                   */
+                  found_cols[num_found_cols-1][0] = data[RED];
+                  found_cols[num_found_cols-1][1] = data[GREEN];
+                  found_cols[num_found_cols-1][2] = data[BLUE];
                 }
             }
+        already_found:
+
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + offsetx;
+              row++;
+            }
+
+          data += bpp;
         }
-      else
+
+      if (needs_quantize)
         {
-          /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
-          col = roi->x + offsetx;
-          coledge = col + roi->width;
-          row = roi->y + offsety;
+          gegl_buffer_iterator_stop (iter);
+          break;
+        }
+    }
+}
 
-          while (length--)
-            {
-              gboolean transparent = FALSE;
+/*  Accumulates the histogram of one horizontal band of the layer.
+ *  Band 0 goes straight into the main histogram, the others into
+ *  their own, which are summed up afterwards.
+ */
+static void
+generate_histogram_rgb_func (gint     i,
+                             gint     n,
+                             gpointer user_data)
+{
+  GenerateHistogramRGBData *data = user_data;
+  CFHistogram               histogram;
+  GeglBufferIterator       *iter;
+  GeglRectangle            *roi;
+  GeglRectangle             rect;
+  gfloat                   *rgb      = NULL;
+  gfloat                   *lab      = NULL;
+  gint                      buf_size = 0;
+  gint                      bpp;
+  gboolean                  has_alpha;
+
+  rect.x      = data->rect.x;
+  rect.width  = data->rect.width;
+  rect.y      = data->rect.y + data->rect.height * i / n;
+  rect.height = data->rect.y + data->rect.height * (i + 1) / n - rect.y;
+
+  if (rect.height == 0)
+    return;
+
+  if (i == 0)
+    {
+      histogram = data->histogram;
+    }
+  else
+    {
+      histogram = g_new0 (ColorFreq,
+                          HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
 
-              if (has_alpha)
-                {
-                  if (dither_alpha)
-                    {
-                      if (data[ALPHA] <
-                          DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-                        transparent = TRUE;
-                    }
-                  else
-                    {
-                      if (data[ALPHA] <= 127)
-                        transparent = TRUE;
-                    }
-                }
+      data->band_histograms[i] = histogram;
+    }
 
-              if (! transparent)
-                {
-                  colfreq = HIST_RGB (histogram,
-                                      data[RED],
-                                      data[GREEN],
-                                      data[BLUE]);
-                  (*colfreq)++;
+  bpp       = babl_format_get_bytes_per_pixel (data->format);
+  has_alpha = babl_format_has_alpha (data->format);
 
-                  if (!needs_quantize)
-                    {
-                      for (nfc_iter = 0;
-                           nfc_iter < num_found_cols;
-                           nfc_iter++)
-                        {
-                          if ((data[RED]   == found_cols[nfc_iter][0]) &&
-                              (data[GREEN] == found_cols[nfc_iter][1]) &&
-                              (data[BLUE]  == found_cols[nfc_iter][2]))
-                            goto already_found;
-                        }
+  iter = gegl_buffer_iterator_new (data->buffer, &rect, 0, data->format,
+                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  roi = &iter->roi[0];
 
-                      /* Color was not in the table of
-                       * existing colors
-                       */
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const guchar *src      = iter->data[0];
+      gint          length   = iter->length;
+      gint          n_colors = 0;
+      gint          row, col, coledge;
+      gint          j;
 
-                      num_found_cols++;
+      if (length > buf_size)
+        {
+          buf_size = length;
 
-                      if (num_found_cols > col_limit)
-                        {
-                          /* There are more colors in the image than
-                           *  were allowed.  We switch to plain
-                           *  histogram calculation with a view to
-                           *  quantizing at a later stage.
-                           */
-                          needs_quantize = TRUE;
-                          /* g_print ("\nmax colors exceeded - needs quantize.\n");*/
-                          goto already_found;
-                        }
-                      else
-                        {
-                          /* Remember the new color we just found.
-                           */
-                          found_cols[num_found_cols-1][0] = data[RED];
-                          found_cols[num_found_cols-1][1] = data[GREEN];
-                          found_cols[num_found_cols-1][2] = data[BLUE];
-                        }
-                    }
-                }
-            already_found:
+          rgb = g_renew (gfloat, rgb, 3 * buf_size);
+          lab = g_renew (gfloat, lab, 3 * buf_size);
+        }
 
-              col++;
-              if (col == coledge)
-                {
-                  col = roi->x + offsetx;
-                  row++;
-                }
+      col     = roi->x + data->offsetx;
+      coledge = col + roi->width;
+      row     = roi->y + data->offsety;
 
-              data += bpp;
+      while (length--)
+        {
+          if (! histogram_pixel_is_transparent (src, has_alpha,
+                                                data->dither_alpha,
+                                                col, row))
+            {
+              rgb[3 * n_colors + 0] = src[RED]   / 255.0;
+              rgb[3 * n_colors + 1] = src[GREEN] / 255.0;
+              rgb[3 * n_colors + 2] = src[BLUE]  / 255.0;
+
+              n_colors++;
             }
+
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + data->offsetx;
+              row++;
+            }
+
+          src += bpp;
         }
 
-      if (progress && (count % 16 == 0))
-        gimp_progress_set_value (progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
+      babl_process (rgb_to_lab_fish, rgb, lab, n_colors);
+
+      for (j = 0; j < n_colors; j++)
+        {
+          gint hr, hg, hb;
+
+          lab_to_lin (lab + 3 * j, &hr, &hg, &hb);
+
+          (*HIST_LIN (histogram, hr, hg, hb))++;
+        }
+    }
+
+  g_free (rgb);
+  g_free (lab);
+}
+
+/*  Adds a slice of the other bands' histograms to the main one.  */
+static void
+generate_histogram_rgb_merge_func (gsize    offset,
+                                   gsize    size,
+                                   gpointer user_data)
+{
+  GenerateHistogramRGBData *data = user_data;
+  gint                      i;
+
+  for (i = 1; i < MAX_HISTOGRAM_BANDS; i++)
+    {
+      const ColorFreq *src  = data->band_histograms[i];
+      ColorFreq       *dest = data->histogram + offset;
+      gsize            j;
+
+      if (! src)
+        continue;
+
+      src += offset;
+
+      for (j = 0; j < size; j++)
+        dest[j] += src[j];
     }
+}
+
+static void
+generate_histogram_rgb (CFHistogram   histogram,
+                        GimpLayer    *layer,
+                        gint          col_limit,
+                        gboolean      dither_alpha,
+                        GimpProgress *progress,
+                        gint          nth_layer,
+                        gint          n_layers)
+{
+  GenerateHistogramRGBData data = { 0, };
+  const Babl               *format;
+  gint                      max_n;
+  gint                      i;
+
+  format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
+
+  g_return_if_fail (format == babl_format ("R'G'B' u8") ||
+                    format == babl_format ("R'G'B'A u8"));
+
+  if (progress)
+    gimp_progress_set_value (progress, (gdouble) nth_layer / n_layers);
+
+  /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
+
+  /*  as long as the image has no more colors than allowed, we need
+   *  to know them exactly, which has to be done in order
+   */
+  if (! needs_quantize)
+    find_colors_rgb (layer, format, col_limit, dither_alpha);
+
+  data.buffer       = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.format       = format;
+  data.rect         = *GEGL_RECTANGLE (0, 0,
+                                       gimp_item_get_width  (GIMP_ITEM (layer)),
+                                       gimp_item_get_height (GIMP_ITEM (layer)));
+  data.dither_alpha = dither_alpha;
+  data.histogram    = histogram;
+
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
+
+  /*  every additional band costs a histogram to allocate and sum up,
+   *  only worth it for enough pixels
+   */
+  max_n = CLAMP ((gint64) data.rect.width * data.rect.height /
+                 MIN_HISTOGRAM_BAND_SIZE,
+                 1, MAX_HISTOGRAM_BANDS);
+
+  gimp_parallel_distribute (max_n, generate_histogram_rgb_func, &data);
+
+  if (max_n > 1)
+    {
+      gimp_parallel_distribute_range (HIST_R_ELEMS *
+                                      HIST_G_ELEMS *
+                                      HIST_B_ELEMS,
+                                      MIN_HISTOGRAM_MERGE_SIZE,
+                                      generate_histogram_rgb_merge_func,
+                                      &data);
+
+      for (i = 1; i < MAX_HISTOGRAM_BANDS; i++)
+        g_free (data.band_histograms[i]);
+    }
+
+  if (progress)
+    gimp_progress_set_value (progress, (gdouble) (nth_layer + 1) / n_layers);
 
 /*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit, num_found_cols);*/
 }
@@ -2729,6 +2901,35 @@ fill_inverse_cmap_rgb (QuantizeObj *quantobj,
     }
 }
 
+/* Like fill_inverse_cmap_rgb(), but only returns the colormap index
+ * for histogram cell R/G/B instead of storing it, so it can be used
+ * by several threads sharing the cache.
+ */
+static gint
+find_inverse_cmap_rgb (QuantizeObj *quantobj,
+                       gint         R,
+                       gint         G,
+                       gint         B)
+{
+  gint minR, minG, minB;
+  gint colorlist[MAXNUMCOLORS];
+  gint numcolors;
+  gint bestcolor[BOX_R_ELEMS * BOX_G_ELEMS * BOX_B_ELEMS] = { 0, };
+
+  minR = ((R >> BOX_R_LOG) << BOX_R_SHIFT) + ((1 << R_SHIFT) >> 1);
+  minG = ((G >> BOX_G_LOG) << BOX_G_SHIFT) + ((1 << G_SHIFT) >> 1);
+  minB = ((B >> BOX_B_LOG) << BOX_B_SHIFT) + ((1 << B_SHIFT) >> 1);
+
+  numcolors = find_nearby_colors (quantobj, minR, minG, minB, colorlist);
+
+  find_best_colors (quantobj, minR, minG, minB, numcolors, colorlist,
+                    bestcolor);
+
+  return bestcolor[(((R & (BOX_R_ELEMS - 1)) * BOX_G_ELEMS) +
+                    (G & (BOX_G_ELEMS - 1))) * BOX_B_ELEMS +
+                   (B & (BOX_B_ELEMS - 1))];
+}
+
 
 /*  This is pass 1  */
 
@@ -3073,11 +3274,22 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
     }
 }
 
+typedef struct
+{
+  QuantizeObj *quantobj;
+  GimpLayer   *layer;
+  GeglBuffer  *new_buffer;
+  gboolean     parallel;
+  GMutex       mutex;
+} NoDitherRGBData;
+
 static void
-median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_rgb_area (const GeglRectangle *area,
+                                     gpointer             user_data)
 {
+  NoDitherRGBData    *data      = user_data;
+  QuantizeObj        *quantobj  = data->quantobj;
+  GimpLayer          *layer     = data->layer;
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
   ColorFreq          *cachep;
@@ -3094,17 +3306,18 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
   gint                alpha_pix        = ALPHA;
   gboolean            dither_alpha     = quantobj->want_dither_alpha;
   gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
+  gulong              index_used_count[256] = { 0, };
   glong               total_size       = 0;
   glong               layer_size;
   gint                count            = 0;
   gint                nth_layer        = quantobj->nth_layer;
   gint                n_layers         = quantobj->n_layers;
+  gint                i;
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
   src_format  = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-  dest_format = gegl_buffer_get_format (new_buffer);
+  dest_format = gegl_buffer_get_format (data->new_buffer);
 
   src_bpp  = babl_format_get_bytes_per_pixel (src_format);
   dest_bpp = babl_format_get_bytes_per_pixel (dest_format);
@@ -3121,12 +3334,12 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
     }
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
-  gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+  gegl_buffer_iterator_add (iter, data->new_buffer,
+                            area, 0, NULL,
                             GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
 
   layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
@@ -3146,6 +3359,8 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
 
           for (col = 0; col < src_roi->width; col++)
             {
+              gint index;
+
               if (has_alpha)
                 {
                   gboolean transparent = FALSE;
@@ -3180,14 +3395,30 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
                           &R, &G, &B);
 
               cachep = HIST_LIN (histogram, R, G, B);
-              /* If we have not seen this color before, find nearest
-               * colormap entry and update the cache
-               */
-              if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+
+              if (*cachep != 0)
+                {
+                  index = *cachep - 1;
+                }
+              else if (data->parallel)
+                {
+                  /* The cache is shared, and is only ever written
+                   * before the threads start
+                   */
+                  index = find_inverse_cmap_rgb (quantobj, R, G, B);
+                }
+              else
+                {
+                  /* If we have not seen this color before, find nearest
+                   * colormap entry and update the cache
+                   */
+                  fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+
+                  index = *cachep - 1;
+                }
 
               /* Now emit the colormap index for this cell, barfbarf */
-              index_used_count[dest[INDEXED] = *cachep - 1]++;
+              index_used_count[dest[INDEXED] = index]++;
 
             next_pixel:
 
@@ -3196,11 +3427,60 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
             }
         }
 
-      if (quantobj->progress && (count % 16 == 0))
+      if (! data->parallel && quantobj->progress && (count % 16 == 0))
          gimp_progress_set_value (quantobj->progress,
                                   (nth_layer + ((gdouble) total_size)/
                                    layer_size) / (gdouble) n_layers);
     }
+
+  g_mutex_lock (&data->mutex);
+
+  for (i = 0; i < 256; i++)
+    quantobj->index_used_count[i] += index_used_count[i];
+
+  g_mutex_unlock (&data->mutex);
+}
+
+static void
+median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
+                                GimpLayer   *layer,
+                                GeglBuffer  *new_buffer)
+{
+  NoDitherRGBData data;
+  GeglRectangle   rect;
+
+  data.quantobj   = quantobj;
+  data.layer      = layer;
+  data.new_buffer = new_buffer;
+
+  /*  pixels only map to colors independently of each other as long as
+   *  the cache doesn't need to be filled on the way
+   */
+  data.parallel   = quantobj->inverse_cmap_complete;
+
+  g_mutex_init (&data.mutex);
+
+  rect = *GEGL_RECTANGLE (0, 0,
+                          gimp_item_get_width  (GIMP_ITEM (layer)),
+                          gimp_item_get_height (GIMP_ITEM (layer)));
+
+  if (data.parallel)
+    {
+      gimp_parallel_distribute_area (&rect, MIN_PARALLEL_SUB_AREA,
+                                     median_cut_pass2_no_dither_rgb_area,
+                                     &data);
+
+      if (quantobj->progress)
+        gimp_progress_set_value (quantobj->progress,
+                                 (quantobj->nth_layer + 1.0) /
+                                 (gdouble) quantobj->n_layers);
+    }
+  else
+    {
+      median_cut_pass2_no_dither_rgb_area (&rect, &data);
+    }
+
+  g_mutex_clear (&data.mutex);
 }
 
 static void
@@ -3873,13 +4153,30 @@ median_cut_pass2_fs_dither_gray (QuantizeObj *quantobj,
   g_free (dest_buf);
 }
 
+static void
+median_cut_pass2_rgb_init_func (gsize    offset,
+                                gsize    size,
+                                gpointer user_data)
+{
+  QuantizeObj *quantobj  = user_data;
+  CFHistogram  histogram = quantobj->histogram;
+  gint         R, G, B;
+
+  for (R = offset << BOX_R_LOG; R < (offset + size) << BOX_R_LOG; R++)
+    for (G = 0; G < HIST_G_ELEMS; G++)
+      for (B = 0; B < HIST_B_ELEMS; B++)
+        {
+          if (quantobj->want_full_inverse_cmap ||
+              *HIST_LIN (histogram, R, G, B))
+            fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+        }
+}
+
 static void
 median_cut_pass2_rgb_init (QuantizeObj *quantobj)
 {
   int i;
 
-  zero_histogram_rgb (quantobj->histogram);
-
   /* Mark all indices as currently unused */
   memset (quantobj->index_used_count, 0, 256 * sizeof (gulong));
 
@@ -3893,6 +4190,30 @@ median_cut_pass2_rgb_init (QuantizeObj *quantobj)
                             &quantobj->clin[i].green,
                             &quantobj->clin[i].blue);
     }
+
+  if (quantobj->want_full_inverse_cmap ||
+      quantobj->first_pass == median_cut_pass1_rgb)
+    {
+      /* The histogram still holds the count of every color of the
+       * image, so we know the cells the second pass will look up.
+       * Turn them into the inverse colormap right away, on all
+       * threads, instead of one by one when they are first met.
+       * The update boxes along R never overlap, so each thread
+       * writes its own cells only.
+       *
+       * Banded dithering looks up colors that are nowhere in the
+       * image, so it gets every cell filled instead.
+       */
+      gimp_parallel_distribute_range (HIST_R_ELEMS >> BOX_R_LOG, 1,
+                                      median_cut_pass2_rgb_init_func,
+                                      quantobj);
+
+      quantobj->inverse_cmap_complete = TRUE;
+    }
+  else
+    {
+      zero_histogram_rgb (quantobj->histogram);
+    }
 }
 
 static void
@@ -3904,10 +4225,21 @@ median_cut_pass2_gray_init (QuantizeObj *quantobj)
   memset (quantobj->index_used_count, 0, 256 * sizeof (gulong));
 }
 
+/* Dithers the rows from first_row to y + height - 1 of the layer, but
+ * only writes the rows from y on.  The error diffusion starts from zero
+ * at first_row, and the serpentine direction of a row only depends on
+ * the row, so dithering all of the layer at once and dithering it in
+ * bands give the same rows.
+ */
 static void
-median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+median_cut_pass2_fs_dither_rgb_rows (QuantizeObj *quantobj,
+                                     GimpLayer   *layer,
+                                     GeglBuffer  *new_buffer,
+                                     gint         first_row,
+                                     gint         y,
+                                     gint         height,
+                                     gulong      *index_used_count,
+                                     gboolean     show_progress)
 {
   GeglBuffer   *src_buffer;
   CFHistogram   histogram = quantobj->histogram;
@@ -3935,14 +4267,14 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   gint          step_dest, step_src;
   gint          odd_row;
   gboolean      has_alpha;
-  gint          width, height;
+  gint          width;
+  gint          layer_height;
   gint          red_pix   = RED;
   gint          green_pix = GREEN;
   gint          blue_pix  = BLUE;
   gint          alpha_pix = ALPHA;
   gint          offsetx, offsety;
   gboolean      dither_alpha     = quantobj->want_dither_alpha;
-  gulong       *index_used_count = quantobj->index_used_count;
   gint          global_rmax = 0, global_rmin = G_MAXINT;
   gint          global_gmax = 0, global_gmin = G_MAXINT;
   gint          global_bmax = 0, global_bmin = G_MAXINT;
@@ -3967,8 +4299,8 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 
   has_alpha = babl_format_has_alpha (src_format);
 
-  width  = gimp_item_get_width  (GIMP_ITEM (layer));
-  height = gimp_item_get_height (GIMP_ITEM (layer));
+  width        = gimp_item_get_width  (GIMP_ITEM (layer));
+  layer_height = gimp_item_get_height (GIMP_ITEM (layer));
 
   error_limiter = init_error_limit (quantobj->error_freedom);
   range_limiter = range_array + 256;
@@ -4002,9 +4334,7 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   fs_err3 = floyd_steinberg_error3 + 511;
   fs_err4 = floyd_steinberg_error4 + 511;
 
-  odd_row = 0;
-
-  for (row = 0; row < height; row++)
+  for (row = first_row; row < y + height; row++)
     {
       const guchar *src;
       guchar       *dest;
@@ -4016,6 +4346,8 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
       src  = src_buf;
       dest = dest_buf;
 
+      odd_row = row & 1;
+
       rnr = red_n_row;
       gnr = grn_n_row;
       bnr = blu_n_row;
@@ -4155,9 +4487,11 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
                                    BSDF (be));
 
           index = *cachep - 1;
-          index_used_count[index]++;
           dest[INDEXED] = index;
 
+          if (row >= y)
+            index_used_count[index]++;
+
           /*if (re > global_rmax)
             re = (re + 3*global_rmax) / 4;
           else if (re < global_rmin)
@@ -4257,16 +4591,15 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
       blu_n_row = blu_p_row;
       blu_p_row = tmp;
 
-      odd_row = !odd_row;
-
-      gegl_buffer_set (new_buffer, GEGL_RECTANGLE (0, row, width, 1),
-                       0, NULL, dest_buf,
-                       GEGL_AUTO_ROWSTRIDE);
+      if (row >= y)
+        gegl_buffer_set (new_buffer, GEGL_RECTANGLE (0, row, width, 1),
+                         0, NULL, dest_buf,
+                         GEGL_AUTO_ROWSTRIDE);
 
-      if (quantobj->progress && (row % 16 == 0))
+      if (show_progress && quantobj->progress && (row % 16 == 0))
         gimp_progress_set_value (quantobj->progress,
                                  (nth_layer + ((gdouble) row) /
-                                  height) / (gdouble) n_layers);
+                                  layer_height) / (gdouble) n_layers);
     }
 
   g_free (error_limiter - 255);
@@ -4280,6 +4613,92 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
   g_free (dest_buf);
 }
 
+static void
+median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
+                                GimpLayer   *layer,
+                                GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_fs_dither_rgb_rows (quantobj, layer, new_buffer,
+                                       0, 0,
+                                       gimp_item_get_height (GIMP_ITEM (layer)),
+                                       quantobj->index_used_count,
+                                       TRUE);
+}
+
+typedef struct
+{
+  QuantizeObj *quantobj;
+  GimpLayer   *layer;
+  GeglBuffer  *new_buffer;
+  gint         height;
+  GMutex       mutex;
+} FSBandedDitherRGBData;
+
+static void
+median_cut_pass2_fs_banded_dither_rgb_func (gsize    offset,
+                                            gsize    size,
+                                            gpointer user_data)
+{
+  FSBandedDitherRGBData *data                  = user_data;
+  gulong                 index_used_count[256] = { 0, };
+  gsize                  band;
+  gint                   i;
+
+  for (band = offset; band < offset + size; band++)
+    {
+      gint y      = band * FS_DITHER_BAND_HEIGHT;
+      gint height = MIN (FS_DITHER_BAND_HEIGHT, data->height - y);
+
+      median_cut_pass2_fs_dither_rgb_rows (data->quantobj,
+                                           data->layer,
+                                           data->new_buffer,
+                                           MAX (y - FS_DITHER_BAND_OVERLAP, 0),
+                                           y, height,
+                                           index_used_count,
+                                           FALSE);
+    }
+
+  g_mutex_lock (&data->mutex);
+
+  for (i = 0; i < 256; i++)
+    data->quantobj->index_used_count[i] += index_used_count[i];
+
+  g_mutex_unlock (&data->mutex);
+}
+
+/* Floyd-Steinberg dithering in bands of FS_DITHER_BAND_HEIGHT rows,
+ * on all threads.  The bands don't depend on the number of threads,
+ * so neither does the result.  The threads only read the inverse
+ * colormap, which median_cut_pass2_rgb_init() filled completely.
+ */
+static void
+median_cut_pass2_fs_banded_dither_rgb (QuantizeObj *quantobj,
+                                       GimpLayer   *layer,
+                                       GeglBuffer  *new_buffer)
+{
+  FSBandedDitherRGBData data;
+  gint                  n_bands;
+
+  data.quantobj   = quantobj;
+  data.layer      = layer;
+  data.new_buffer = new_buffer;
+  data.height     = gimp_item_get_height (GIMP_ITEM (layer));
+
+  g_mutex_init (&data.mutex);
+
+  n_bands = (data.height + FS_DITHER_BAND_HEIGHT - 1) / FS_DITHER_BAND_HEIGHT;
+
+  gimp_parallel_distribute_range (n_bands, 1,
+                                  median_cut_pass2_fs_banded_dither_rgb_func,
+                                  &data);
+
+  g_mutex_clear (&data.mutex);
+
+  if (quantobj->progress)
+    gimp_progress_set_value (quantobj->progress,
+                             (quantobj->nth_layer + 1.0) /
+                             (gdouble) quantobj->n_layers);
+}
 
 static void
 delete_median_cut (QuantizeObj *quantobj)
@@ -4339,6 +4758,8 @@ initialize_median_cut (GimpImageBaseType       type,
     quantobj->histogram = g_new (ColorFreq,
                                  HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
 
+  quantobj->inverse_cmap_complete    = FALSE;
+  quantobj->want_full_inverse_cmap   = FALSE;
   quantobj->custom_palette           = custom_palette;
   quantobj->desired_number_of_colors = num_colors;
   quantobj->want_dither_alpha        = want_dither_alpha;
@@ -4386,6 +4807,12 @@ initialize_median_cut (GimpImageBaseType       type,
               quantobj->second_pass_init = median_cut_pass2_rgb_init;
               quantobj->second_pass = median_cut_pass2_fs_dither_rgb;
               break;
+            case GIMP_CONVERT_DITHER_FS_BANDED:
+              quantobj->error_freedom = 0;
+              quantobj->want_full_inverse_cmap = TRUE;
+              quantobj->second_pass_init = median_cut_pass2_rgb_init;
+              quantobj->second_pass = median_cut_pass2_fs_banded_dither_rgb;
+              break;
             case GIMP_CONVERT_DITHER_FIXED:
               quantobj->second_pass_init = median_cut_pass2_rgb_init;
               quantobj->second_pass = median_cut_pass2_fixed_dither_rgb;
@@ -4413,6 +4840,12 @@ initialize_median_cut (GimpImageBaseType       type,
               quantobj->second_pass_init = median_cut_pass2_gray_init;
               quantobj->second_pass = median_cut_pass2_fs_dither_gray;
               break;
+            case GIMP_CONVERT_DITHER_FS_BANDED:
+              /*  a gray histogram is small enough not to bother  */
+              quantobj->error_freedom = 0;
+              quantobj->second_pass_init = median_cut_pass2_gray_init;
+              quantobj->second_pass = median_cut_pass2_fs_dither_gray;
+              break;
             case GIMP_CONVERT_DITHER_FIXED:
               quantobj->second_pass_init = median_cut_pass2_gray_init;
               quantobj->second_pass = median_cut_pass2_fixed_dither_gray;
@@ -4456,6 +4889,12 @@ initialize_median_cut (GimpImageBaseType       type,
           quantobj->second_pass_init = median_cut_pass2_rgb_init;
           quantobj->second_pass = median_cut_pass2_fs_dither_rgb;
           break;
+        case GIMP_CONVERT_DITHER_FS_BANDED:
+          quantobj->error_freedom = 0;
+          quantobj->want_full_inverse_cmap = TRUE;
+          quantobj->second_pass_init = median_cut_pass2_rgb_init;
+          quantobj->second_pass = median_cut_pass2_fs_banded_dither_rgb;
+          break;
         case GIMP_CONVERT_DITHER_NODESTRUCT:
           quantobj->second_pass_init = NULL;
           quantobj->second_pass = median_cut_pass2_nodestruct_dither_rgb;
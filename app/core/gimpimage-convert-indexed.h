@@ -21,6 +21,9 @@
 
 #define MAXNUMCOLORS 256
 
+/*  the height of the bands of GIMP_CONVERT_DITHER_FS_BANDED  */
+#define FS_DITHER_BAND_HEIGHT 128
+
 
 gboolean   gimp_image_convert_indexed      (GimpImage               *image,
                                             GimpConvertPaletteType   palette_type,
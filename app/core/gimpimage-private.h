@@ -126,6 +126,8 @@ struct _GimpImagePrivate
   GimpUndoStack     *redo_stack;            /*  stack for redo operations    */
   gint               group_count;           /*  nested undo groups           */
   GimpUndoType       pushing_undo_group;    /*  undo group status flag       */
+  GimpSwapFile      *undo_swap_file;        /*  spilled undo data            */
+  gboolean           undo_swap_failed;      /*  don't retry spilling         */
 
   /*  Signal emission accumulator  */
   GimpImageFlushAccumulator  flush_accum;
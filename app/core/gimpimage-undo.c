@@ -32,16 +32,20 @@
 #include "gimpimage-undo.h"
 #include "gimpitem.h"
 #include "gimplist.h"
+#include "gimpswapfile.h"
 #include "gimpundostack.h"
 
+#include "gimp-intl.h"
+
 
 /*  local function prototypes  */
 
-static void          gimp_image_undo_pop_stack       (GimpImage     *image,
+static gboolean      gimp_image_undo_pop_stack       (GimpImage     *image,
                                                       GimpUndoStack *undo_stack,
                                                       GimpUndoStack *redo_stack,
                                                       GimpUndoMode   undo_mode);
 static void          gimp_image_undo_free_space      (GimpImage     *image);
+static gboolean      gimp_image_undo_swap_out_bottom (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
 static GimpDirtyMask gimp_image_undo_dirty_from_type (GimpUndoType   undo_type);
@@ -124,12 +128,10 @@ gimp_image_undo (GimpImage *image)
   g_return_val_if_fail (private->pushing_undo_group == GIMP_UNDO_GROUP_NONE,
                         FALSE);
 
-  gimp_image_undo_pop_stack (image,
-                             private->undo_stack,
-                             private->redo_stack,
-                             GIMP_UNDO_MODE_UNDO);
-
-  return TRUE;
+  return gimp_image_undo_pop_stack (image,
+                                    private->undo_stack,
+                                    private->redo_stack,
+                                    GIMP_UNDO_MODE_UNDO);
 }
 
 gboolean
@@ -144,12 +146,10 @@ gimp_image_redo (GimpImage *image)
   g_return_val_if_fail (private->pushing_undo_group == GIMP_UNDO_GROUP_NONE,
                         FALSE);
 
-  gimp_image_undo_pop_stack (image,
-                             private->redo_stack,
-                             private->undo_stack,
-                             GIMP_UNDO_MODE_REDO);
-
-  return TRUE;
+  return gimp_image_undo_pop_stack (image,
+                                    private->redo_stack,
+                                    private->undo_stack,
+                                    GIMP_UNDO_MODE_REDO);
 }
 
 /*
@@ -477,7 +477,11 @@ gimp_image_undo_get_fadeable (GimpImage *image)
     }
 
   if (GIMP_IS_DRAWABLE_UNDO (undo))
-    return undo;
+    {
+      /*  make the buffers available for "Fade"  */
+      if (gimp_undo_swap_in (undo, NULL))
+        return undo;
+    }
 
   return NULL;
 }
@@ -485,7 +489,7 @@ gimp_image_undo_get_fadeable (GimpImage *image)
 
 /*  private functions  */
 
-static void
+static gboolean
 gimp_image_undo_pop_stack (GimpImage     *image,
                            GimpUndoStack *undo_stack,
                            GimpUndoStack *redo_stack,
@@ -493,6 +497,26 @@ gimp_image_undo_pop_stack (GimpImage     *image,
 {
   GimpUndo            *undo;
   GimpUndoAccumulator  accum = { 0, };
+  GError              *error = NULL;
+
+  /*  a step moved to disk must be read back completely before it is
+   *  applied, or the image would be left partly transparent
+   */
+  undo = gimp_undo_stack_peek (undo_stack);
+
+  if (undo && ! gimp_undo_swap_in (undo, &error))
+    {
+      gimp_message (image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    (undo_mode == GIMP_UNDO_MODE_UNDO) ?
+                    _("Could not undo \"%s\", its data could not be "
+                      "read back from disk:\n\n%s") :
+                    _("Could not redo \"%s\", its data could not be "
+                      "read back from disk:\n\n%s"),
+                    gimp_object_get_name (undo), error->message);
+      g_clear_error (&error);
+
+      return FALSE;
+    }
 
   g_object_freeze_notify (G_OBJECT (image));
 
@@ -532,6 +556,8 @@ gimp_image_undo_pop_stack (GimpImage     *image,
     }
 
   g_object_thaw_notify (G_OBJECT (image));
+
+  return TRUE;
 }
 
 static void
@@ -542,24 +568,52 @@ gimp_image_undo_free_space (GimpImage *image)
   gint              min_undo_levels;
   gint              max_undo_levels;
   gint64            undo_size;
+  gint64            undo_swap_size;
 
   container = private->undo_stack->undos;
 
   min_undo_levels = image->gimp->config->levels_of_undo;
   max_undo_levels = 1024; /* FIXME */
   undo_size       = image->gimp->config->undo_size;
+  undo_swap_size  = 0;
+
+  /*  the default swap size follows the current undo size  */
+  if (image->gimp->config->undo_swap)
+    {
+      undo_swap_size = image->gimp->config->undo_swap_size;
+
+      if (undo_swap_size == 0)
+        undo_swap_size = undo_size * 4;
+    }
 
 #ifdef DEBUG_IMAGE_UNDO
-  g_printerr ("undo_steps: %d    undo_bytes: %ld\n",
+  g_printerr ("undo_steps: %d    undo_bytes: %ld    swapped_bytes: %ld\n",
               gimp_container_get_n_children (container),
-              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL));
+              (glong) gimp_object_get_memsize (GIMP_OBJECT (container), NULL),
+              (glong) gimp_undo_stack_get_swapped_size (private->undo_stack));
 #endif
 
+  /*  move the oldest undo steps to disk rather than discarding them  */
+  if (undo_swap_size > 0)
+    {
+      while (gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size &&
+             gimp_image_undo_swap_out_bottom (image))
+        {
+#ifdef DEBUG_IMAGE_UNDO
+          g_printerr ("swapped one step: undo_bytes: %ld    swapped_bytes: %ld\n",
+                      (glong) gimp_object_get_memsize (GIMP_OBJECT (container),
+                                                       NULL),
+                      (glong) gimp_undo_stack_get_swapped_size (private->undo_stack));
+#endif
+        }
+    }
+
   /*  keep at least min_undo_levels undo steps  */
   if (gimp_container_get_n_children (container) <= min_undo_levels)
     return;
 
   while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
+         (gimp_undo_stack_get_swapped_size (private->undo_stack) > undo_swap_size) ||
          (gimp_container_get_n_children (container) > max_undo_levels))
     {
       GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
@@ -581,6 +635,60 @@ gimp_image_undo_free_space (GimpImage *image)
     }
 }
 
+static gboolean
+gimp_image_undo_swap_out_bottom (GimpImage *image)
+{
+  GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+  GList            *list;
+  GError           *error   = NULL;
+
+  if (private->undo_swap_failed)
+    return FALSE;
+
+  if (! private->undo_swap_file)
+    {
+      GFile *file = gimp_get_temp_file (image->gimp, "swap");
+
+      private->undo_swap_file = gimp_swap_file_new (file, &error);
+
+      g_object_unref (file);
+    }
+
+  if (private->undo_swap_file)
+    {
+      /*  never swap out the most recent step, it is the one "Fade"
+       *  and friends operate on
+       */
+      for (list = GIMP_LIST (private->undo_stack->undos)->queue->tail;
+           list && list->prev;
+           list = g_list_previous (list))
+        {
+          GimpUndo *undo = list->data;
+
+          if (gimp_undo_is_swapped (undo))
+            continue;
+
+          if (gimp_undo_swap_out (undo, private->undo_swap_file, &error))
+            return TRUE;
+
+          break;
+        }
+    }
+
+  if (error)
+    {
+      gimp_message (image->gimp, NULL, GIMP_MESSAGE_WARNING,
+                    _("Could not move undo steps to disk, the oldest "
+                      "steps will be discarded instead:\n\n%s"),
+                    error->message);
+      g_clear_error (&error);
+
+      private->undo_swap_failed = TRUE;
+    }
+
+  return FALSE;
+}
+
 static void
 gimp_image_undo_free_redo (GimpImage *image)
 {
@@ -74,6 +74,7 @@
 #include "gimpprojection.h"
 #include "gimpsamplepoint.h"
 #include "gimpselection.h"
+#include "gimpswapfile.h"
 #include "gimpsymmetry.h"
 #include "gimptempbuf.h"
 #include "gimptemplate.h"
@@ -1083,6 +1084,8 @@ gimp_image_finalize (GObject *object)
   g_clear_object (&private->undo_stack);
   g_clear_object (&private->redo_stack);
 
+  g_clear_pointer (&private->undo_swap_file, gimp_swap_file_unref);
+
   if (image->gimp && image->gimp->image_table)
     {
       gimp_id_table_remove (image->gimp->image_table, private->ID);
@@ -2341,7 +2344,7 @@ gimp_image_get_export_proc (GimpImage *image)
 
 gint
 gimp_image_get_xcf_version (GimpImage    *image,
-                            gboolean      zlib_compression,
+                            gboolean      compression,
                             gint         *gimp_version,
                             const gchar **version_string)
 {
@@ -2460,9 +2463,18 @@ gimp_image_get_xcf_version (GimpImage    *image,
   if (gimp_image_get_precision (image) != GIMP_PRECISION_U8_GAMMA)
     version = MAX (7, version);
 
-  /* need version 8 for zlib compression */
-  if (zlib_compression)
-    version = MAX (8, version);
+  /* need version 8 for zlib compression, and version 12 for zstd
+   * compression, which is used instead when xcf-fast-compression is set
+   */
+  if (compression)
+    {
+      version = MAX (8, version);
+
+#ifdef HAVE_ZSTD
+      if (image->gimp->config->xcf_fast_compression)
+        version = MAX (12, version);
+#endif
+    }
 
   /* if version is 10 (lots of new layer modes), go to version 11 with
    * 64 bit offsets right away
@@ -2502,6 +2514,13 @@ gimp_image_get_xcf_version (GimpImage    *image,
       if (gimp_version)   *gimp_version   = 210;
       if (version_string) *version_string = "GIMP 2.10";
       break;
+
+    case 12:
+      /*  not readable by any released GIMP yet  */
+      if (gimp_version)   *gimp_version   = (GIMP_MAJOR_VERSION * 100 +
+                                             GIMP_MINOR_VERSION);
+      if (version_string) *version_string = "GIMP " GIMP_VERSION;
+      break;
     }
 
   return version;
@@ -172,7 +172,7 @@ void            gimp_image_exported              (GimpImage          *image,
                                                   GFile              *file);
 
 gint            gimp_image_get_xcf_version       (GimpImage          *image,
-                                                  gboolean            zlib_compression,
+                                                  gboolean            compression,
                                                   gint               *gimp_version,
                                                   const gchar       **version_string);
 
@@ -27,6 +27,7 @@
 #include "gimp-memsize.h"
 #include "gimpchannel.h"
 #include "gimpmaskundo.h"
+#include "gimpswapfile.h"
 
 
 enum
@@ -54,6 +55,11 @@ static void     gimp_mask_undo_pop          (GimpUndo            *undo,
                                              GimpUndoAccumulator *accum);
 static void     gimp_mask_undo_free         (GimpUndo            *undo,
                                              GimpUndoMode         undo_mode);
+static gboolean gimp_mask_undo_swap_out     (GimpUndo            *undo,
+                                             GimpSwapFile        *swap_file,
+                                             GError             **error);
+static gboolean gimp_mask_undo_swap_in      (GimpUndo            *undo,
+                                             GError             **error);
 
 
 G_DEFINE_TYPE (GimpMaskUndo, gimp_mask_undo, GIMP_TYPE_ITEM_UNDO)
@@ -76,6 +82,8 @@ gimp_mask_undo_class_init (GimpMaskUndoClass *klass)
 
   undo_class->pop                = gimp_mask_undo_pop;
   undo_class->free               = gimp_mask_undo_free;
+  undo_class->swap_out           = gimp_mask_undo_swap_out;
+  undo_class->swap_in            = gimp_mask_undo_swap_in;
 
   g_object_class_install_property (object_class, PROP_CONVERT_FORMAT,
                                    g_param_spec_boolean ("convert-format",
@@ -281,6 +289,55 @@ gimp_mask_undo_free (GimpUndo     *undo,
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
 
   g_clear_object (&mask_undo->buffer);
+  g_clear_pointer (&mask_undo->buffer_entry, gimp_swap_entry_free);
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gboolean
+gimp_mask_undo_swap_out (GimpUndo      *undo,
+                         GimpSwapFile  *swap_file,
+                         GError       **error)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  /*  an empty mask has no buffer  */
+  if (mask_undo->buffer)
+    {
+      mask_undo->buffer_entry =
+        gimp_swap_file_write_buffer (swap_file, mask_undo->buffer, error);
+
+      if (! mask_undo->buffer_entry)
+        return FALSE;
+
+      g_clear_object (&mask_undo->buffer);
+    }
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_out (undo, swap_file, error);
+}
+
+static gboolean
+gimp_mask_undo_swap_in (GimpUndo  *undo,
+                        GError   **error)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  if (mask_undo->buffer_entry)
+    {
+      GError *my_error = NULL;
+
+      mask_undo->buffer =
+        gimp_swap_entry_read_buffer (mask_undo->buffer_entry, &my_error);
+
+      g_clear_pointer (&mask_undo->buffer_entry, gimp_swap_entry_free);
+
+      if (my_error)
+        {
+          g_propagate_error (error, my_error);
+
+          return FALSE;
+        }
+    }
+
+  return GIMP_UNDO_CLASS (parent_class)->swap_in (undo, error);
+}
@@ -39,10 +39,12 @@ struct _GimpMaskUndo
 
   gboolean      convert_format;
 
-  GeglBuffer   *buffer;
-  gint          x;
-  gint          y;
-  const Babl   *format;
+  GeglBuffer    *buffer;
+  gint           x;
+  gint           y;
+  const Babl    *format;
+
+  GimpSwapEntry *buffer_entry;  /* the buffer while swapped out */
 };
 
 struct _GimpMaskUndoClass
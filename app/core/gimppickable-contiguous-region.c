@@ -30,9 +30,84 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimp-utils.h" /* GIMP_TIMER */
 #include "gimppickable.h"
 #include "gimppickable-contiguous-region.h"
+#include "gimpprogress.h"
+
+#include "gimp-intl.h"
+
+
+/*  the fill compares the pixels to the start color one square tile at
+ *  a time, when it first gets there
+ */
+#define FILL_TILE_SHIFT 6
+#define FILL_TILE_SIZE  (1 << FILL_TILE_SHIFT)
+#define FILL_TILE_MASK  (FILL_TILE_SIZE - 1)
+
+/*  microseconds between two progress updates  */
+#define PROGRESS_INTERVAL 50000
+
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+} PixelDifferenceData;
+
+typedef struct
+{
+  GimpProgress        *progress;
+  gboolean             started;
+  gboolean             cancellable;
+  gboolean             cancel;
+  gint64               last_update;
+} RegionProgress;
+
+typedef struct
+{
+  PixelDifferenceData  diff;
+  GeglRectangle        extent;
+  gint                 n_tiles_x;
+  gint                 n_tiles_y;
+
+  /*  per tile, how closely each of its pixels matches, negated while
+   *  the pixel is not reached by the fill yet; NULL for the tiles the
+   *  fill didn't get to
+   */
+  gfloat             **tiles;
+
+  /*  the bounding box of the computed tiles, in tiles; empty at first  */
+  gint                 computed_x1;
+  gint                 computed_y1;
+  gint                 computed_x2;
+  gint                 computed_y2;
+
+  /*  the tiles to compute in parallel  */
+  gint                *missing;
+  gint                 n_missing;
+
+  RegionProgress      *progress;
+} FillData;
+
+typedef struct
+{
+  PixelDifferenceData  diff;
+  GeglBuffer          *mask_buffer;
+  GeglRectangle        extent;
+  gint                 band_y;
+  gint                 band_height;
+  gint                 first_band;
+  gint                 n_bands;
+} ByColorData;
 
 
 /*  local function prototypes  */
@@ -49,6 +124,22 @@ static gfloat   pixel_difference          (const gfloat        *col1,
                                            gboolean             has_alpha,
                                            gboolean             select_transparent,
                                            GimpSelectCriterion  select_criterion);
+static void     pixel_difference_row      (const PixelDifferenceData *data,
+                                           const gfloat        *src,
+                                           gfloat              *dest,
+                                           gint                 width,
+                                           gboolean             unvisited);
+static void     by_color_bands            (gint                 i,
+                                           gint                 n,
+                                           gpointer             user_data);
+static void     region_progress_start     (RegionProgress      *progress,
+                                           GimpProgress        *gimp_progress,
+                                           const gchar         *text);
+static void     region_progress_update    (RegionProgress      *progress,
+                                           gdouble              value);
+static void     region_progress_end       (RegionProgress      *progress);
+static void     region_progress_cancel    (GimpProgress        *gimp_progress,
+                                           RegionProgress      *progress);
 static void     push_segment              (GQueue              *segment_queue,
                                            gint                 y,
                                            gint                 old_y,
@@ -62,24 +153,24 @@ static void     pop_segment               (GQueue              *segment_queue,
                                            gint                *old_y,
                                            gint                *start,
                                            gint                *end);
-static gboolean find_contiguous_segment   (const gfloat        *col,
-                                           GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *src_format,
-                                           const Babl          *mask_format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gint                 width,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
-                                           gboolean             antialias,
-                                           gfloat               threshold,
+static gboolean fill_tile_is_frontier     (FillData            *fill,
+                                           gint                 tile_x,
+                                           gint                 tile_y);
+static void     fill_compute_tiles        (FillData            *fill,
+                                           gint                 tile_x,
+                                           gint                 tile_y);
+static void     fill_compute_tiles_func   (gint                 i,
+                                           gint                 n,
+                                           gpointer             user_data);
+static inline gfloat * fill_pixel         (FillData            *fill,
+                                           gint                 x,
+                                           gint                 y);
+static gboolean find_contiguous_segment   (FillData            *fill,
+                                           gint                 y,
                                            gint                 initial_x,
-                                           gint                 initial_y,
                                            gint                *start,
-                                           gint                *end,
-                                           gfloat              *row);
-static void     find_contiguous_region    (GeglBuffer          *src_buffer,
+                                           gint                *end);
+static gboolean find_contiguous_region    (GeglBuffer          *src_buffer,
                                            GeglBuffer          *mask_buffer,
                                            const Babl          *format,
                                            gint                 n_components,
@@ -91,7 +182,8 @@ static void     find_contiguous_region    (GeglBuffer          *src_buffer,
                                            gboolean             diagonal_neighbors,
                                            gint                 x,
                                            gint                 y,
-                                           const gfloat        *col);
+                                           const gfloat        *col,
+                                           RegionProgress      *progress);
 
 
 /*  public functions  */
@@ -104,17 +196,20 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
                                          GimpSelectCriterion  select_criterion,
                                          gboolean             diagonal_neighbors,
                                          gint                 x,
-                                         gint                 y)
+                                         gint                 y,
+                                         GimpProgress        *progress)
 {
-  GeglBuffer    *src_buffer;
-  GeglBuffer    *mask_buffer;
-  const Babl    *format;
-  GeglRectangle  extent;
-  gint           n_components;
-  gboolean       has_alpha;
-  gfloat         start_col[MAX_CHANNELS];
+  GeglBuffer     *src_buffer;
+  GeglBuffer     *mask_buffer;
+  const Babl     *format;
+  GeglRectangle   extent;
+  gint            n_components;
+  gboolean        has_alpha;
+  gfloat          start_col[MAX_CHANNELS];
+  RegionProgress  region_progress;
 
   g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
 
   gimp_pickable_flush (pickable);
 
@@ -149,15 +244,25 @@ gimp_pickable_contiguous_region_by_seed (GimpPickable        *pickable,
   if (x >= extent.x && x < (extent.x + extent.width) &&
       y >= extent.y && y < (extent.y + extent.height))
     {
+      gboolean found;
+
       GIMP_TIMER_START();
 
-      find_contiguous_region (src_buffer, mask_buffer,
-                              format, n_components, has_alpha,
-                              select_transparent, select_criterion,
-                              antialias, threshold, diagonal_neighbors,
-                              x, y, start_col);
+      region_progress_start (&region_progress, progress,
+                             _("Finding contiguous region"));
+
+      found = find_contiguous_region (src_buffer, mask_buffer,
+                                      format, n_components, has_alpha,
+                                      select_transparent, select_criterion,
+                                      antialias, threshold, diagonal_neighbors,
+                                      x, y, start_col, &region_progress);
+
+      region_progress_end (&region_progress);
 
       GIMP_TIMER_END("foo");
+
+      if (! found)
+        g_clear_object (&mask_buffer);
     }
 
   return mask_buffer;
@@ -169,7 +274,8 @@ gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
                                           gfloat               threshold,
                                           gboolean             select_transparent,
                                           GimpSelectCriterion  select_criterion,
-                                          const GimpRGB       *color)
+                                          const GimpRGB       *color,
+                                          GimpProgress        *progress)
 {
   /*  Scan over the pickable's active layer, finding pixels within the
    *  specified threshold from the given R, G, & B values.  If
@@ -177,16 +283,21 @@ gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
    *  fuzzy_select.  Modify the pickable's mask to reflect the
    *  additional selection
    */
-  GeglBufferIterator *iter;
-  GeglBuffer         *src_buffer;
-  GeglBuffer         *mask_buffer;
-  const Babl         *format;
-  gint                n_components;
-  gboolean            has_alpha;
-  gfloat              start_col[MAX_CHANNELS];
+  ByColorData     data;
+  RegionProgress  region_progress;
+  GeglBuffer     *src_buffer;
+  GeglBuffer     *mask_buffer;
+  const Babl     *format;
+  gint            n_components;
+  gboolean        has_alpha;
+  gfloat          start_col[MAX_CHANNELS];
+  gint            tile_height;
+  gint            n_bands;
+  gint            batch;
 
   g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), NULL);
   g_return_val_if_fail (color != NULL, NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
 
   gimp_pickable_flush (pickable);
 
@@ -215,36 +326,60 @@ gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
   mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
                                  babl_format ("Y float"));
 
-  iter = gegl_buffer_iterator_new (src_buffer,
-                                   NULL, 0, format,
-                                   GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+  data.diff.src_buffer         = src_buffer;
+  data.diff.format             = format;
+  data.diff.n_components       = n_components;
+  data.diff.has_alpha          = has_alpha;
+  data.diff.select_transparent = select_transparent;
+  data.diff.select_criterion   = select_criterion;
+  data.diff.antialias          = antialias;
+  data.diff.threshold          = threshold;
+  data.diff.col                = start_col;
+  data.mask_buffer             = mask_buffer;
+  data.extent                  = *gegl_buffer_get_extent (src_buffer);
+
+  /*  each thread writes whole rows of the mask's tiles, so that no two
+   *  threads ever write to the same tile
+   */
+  g_object_get (mask_buffer,
+                "tile-height", &tile_height,
+                NULL);
+
+  data.band_y      = data.extent.y - (data.extent.y % tile_height);
+  data.band_height = tile_height;
 
-  gegl_buffer_iterator_add (iter, mask_buffer,
-                            NULL, 0, babl_format ("Y float"),
-                            GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+  if (data.band_y > data.extent.y)
+    data.band_y -= tile_height;
 
-  while (gegl_buffer_iterator_next (iter))
+  n_bands = (data.extent.y + data.extent.height - data.band_y +
+             tile_height - 1) / tile_height;
+
+  /*  a few bands per thread at a time, with a chance to update the
+   *  progress and to cancel in between
+   */
+  batch = 4 * gimp_parallel_get_n_threads ();
+
+  region_progress_start (&region_progress, progress,
+                         _("Selecting by color"));
+
+  for (data.first_band = 0;
+       data.first_band < n_bands && ! region_progress.cancel;
+       data.first_band += batch)
     {
-      const gfloat *src   = iter->data[0];
-      gfloat       *dest  = iter->data[1];
-      gint          count = iter->length;
+      data.n_bands = MIN (batch, n_bands - data.first_band);
 
-      while (count--)
-        {
-          /*  Find how closely the colors match  */
-          *dest = pixel_difference (start_col, src,
-                                    antialias,
-                                    threshold,
-                                    n_components,
-                                    has_alpha,
-                                    select_transparent,
-                                    select_criterion);
-
-          src  += n_components;
-          dest += 1;
-        }
+      gimp_parallel_distribute (data.n_bands, by_color_bands, &data);
+
+      region_progress_update (&region_progress,
+                              (gdouble) (data.first_band + data.n_bands) /
+                              n_bands);
     }
 
+  region_progress_end (&region_progress);
+
+  if (region_progress.cancel)
+    g_clear_object (&mask_buffer);
+
   return mask_buffer;
 }
 
@@ -407,6 +542,149 @@ pixel_difference (const gfloat        *col1,
     }
 }
 
+static void
+pixel_difference_row (const PixelDifferenceData *data,
+                      const gfloat              *src,
+                      gfloat                    *dest,
+                      gint                       width,
+                      gboolean                   unvisited)
+{
+  while (width--)
+    {
+      /*  Find how closely the colors match  */
+      *dest = pixel_difference (data->col, src,
+                                data->antialias,
+                                data->threshold,
+                                data->n_components,
+                                data->has_alpha,
+                                data->select_transparent,
+                                data->select_criterion);
+
+      if (unvisited)
+        *dest = -*dest;
+
+      src  += data->n_components;
+      dest += 1;
+    }
+}
+
+static void
+by_color_bands (gint     i,
+                gint     n,
+                gpointer user_data)
+{
+  ByColorData *data = user_data;
+
+  for (; i < data->n_bands; i += n)
+    {
+      GeglRectangle       band;
+      GeglBufferIterator *iter;
+
+      band.x      = data->extent.x;
+      band.y      = data->band_y +
+                    (data->first_band + i) * data->band_height;
+      band.width  = data->extent.width;
+      band.height = data->band_height;
+
+      gegl_rectangle_intersect (&band, &band, &data->extent);
+
+      iter = gegl_buffer_iterator_new (data->diff.src_buffer,
+                                       &band, 0, data->diff.format,
+                                       GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+      gegl_buffer_iterator_add (iter, data->mask_buffer,
+                                &band, 0, babl_format ("Y float"),
+                                GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          pixel_difference_row (&data->diff,
+                                iter->data[0], iter->data[1],
+                                iter->length, FALSE);
+        }
+    }
+}
+
+static void
+region_progress_start (RegionProgress *progress,
+                       GimpProgress   *gimp_progress,
+                       const gchar    *text)
+{
+  progress->progress    = gimp_progress;
+  progress->started     = FALSE;
+  progress->cancellable = FALSE;
+  progress->cancel      = FALSE;
+  progress->last_update = g_get_monotonic_time ();
+
+  if (! gimp_progress)
+    return;
+
+  if (gimp_progress_is_active (gimp_progress))
+    {
+      gimp_progress_set_text_literal (gimp_progress, text);
+    }
+  else
+    {
+      gimp_progress_start (gimp_progress, TRUE, "%s", text);
+
+      g_signal_connect (gimp_progress, "cancel",
+                        G_CALLBACK (region_progress_cancel),
+                        progress);
+
+      progress->started     = TRUE;
+      progress->cancellable = TRUE;
+    }
+}
+
+/*  a negative value only pulses the progress, for when there's no
+ *  telling how much work is left
+ */
+static void
+region_progress_update (RegionProgress *progress,
+                        gdouble         value)
+{
+  gint64 time;
+
+  if (! progress->progress)
+    return;
+
+  time = g_get_monotonic_time ();
+
+  if (time - progress->last_update < PROGRESS_INTERVAL)
+    return;
+
+  progress->last_update = time;
+
+  if (value < 0.0)
+    gimp_progress_pulse (progress->progress);
+  else
+    gimp_progress_set_value (progress->progress, value);
+
+  if (progress->cancellable)
+    while (! progress->cancel && g_main_context_pending (NULL))
+      g_main_context_iteration (NULL, FALSE);
+}
+
+static void
+region_progress_end (RegionProgress *progress)
+{
+  if (progress->started)
+    {
+      gimp_progress_end (progress->progress);
+
+      g_signal_handlers_disconnect_by_func (progress->progress,
+                                            region_progress_cancel,
+                                            progress);
+    }
+}
+
+static void
+region_progress_cancel (GimpProgress   *gimp_progress,
+                        RegionProgress *progress)
+{
+  progress->cancel = TRUE;
+}
+
 static void
 push_segment (GQueue *segment_queue,
               gint    y,
@@ -472,114 +750,187 @@ pop_segment (GQueue *segment_queue,
   *end   = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
 }
 
-/* #define FETCH_ROW 1 */
-
+/*  Returns whether any of the tiles around (tile_x, tile_y) is computed.  */
 static gboolean
-find_contiguous_segment (const gfloat        *col,
-                         GeglBuffer          *src_buffer,
-                         GeglBuffer          *mask_buffer,
-                         const Babl          *src_format,
-                         const Babl          *mask_format,
-                         gint                 n_components,
-                         gboolean             has_alpha,
-                         gint                 width,
-                         gboolean             select_transparent,
-                         GimpSelectCriterion  select_criterion,
-                         gboolean             antialias,
-                         gfloat               threshold,
-                         gint                 initial_x,
-                         gint                 initial_y,
-                         gint                *start,
-                         gint                *end,
-                         gfloat              *row)
+fill_tile_is_frontier (FillData *fill,
+                       gint      tile_x,
+                       gint      tile_y)
 {
-  gfloat *s;
-  gfloat  mask_row[width];
-  gfloat  diff;
-
-#ifdef FETCH_ROW
-  gegl_buffer_get (src_buffer, GEGL_RECTANGLE (0, initial_y, width, 1), 1.0,
-                   src_format,
-                   row, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-  s = row + initial_x * n_components;
-#else
-  s = g_alloca (n_components * sizeof (gfloat));
-
-  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, src_format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
+  gint tx, ty;
 
-  diff = pixel_difference (col, s, antialias, threshold,
-                           n_components, has_alpha, select_transparent,
-                           select_criterion);
+  for (ty = MAX (tile_y - 1, 0);
+       ty <= MIN (tile_y + 1, fill->n_tiles_y - 1);
+       ty++)
+    {
+      for (tx = MAX (tile_x - 1, 0);
+           tx <= MIN (tile_x + 1, fill->n_tiles_x - 1);
+           tx++)
+        {
+          if (fill->tiles[ty * fill->n_tiles_x + tx])
+            return TRUE;
+        }
+    }
 
-  /* check the starting pixel */
-  if (! diff)
-    return FALSE;
+  return FALSE;
+}
 
-  mask_row[initial_x] = diff;
+/*  Compares the pixels of the tile at (tile_x, tile_y), and of those of
+ *  its neighbours, to the start color, together with the whole ring of
+ *  tiles around the ones computed so far.  The fill is likely to cross
+ *  into any of them next, and computing them in one go gives the
+ *  threads enough tiles to share.
+ */
+static void
+fill_compute_tiles (FillData *fill,
+                    gint      tile_x,
+                    gint      tile_y)
+{
+  gint x1, y1, x2, y2;
+  gint tx, ty;
 
-  *start = initial_x - 1;
-#ifdef FETCH_ROW
-  s = row + *start * n_components;
-#endif
+  fill->n_missing = 0;
 
-  while (*start >= 0)
+  x1 = MAX (MIN (fill->computed_x1, tile_x) - 1, 0);
+  y1 = MAX (MIN (fill->computed_y1, tile_y) - 1, 0);
+  x2 = MIN (MAX (fill->computed_x2, tile_x + 1) + 1, fill->n_tiles_x);
+  y2 = MIN (MAX (fill->computed_y2, tile_y + 1) + 1, fill->n_tiles_y);
+
+  for (ty = y1; ty < y2; ty++)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
-      if (diff == 0.0)
-        break;
+      for (tx = x1; tx < x2; tx++)
+        {
+          gint tile = ty * fill->n_tiles_x + tx;
+
+          if (fill->tiles[tile])
+            continue;
 
-      mask_row[*start] = diff;
+          if ((ABS (tx - tile_x) <= 1 && ABS (ty - tile_y) <= 1) ||
+              fill_tile_is_frontier (fill, tx, ty))
+            {
+              fill->missing[fill->n_missing++] = tile;
 
-      (*start)--;
-#ifdef FETCH_ROW
-      s -= n_components;
-#endif
+              fill->computed_x1 = MIN (fill->computed_x1, tx);
+              fill->computed_y1 = MIN (fill->computed_y1, ty);
+              fill->computed_x2 = MAX (fill->computed_x2, tx + 1);
+              fill->computed_y2 = MAX (fill->computed_y2, ty + 1);
+            }
+        }
     }
 
-  *end = initial_x + 1;
-#ifdef FETCH_ROW
-  s = row + *end * n_components;
-#endif
+  gimp_parallel_distribute (fill->n_missing, fill_compute_tiles_func, fill);
+
+  region_progress_update (fill->progress, -1.0);
+}
+
+static void
+fill_compute_tiles_func (gint     i,
+                         gint     n,
+                         gpointer user_data)
+{
+  FillData *fill = user_data;
+  gfloat   *src;
+
+  src = g_new (gfloat,
+               FILL_TILE_SIZE * FILL_TILE_SIZE * fill->diff.n_components);
 
-  while (*end < width)
+  for (; i < fill->n_missing; i += n)
     {
-#ifndef FETCH_ROW
-      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, src_format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-#endif
-
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
-      if (diff == 0.0)
-        break;
+      gint           tile = fill->missing[i];
+      gfloat        *dest;
+      GeglRectangle  rect;
+      gint           y;
+
+      rect.x      = (tile % fill->n_tiles_x) << FILL_TILE_SHIFT;
+      rect.y      = (tile / fill->n_tiles_x) << FILL_TILE_SHIFT;
+      rect.width  = MIN (FILL_TILE_SIZE, fill->extent.width  - rect.x);
+      rect.height = MIN (FILL_TILE_SIZE, fill->extent.height - rect.y);
 
-      mask_row[*end] = diff;
+      rect.x += fill->extent.x;
+      rect.y += fill->extent.y;
 
-      (*end)++;
-#ifdef FETCH_ROW
-      s += n_components;
-#endif
+      gegl_buffer_get (fill->diff.src_buffer, &rect, 1.0,
+                       fill->diff.format, src,
+                       FILL_TILE_SIZE * fill->diff.n_components *
+                       sizeof (gfloat),
+                       GEGL_ABYSS_NONE);
+
+      dest = g_new0 (gfloat, FILL_TILE_SIZE * FILL_TILE_SIZE);
+
+      for (y = 0; y < rect.height; y++)
+        {
+          pixel_difference_row (&fill->diff,
+                                src + y * FILL_TILE_SIZE *
+                                      fill->diff.n_components,
+                                dest + y * FILL_TILE_SIZE,
+                                rect.width, TRUE);
+        }
+
+      fill->tiles[tile] = dest;
     }
 
-  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start + 1, initial_y,
-                                                *end - *start - 1, 1),
-                   0, mask_format, &mask_row[*start + 1],
-                   GEGL_AUTO_ROWSTRIDE);
+  g_free (src);
+}
+
+static inline gfloat *
+fill_pixel (FillData *fill,
+            gint      x,
+            gint      y)
+{
+  gint tile = (y >> FILL_TILE_SHIFT) * fill->n_tiles_x +
+              (x >> FILL_TILE_SHIFT);
+
+  if (G_UNLIKELY (! fill->tiles[tile]))
+    fill_compute_tiles (fill, x >> FILL_TILE_SHIFT, y >> FILL_TILE_SHIFT);
+
+  return fill->tiles[tile] +
+         ((y & FILL_TILE_MASK) << FILL_TILE_SHIFT) + (x & FILL_TILE_MASK);
+}
+
+/*  Marks the unvisited pixels of row y around initial_x as visited, for
+ *  as long as they match.
+ */
+static gboolean
+find_contiguous_segment (FillData *fill,
+                         gint      y,
+                         gint      initial_x,
+                         gint     *start,
+                         gint     *end)
+{
+  gint    width = fill->extent.width;
+  gfloat *pixel;
+
+  /* check the starting pixel */
+  pixel = fill_pixel (fill, initial_x, y);
+
+  if (! (*pixel < 0.0))
+    return FALSE;
+
+  *pixel = -*pixel;
+
+  for (*start = initial_x - 1; *start >= 0; (*start)--)
+    {
+      pixel = fill_pixel (fill, *start, y);
+
+      if (! (*pixel < 0.0))
+        break;
+
+      *pixel = -*pixel;
+    }
+
+  for (*end = initial_x + 1; *end < width; (*end)++)
+    {
+      pixel = fill_pixel (fill, *end, y);
+
+      if (! (*pixel < 0.0))
+        break;
+
+      *pixel = -*pixel;
+    }
 
   return TRUE;
 }
 
-static void
+static gboolean
 find_contiguous_region (GeglBuffer          *src_buffer,
                         GeglBuffer          *mask_buffer,
                         const Babl          *format,
@@ -592,18 +943,52 @@ find_contiguous_region (GeglBuffer          *src_buffer,
                         gboolean             diagonal_neighbors,
                         gint                 x,
                         gint                 y,
-                        const gfloat        *col)
+                        const gfloat        *col,
+                        RegionProgress      *progress)
 {
-  const Babl *mask_format = babl_format ("Y float");
-  gint        old_y;
-  gint        start, end;
-  gint        new_start, new_end;
-  GQueue     *segment_queue;
-  gfloat     *row = NULL;
-
-#ifdef FETCH_ROW
-  row = g_new (gfloat, gegl_buffer_get_width (src_buffer) * n_components);
-#endif
+  FillData  fill;
+  gint      width;
+  gint      height;
+  gint      old_y;
+  gint      start, end;
+  gint      new_start, new_end;
+  GQueue   *segment_queue;
+  gint      n_tiles;
+  gint      i;
+
+  /*  A matching pixel holds its negated difference until it's reached,
+   *  and its difference once it's selected.  Only the tiles the fill
+   *  gets to are ever compared to the start color.
+   */
+  fill.diff.src_buffer         = src_buffer;
+  fill.diff.format             = format;
+  fill.diff.n_components       = n_components;
+  fill.diff.has_alpha          = has_alpha;
+  fill.diff.select_transparent = select_transparent;
+  fill.diff.select_criterion   = select_criterion;
+  fill.diff.antialias          = antialias;
+  fill.diff.threshold          = threshold;
+  fill.diff.col                = col;
+  fill.extent                  = *gegl_buffer_get_extent (src_buffer);
+  fill.n_tiles_x               = (fill.extent.width  + FILL_TILE_MASK) >>
+                                 FILL_TILE_SHIFT;
+  fill.n_tiles_y               = (fill.extent.height + FILL_TILE_MASK) >>
+                                 FILL_TILE_SHIFT;
+  fill.computed_x1             = G_MAXINT;
+  fill.computed_y1             = G_MAXINT;
+  fill.computed_x2             = 0;
+  fill.computed_y2             = 0;
+  fill.progress                = progress;
+
+  n_tiles      = fill.n_tiles_x * fill.n_tiles_y;
+  fill.tiles   = g_new0 (gfloat *, n_tiles);
+  fill.missing = g_new (gint, n_tiles);
+
+  width  = fill.extent.width;
+  height = fill.extent.height;
+
+  x -= fill.extent.x;
+  y -= fill.extent.y;
 
   segment_queue = g_queue_new ();
 
@@ -618,12 +1003,7 @@ find_contiguous_region (GeglBuffer          *src_buffer,
 
       for (x = start + 1; x < end; x++)
         {
-          gfloat val;
-
-          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
-                              mask_format,
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          if (val != 0.0)
+          if (*fill_pixel (&fill, x, y) > 0.0)
             {
               /* If the current pixel is selected, then we've already visited
                * the next pixel.  (Note that we assume that the maximal image
@@ -633,15 +1013,8 @@ find_contiguous_region (GeglBuffer          *src_buffer,
               continue;
             }
 
-          if (! find_contiguous_segment (col, src_buffer, mask_buffer,
-                                         format, mask_format,
-                                         n_components,
-                                         has_alpha,
-                                         gegl_buffer_get_width (src_buffer),
-                                         select_transparent, select_criterion,
-                                         antialias, threshold, x, y,
-                                         &new_start, &new_end,
-                                         row))
+          if (! find_contiguous_segment (&fill, y, x,
+                                         &new_start, &new_end))
             continue;
 
           /* We can skip directly to `new_end + 1` on the next iteration, since
@@ -657,11 +1030,11 @@ find_contiguous_region (GeglBuffer          *src_buffer,
               if (new_start >= 0)
                 new_start--;
 
-              if (new_end < gegl_buffer_get_width (src_buffer))
+              if (new_end < width)
                 new_end++;
             }
 
-          if (y + 1 < gegl_buffer_get_height (src_buffer))
+          if (y + 1 < height)
             {
               push_segment (segment_queue,
                             y, old_y, start, end,
@@ -677,11 +1050,50 @@ find_contiguous_region (GeglBuffer          *src_buffer,
 
         }
     }
-  while (! g_queue_is_empty (segment_queue));
+  while (! progress->cancel && ! g_queue_is_empty (segment_queue));
 
   g_queue_free (segment_queue);
 
-#ifdef FETCH_ROW
-  g_free (row);
-#endif
+  /*  copy the visited pixels of the tiles the fill got to into the
+   *  mask; whatever matches but wasn't reached isn't part of the
+   *  region
+   */
+  for (i = 0; i < n_tiles; i++)
+    {
+      gfloat *tile = fill.tiles[i];
+
+      if (tile && ! progress->cancel)
+        {
+          GeglRectangle rect;
+          gboolean      selected = FALSE;
+          gint          j;
+
+          for (j = 0; j < FILL_TILE_SIZE * FILL_TILE_SIZE; j++)
+            {
+              if (tile[j] < 0.0)
+                tile[j] = 0.0;
+              else if (tile[j] > 0.0)
+                selected = TRUE;
+            }
+
+          rect.x      = (i % fill.n_tiles_x) << FILL_TILE_SHIFT;
+          rect.y      = (i / fill.n_tiles_x) << FILL_TILE_SHIFT;
+          rect.width  = MIN (FILL_TILE_SIZE, width  - rect.x);
+          rect.height = MIN (FILL_TILE_SIZE, height - rect.y);
+
+          rect.x += fill.extent.x;
+          rect.y += fill.extent.y;
+
+          if (selected)
+            gegl_buffer_set (mask_buffer, &rect, 0, babl_format ("Y float"),
+                             tile, FILL_TILE_SIZE * sizeof (gfloat));
+        }
+
+      g_free (tile);
+    }
+
+  g_free (fill.tiles);
+  g_free (fill.missing);
+
+  return ! progress->cancel;
 }
@@ -26,14 +26,16 @@ GeglBuffer * gimp_pickable_contiguous_region_by_seed  (GimpPickable        *pick
                                                        GimpSelectCriterion  select_criterion,
                                                        gboolean             diagonal_neighbors,
                                                        gint                 x,
-                                                       gint                 y);
+                                                       gint                 y,
+                                                       GimpProgress        *progress);
 
 GeglBuffer * gimp_pickable_contiguous_region_by_color (GimpPickable        *pickable,
                                                        gboolean             antialias,
                                                        gfloat               threshold,
                                                        gboolean             select_transparent,
                                                        GimpSelectCriterion  select_criterion,
-                                                       const GimpRGB       *color);
+                                                       const GimpRGB       *color,
+                                                       GimpProgress        *progress);
 
 
 #endif  /*  __GIMP_PICKABLE_CONTIGUOUS_REGION_H__ */
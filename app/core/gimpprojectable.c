@@ -25,6 +25,7 @@
 
 #include "core-types.h"
 
+#include "gimpdrawable.h"
 #include "gimpmarshal.h"
 #include "gimpprojectable.h"
 #include "gimpviewable.h"
@@ -244,6 +245,9 @@ gimp_projectable_begin_render (GimpProjectable *projectable)
 
   iface = GIMP_PROJECTABLE_GET_INTERFACE (projectable);
 
+  /*  keep the paint thread out of the drawables while they are read  */
+  gimp_drawable_paint_lock ();
+
   if (iface->begin_render)
     iface->begin_render (projectable);
 }
@@ -259,6 +263,8 @@ gimp_projectable_end_render (GimpProjectable *projectable)
 
   if (iface->end_render)
     iface->end_render (projectable);
+
+  gimp_drawable_paint_unlock ();
 }
 
 void
@@ -53,6 +53,13 @@ static gint GIMP_PROJECTION_CHUNK_HEIGHT = 128;
  */
 static gdouble GIMP_PROJECTION_CHUNK_TIME = 0.0666;
 
+/*  the highest mipmap level the chunk renderer keeps up to date for
+ *  the views showing it, the levels above are built when they are
+ *  read.  a tile of this level covers 16x16 tiles of the full-size
+ *  projection.
+ */
+#define GIMP_PROJECTION_MAX_LEVEL 4
+
 
 enum
 {
@@ -94,6 +101,7 @@ struct _GimpProjectionPrivate
   cairo_region_t            *update_region;
   GimpProjectionChunkRender  chunk_render;
   cairo_rectangle_int_t      priority_rect;
+  gint                       render_levels[GIMP_PROJECTION_MAX_LEVEL + 1];
 
   gboolean                   invalidate_preview;
 };
@@ -157,6 +165,8 @@ static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gint             y,
                                                           gint             w,
                                                           gint             h);
+static void        gimp_projection_update_levels         (GimpProjection  *proj,
+                                                          const GeglRectangle *rect);
 
 static void        gimp_projection_projectable_invalidate(GimpProjectable *projectable,
                                                           gint             x,
@@ -537,6 +547,78 @@ gimp_projection_set_priority_rect (GimpProjection *proj,
     }
 }
 
+/**
+ * gimp_projection_get_level:
+ * @proj:  a #GimpProjection
+ * @scale: the scale a view reads the projection's buffer at
+ *
+ * Returns the mipmap level of the projection's buffer that
+ * gegl_buffer_get() reads from at @scale, limited to the levels the
+ * chunk renderer keeps up to date.
+ *
+ * Return value: the mipmap level for the given scale.
+ **/
+gint
+gimp_projection_get_level (GimpProjection *proj,
+                           gdouble         scale)
+{
+  gint level = 0;
+
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), 0);
+
+  while (scale <= 0.5 && level < GIMP_PROJECTION_MAX_LEVEL)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  return level;
+}
+
+/**
+ * gimp_projection_add_render_level:
+ * @proj:  a #GimpProjection
+ * @level: a mipmap level, as returned by gimp_projection_get_level()
+ *
+ * Registers a view of the projection that shows mipmap level @level.
+ * After rendering a chunk, the chunk renderer builds the tiles of the
+ * highest level any view registered over it, each from the level
+ * below, so that zoomed-out views find them ready instead of building
+ * them while drawing. Each call must be paired with a call to
+ * gimp_projection_remove_render_level().
+ **/
+void
+gimp_projection_add_render_level (GimpProjection *proj,
+                                  gint            level)
+{
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  proj->priv->render_levels[CLAMP (level, 0, GIMP_PROJECTION_MAX_LEVEL)]++;
+}
+
+/**
+ * gimp_projection_remove_render_level:
+ * @proj:  a #GimpProjection
+ * @level: a mipmap level, as passed to gimp_projection_add_render_level()
+ *
+ * Unregisters a view added with gimp_projection_add_render_level().
+ **/
+void
+gimp_projection_remove_render_level (GimpProjection *proj,
+                                     gint            level)
+{
+  gint *count;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  count = &proj->priv->render_levels[CLAMP (level, 0,
+                                            GIMP_PROJECTION_MAX_LEVEL)];
+
+  g_return_if_fail (*count > 0);
+
+  (*count)--;
+}
+
 void
 gimp_projection_stop_rendering (GimpProjection *proj)
 {
@@ -857,6 +939,10 @@ gimp_projection_chunk_render_iteration (GimpProjection *proj)
   gimp_projection_paint_area (proj, TRUE /* sic! */,
                               work_x, work_y, work_w, work_h);
 
+  gimp_projection_update_levels (proj,
+                                 GEGL_RECTANGLE (work_x, work_y,
+                                                 work_w, work_h));
+
   chunk_render->work_x += work_w;
 
   if (chunk_render->work_x >= chunk_render->x + chunk_render->width)
@@ -980,6 +1066,45 @@ gimp_projection_paint_area (GimpProjection *proj,
     }
 }
 
+/*  builds the tiles of the highest mipmap level shown by a view of the
+ *  projection over @rect, which was just rendered.  reading them makes
+ *  GEGL build each level's tiles from the level below, the same way
+ *  as when a view reads them, only here, within the chunk renderer's
+ *  time slice, instead of while the view draws
+ */
+static void
+gimp_projection_update_levels (GimpProjection      *proj,
+                               const GeglRectangle *rect)
+{
+  gint level;
+
+  for (level = GIMP_PROJECTION_MAX_LEVEL; level > 0; level--)
+    {
+      if (proj->priv->render_levels[level] > 0)
+        {
+          const Babl    *format = gegl_buffer_get_format (proj->priv->buffer);
+          GeglRectangle  area;
+          guchar        *data;
+
+          area.x      = rect->x >> level;
+          area.y      = rect->y >> level;
+          area.width  = ((rect->x + rect->width  - 1) >> level) + 1 - area.x;
+          area.height = ((rect->y + rect->height - 1) >> level) + 1 - area.y;
+
+          data = g_malloc ((gsize) babl_format_get_bytes_per_pixel (format) *
+                           area.width * area.height);
+
+          gegl_buffer_get (proj->priv->buffer, &area, 1.0 / (1 << level),
+                           format, data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          g_free (data);
+
+          break;
+        }
+    }
+}
+
 
 /*  image callbacks  */
 
@@ -63,6 +63,13 @@ void             gimp_projection_set_priority_rect (GimpProjection    *proj,
                                                     gint               width,
                                                     gint               height);
 
+gint             gimp_projection_get_level         (GimpProjection    *proj,
+                                                    gdouble            scale);
+void             gimp_projection_add_render_level  (GimpProjection    *proj,
+                                                    gint               level);
+void           gimp_projection_remove_render_level (GimpProjection    *proj,
+                                                    gint               level);
+
 void             gimp_projection_stop_rendering    (GimpProjection    *proj);
 
 void             gimp_projection_flush             (GimpProjection    *proj);
@@ -0,0 +1,477 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpswapfile.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <zlib.h>
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimpswapfile.h"
+
+#include "gimp-intl.h"
+
+
+/*  buffers are written in strips of roughly this many bytes, each
+ *  compressed on its own
+ */
+#define STRIP_SIZE (256 * 1024)
+
+
+typedef struct _GimpSwapChunk GimpSwapChunk;
+
+struct _GimpSwapChunk
+{
+  goffset offset;
+  gsize   size;
+};
+
+struct _GimpSwapFile
+{
+  gint           ref_count;
+
+  GFile         *file;
+  GFileIOStream *stream;
+
+  goffset        length;  /*  end of the used part of the file      */
+  GList         *holes;   /*  free GimpSwapChunks, sorted by offset  */
+  gint64         size;    /*  bytes used by entries                  */
+};
+
+struct _GimpSwapEntry
+{
+  GimpSwapFile  *swap_file;
+
+  const Babl    *format;
+  GeglRectangle  extent;
+  gint           strip_height;
+
+  gint           n_chunks;
+  GimpSwapChunk *chunks;
+  gint64         size;
+};
+
+
+/*  local function prototypes  */
+
+static goffset    gimp_swap_file_alloc (GimpSwapFile  *swap_file,
+                                        gsize          size);
+static void       gimp_swap_file_free  (GimpSwapFile  *swap_file,
+                                        goffset        offset,
+                                        gsize          size);
+static gboolean   gimp_swap_file_seek  (GimpSwapFile  *swap_file,
+                                        goffset        offset,
+                                        GError       **error);
+
+
+/*  public functions  */
+
+GimpSwapFile *
+gimp_swap_file_new (GFile   *file,
+                    GError **error)
+{
+  GimpSwapFile  *swap_file;
+  GFileIOStream *stream;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  stream = g_file_replace_readwrite (file, NULL, FALSE,
+                                     G_FILE_CREATE_PRIVATE |
+                                     G_FILE_CREATE_REPLACE_DESTINATION,
+                                     NULL, error);
+  if (! stream)
+    return NULL;
+
+  swap_file = g_slice_new0 (GimpSwapFile);
+
+  swap_file->ref_count = 1;
+  swap_file->file      = g_object_ref (file);
+  swap_file->stream    = stream;
+
+  return swap_file;
+}
+
+GimpSwapFile *
+gimp_swap_file_ref (GimpSwapFile *swap_file)
+{
+  g_return_val_if_fail (swap_file != NULL, NULL);
+
+  swap_file->ref_count++;
+
+  return swap_file;
+}
+
+void
+gimp_swap_file_unref (GimpSwapFile *swap_file)
+{
+  g_return_if_fail (swap_file != NULL);
+  g_return_if_fail (swap_file->ref_count > 0);
+
+  swap_file->ref_count--;
+
+  if (swap_file->ref_count < 1)
+    {
+      g_io_stream_close (G_IO_STREAM (swap_file->stream), NULL, NULL);
+      g_object_unref (swap_file->stream);
+
+      g_file_delete (swap_file->file, NULL, NULL);
+      g_object_unref (swap_file->file);
+
+      g_list_free_full (swap_file->holes, (GDestroyNotify) g_free);
+
+      g_slice_free (GimpSwapFile, swap_file);
+    }
+}
+
+gint64
+gimp_swap_file_get_size (GimpSwapFile *swap_file)
+{
+  g_return_val_if_fail (swap_file != NULL, 0);
+
+  return swap_file->size;
+}
+
+GimpSwapEntry *
+gimp_swap_file_write_buffer (GimpSwapFile  *swap_file,
+                             GeglBuffer    *buffer,
+                             GError       **error)
+{
+  GimpSwapEntry *entry;
+  GOutputStream *output;
+  const Babl    *format;
+  gint           bpp;
+  gsize          strip_bytes;
+  guchar        *strip;
+  guchar        *compressed;
+  uLong          compressed_bound;
+  gint           y;
+  gint           i;
+
+  g_return_val_if_fail (swap_file != NULL, NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  format = gegl_buffer_get_format (buffer);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  entry = g_slice_new0 (GimpSwapEntry);
+
+  entry->swap_file    = gimp_swap_file_ref (swap_file);
+  entry->format       = format;
+  entry->extent       = *gegl_buffer_get_extent (buffer);
+  entry->strip_height = MAX (1, STRIP_SIZE / MAX (1, entry->extent.width * bpp));
+  entry->n_chunks     = (entry->extent.height + entry->strip_height - 1) /
+                        entry->strip_height;
+  entry->chunks       = g_new0 (GimpSwapChunk, entry->n_chunks);
+
+  strip_bytes      = (gsize) entry->extent.width * entry->strip_height * bpp;
+  compressed_bound = compressBound (strip_bytes);
+
+  strip      = g_malloc (strip_bytes);
+  compressed = g_malloc (compressed_bound);
+
+  output = g_io_stream_get_output_stream (G_IO_STREAM (swap_file->stream));
+
+  for (y = 0, i = 0; i < entry->n_chunks; y += entry->strip_height, i++)
+    {
+      GeglRectangle  rect;
+      uLong          compressed_size = compressed_bound;
+      GimpSwapChunk *chunk           = &entry->chunks[i];
+
+      gegl_rectangle_set (&rect,
+                          entry->extent.x,
+                          entry->extent.y + y,
+                          entry->extent.width,
+                          MIN (entry->strip_height, entry->extent.height - y));
+
+      gegl_buffer_get (buffer, &rect, 1.0, format, strip,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      if (compress2 (compressed, &compressed_size,
+                     strip, (uLong) rect.width * rect.height * bpp,
+                     Z_BEST_SPEED) != Z_OK)
+        {
+          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               _("Could not compress pixel data for swapping"));
+          break;
+        }
+
+      chunk->size   = compressed_size;
+      chunk->offset = gimp_swap_file_alloc (swap_file, chunk->size);
+
+      entry->size += chunk->size;
+
+      if (! gimp_swap_file_seek (swap_file, chunk->offset, error) ||
+          ! g_output_stream_write_all (output, compressed, chunk->size,
+                                       NULL, NULL, error))
+        {
+          break;
+        }
+    }
+
+  g_free (compressed);
+  g_free (strip);
+
+  if (i < entry->n_chunks)
+    {
+      gimp_swap_entry_free (entry);
+
+      return NULL;
+    }
+
+  return entry;
+}
+
+GeglBuffer *
+gimp_swap_entry_read_buffer (GimpSwapEntry  *entry,
+                             GError        **error)
+{
+  GimpSwapFile *swap_file;
+  GeglBuffer   *buffer;
+  GInputStream *input;
+  gint          bpp;
+  guchar       *strip;
+  guchar       *compressed  = NULL;
+  gsize         max_size    = 0;
+  gint          y;
+  gint          i;
+
+  g_return_val_if_fail (entry != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  swap_file = entry->swap_file;
+  bpp       = babl_format_get_bytes_per_pixel (entry->format);
+
+  buffer = gegl_buffer_new (&entry->extent, entry->format);
+
+  for (i = 0; i < entry->n_chunks; i++)
+    max_size = MAX (max_size, entry->chunks[i].size);
+
+  strip      = g_malloc ((gsize) entry->extent.width * entry->strip_height * bpp);
+  compressed = g_malloc (MAX (max_size, 1));
+
+  input = g_io_stream_get_input_stream (G_IO_STREAM (swap_file->stream));
+
+  for (y = 0, i = 0; i < entry->n_chunks; y += entry->strip_height, i++)
+    {
+      GeglRectangle  rect;
+      GimpSwapChunk *chunk = &entry->chunks[i];
+      gsize          bytes_read;
+      uLongf         size;
+
+      gegl_rectangle_set (&rect,
+                          entry->extent.x,
+                          entry->extent.y + y,
+                          entry->extent.width,
+                          MIN (entry->strip_height, entry->extent.height - y));
+
+      size = (uLongf) rect.width * rect.height * bpp;
+
+      if (! gimp_swap_file_seek (swap_file, chunk->offset, error) ||
+          ! g_input_stream_read_all (input, compressed, chunk->size,
+                                     &bytes_read, NULL, error))
+        {
+          break;
+        }
+
+      if (bytes_read != chunk->size ||
+          uncompress (strip, &size, compressed, chunk->size) != Z_OK ||
+          size != (uLongf) rect.width * rect.height * bpp)
+        {
+          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               _("Swapped pixel data is corrupt"));
+          break;
+        }
+
+      gegl_buffer_set (buffer, &rect, 0, entry->format, strip,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (compressed);
+  g_free (strip);
+
+  /*  never hand out a buffer that is only partly read back  */
+  if (i < entry->n_chunks)
+    g_clear_object (&buffer);
+
+  return buffer;
+}
+
+gint64
+gimp_swap_entry_get_size (GimpSwapEntry *entry)
+{
+  g_return_val_if_fail (entry != NULL, 0);
+
+  return entry->size;
+}
+
+void
+gimp_swap_entry_free (GimpSwapEntry *entry)
+{
+  gint i;
+
+  g_return_if_fail (entry != NULL);
+
+  for (i = 0; i < entry->n_chunks; i++)
+    {
+      if (entry->chunks[i].size > 0)
+        gimp_swap_file_free (entry->swap_file,
+                             entry->chunks[i].offset,
+                             entry->chunks[i].size);
+    }
+
+  g_free (entry->chunks);
+
+  gimp_swap_file_unref (entry->swap_file);
+
+  g_slice_free (GimpSwapEntry, entry);
+}
+
+
+/*  private functions  */
+
+static goffset
+gimp_swap_file_alloc (GimpSwapFile *swap_file,
+                      gsize         size)
+{
+  GList   *list;
+  goffset  offset;
+
+  swap_file->size += size;
+
+  /*  first fit  */
+  for (list = swap_file->holes; list; list = g_list_next (list))
+    {
+      GimpSwapChunk *hole = list->data;
+
+      if (hole->size >= size)
+        {
+          offset = hole->offset;
+
+          hole->offset += size;
+          hole->size   -= size;
+
+          if (hole->size == 0)
+            {
+              swap_file->holes = g_list_delete_link (swap_file->holes, list);
+              g_free (hole);
+            }
+
+          return offset;
+        }
+    }
+
+  offset = swap_file->length;
+
+  swap_file->length += size;
+
+  return offset;
+}
+
+static void
+gimp_swap_file_free (GimpSwapFile *swap_file,
+                     goffset       offset,
+                     gsize         size)
+{
+  GimpSwapChunk *hole;
+  GList         *list;
+  GList         *prev = NULL;
+
+  swap_file->size -= size;
+
+  for (list = swap_file->holes; list; list = g_list_next (list))
+    {
+      hole = list->data;
+
+      if (hole->offset > offset)
+        break;
+
+      prev = list;
+    }
+
+  /*  merge with the preceding hole, or insert a new one  */
+  if (prev &&
+      ((GimpSwapChunk *) prev->data)->offset +
+      ((GimpSwapChunk *) prev->data)->size == offset)
+    {
+      hole = prev->data;
+
+      hole->size += size;
+      list        = prev;
+    }
+  else
+    {
+      hole = g_new (GimpSwapChunk, 1);
+
+      hole->offset = offset;
+      hole->size   = size;
+
+      if (prev)
+        {
+          swap_file->holes = g_list_insert_before (swap_file->holes,
+                                                   prev->next, hole);
+          list = prev->next;
+        }
+      else
+        {
+          swap_file->holes = g_list_prepend (swap_file->holes, hole);
+          list = swap_file->holes;
+        }
+    }
+
+  /*  merge with the following hole  */
+  if (list->next)
+    {
+      GimpSwapChunk *next = list->next->data;
+
+      if (hole->offset + hole->size == next->offset)
+        {
+          hole->size += next->size;
+
+          swap_file->holes = g_list_delete_link (swap_file->holes,
+                                                 list->next);
+          g_free (next);
+        }
+    }
+
+  /*  give a hole at the end of the file back to the file system  */
+  if (hole->offset + hole->size == swap_file->length)
+    {
+      swap_file->length = hole->offset;
+
+      swap_file->holes = g_list_delete_link (swap_file->holes, list);
+      g_free (hole);
+
+      g_seekable_truncate (G_SEEKABLE (swap_file->stream),
+                           swap_file->length, NULL, NULL);
+    }
+}
+
+static gboolean
+gimp_swap_file_seek (GimpSwapFile  *swap_file,
+                     goffset        offset,
+                     GError       **error)
+{
+  return g_seekable_seek (G_SEEKABLE (swap_file->stream),
+                          offset, G_SEEK_SET, NULL, error);
+}
@@ -0,0 +1,42 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpswapfile.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_SWAP_FILE_H__
+#define __GIMP_SWAP_FILE_H__
+
+
+GimpSwapFile  * gimp_swap_file_new          (GFile          *file,
+                                             GError        **error);
+
+GimpSwapFile  * gimp_swap_file_ref          (GimpSwapFile   *swap_file);
+void            gimp_swap_file_unref        (GimpSwapFile   *swap_file);
+
+gint64          gimp_swap_file_get_size     (GimpSwapFile   *swap_file);
+
+GimpSwapEntry * gimp_swap_file_write_buffer (GimpSwapFile   *swap_file,
+                                             GeglBuffer     *buffer,
+                                             GError        **error);
+
+GeglBuffer    * gimp_swap_entry_read_buffer (GimpSwapEntry  *entry,
+                                             GError        **error);
+gint64          gimp_swap_entry_get_size    (GimpSwapEntry  *entry);
+void            gimp_swap_entry_free        (GimpSwapEntry  *entry);
+
+
+#endif  /*  __GIMP_SWAP_FILE_H__  */
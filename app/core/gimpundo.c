@@ -33,6 +33,7 @@
 #include "gimpimage.h"
 #include "gimpimage-undo.h"
 #include "gimpmarshal.h"
+#include "gimpswapfile.h"
 #include "gimptempbuf.h"
 #include "gimpundo.h"
 #include "gimpundostack.h"
@@ -89,6 +90,11 @@ static void          gimp_undo_real_pop            (GimpUndo            *undo,
                                                     GimpUndoAccumulator *accum);
 static void          gimp_undo_real_free           (GimpUndo            *undo,
                                                     GimpUndoMode         undo_mode);
+static gboolean      gimp_undo_real_swap_out       (GimpUndo            *undo,
+                                                    GimpSwapFile        *swap_file,
+                                                    GError             **error);
+static gboolean      gimp_undo_real_swap_in        (GimpUndo            *undo,
+                                                    GError             **error);
 
 static gboolean      gimp_undo_create_preview_idle (gpointer             data);
 static void       gimp_undo_create_preview_private (GimpUndo            *undo,
@@ -143,6 +149,8 @@ gimp_undo_class_init (GimpUndoClass *klass)
 
   klass->pop                        = gimp_undo_real_pop;
   klass->free                       = gimp_undo_real_free;
+  klass->swap_out                   = gimp_undo_real_swap_out;
+  klass->swap_in                    = gimp_undo_real_swap_in;
 
   g_object_class_install_property (object_class, PROP_IMAGE,
                                    g_param_spec_object ("image", NULL, NULL,
@@ -346,6 +354,21 @@ gimp_undo_real_free (GimpUndo     *undo,
 {
 }
 
+static gboolean
+gimp_undo_real_swap_out (GimpUndo      *undo,
+                         GimpSwapFile  *swap_file,
+                         GError       **error)
+{
+  return TRUE;
+}
+
+static gboolean
+gimp_undo_real_swap_in (GimpUndo  *undo,
+                        GError   **error)
+{
+  return TRUE;
+}
+
 void
 gimp_undo_pop (GimpUndo            *undo,
                GimpUndoMode         undo_mode,
@@ -354,6 +377,9 @@ gimp_undo_pop (GimpUndo            *undo,
   g_return_if_fail (GIMP_IS_UNDO (undo));
   g_return_if_fail (accum != NULL);
 
+  /*  gimp_undo_stack_pop_undo() reads the step back before popping it  */
+  g_return_if_fail (! undo->swapped);
+
   if (undo->dirty_mask != GIMP_DIRTY_NONE)
     {
       switch (undo_mode)
@@ -380,6 +406,90 @@ gimp_undo_free (GimpUndo     *undo,
   g_signal_emit (undo, undo_signals[FREE], 0, undo_mode);
 }
 
+/**
+ * gimp_undo_swap_out:
+ * @undo:      a #GimpUndo
+ * @swap_file: the #GimpSwapFile to write the undo's data to
+ * @error:     return location for errors
+ *
+ * Writes the pixel data kept by @undo to @swap_file and releases it
+ * from memory.  The data is read back by gimp_undo_swap_in(), which
+ * gimp_undo_stack_pop_undo() calls before the undo is popped.
+ *
+ * Return value: %TRUE on success, %FALSE if writing failed, in which
+ *               case @undo is left untouched.
+ */
+gboolean
+gimp_undo_swap_out (GimpUndo      *undo,
+                    GimpSwapFile  *swap_file,
+                    GError       **error)
+{
+  gint64 size;
+
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), FALSE);
+  g_return_val_if_fail (swap_file != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (undo->swapped)
+    return TRUE;
+
+  size = gimp_swap_file_get_size (swap_file);
+
+  if (! GIMP_UNDO_GET_CLASS (undo)->swap_out (undo, swap_file, error))
+    return FALSE;
+
+  undo->swapped      = TRUE;
+  undo->swapped_size = gimp_swap_file_get_size (swap_file) - size;
+
+  return TRUE;
+}
+
+/**
+ * gimp_undo_swap_in:
+ * @undo:  a #GimpUndo
+ * @error: return location for errors
+ *
+ * Reads the pixel data of @undo back from the swap file it was
+ * written to by gimp_undo_swap_out().
+ *
+ * Return value: %TRUE on success, %FALSE if reading failed, in which
+ *               case @undo stays swapped out and must not be popped.
+ */
+gboolean
+gimp_undo_swap_in (GimpUndo  *undo,
+                   GError   **error)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! undo->swapped)
+    return TRUE;
+
+  if (! GIMP_UNDO_GET_CLASS (undo)->swap_in (undo, error))
+    return FALSE;
+
+  undo->swapped      = FALSE;
+  undo->swapped_size = 0;
+
+  return TRUE;
+}
+
+gboolean
+gimp_undo_is_swapped (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), FALSE);
+
+  return undo->swapped;
+}
+
+gint64
+gimp_undo_get_swapped_size (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  return undo->swapped_size;
+}
+
 typedef struct _GimpUndoIdle GimpUndoIdle;
 
 struct _GimpUndoIdle
@@ -61,6 +61,9 @@ struct _GimpUndo
 
   GimpTempBuf      *preview;
   guint             preview_idle_id;
+
+  gboolean          swapped;        /* data spilled to the swap file      */
+  gint64            swapped_size;   /* bytes spilled to the swap file     */
 };
 
 struct _GimpUndoClass
@@ -72,28 +75,42 @@ struct _GimpUndoClass
                  GimpUndoAccumulator *accum);
   void (* free) (GimpUndo            *undo,
                  GimpUndoMode         undo_mode);
+
+  gboolean (* swap_out) (GimpUndo      *undo,
+                         GimpSwapFile  *swap_file,
+                         GError       **error);
+  gboolean (* swap_in)  (GimpUndo      *undo,
+                         GError       **error);
 };
 
 
-GType         gimp_undo_get_type        (void) G_GNUC_CONST;
+GType         gimp_undo_get_type         (void) G_GNUC_CONST;
+
+void          gimp_undo_pop              (GimpUndo            *undo,
+                                          GimpUndoMode         undo_mode,
+                                          GimpUndoAccumulator *accum);
+void          gimp_undo_free             (GimpUndo            *undo,
+                                          GimpUndoMode         undo_mode);
 
-void          gimp_undo_pop             (GimpUndo            *undo,
-                                         GimpUndoMode         undo_mode,
-                                         GimpUndoAccumulator *accum);
-void          gimp_undo_free            (GimpUndo            *undo,
-                                         GimpUndoMode         undo_mode);
+gboolean      gimp_undo_swap_out         (GimpUndo            *undo,
+                                          GimpSwapFile        *swap_file,
+                                          GError             **error);
+gboolean      gimp_undo_swap_in          (GimpUndo            *undo,
+                                          GError             **error);
+gboolean      gimp_undo_is_swapped       (GimpUndo            *undo);
+gint64        gimp_undo_get_swapped_size (GimpUndo            *undo);
 
-void          gimp_undo_create_preview  (GimpUndo            *undo,
-                                         GimpContext         *context,
-                                         gboolean             create_now);
-void          gimp_undo_refresh_preview (GimpUndo            *undo,
-                                         GimpContext         *context);
+void          gimp_undo_create_preview   (GimpUndo            *undo,
+                                          GimpContext         *context,
+                                          gboolean             create_now);
+void          gimp_undo_refresh_preview  (GimpUndo            *undo,
+                                          GimpContext         *context);
 
-const gchar * gimp_undo_type_to_name    (GimpUndoType         type);
+const gchar * gimp_undo_type_to_name     (GimpUndoType         type);
 
-gboolean      gimp_undo_is_weak         (GimpUndo            *undo);
-gint          gimp_undo_get_age         (GimpUndo            *undo);
-void          gimp_undo_reset_age       (GimpUndo            *undo);
+gboolean      gimp_undo_is_weak          (GimpUndo            *undo);
+gint          gimp_undo_get_age          (GimpUndo            *undo);
+void          gimp_undo_reset_age        (GimpUndo            *undo);
 
 
 #endif /* __GIMP_UNDO_H__ */
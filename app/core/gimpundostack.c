@@ -28,16 +28,21 @@
 #include "gimpundostack.h"
 
 
-static void    gimp_undo_stack_finalize    (GObject             *object);
+static void     gimp_undo_stack_finalize    (GObject             *object);
 
-static gint64  gimp_undo_stack_get_memsize (GimpObject          *object,
-                                            gint64              *gui_size);
+static gint64   gimp_undo_stack_get_memsize (GimpObject          *object,
+                                             gint64              *gui_size);
 
-static void    gimp_undo_stack_pop         (GimpUndo            *undo,
-                                            GimpUndoMode         undo_mode,
-                                            GimpUndoAccumulator *accum);
-static void    gimp_undo_stack_free        (GimpUndo            *undo,
-                                            GimpUndoMode         undo_mode);
+static void     gimp_undo_stack_pop         (GimpUndo            *undo,
+                                             GimpUndoMode         undo_mode,
+                                             GimpUndoAccumulator *accum);
+static void     gimp_undo_stack_free        (GimpUndo            *undo,
+                                             GimpUndoMode         undo_mode);
+static gboolean gimp_undo_stack_swap_out    (GimpUndo            *undo,
+                                             GimpSwapFile        *swap_file,
+                                             GError             **error);
+static gboolean gimp_undo_stack_swap_in     (GimpUndo            *undo,
+                                             GError             **error);
 
 
 G_DEFINE_TYPE (GimpUndoStack, gimp_undo_stack, GIMP_TYPE_UNDO)
@@ -58,6 +63,8 @@ gimp_undo_stack_class_init (GimpUndoStackClass *klass)
 
   undo_class->pop                = gimp_undo_stack_pop;
   undo_class->free               = gimp_undo_stack_free;
+  undo_class->swap_out           = gimp_undo_stack_swap_out;
+  undo_class->swap_in            = gimp_undo_stack_swap_in;
 }
 
 static void
@@ -127,6 +134,68 @@ gimp_undo_stack_free (GimpUndo     *undo,
   gimp_container_clear (stack->undos);
 }
 
+static gboolean
+gimp_undo_stack_swap_out (GimpUndo      *undo,
+                          GimpSwapFile  *swap_file,
+                          GError       **error)
+{
+  GimpUndoStack *stack   = GIMP_UNDO_STACK (undo);
+  GList         *swapped = NULL;
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      if (gimp_undo_is_swapped (child))
+        continue;
+
+      if (! gimp_undo_swap_out (child, swap_file, error))
+        {
+          /*  leave the stack untouched  */
+          for (list = swapped; list; list = g_list_next (list))
+            gimp_undo_swap_in (list->data, NULL);
+
+          g_list_free (swapped);
+
+          return FALSE;
+        }
+
+      swapped = g_list_prepend (swapped, child);
+    }
+
+  g_list_free (swapped);
+
+  return TRUE;
+}
+
+static gboolean
+gimp_undo_stack_swap_in (GimpUndo  *undo,
+                         GError   **error)
+{
+  GimpUndoStack *stack = GIMP_UNDO_STACK (undo);
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      if (! gimp_undo_swap_in (child, error))
+        {
+          /*  the children read so far stay in memory  */
+          undo->swapped_size = gimp_undo_stack_get_swapped_size (stack);
+
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
 GimpUndoStack *
 gimp_undo_stack_new (GimpImage *image)
 {
@@ -161,6 +230,10 @@ gimp_undo_stack_pop_undo (GimpUndoStack       *stack,
 
   if (undo)
     {
+      /*  never apply a step whose data couldn't be read back  */
+      if (! gimp_undo_swap_in (undo, NULL))
+        return NULL;
+
       gimp_container_remove (stack->undos, GIMP_OBJECT (undo));
       gimp_undo_pop (undo, undo_mode, accum);
 
@@ -206,3 +279,26 @@ gimp_undo_stack_get_depth (GimpUndoStack *stack)
 
   return gimp_container_get_n_children (stack->undos);
 }
+
+gint64
+gimp_undo_stack_get_swapped_size (GimpUndoStack *stack)
+{
+  GList  *list;
+  gint64  size = 0;
+
+  g_return_val_if_fail (GIMP_IS_UNDO_STACK (stack), 0);
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      if (gimp_undo_is_swapped (child))
+        size += gimp_undo_get_swapped_size (child);
+      else if (GIMP_IS_UNDO_STACK (child))
+        size += gimp_undo_stack_get_swapped_size (GIMP_UNDO_STACK (child));
+    }
+
+  return size;
+}
@@ -60,5 +60,8 @@ GimpUndo      * gimp_undo_stack_free_bottom (GimpUndoStack       *stack,
 GimpUndo      * gimp_undo_stack_peek        (GimpUndoStack       *stack);
 gint            gimp_undo_stack_get_depth   (GimpUndoStack       *stack);
 
+gint64          gimp_undo_stack_get_swapped_size
+                                            (GimpUndoStack       *stack);
+
 
 #endif /* __GIMP_UNDO_STACK_H__ */
@@ -49,6 +49,8 @@
 
 #include "git-version.h"
 
+#include "gimp-log.h"
+
 #include "gimp-intl.h"
 
 
@@ -418,6 +420,11 @@ gimp_display_shell_canvas_draw_image (GimpDisplayShell *shell,
 {
   cairo_rectangle_list_t *clip_rectangles;
   cairo_rectangle_int_t   image_rect;
+  GTimer                 *timer = NULL;
+  gint64                  n_pixels = 0;
+
+  if (gimp_log_flags & GIMP_LOG_RENDER)
+    timer = g_timer_new ();
 
   image_rect.x = - shell->offset_x;
   image_rect.y = - shell->offset_y;
@@ -484,12 +491,24 @@ gimp_display_shell_canvas_draw_image (GimpDisplayShell *shell,
                                          floor (rect.y),
                                          ceil (rect.width),
                                          ceil (rect.height));
+
+          n_pixels += (gint64) ceil (rect.width) * ceil (rect.height);
         }
     }
 
   cairo_rectangle_list_destroy (clip_rectangles);
   cairo_restore (cr);
 
+  if (timer)
+    {
+      GIMP_LOG (RENDER, "%" G_GINT64_FORMAT " pixels from level %d "
+                "in %f seconds\n",
+                n_pixels, shell->render_level,
+                g_timer_elapsed (timer, NULL));
+
+      g_timer_destroy (timer);
+    }
+
 
   /*  finally, draw all the remaining image window stuff on top
    */
@@ -324,6 +324,8 @@ gimp_display_shell_init (GimpDisplayShell *shell)
   shell->scale_x     = 1.0;
   shell->scale_y     = 1.0;
 
+  shell->render_level = -1;
+
   gimp_display_shell_items_init (shell);
 
   shell->icon_size       = 128;
@@ -1042,6 +1044,8 @@ gimp_display_shell_real_scaled (GimpDisplayShell *shell)
 
   gimp_display_shell_title_update (shell);
 
+  gimp_display_shell_update_render_level (shell);
+
   user_context = gimp_get_user_context (shell->display->gimp);
 
   if (shell->display == gimp_context_get_display (user_context))
@@ -1591,6 +1595,71 @@ gimp_display_shell_rotated (GimpDisplayShell *shell)
   g_signal_emit (shell, display_shell_signals[ROTATED], 0);
 }
 
+/**
+ * gimp_display_shell_update_render_level:
+ * @shell: a #GimpDisplayShell
+ *
+ * Registers the mipmap level of the image's projection which @shell
+ * shows at its current scale with the projection, replacing the level
+ * registered before, so that the projection keeps that level up to
+ * date while it renders.
+ **/
+void
+gimp_display_shell_update_render_level (GimpDisplayShell *shell)
+{
+  GimpImage      *image;
+  GimpProjection *projection;
+  gint            level;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  image = gimp_display_get_image (shell->display);
+
+  if (! image)
+    return;
+
+  projection = gimp_image_get_projection (image);
+
+  /*  gimp_display_shell_render() reads the projection at the larger
+   *  of the two scales
+   */
+  level = gimp_projection_get_level (projection,
+                                     MAX (shell->scale_x, shell->scale_y));
+
+  if (level != shell->render_level)
+    {
+      gimp_projection_add_render_level (projection, level);
+
+      if (shell->render_level >= 0)
+        gimp_projection_remove_render_level (projection, shell->render_level);
+
+      shell->render_level = level;
+    }
+}
+
+/**
+ * gimp_display_shell_clear_render_level:
+ * @shell: a #GimpDisplayShell
+ *
+ * Unregisters the mipmap level registered by
+ * gimp_display_shell_update_render_level().
+ **/
+void
+gimp_display_shell_clear_render_level (GimpDisplayShell *shell)
+{
+  GimpImage *image;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  image = gimp_display_get_image (shell->display);
+
+  if (image && shell->render_level >= 0)
+    gimp_projection_remove_render_level (gimp_image_get_projection (image),
+                                         shell->render_level);
+
+  shell->render_level = -1;
+}
+
 void
 gimp_display_shell_set_unit (GimpDisplayShell *shell,
                              GimpUnit          unit)
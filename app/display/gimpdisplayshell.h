@@ -66,6 +66,7 @@ struct _GimpDisplayShell
 
   gdouble            scale_x;          /*  horizontal scale factor            */
   gdouble            scale_y;          /*  vertical scale factor              */
+  gint               render_level;     /*  projection level shown, or -1      */
 
   gboolean           flip_horizontally;
   gboolean           flip_vertically;
@@ -269,6 +270,9 @@ void              gimp_display_shell_scaled        (GimpDisplayShell   *shell);
 void              gimp_display_shell_scrolled      (GimpDisplayShell   *shell);
 void              gimp_display_shell_rotated       (GimpDisplayShell   *shell);
 
+void       gimp_display_shell_update_render_level  (GimpDisplayShell   *shell);
+void       gimp_display_shell_clear_render_level   (GimpDisplayShell   *shell);
+
 void              gimp_display_shell_set_unit      (GimpDisplayShell   *shell,
                                                     GimpUnit            unit);
 GimpUnit          gimp_display_shell_get_unit      (GimpDisplayShell   *shell);
@@ -28,6 +28,7 @@
 
 #include "gimp-gegl-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
@@ -36,6 +37,31 @@
 #include "gegl/gimp-gegl-utils.h"
 
 
+#define MIN_PARALLEL_AREA   (256 * 256)
+#define PARALLEL_CHUNK_ROWS 64
+
+
+typedef struct
+{
+  GeglBuffer     *src_buffer;
+  GeglNode      **operations;
+  GeglBuffer     *dest_buffer;
+  GeglRectangle   rect;
+
+  GimpProgress   *progress;
+  GThread        *main_thread;
+  gint            next_row;     /*  first row of the next strip to render  */
+  gint            rows_done;
+} GimpGeglApplyParallel;
+
+
+static gboolean   gimp_gegl_apply_parallel_operation (GeglBuffer   *src_buffer,
+                                                      GimpProgress *progress,
+                                                      const gchar  *undo_desc,
+                                                      GeglNode     *operation,
+                                                      GeglBuffer   *dest_buffer);
+
+
 void
 gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GimpProgress        *progress,
@@ -630,8 +656,13 @@ gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
                               "y",          y,
                               NULL);
 
-  gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
-                             node, dest_buffer, NULL);
+  if (! gimp_gegl_apply_parallel_operation (src_buffer, progress, undo_desc,
+                                            node, dest_buffer))
+    {
+      gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
+                                 node, dest_buffer, NULL);
+    }
+
   g_object_unref (node);
 }
 
@@ -707,7 +738,195 @@ gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
 
   gimp_gegl_node_set_matrix (node, transform);
 
-  gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
-                             node, dest_buffer, NULL);
+  if (! gimp_gegl_apply_parallel_operation (src_buffer, progress, undo_desc,
+                                            node, dest_buffer))
+    {
+      gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
+                                 node, dest_buffer, NULL);
+    }
+
   g_object_unref (node);
 }
+
+
+/*  private functions  */
+
+static GeglNode *
+gimp_gegl_apply_parallel_dup_operation (GeglNode *operation)
+{
+  const gchar  *name = gegl_node_get_operation (operation);
+  GeglNode     *dup;
+  GParamSpec  **pspecs;
+  guint         n_pspecs;
+  guint         i;
+
+  dup = gegl_node_new_child (NULL,
+                             "operation", name,
+                             NULL);
+
+  pspecs = gegl_operation_list_properties (name, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GValue value = G_VALUE_INIT;
+
+      if ((pspecs[i]->flags & G_PARAM_READWRITE) != G_PARAM_READWRITE)
+        continue;
+
+      g_value_init (&value, pspecs[i]->value_type);
+
+      gegl_node_get_property (operation, pspecs[i]->name, &value);
+      gegl_node_set_property (dup,       pspecs[i]->name, &value);
+
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+
+  return dup;
+}
+
+static void
+gimp_gegl_apply_parallel_func (gint     i,
+                               gint     n,
+                               gpointer user_data)
+{
+  GimpGeglApplyParallel *data      = user_data;
+  GeglNode              *operation = data->operations[i];
+  const Babl            *format    = gegl_buffer_get_format (data->dest_buffer);
+  GeglNode              *gegl;
+  GeglNode              *src_node;
+  guchar                *buf;
+  gint                   y;
+
+  /*  the threads take the next strip of rows in turn, and render it
+   *  through their own copy of the graph, since a graph can't be
+   *  processed by several threads at once
+   */
+  y = g_atomic_int_add (&data->next_row, PARALLEL_CHUNK_ROWS);
+
+  if (y >= data->rect.height)
+    return;
+
+  gegl = gegl_node_new ();
+
+  gegl_node_add_child (gegl, operation);
+
+  src_node = gegl_node_new_child (gegl,
+                                  "operation", "gegl:buffer-source",
+                                  "buffer",    data->src_buffer,
+                                  NULL);
+
+  gegl_node_connect_to (src_node,  "output",
+                        operation, "input");
+
+  buf = g_malloc ((gsize) data->rect.width * PARALLEL_CHUNK_ROWS *
+                  babl_format_get_bytes_per_pixel (format));
+
+  for (;
+       y < data->rect.height;
+       y = g_atomic_int_add (&data->next_row, PARALLEL_CHUNK_ROWS))
+    {
+      GeglRectangle roi = { data->rect.x,     data->rect.y + y,
+                            data->rect.width, MIN (PARALLEL_CHUNK_ROWS,
+                                                   data->rect.height - y) };
+      gint          rows_done;
+
+      gegl_node_blit (operation, 1.0, &roi, format, buf,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+      gegl_buffer_set (data->dest_buffer, &roi, 0, format, buf,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      rows_done = g_atomic_int_add (&data->rows_done, roi.height) +
+                  roi.height;
+
+      /*  the progress can only be updated from the main thread  */
+      if (data->progress && g_thread_self () == data->main_thread)
+        gimp_progress_set_value (data->progress,
+                                 (gdouble) rows_done / data->rect.height);
+    }
+
+  g_free (buf);
+
+  g_object_unref (gegl);
+}
+
+/*  renders operation, which must be a plain filter, into dest_buffer
+ *  on all threads. Returns FALSE without doing anything if that isn't
+ *  worth it, and the caller needs to apply the operation itself.
+ */
+static gboolean
+gimp_gegl_apply_parallel_operation (GeglBuffer   *src_buffer,
+                                    GimpProgress *progress,
+                                    const gchar  *undo_desc,
+                                    GeglNode     *operation,
+                                    GeglBuffer   *dest_buffer)
+{
+  GimpGeglApplyParallel data;
+  gint                  n_threads;
+  gboolean              progress_started = FALSE;
+  gint                  i;
+
+  n_threads = gimp_parallel_get_n_threads ();
+
+  data.rect = *GEGL_RECTANGLE (0, 0,
+                               gegl_buffer_get_width  (dest_buffer),
+                               gegl_buffer_get_height (dest_buffer));
+
+  if (n_threads < 2             ||
+      src_buffer == dest_buffer ||
+      data.rect.width * data.rect.height < MIN_PARALLEL_AREA)
+    {
+      return FALSE;
+    }
+
+  n_threads = MIN (n_threads,
+                   (data.rect.height + PARALLEL_CHUNK_ROWS - 1) /
+                   PARALLEL_CHUNK_ROWS);
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.operations  = g_new (GeglNode *, n_threads);
+  data.progress    = progress;
+  data.main_thread = g_thread_self ();
+  data.next_row    = 0;
+  data.rows_done   = 0;
+
+  for (i = 0; i < n_threads; i++)
+    data.operations[i] = gimp_gegl_apply_parallel_dup_operation (operation);
+
+  if (progress)
+    {
+      if (gimp_progress_is_active (progress))
+        {
+          if (undo_desc)
+            gimp_progress_set_text_literal (progress, undo_desc);
+        }
+      else
+        {
+          gimp_progress_start (progress, FALSE, "%s", undo_desc);
+
+          progress_started = TRUE;
+        }
+
+      gimp_progress_set_value (progress, 0.0);
+    }
+
+  gimp_parallel_distribute (n_threads, gimp_gegl_apply_parallel_func, &data);
+
+  for (i = 0; i < n_threads; i++)
+    g_object_unref (data.operations[i]);
+
+  g_free (data.operations);
+
+  if (progress)
+    {
+      gimp_progress_set_value (progress, 1.0);
+
+      if (progress_started)
+        gimp_progress_end (progress);
+    }
+
+  return TRUE;
+}
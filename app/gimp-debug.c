@@ -31,6 +31,11 @@
 
 static GHashTable *class_hash = NULL;
 
+/*  objects are also created on the worker threads of
+ *  gimp_parallel_distribute(), e.g. when loading data
+ */
+static GMutex      class_hash_mutex;
+
 
 void
 gimp_debug_enable_instances (void)
@@ -52,6 +57,8 @@ gimp_debug_add_instance (GObject      *instance,
       GHashTable  *instance_hash;
       const gchar *type_name;
 
+      g_mutex_lock (&class_hash_mutex);
+
       type_name = g_type_name (G_TYPE_FROM_CLASS (klass));
 
       instance_hash = g_hash_table_lookup (class_hash, type_name);
@@ -64,6 +71,8 @@ gimp_debug_add_instance (GObject      *instance,
         }
 
       g_hash_table_insert (instance_hash, instance, instance);
+
+      g_mutex_unlock (&class_hash_mutex);
     }
 }
 
@@ -75,6 +84,8 @@ gimp_debug_remove_instance (GObject *instance)
       GHashTable  *instance_hash;
       const gchar *type_name;
 
+      g_mutex_lock (&class_hash_mutex);
+
       type_name = g_type_name (G_OBJECT_TYPE (instance));
 
       instance_hash = g_hash_table_lookup (class_hash, type_name);
@@ -86,6 +97,8 @@ gimp_debug_remove_instance (GObject *instance)
           if (g_hash_table_size (instance_hash) == 0)
             g_hash_table_remove (class_hash, type_name);
         }
+
+      g_mutex_unlock (&class_hash_mutex);
     }
 }
 
@@ -115,8 +128,12 @@ gimp_debug_instances (void)
 {
   if (class_hash)
     {
+      g_mutex_lock (&class_hash_mutex);
+
       g_hash_table_foreach (class_hash,
                             (GHFunc) gimp_debug_class_foreach,
                             NULL);
+
+      g_mutex_unlock (&class_hash_mutex);
     }
 }
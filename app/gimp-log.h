@@ -42,7 +42,8 @@ typedef enum
   GIMP_LOG_BRUSH_CACHE        = 1 << 18,
   GIMP_LOG_PROJECTION         = 1 << 19,
   GIMP_LOG_XCF                = 1 << 20,
-  GIMP_LOG_MAGIC_MATCH        = 1 << 21
+  GIMP_LOG_MAGIC_MATCH        = 1 << 21,
+  GIMP_LOG_RENDER             = 1 << 22
 } GimpLogFlags;
 
 
@@ -104,6 +105,7 @@ void   gimp_logv     (GimpLogFlags  flags,
 #define BRUSH_CACHE        GIMP_LOG_BRUSH_CACHE
 #define PROJECTION         GIMP_LOG_PROJECTION
 #define XCF                GIMP_LOG_XCF
+#define RENDER             GIMP_LOG_RENDER
 
 #if 0 /* last resort */
 #  define GIMP_LOG /* nothing => no varargs, no log */
@@ -25,6 +25,11 @@
 
 /* #define G_PRIORITY_HIGH_IDLE 100 */
 
+/*  before redraw, so that a coalesced filter preview update is drawn
+ *  right away
+ */
+#define GIMP_PRIORITY_DRAWABLE_FILTER_IDLE (G_PRIORITY_HIGH_IDLE + 10)
+
 /* #define GTK_PRIORITY_REDRAW (G_PRIORITY_HIGH_IDLE + 20) */
 
 /*  a bit higher than projection construction  */
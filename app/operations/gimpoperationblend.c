@@ -38,7 +38,12 @@
 #include "gimp-intl.h"
 
 
-//#define USE_GRADIENT_CACHE 1
+/*  the number of colors the gradient is sampled at before rendering,
+ *  enough to give every pixel of even a very large gradient its own
+ *  color
+ */
+#define GRADIENT_CACHE_SIZE 65536
+
 
 enum
 {
@@ -61,12 +66,7 @@ enum
 
 typedef struct
 {
-  GimpGradient     *gradient;
-  gboolean          reverse;
-#ifdef USE_GRADIENT_CACHE
-  GimpRGB          *gradient_cache;
-  gint              gradient_cache_size;
-#endif
+  const gfloat     *gradient_cache;
   gdouble           offset;
   gdouble           sx, sy;
   GimpGradientType  gradient_type;
@@ -91,6 +91,7 @@ typedef struct
 /*  local function prototypes  */
 
 static void     gimp_operation_blend_dispose      (GObject      *gobject);
+static void     gimp_operation_blend_finalize     (GObject      *gobject);
 static void     gimp_operation_blend_get_property (GObject      *object,
                                                    guint         property_id,
                                                    GValue       *value,
@@ -139,16 +140,20 @@ static gdouble  gradient_calc_spiral_factor       (gdouble   dist,
                                                    gdouble   y,
                                                    gboolean  clockwise);
 
-static gdouble  gradient_calc_shapeburst_angular_factor   (GeglBuffer *dist_buffer,
-                                                           gdouble     x,
-                                                           gdouble     y);
-static gdouble  gradient_calc_shapeburst_spherical_factor (GeglBuffer *dist_buffer,
-                                                           gdouble     x,
-                                                           gdouble     y);
-static gdouble  gradient_calc_shapeburst_dimpled_factor   (GeglBuffer *dist_buffer,
+static gfloat   gradient_get_shapeburst_value             (GeglBuffer *dist_buffer,
                                                            gdouble     x,
                                                            gdouble     y);
+static gdouble  gradient_calc_shapeburst_angular_factor   (gfloat      value);
+static gdouble  gradient_calc_shapeburst_spherical_factor (gfloat      value);
+static gdouble  gradient_calc_shapeburst_dimpled_factor   (gfloat      value);
 
+static void     gradient_render_row          (RenderBlendData    *rbd,
+                                              gint                x,
+                                              gint                y,
+                                              gint                width,
+                                              const gfloat       *dist_row,
+                                              gdouble            *factors,
+                                              gfloat             *dest);
 static void     gradient_render_pixel        (gdouble             x,
                                               gdouble             y,
                                               GimpRGB            *color,
@@ -165,6 +170,8 @@ static gboolean gimp_operation_blend_process (GeglOperation       *operation,
                                               const GeglRectangle *result,
                                               gint                 level);
 
+static GBytes * gimp_operation_blend_get_gradient_cache (GimpOperationBlend *self);
+
 
 G_DEFINE_TYPE (GimpOperationBlend, gimp_operation_blend,
                GEGL_TYPE_OPERATION_FILTER)
@@ -180,6 +187,7 @@ gimp_operation_blend_class_init (GimpOperationBlendClass *klass)
   GeglOperationFilterClass *filter_class    = GEGL_OPERATION_FILTER_CLASS (klass);
 
   object_class->dispose             = gimp_operation_blend_dispose;
+  object_class->finalize            = gimp_operation_blend_finalize;
   object_class->set_property        = gimp_operation_blend_set_property;
   object_class->get_property        = gimp_operation_blend_get_property;
 
@@ -313,6 +321,7 @@ gimp_operation_blend_class_init (GimpOperationBlendClass *klass)
 static void
 gimp_operation_blend_init (GimpOperationBlend *self)
 {
+  g_mutex_init (&self->gradient_cache_mutex);
 }
 
 static void
@@ -326,6 +335,18 @@ gimp_operation_blend_dispose (GObject *object)
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gimp_operation_blend_finalize (GObject *object)
+{
+  GimpOperationBlend *self = GIMP_OPERATION_BLEND (object);
+
+  g_clear_pointer (&self->gradient_cache, g_bytes_unref);
+
+  g_mutex_clear (&self->gradient_cache_mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gimp_operation_blend_get_property (GObject    *object,
                                    guint       property_id,
@@ -419,6 +440,8 @@ gimp_operation_blend_set_property (GObject      *object,
       {
         GimpGradient *gradient = g_value_get_object (value);
 
+        g_mutex_lock (&self->gradient_cache_mutex);
+
         if (self->gradient)
           {
             g_object_unref (self->gradient);
@@ -432,6 +455,10 @@ gimp_operation_blend_set_property (GObject      *object,
             else
               self->gradient = g_object_ref (gradient);
           }
+
+        g_clear_pointer (&self->gradient_cache, g_bytes_unref);
+
+        g_mutex_unlock (&self->gradient_cache_mutex);
       }
       break;
 
@@ -464,7 +491,13 @@ gimp_operation_blend_set_property (GObject      *object,
       break;
 
     case PROP_GRADIENT_REVERSE:
+      g_mutex_lock (&self->gradient_cache_mutex);
+
       self->gradient_reverse = g_value_get_boolean (value);
+
+      g_clear_pointer (&self->gradient_cache, g_bytes_unref);
+
+      g_mutex_unlock (&self->gradient_cache_mutex);
       break;
 
     case PROP_SUPERSAMPLE:
@@ -748,10 +781,10 @@ gradient_calc_spiral_factor (gdouble   dist,
     }
 }
 
-static gdouble
-gradient_calc_shapeburst_angular_factor (GeglBuffer *dist_buffer,
-                                         gdouble     x,
-                                         gdouble     y)
+static gfloat
+gradient_get_shapeburst_value (GeglBuffer *dist_buffer,
+                               gdouble     x,
+                               gdouble     y)
 {
   gfloat value;
 
@@ -759,43 +792,189 @@ gradient_calc_shapeburst_angular_factor (GeglBuffer *dist_buffer,
                    NULL, &value,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  value = 1.0 - value;
-
   return value;
 }
 
+static gdouble
+gradient_calc_shapeburst_angular_factor (gfloat value)
+{
+  return 1.0 - value;
+}
+
+static gdouble
+gradient_calc_shapeburst_spherical_factor (gfloat value)
+{
+  return 1.0 - sin (0.5 * G_PI * value);
+}
 
 static gdouble
-gradient_calc_shapeburst_spherical_factor (GeglBuffer *dist_buffer,
-                                           gdouble     x,
-                                           gdouble     y)
+gradient_calc_shapeburst_dimpled_factor (gfloat value)
 {
-  gfloat value;
+  return cos (0.5 * G_PI * value);
+}
 
-  gegl_buffer_get (dist_buffer, GEGL_RECTANGLE (x, y, 1, 1), 1.0,
-                   NULL, &value,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+static inline gdouble
+gradient_repeat_factor (GimpRepeatMode repeat,
+                        gdouble        factor)
+{
+  switch (repeat)
+    {
+    case GIMP_REPEAT_TRUNCATE:
+      break;
 
-  value = 1.0 - sin (0.5 * G_PI * value);
+    case GIMP_REPEAT_NONE:
+      factor = CLAMP (factor, 0.0, 1.0);
+      break;
 
-  return value;
+    case GIMP_REPEAT_SAWTOOTH:
+      factor = factor - floor (factor);
+      break;
+
+    case GIMP_REPEAT_TRIANGULAR:
+      {
+        guint ifactor;
+
+        if (factor < 0.0)
+          factor = -factor;
+
+        ifactor = (guint) factor;
+        factor = factor - floor (factor);
+
+        if (ifactor & 1)
+          factor = 1.0 - factor;
+      }
+      break;
+    }
+
+  return factor;
 }
 
+static inline void
+gradient_lookup_color (RenderBlendData *rbd,
+                       gdouble          factor,
+                       gfloat          *color)
+{
+  if (factor < 0.0 || factor > 1.0)
+    {
+      color[0] = color[1] = color[2] = 0.0;
+      color[3] = GIMP_OPACITY_TRANSPARENT;
+    }
+  else
+    {
+      const gfloat *cached;
+
+      cached = rbd->gradient_cache +
+               4 * (gint) (factor * (GRADIENT_CACHE_SIZE - 1) + 0.5);
 
-static gdouble
-gradient_calc_shapeburst_dimpled_factor (GeglBuffer *dist_buffer,
-                                         gdouble     x,
-                                         gdouble     y)
+      color[0] = cached[0];
+      color[1] = cached[1];
+      color[2] = cached[2];
+      color[3] = cached[3];
+    }
+}
+
+/*  renders one row of pixels. The blending factors are calculated for
+ *  the whole row first, in a loop per gradient type, and only then
+ *  mapped to colors.
+ */
+static void
+gradient_render_row (RenderBlendData *rbd,
+                     gint             x,
+                     gint             y,
+                     gint             width,
+                     const gfloat    *dist_row,
+                     gdouble         *factors,
+                     gfloat          *dest)
 {
-  gfloat value;
+  const gdouble x0 = x + 0.5 - rbd->sx;
+  const gdouble y0 = y + 0.5 - rbd->sy;
+  gint          i;
 
-  gegl_buffer_get (dist_buffer, GEGL_RECTANGLE (x, y, 1, 1), 1.0,
-                   NULL, &value,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  switch (rbd->gradient_type)
+    {
+    case GIMP_GRADIENT_LINEAR:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_linear_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  x0 + i, y0);
+      break;
 
-  value = cos (0.5 * G_PI * value);
+    case GIMP_GRADIENT_BILINEAR:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_bilinear_factor (rbd->dist,
+                                                    rbd->vec, rbd->offset,
+                                                    x0 + i, y0);
+      break;
 
-  return value;
+    case GIMP_GRADIENT_RADIAL:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_radial_factor (rbd->dist,
+                                                  rbd->offset,
+                                                  x0 + i, y0);
+      break;
+
+    case GIMP_GRADIENT_SQUARE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                                  x0 + i, y0);
+      break;
+
+    case GIMP_GRADIENT_CONICAL_SYMMETRIC:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_sym_factor (rbd->dist,
+                                                       rbd->vec, rbd->offset,
+                                                       x0 + i, y0);
+      break;
+
+    case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_conical_asym_factor (rbd->dist,
+                                                        rbd->vec, rbd->offset,
+                                                        x0 + i, y0);
+      break;
+
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_shapeburst_angular_factor (dist_row[i]);
+      break;
+
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_shapeburst_spherical_factor (dist_row[i]);
+      break;
+
+    case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_shapeburst_dimpled_factor (dist_row[i]);
+      break;
+
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  x0 + i, y0, TRUE);
+      break;
+
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      for (i = 0; i < width; i++)
+        factors[i] = gradient_calc_spiral_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  x0 + i, y0, FALSE);
+      break;
+
+    default:
+      g_return_if_reached ();
+      break;
+    }
+
+  for (i = 0; i < width; i++)
+    {
+      gradient_lookup_color (rbd,
+                             gradient_repeat_factor (rbd->repeat, factors[i]),
+                             dest);
+
+      dest += 4;
+    }
 }
 
 static void
@@ -805,7 +984,9 @@ gradient_render_pixel (gdouble   x,
                        gpointer  render_data)
 {
   RenderBlendData *rbd = render_data;
+  gfloat           value;
   gdouble          factor;
+  gfloat           rgba[4];
 
   /*  we want to calculate the color at the pixel's center  */
   x += 0.5;
@@ -851,15 +1032,18 @@ gradient_render_pixel (gdouble   x,
       break;
 
     case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
-      factor = gradient_calc_shapeburst_angular_factor (rbd->dist_buffer, x, y);
+      value  = gradient_get_shapeburst_value (rbd->dist_buffer, x, y);
+      factor = gradient_calc_shapeburst_angular_factor (value);
       break;
 
     case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
-      factor = gradient_calc_shapeburst_spherical_factor (rbd->dist_buffer, x, y);
+      value  = gradient_get_shapeburst_value (rbd->dist_buffer, x, y);
+      factor = gradient_calc_shapeburst_spherical_factor (value);
       break;
 
     case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
-      factor = gradient_calc_shapeburst_dimpled_factor (rbd->dist_buffer, x, y);
+      value  = gradient_get_shapeburst_value (rbd->dist_buffer, x, y);
+      factor = gradient_calc_shapeburst_dimpled_factor (value);
       break;
 
     case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
@@ -879,53 +1063,16 @@ gradient_render_pixel (gdouble   x,
       break;
     }
 
-  /* Adjust for repeat */
-
-  switch (rbd->repeat)
-    {
-    case GIMP_REPEAT_TRUNCATE:
-      break;
-
-    case GIMP_REPEAT_NONE:
-      factor = CLAMP (factor, 0.0, 1.0);
-      break;
-
-    case GIMP_REPEAT_SAWTOOTH:
-      factor = factor - floor (factor);
-      break;
-
-    case GIMP_REPEAT_TRIANGULAR:
-      {
-        guint ifactor;
-
-        if (factor < 0.0)
-          factor = -factor;
-
-        ifactor = (guint) factor;
-        factor = factor - floor (factor);
-
-        if (ifactor & 1)
-          factor = 1.0 - factor;
-      }
-      break;
-    }
+  factor = gradient_repeat_factor (rbd->repeat, factor);
 
   /* Blend the colors */
 
-  if (factor < 0.0 || factor > 1.0)
-    {
-      color->r = color->g = color->b = 0;
-      color->a = GIMP_OPACITY_TRANSPARENT;
-    }
-  else
-    {
-#ifdef USE_GRADIENT_CACHE
-      *color = rbd->gradient_cache[(gint) (factor * (rbd->gradient_cache_size - 1))];
-#else
-      gimp_gradient_get_color_at (rbd->gradient, NULL, NULL,
-                                  factor, rbd->reverse, color);
-#endif
-    }
+  gradient_lookup_color (rbd, factor, rgba);
+
+  color->r = rgba[0];
+  color->g = rgba[1];
+  color->b = rgba[2];
+  color->a = rgba[3];
 }
 
 static void
@@ -986,33 +1133,8 @@ gimp_operation_blend_process (GeglOperation       *operation,
   const gdouble ex = self->end_x;
   const gdouble ey = self->end_y;
 
-  RenderBlendData rbd = { 0, };
-
-  rbd.gradient = NULL;
-  rbd.reverse  = self->gradient_reverse;
-
-  if (self->gradient)
-    rbd.gradient = g_object_ref (self->gradient);
-  else
-    rbd.gradient = GIMP_GRADIENT (gimp_gradient_new (NULL, "Blend-Temp"));
-
-#ifdef USE_GRADIENT_CACHE
-  {
-    gint i;
-
-    rbd.gradient_cache_size = ceil (sqrt (SQR (sx - ex) + SQR (sy - ey)));
-    rbd.gradient_cache      = g_new0 (GimpRGB, rbd.gradient_cache_size);
-
-    for (i = 0; i < rbd.gradient_cache_size; i++)
-      {
-        gdouble factor = (gdouble) i / (gdouble) (rbd.gradient_cache_size - 1);
-
-        gimp_gradient_get_color_at (rbd.gradient, NULL, NULL,
-                                    factor, rbd.reverse,
-                                    rbd.gradient_cache + i);
-      }
-  }
-#endif
+  RenderBlendData  rbd = { 0, };
+  GBytes          *gradient_cache;
 
   /* Calculate type-specific parameters */
 
@@ -1062,6 +1184,12 @@ gimp_operation_blend_process (GeglOperation       *operation,
   rbd.gradient_type = self->gradient_type;
   rbd.repeat        = self->gradient_repeat;
 
+  /*  keep our own reference, set_property() may drop the cache while
+   *  the threads are still reading it
+   */
+  gradient_cache     = gimp_operation_blend_get_gradient_cache (self);
+  rbd.gradient_cache = g_bytes_get_data (gradient_cache, NULL);
+
   /* Render the gradient! */
 
   if (self->supersample)
@@ -1093,78 +1221,131 @@ gimp_operation_blend_process (GeglOperation       *operation,
     {
       GeglBufferIterator *iter;
       GeglRectangle      *roi;
+      gdouble            *factors;
 
       iter = gegl_buffer_iterator_new (output, result, 0,
                                        babl_format ("R'G'B'A float"),
                                        GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
       roi = &iter->roi[0];
 
+      if (rbd.dist_buffer)
+        gegl_buffer_iterator_add (iter, rbd.dist_buffer, result, 0,
+                                  babl_format ("Y float"),
+                                  GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+      factors = g_new (gdouble, result->width);
+
       if (self->dither)
         rbd.seed = g_rand_new ();
 
       while (gegl_buffer_iterator_next (iter))
         {
-          gfloat *dest = iter->data[0];
-          gint    endx = roi->x + roi->width;
-          gint    endy = roi->y + roi->height;
-          gint    x, y;
+          gfloat       *dest        = iter->data[0];
+          const gfloat *dist_row    = rbd.dist_buffer ? iter->data[1] : NULL;
+          GRand        *dither_rand = NULL;
+          gint          endy        = roi->y + roi->height;
+          gint          y;
 
           if (rbd.seed)
+            dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
+
+          for (y = roi->y; y < endy; y++)
             {
-              GRand *dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
+              gradient_render_row (&rbd, roi->x, y, roi->width,
+                                   dist_row, factors, dest);
+
+              if (dither_rand)
+                {
+                  gint x;
+
+                  for (x = 0; x < roi->width; x++)
+                    {
+                      gfloat *color = dest + 4 * x;
+                      gfloat  r, g, b, a;
+                      gint    i = g_rand_int (dither_rand);
+
+                      r = color[0] + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                      g = color[1] + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+                      b = color[2] + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+
+                      if (color[3] > 0.0 && color[3] < 1.0)
+                        a = color[3] + (gdouble) (i & 0xff) / 256.0 / 256.0;
+                      else
+                        a = color[3];
+
+                      color[0] = MAX (r, 0.0);
+                      color[1] = MAX (g, 0.0);
+                      color[2] = MAX (b, 0.0);
+                      color[3] = MAX (a, 0.0);
+                    }
+                }
+
+              dest += 4 * roi->width;
+
+              if (dist_row)
+                dist_row += roi->width;
+            }
 
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-                    gfloat   r, g, b, a;
-                    gint     i = g_rand_int (dither_rand);
+          if (dither_rand)
+            g_rand_free (dither_rand);
+        }
+
+      if (self->dither)
+        g_rand_free (rbd.seed);
+
+      g_free (factors);
+    }
 
-                    gradient_render_pixel (x, y, &color, &rbd);
+  g_bytes_unref (gradient_cache);
 
-                    r = color.r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    g = color.g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    b = color.b + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
+  return TRUE;
+}
 
-                    if (color.a > 0.0 && color.a < 1.0)
-                      a = color.a + (gdouble) (i & 0xff) / 256.0 / 256.0;
-                    else
-                      a = color.a;
+static GBytes *
+gimp_operation_blend_get_gradient_cache (GimpOperationBlend *self)
+{
+  GBytes *gradient_cache;
 
-                    *dest++ = MAX (r, 0.0);
-                    *dest++ = MAX (g, 0.0);
-                    *dest++ = MAX (b, 0.0);
-                    *dest++ = MAX (a, 0.0);
-                  }
+  g_mutex_lock (&self->gradient_cache_mutex);
 
-              g_rand_free (dither_rand);
-            }
-          else
-            {
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    *dest++ = color.r;
-                    *dest++ = color.g;
-                    *dest++ = color.b;
-                    *dest++ = color.a;
-                  }
-            }
+  if (! self->gradient_cache)
+    {
+      GimpGradient        *gradient;
+      GimpGradientSegment *seg = NULL;
+      gfloat              *colors;
+      gint                 i;
+
+      if (self->gradient)
+        gradient = g_object_ref (self->gradient);
+      else
+        gradient = GIMP_GRADIENT (gimp_gradient_new (NULL, "Blend-Temp"));
+
+      colors = g_new (gfloat, 4 * GRADIENT_CACHE_SIZE);
+
+      for (i = 0; i < GRADIENT_CACHE_SIZE; i++)
+        {
+          gdouble  factor = (gdouble) i / (gdouble) (GRADIENT_CACHE_SIZE - 1);
+          GimpRGB  color;
+
+          seg = gimp_gradient_get_color_at (gradient, NULL, seg,
+                                            factor, self->gradient_reverse,
+                                            &color);
+
+          colors[4 * i + 0] = color.r;
+          colors[4 * i + 1] = color.g;
+          colors[4 * i + 2] = color.b;
+          colors[4 * i + 3] = color.a;
         }
 
-      if (self->dither)
-        g_rand_free (rbd.seed);
+      self->gradient_cache =
+        g_bytes_new_take (colors, sizeof (gfloat) * 4 * GRADIENT_CACHE_SIZE);
+
+      g_object_unref (gradient);
     }
 
-#ifdef USE_GRADIENT_CACHE
-  g_free (rbd.gradient_cache);
-#endif
+  gradient_cache = g_bytes_ref (self->gradient_cache);
 
-  g_object_unref (rbd.gradient);
+  g_mutex_unlock (&self->gradient_cache_mutex);
 
-  return TRUE;
+  return gradient_cache;
 }
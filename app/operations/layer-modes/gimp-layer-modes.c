@@ -23,6 +23,8 @@
 
 #include <glib-object.h>
 
+#include "libgimpbase/gimpbase.h"
+
 #include "../operations-types.h"
 
 #include "gimpoperationlayermode.h"
@@ -46,6 +48,21 @@ struct _GimpLayerModeInfo
   GimpLayerColorSpace       blend_space;
 };
 
+typedef struct _GimpLayerModeBlendVariant GimpLayerModeBlendVariant;
+
+struct _GimpLayerModeBlendVariant
+{
+  GimpLayerModeBlendFunc    generic;
+  GimpLayerModeBlendFunc    accelerated;
+};
+
+
+/*  local function prototypes  */
+
+static void   gimp_layer_modes_use_blend_variants
+                                 (const GimpLayerModeBlendVariant *variants,
+                                  gint                             n_variants);
+
 
 /*  static variables  */
 
@@ -1096,6 +1113,56 @@ static const GimpLayerMode layer_mode_groups[][2] =
   }
 };
 
+/*  only the blends working on each channel on its own have vector
+ *  variants.  the HSV, HSL and LCH blends, luminance and the luma
+ *  modes mix the channels of a pixel, and would first need the pixels
+ *  deinterleaved, so they, like divide, the light modes and color
+ *  erase, always use the generic function for now
+ */
+#define BLEND_VARIANT(name, suffix)                                     \
+  { gimp_operation_layer_mode_blend_##name,                             \
+    gimp_operation_layer_mode_blend_##name##_##suffix }
+
+#define BLEND_VARIANTS(suffix)                                          \
+  {                                                                     \
+    BLEND_VARIANT (addition,      suffix),                              \
+    BLEND_VARIANT (burn,          suffix),                              \
+    BLEND_VARIANT (darken_only,   suffix),                              \
+    BLEND_VARIANT (difference,    suffix),                              \
+    BLEND_VARIANT (dodge,         suffix),                              \
+    BLEND_VARIANT (exclusion,     suffix),                              \
+    BLEND_VARIANT (grain_extract, suffix),                              \
+    BLEND_VARIANT (grain_merge,   suffix),                              \
+    BLEND_VARIANT (hard_mix,      suffix),                              \
+    BLEND_VARIANT (hardlight,     suffix),                              \
+    BLEND_VARIANT (lighten_only,  suffix),                              \
+    BLEND_VARIANT (linear_burn,   suffix),                              \
+    BLEND_VARIANT (multiply,      suffix),                              \
+    BLEND_VARIANT (overlay,       suffix),                              \
+    BLEND_VARIANT (screen,        suffix),                              \
+    BLEND_VARIANT (softlight,     suffix),                              \
+    BLEND_VARIANT (subtract,      suffix)                               \
+  }
+
+#if COMPILE_SSE2_INTRINISICS
+static const GimpLayerModeBlendVariant blend_variants_sse2[] =
+  BLEND_VARIANTS (sse2);
+#endif
+
+#if COMPILE_AVX_INTRINISICS
+static const GimpLayerModeBlendVariant blend_variants_avx[] =
+  BLEND_VARIANTS (avx);
+#endif
+
+#undef BLEND_VARIANTS
+#undef BLEND_VARIANT
+
+/*  the blend functions actually used, picked at runtime according to the
+ *  instruction sets supported by the CPU
+ */
+static GimpLayerModeBlendFunc
+  layer_mode_blend_functions[G_N_ELEMENTS (layer_mode_infos)];
+
 
 /*  public functions  */
 
@@ -1107,7 +1174,21 @@ gimp_layer_modes_init (void)
   for (i = 0; i < G_N_ELEMENTS (layer_mode_infos); i++)
     {
       g_assert ((GimpLayerMode) i == layer_mode_infos[i].layer_mode);
+
+      layer_mode_blend_functions[i] = layer_mode_infos[i].blend_function;
     }
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    gimp_layer_modes_use_blend_variants (blend_variants_sse2,
+                                         G_N_ELEMENTS (blend_variants_sse2));
+#endif
+
+#if COMPILE_AVX_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX)
+    gimp_layer_modes_use_blend_variants (blend_variants_avx,
+                                         G_N_ELEMENTS (blend_variants_avx));
+#endif
 }
 
 static const GimpLayerModeInfo *
@@ -1267,7 +1348,7 @@ gimp_layer_mode_get_blend_function (GimpLayerMode mode)
   if (! info)
     return NULL;
 
-  return info->blend_function;
+  return layer_mode_blend_functions[info - layer_mode_infos];
 }
 
 GimpLayerModeContext
@@ -1460,3 +1541,27 @@ gimp_layer_mode_get_included_region (GimpLayerMode          mode,
       g_return_val_if_reached (GIMP_LAYER_COMPOSITE_REGION_INTERSECTION);
     }
 }
+
+
+/*  private functions  */
+
+static void
+gimp_layer_modes_use_blend_variants (const GimpLayerModeBlendVariant *variants,
+                                     gint                             n_variants)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (layer_mode_infos); i++)
+    {
+      gint j;
+
+      for (j = 0; j < n_variants; j++)
+        {
+          if (layer_mode_infos[i].blend_function == variants[j].generic)
+            {
+              layer_mode_blend_functions[i] = variants[j].accelerated;
+              break;
+            }
+        }
+    }
+}
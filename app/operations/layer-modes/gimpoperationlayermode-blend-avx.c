@@ -0,0 +1,269 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-avx.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_AVX_INTRINISICS
+
+/* AVX */
+#include <immintrin.h>
+
+
+/*  AVX versions of the per-channel blend functions.  these work like the
+ *  SSE2 versions, but process two pixels per vector; an odd trailing pixel
+ *  is handed to the generic function.
+ */
+
+
+static inline __m256
+blend_addition (__m256 in,
+                __m256 layer)
+{
+  return _mm256_add_ps (in, layer);
+}
+
+static inline __m256
+blend_burn (__m256 in,
+            __m256 layer)
+{
+  const __m256 one = _mm256_set1_ps (1.0f);
+  __m256       val;
+
+  val = _mm256_div_ps (_mm256_sub_ps (one, in), layer);
+  val = _mm256_sub_ps (one, val);
+
+  /* _mm256_min_ps() returns its second operand for NaN, which maps
+   * val == NAN (0 / 0) -> 1, like the generic version
+   */
+  val = _mm256_min_ps (val, one);
+
+  return _mm256_max_ps (val, _mm256_setzero_ps ());
+}
+
+static inline __m256
+blend_darken_only (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_min_ps (in, layer);
+}
+
+static inline __m256
+blend_difference (__m256 in,
+                  __m256 layer)
+{
+  const __m256 sign = _mm256_set1_ps (-0.0f);
+
+  return _mm256_andnot_ps (sign, _mm256_sub_ps (in, layer));
+}
+
+static inline __m256
+blend_dodge (__m256 in,
+             __m256 layer)
+{
+  const __m256 one = _mm256_set1_ps (1.0f);
+
+  return _mm256_min_ps (_mm256_div_ps (in, _mm256_sub_ps (one, layer)), one);
+}
+
+static inline __m256
+blend_exclusion (__m256 in,
+                 __m256 layer)
+{
+  const __m256 half = _mm256_set1_ps (0.5f);
+  const __m256 two  = _mm256_set1_ps (2.0f);
+  __m256       val;
+
+  val = _mm256_mul_ps (two, _mm256_sub_ps (in, half));
+  val = _mm256_mul_ps (val, _mm256_sub_ps (layer, half));
+
+  return _mm256_sub_ps (half, val);
+}
+
+static inline __m256
+blend_grain_extract (__m256 in,
+                     __m256 layer)
+{
+  return _mm256_add_ps (_mm256_sub_ps (in, layer), _mm256_set1_ps (0.5f));
+}
+
+static inline __m256
+blend_grain_merge (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_sub_ps (_mm256_add_ps (in, layer), _mm256_set1_ps (0.5f));
+}
+
+static inline __m256
+blend_hard_mix (__m256 in,
+                __m256 layer)
+{
+  const __m256 one = _mm256_set1_ps (1.0f);
+  __m256       mask;
+
+  mask = _mm256_cmp_ps (_mm256_add_ps (in, layer), one, _CMP_NLT_UQ);
+
+  return _mm256_and_ps (mask, one);
+}
+
+static inline __m256
+blend_hardlight (__m256 in,
+                 __m256 layer)
+{
+  const __m256 one  = _mm256_set1_ps (1.0f);
+  const __m256 half = _mm256_set1_ps (0.5f);
+  const __m256 two  = _mm256_set1_ps (2.0f);
+  __m256       high, low, mask;
+
+  high = _mm256_mul_ps (_mm256_sub_ps (layer, half), two);
+  high = _mm256_mul_ps (_mm256_sub_ps (one, in), _mm256_sub_ps (one, high));
+  high = _mm256_min_ps (_mm256_sub_ps (one, high), one);
+
+  low  = _mm256_mul_ps (in, _mm256_mul_ps (layer, two));
+  low  = _mm256_min_ps (low, one);
+
+  mask = _mm256_cmp_ps (layer, half, _CMP_GT_OQ);
+
+  return _mm256_blendv_ps (low, high, mask);
+}
+
+static inline __m256
+blend_lighten_only (__m256 in,
+                    __m256 layer)
+{
+  return _mm256_max_ps (in, layer);
+}
+
+static inline __m256
+blend_linear_burn (__m256 in,
+                   __m256 layer)
+{
+  return _mm256_sub_ps (_mm256_add_ps (in, layer), _mm256_set1_ps (1.0f));
+}
+
+static inline __m256
+blend_multiply (__m256 in,
+                __m256 layer)
+{
+  return _mm256_mul_ps (in, layer);
+}
+
+static inline __m256
+blend_overlay (__m256 in,
+               __m256 layer)
+{
+  const __m256 one  = _mm256_set1_ps (1.0f);
+  const __m256 two  = _mm256_set1_ps (2.0f);
+  __m256       high, low, mask;
+
+  low  = _mm256_mul_ps (_mm256_mul_ps (two, in), layer);
+
+  high = _mm256_mul_ps (two, _mm256_sub_ps (one, layer));
+  high = _mm256_mul_ps (high, _mm256_sub_ps (one, in));
+  high = _mm256_sub_ps (one, high);
+
+  mask = _mm256_cmp_ps (in, _mm256_set1_ps (0.5f), _CMP_LT_OQ);
+
+  return _mm256_blendv_ps (high, low, mask);
+}
+
+static inline __m256
+blend_screen (__m256 in,
+              __m256 layer)
+{
+  const __m256 one = _mm256_set1_ps (1.0f);
+
+  return _mm256_sub_ps (one, _mm256_mul_ps (_mm256_sub_ps (one, in),
+                                            _mm256_sub_ps (one, layer)));
+}
+
+static inline __m256
+blend_softlight (__m256 in,
+                 __m256 layer)
+{
+  const __m256 one = _mm256_set1_ps (1.0f);
+  __m256       multiply, screen;
+
+  multiply = _mm256_mul_ps (in, layer);
+  screen   = _mm256_sub_ps (one, _mm256_mul_ps (_mm256_sub_ps (one, in),
+                                                _mm256_sub_ps (one, layer)));
+
+  return _mm256_add_ps (_mm256_mul_ps (_mm256_sub_ps (one, in), multiply),
+                        _mm256_mul_ps (in, screen));
+}
+
+static inline __m256
+blend_subtract (__m256 in,
+                __m256 layer)
+{
+  return _mm256_sub_ps (in, layer);
+}
+
+
+#define DEFINE_BLEND_FUNC(name)                                              \
+void                                                                         \
+gimp_operation_layer_mode_blend_##name##_avx (const gfloat *in,              \
+                                              const gfloat *layer,           \
+                                              gfloat       *comp,            \
+                                              gint          samples)         \
+{                                                                            \
+  for (; samples >= 2; samples -= 2)                                         \
+    {                                                                        \
+      __m256 rgba_in    = _mm256_loadu_ps (in);                              \
+      __m256 rgba_layer = _mm256_loadu_ps (layer);                           \
+      __m256 rgba_comp  = blend_##name (rgba_in, rgba_layer);                \
+                                                                             \
+      _mm256_storeu_ps (comp, _mm256_blend_ps (rgba_comp, rgba_layer, 0x88));\
+                                                                             \
+      comp  += 8;                                                            \
+      layer += 8;                                                            \
+      in    += 8;                                                            \
+    }                                                                        \
+                                                                             \
+  if (samples)                                                               \
+    gimp_operation_layer_mode_blend_##name (in, layer, comp, samples);       \
+}
+
+DEFINE_BLEND_FUNC (addition)
+DEFINE_BLEND_FUNC (burn)
+DEFINE_BLEND_FUNC (darken_only)
+DEFINE_BLEND_FUNC (difference)
+DEFINE_BLEND_FUNC (dodge)
+DEFINE_BLEND_FUNC (exclusion)
+DEFINE_BLEND_FUNC (grain_extract)
+DEFINE_BLEND_FUNC (grain_merge)
+DEFINE_BLEND_FUNC (hard_mix)
+DEFINE_BLEND_FUNC (hardlight)
+DEFINE_BLEND_FUNC (lighten_only)
+DEFINE_BLEND_FUNC (linear_burn)
+DEFINE_BLEND_FUNC (multiply)
+DEFINE_BLEND_FUNC (overlay)
+DEFINE_BLEND_FUNC (screen)
+DEFINE_BLEND_FUNC (softlight)
+DEFINE_BLEND_FUNC (subtract)
+
+#endif /* COMPILE_AVX_INTRINISICS */
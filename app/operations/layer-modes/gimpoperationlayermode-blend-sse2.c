@@ -0,0 +1,265 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+/* SSE2 */
+#include <emmintrin.h>
+
+
+/*  SSE2 versions of the per-channel blend functions.  since the value of
+ *  comp[RED..BLUE] is unconstrained when in[ALPHA] or layer[ALPHA] are
+ *  zero, these process every pixel unconditionally, one pixel per vector,
+ *  and only take comp[ALPHA] from layer[ALPHA].  each kernel performs the
+ *  same float operations, in the same order, as its generic counterpart.
+ */
+
+
+static inline __m128
+blend_addition (__m128 in,
+                __m128 layer)
+{
+  return _mm_add_ps (in, layer);
+}
+
+static inline __m128
+blend_burn (__m128 in,
+            __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       val;
+
+  val = _mm_sub_ps (one, _mm_div_ps (_mm_sub_ps (one, in), layer));
+
+  /* _mm_min_ps() returns its second operand for NaN, which maps
+   * val == NAN (0 / 0) -> 1, like the generic version
+   */
+  val = _mm_min_ps (val, one);
+
+  return _mm_max_ps (val, _mm_setzero_ps ());
+}
+
+static inline __m128
+blend_darken_only (__m128 in,
+                   __m128 layer)
+{
+  return _mm_min_ps (in, layer);
+}
+
+static inline __m128
+blend_difference (__m128 in,
+                  __m128 layer)
+{
+  const __m128 sign = _mm_set1_ps (-0.0f);
+
+  return _mm_andnot_ps (sign, _mm_sub_ps (in, layer));
+}
+
+static inline __m128
+blend_dodge (__m128 in,
+             __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_min_ps (_mm_div_ps (in, _mm_sub_ps (one, layer)), one);
+}
+
+static inline __m128
+blend_exclusion (__m128 in,
+                 __m128 layer)
+{
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+
+  return _mm_sub_ps (half,
+                     _mm_mul_ps (_mm_mul_ps (two, _mm_sub_ps (in, half)),
+                                 _mm_sub_ps (layer, half)));
+}
+
+static inline __m128
+blend_grain_extract (__m128 in,
+                     __m128 layer)
+{
+  return _mm_add_ps (_mm_sub_ps (in, layer), _mm_set1_ps (0.5f));
+}
+
+static inline __m128
+blend_grain_merge (__m128 in,
+                   __m128 layer)
+{
+  return _mm_sub_ps (_mm_add_ps (in, layer), _mm_set1_ps (0.5f));
+}
+
+static inline __m128
+blend_hard_mix (__m128 in,
+                __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_and_ps (_mm_cmpnlt_ps (_mm_add_ps (in, layer), one), one);
+}
+
+static inline __m128
+blend_hardlight (__m128 in,
+                 __m128 layer)
+{
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  __m128       high, low, mask;
+
+  high = _mm_mul_ps (_mm_sub_ps (one, in),
+                     _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (layer, half),
+                                                  two)));
+  high = _mm_min_ps (_mm_sub_ps (one, high), one);
+
+  low  = _mm_min_ps (_mm_mul_ps (in, _mm_mul_ps (layer, two)), one);
+
+  mask = _mm_cmpgt_ps (layer, half);
+
+  return _mm_or_ps (_mm_and_ps (mask, high), _mm_andnot_ps (mask, low));
+}
+
+static inline __m128
+blend_lighten_only (__m128 in,
+                    __m128 layer)
+{
+  return _mm_max_ps (in, layer);
+}
+
+static inline __m128
+blend_linear_burn (__m128 in,
+                   __m128 layer)
+{
+  return _mm_sub_ps (_mm_add_ps (in, layer), _mm_set1_ps (1.0f));
+}
+
+static inline __m128
+blend_multiply (__m128 in,
+                __m128 layer)
+{
+  return _mm_mul_ps (in, layer);
+}
+
+static inline __m128
+blend_overlay (__m128 in,
+               __m128 layer)
+{
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  __m128       high, low, mask;
+
+  low  = _mm_mul_ps (_mm_mul_ps (two, in), layer);
+
+  high = _mm_mul_ps (two, _mm_sub_ps (one, layer));
+  high = _mm_mul_ps (high, _mm_sub_ps (one, in));
+  high = _mm_sub_ps (one, high);
+
+  mask = _mm_cmplt_ps (in, _mm_set1_ps (0.5f));
+
+  return _mm_or_ps (_mm_and_ps (mask, low), _mm_andnot_ps (mask, high));
+}
+
+static inline __m128
+blend_screen (__m128 in,
+              __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                      _mm_sub_ps (one, layer)));
+}
+
+static inline __m128
+blend_softlight (__m128 in,
+                 __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       multiply, screen;
+
+  multiply = _mm_mul_ps (in, layer);
+  screen   = _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                          _mm_sub_ps (one, layer)));
+
+  return _mm_add_ps (_mm_mul_ps (_mm_sub_ps (one, in), multiply),
+                     _mm_mul_ps (in, screen));
+}
+
+static inline __m128
+blend_subtract (__m128 in,
+                __m128 layer)
+{
+  return _mm_sub_ps (in, layer);
+}
+
+
+#define DEFINE_BLEND_FUNC(name)                                              \
+void                                                                         \
+gimp_operation_layer_mode_blend_##name##_sse2 (const gfloat *in,             \
+                                               const gfloat *layer,          \
+                                               gfloat       *comp,           \
+                                               gint          samples)        \
+{                                                                            \
+  const __m128 rgb_mask = _mm_castsi128_ps (_mm_set_epi32 (0, -1, -1, -1));  \
+                                                                             \
+  while (samples--)                                                          \
+    {                                                                        \
+      __m128 rgba_in    = _mm_loadu_ps (in);                                 \
+      __m128 rgba_layer = _mm_loadu_ps (layer);                              \
+      __m128 rgba_comp  = blend_##name (rgba_in, rgba_layer);                \
+                                                                             \
+      _mm_storeu_ps (comp, _mm_or_ps (_mm_and_ps (rgb_mask, rgba_comp),      \
+                                      _mm_andnot_ps (rgb_mask, rgba_layer)));\
+                                                                             \
+      comp  += 4;                                                            \
+      layer += 4;                                                            \
+      in    += 4;                                                            \
+    }                                                                        \
+}
+
+DEFINE_BLEND_FUNC (addition)
+DEFINE_BLEND_FUNC (burn)
+DEFINE_BLEND_FUNC (darken_only)
+DEFINE_BLEND_FUNC (difference)
+DEFINE_BLEND_FUNC (dodge)
+DEFINE_BLEND_FUNC (exclusion)
+DEFINE_BLEND_FUNC (grain_extract)
+DEFINE_BLEND_FUNC (grain_merge)
+DEFINE_BLEND_FUNC (hard_mix)
+DEFINE_BLEND_FUNC (hardlight)
+DEFINE_BLEND_FUNC (lighten_only)
+DEFINE_BLEND_FUNC (linear_burn)
+DEFINE_BLEND_FUNC (multiply)
+DEFINE_BLEND_FUNC (overlay)
+DEFINE_BLEND_FUNC (screen)
+DEFINE_BLEND_FUNC (softlight)
+DEFINE_BLEND_FUNC (subtract)
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -164,4 +164,155 @@ void gimp_operation_layer_mode_blend_color_erase       (const gfloat *in,
                                                         gint          samples);
 
 
+/*  SSE2 versions of the per-channel blend functions  */
+
+#if COMPILE_SSE2_INTRINISICS
+
+void gimp_operation_layer_mode_blend_addition_sse2      (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_burn_sse2          (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_darken_only_sse2   (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_difference_sse2    (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_dodge_sse2         (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_exclusion_sse2     (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_grain_extract_sse2 (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_grain_merge_sse2   (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_hard_mix_sse2      (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_hardlight_sse2     (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_lighten_only_sse2  (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_linear_burn_sse2   (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_multiply_sse2      (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_overlay_sse2       (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_screen_sse2        (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_softlight_sse2     (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+void gimp_operation_layer_mode_blend_subtract_sse2      (const gfloat *in,
+                                                         const gfloat *layer,
+                                                         gfloat       *comp,
+                                                         gint          samples);
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+/*  AVX versions of the per-channel blend functions  */
+
+#if COMPILE_AVX_INTRINISICS
+
+void gimp_operation_layer_mode_blend_addition_avx      (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_burn_avx          (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_darken_only_avx   (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_difference_avx    (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_dodge_avx         (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_exclusion_avx     (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_grain_extract_avx (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_grain_merge_avx   (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_hard_mix_avx      (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_hardlight_avx     (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_lighten_only_avx  (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_linear_burn_avx   (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_multiply_avx      (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_overlay_avx       (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_screen_avx        (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_softlight_avx     (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+void gimp_operation_layer_mode_blend_subtract_avx      (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        gfloat       *comp,
+                                                        gint          samples);
+
+#endif /* COMPILE_AVX_INTRINISICS */
+
+
 #endif /* __GIMP_OPERATION_LAYER_MODE_BLEND_H__ */
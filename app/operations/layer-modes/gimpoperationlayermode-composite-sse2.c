@@ -102,4 +102,72 @@ gimp_operation_layer_mode_composite_src_atop_sse2 (const gfloat *in,
     }
 }
 
+void
+gimp_operation_layer_mode_composite_src_over_sse2 (const gfloat *in,
+                                                   const gfloat *layer,
+                                                   const gfloat *comp,
+                                                   const gfloat *mask,
+                                                   gfloat        opacity,
+                                                   gfloat       *out,
+                                                   gint          samples)
+{
+  const __m128 v_zero     = _mm_setzero_ps ();
+  const __m128 v_one      = _mm_set1_ps (1.0f);
+  const __m128 v_opacity  = _mm_set1_ps (opacity);
+  const __m128 v_rgb_mask = _mm_castsi128_ps (_mm_set_epi32 (0, -1, -1, -1));
+
+  while (samples--)
+    {
+      __m128 rgba_in, rgba_layer, rgba_comp, out_pixel;
+      __m128 in_alpha, layer_alpha, new_alpha, ratio;
+      __m128 keep_in, take_layer;
+
+      rgba_in    = _mm_loadu_ps (in);
+      rgba_layer = _mm_loadu_ps (layer);
+      rgba_comp  = _mm_loadu_ps (comp);
+
+      in_alpha    = _mm_shuffle_ps (rgba_in, rgba_in,
+                                    _MM_SHUFFLE (3, 3, 3, 3));
+      layer_alpha = _mm_shuffle_ps (rgba_layer, rgba_layer,
+                                    _MM_SHUFFLE (3, 3, 3, 3));
+      layer_alpha = _mm_mul_ps (layer_alpha, v_opacity);
+
+      if (mask)
+        layer_alpha = _mm_mul_ps (layer_alpha, _mm_set1_ps (*mask++));
+
+      new_alpha = _mm_add_ps (layer_alpha,
+                              _mm_mul_ps (_mm_sub_ps (v_one, layer_alpha),
+                                          in_alpha));
+
+      /*  same as the generic version:  out = in when layer_alpha or
+       *  new_alpha are zero, out = layer when in_alpha is zero, and the
+       *  blended value otherwise.  the ratio is only used in the last case.
+       */
+      ratio     = _mm_div_ps (layer_alpha, new_alpha);
+      out_pixel = _mm_sub_ps (rgba_comp, rgba_layer);
+      out_pixel = _mm_mul_ps (in_alpha, out_pixel);
+      out_pixel = _mm_sub_ps (_mm_add_ps (out_pixel, rgba_layer), rgba_in);
+      out_pixel = _mm_add_ps (_mm_mul_ps (ratio, out_pixel), rgba_in);
+
+      take_layer = _mm_cmpeq_ps (in_alpha, v_zero);
+      out_pixel  = _mm_or_ps (_mm_and_ps (take_layer, rgba_layer),
+                              _mm_andnot_ps (take_layer, out_pixel));
+
+      keep_in    = _mm_or_ps (_mm_cmpeq_ps (layer_alpha, v_zero),
+                              _mm_cmpeq_ps (new_alpha,   v_zero));
+      out_pixel  = _mm_or_ps (_mm_and_ps (keep_in, rgba_in),
+                              _mm_andnot_ps (keep_in, out_pixel));
+
+      out_pixel  = _mm_or_ps (_mm_and_ps (v_rgb_mask, out_pixel),
+                              _mm_andnot_ps (v_rgb_mask, new_alpha));
+
+      _mm_storeu_ps (out, out_pixel);
+
+      in    += 4;
+      layer += 4;
+      comp  += 4;
+      out   += 4;
+    }
+}
+
 #endif /* COMPILE_SSE2_INTRINISICS */
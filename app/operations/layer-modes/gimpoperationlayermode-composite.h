@@ -84,6 +84,13 @@ void gimp_operation_layer_mode_composite_src_in_sub    (const gfloat        *in,
 
 #if COMPILE_SSE2_INTRINISICS
 
+void gimp_operation_layer_mode_composite_src_over_sse2 (const gfloat        *in,
+                                                        const gfloat        *layer,
+                                                        const gfloat        *comp,
+                                                        const gfloat        *mask,
+                                                        gfloat               opacity,
+                                                        gfloat              *out,
+                                                        gint                 samples);
 void gimp_operation_layer_mode_composite_src_atop_sse2 (const gfloat        *in,
                                                         const gfloat        *layer,
                                                         const gfloat        *comp,
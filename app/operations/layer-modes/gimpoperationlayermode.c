@@ -221,7 +221,10 @@ gimp_operation_layer_mode_class_init (GimpOperationLayerModeClass *klass)
 
 #if COMPILE_SSE2_INTRINISICS
   if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
-    composite_src_atop = gimp_operation_layer_mode_composite_src_atop_sse2;
+    {
+      composite_src_over = gimp_operation_layer_mode_composite_src_over_sse2;
+      composite_src_atop = gimp_operation_layer_mode_composite_src_atop_sse2;
+    }
 #endif
 }
 
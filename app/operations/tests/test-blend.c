@@ -0,0 +1,655 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  renders every gradient type with gimp:blend and checks that the
+ *  result is sane, and that it matches what the gradient gives pixel
+ *  by pixel, for every repeat mode. Run with "-m perf" to also time a
+ *  large render of each type.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/core/core-types.h"
+#include "app/core/gimpgradient.h"
+
+#include "app/operations/gimpoperationblend.h"
+
+
+#define SIZE      256
+#define PERF_SIZE 4096
+
+/*  the blend's start and end points, chosen so that the pixel centers
+ *  relative to them are exact in floating point, however they are
+ *  summed up
+ */
+#define START_X   85.25
+#define START_Y   128.0
+#define END_X     255.0
+#define END_Y     64.0
+
+/*  how far the colors from the blend's sampled gradient may be off  */
+#define EPSILON   1e-3
+
+
+typedef struct
+{
+  const gchar      *name;
+  GimpGradientType  type;
+  gboolean          supersample;
+} BlendTest;
+
+
+static const GimpRepeatMode repeat_modes[] =
+{
+  GIMP_REPEAT_NONE,
+  GIMP_REPEAT_SAWTOOTH,
+  GIMP_REPEAT_TRIANGULAR,
+  GIMP_REPEAT_TRUNCATE
+};
+
+
+static const BlendTest blend_tests[] =
+{
+  { "linear",               GIMP_GRADIENT_LINEAR,               FALSE },
+  { "bilinear",             GIMP_GRADIENT_BILINEAR,             FALSE },
+  { "radial",               GIMP_GRADIENT_RADIAL,               FALSE },
+  { "square",               GIMP_GRADIENT_SQUARE,               FALSE },
+  { "conical-symmetric",    GIMP_GRADIENT_CONICAL_SYMMETRIC,    FALSE },
+  { "conical-asymmetric",   GIMP_GRADIENT_CONICAL_ASYMMETRIC,   FALSE },
+  { "shapeburst-angular",   GIMP_GRADIENT_SHAPEBURST_ANGULAR,   FALSE },
+  { "shapeburst-spherical", GIMP_GRADIENT_SHAPEBURST_SPHERICAL, FALSE },
+  { "shapeburst-dimpled",   GIMP_GRADIENT_SHAPEBURST_DIMPLED,   FALSE },
+  { "spiral-clockwise",     GIMP_GRADIENT_SPIRAL_CLOCKWISE,     FALSE },
+  { "spiral-anticlockwise", GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE, FALSE },
+  { "linear-supersample",   GIMP_GRADIENT_LINEAR,               TRUE  },
+  { "radial-supersample",   GIMP_GRADIENT_RADIAL,               TRUE  },
+  { "conical-supersample",  GIMP_GRADIENT_CONICAL_SYMMETRIC,    TRUE  },
+  { "spiral-supersample",   GIMP_GRADIENT_SPIRAL_CLOCKWISE,     TRUE  },
+  { NULL, }
+};
+
+
+/*  a distance map as the shapeburst gradients get it, 0.0 at the
+ *  edges and 1.0 in the center
+ */
+static GeglBuffer *
+create_dist_buffer (gint size)
+{
+  GeglBuffer         *buffer;
+  GeglBufferIterator *iter;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, size, size),
+                            babl_format ("Y float"));
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0, NULL,
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi  = &iter->roi[0];
+      gfloat              *dest = iter->data[0];
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            gint d = MIN (MIN (x, size - 1 - x), MIN (y, size - 1 - y));
+
+            *dest++ = 2.0 * d / (size - 1);
+          }
+    }
+
+  return buffer;
+}
+
+/*  a gradient with several segments, whose colors meet at the segment
+ *  boundaries and never change too steeply, so that sampling it at a
+ *  slightly different position only ever makes a small difference
+ */
+static GimpGradient *
+create_gradient (void)
+{
+  static const struct
+  {
+    gdouble                  left, middle, right;
+    GimpRGB                  left_color;
+    GimpGradientSegmentType  type;
+    GimpGradientSegmentColor color;
+  }
+  segments[] =
+  {
+    { 0.0,  0.1,  0.3,  { 1.0, 0.0, 0.0, 1.0 },
+      GIMP_GRADIENT_SEGMENT_LINEAR,            GIMP_GRADIENT_SEGMENT_RGB     },
+    { 0.3,  0.5,  0.55, { 0.0, 1.0, 0.2, 0.5 },
+      GIMP_GRADIENT_SEGMENT_CURVED,            GIMP_GRADIENT_SEGMENT_HSV_CCW },
+    { 0.55, 0.6,  0.7,  { 0.2, 0.3, 1.0, 1.0 },
+      GIMP_GRADIENT_SEGMENT_SINE,              GIMP_GRADIENT_SEGMENT_RGB     },
+    { 0.7,  0.72, 0.85, { 1.0, 1.0, 0.0, 0.0 },
+      GIMP_GRADIENT_SEGMENT_LINEAR,            GIMP_GRADIENT_SEGMENT_HSV_CW  },
+    { 0.85, 0.93, 1.0,  { 0.5, 0.0, 0.7, 0.8 },
+      GIMP_GRADIENT_SEGMENT_CURVED,            GIMP_GRADIENT_SEGMENT_RGB     }
+  };
+  static const GimpRGB last_color = { 0.0, 0.0, 0.0, 1.0 };
+
+  GimpGradient        *gradient;
+  GimpGradientSegment *prev = NULL;
+  gint                 i;
+
+  gradient = GIMP_GRADIENT (gimp_gradient_new (NULL, "Blend-Test"));
+
+  gimp_gradient_segments_free (gradient->segments);
+  gradient->segments = NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (segments); i++)
+    {
+      GimpGradientSegment *seg = gimp_gradient_segment_new ();
+
+      seg->left        = segments[i].left;
+      seg->middle      = segments[i].middle;
+      seg->right       = segments[i].right;
+      seg->left_color  = segments[i].left_color;
+      seg->right_color = (i + 1 < G_N_ELEMENTS (segments) ?
+                          segments[i + 1].left_color : last_color);
+      seg->type        = segments[i].type;
+      seg->color       = segments[i].color;
+
+      seg->prev = prev;
+
+      if (prev)
+        prev->next = seg;
+      else
+        gradient->segments = seg;
+
+      prev = seg;
+    }
+
+  return gradient;
+}
+
+static GeglNode *
+create_blend_graph (const BlendTest  *test,
+                    gint              size,
+                    GeglNode        **blend)
+{
+  GeglNode *gegl = gegl_node_new ();
+
+  *blend = gegl_node_new_child (gegl,
+                                "operation",             "gimp:blend",
+                                "start-x",               START_X * size / SIZE,
+                                "start-y",               START_Y * size / SIZE,
+                                "end-x",                 END_X   * size / SIZE,
+                                "end-y",                 END_Y   * size / SIZE,
+                                "gradient-type",         test->type,
+                                "gradient-repeat",       GIMP_REPEAT_TRIANGULAR,
+                                "supersample",           test->supersample,
+                                "supersample-depth",     3,
+                                "supersample-threshold", 0.2,
+                                NULL);
+
+  if (test->type >= GIMP_GRADIENT_SHAPEBURST_ANGULAR &&
+      test->type <= GIMP_GRADIENT_SHAPEBURST_DIMPLED)
+    {
+      GeglBuffer *dist_buffer = create_dist_buffer (size);
+      GeglNode   *source;
+
+      source = gegl_node_new_child (gegl,
+                                    "operation", "gegl:buffer-source",
+                                    "buffer",    dist_buffer,
+                                    NULL);
+      g_object_unref (dist_buffer);
+
+      gegl_node_connect_to (source, "output",
+                            *blend, "input");
+    }
+
+  return gegl;
+}
+
+
+/*  the blending factors, as gimp:blend calculated them for every
+ *  single pixel before it rendered rows from a sampled gradient
+ */
+
+static gdouble
+reference_linear_factor (gdouble  dist,
+                         gdouble *vec,
+                         gdouble  offset,
+                         gdouble  x,
+                         gdouble  y)
+{
+  gdouble r, rat;
+
+  if (dist == 0.0)
+    return 0.0;
+
+  offset = offset / 100.0;
+
+  r   = vec[0] * x + vec[1] * y;
+  rat = r / dist;
+
+  if (rat >= 0.0 && rat < offset)
+    return 0.0;
+  else if (offset == 1.0)
+    return (rat >= 1.0) ? 1.0 : 0.0;
+  else if (rat < 0.0)
+    return rat / (1.0 - offset);
+  else
+    return (rat - offset) / (1.0 - offset);
+}
+
+static gdouble
+reference_bilinear_factor (gdouble  dist,
+                           gdouble *vec,
+                           gdouble  offset,
+                           gdouble  x,
+                           gdouble  y)
+{
+  gdouble r, rat;
+
+  if (dist == 0.0)
+    return 0.0;
+
+  offset = offset / 100.0;
+
+  r   = vec[0] * x + vec[1] * y;
+  rat = r / dist;
+
+  if (fabs (rat) < offset)
+    return 0.0;
+  else if (offset == 1.0)
+    return (rat == 1.0) ? 1.0 : 0.0;
+  else
+    return (fabs (rat) - offset) / (1.0 - offset);
+}
+
+static gdouble
+reference_radial_factor (gdouble dist,
+                         gdouble offset,
+                         gdouble r)
+{
+  gdouble rat;
+
+  if (dist == 0.0)
+    return 0.0;
+
+  offset = offset / 100.0;
+
+  rat = r / dist;
+
+  if (rat < offset)
+    return 0.0;
+  else if (offset == 1.0)
+    return (rat >= 1.0) ? 1.0 : 0.0;
+  else
+    return (rat - offset) / (1.0 - offset);
+}
+
+static gdouble
+reference_conical_factor (gdouble   dist,
+                          gdouble  *axis,
+                          gdouble   offset,
+                          gdouble   x,
+                          gdouble   y,
+                          gboolean  symmetric)
+{
+  gdouble rat;
+
+  if (dist == 0.0)
+    return 0.0;
+
+  if (x == 0.0 && y == 0.0)
+    return 0.5;
+
+  if (symmetric)
+    {
+      gdouble r   = sqrt (SQR (x) + SQR (y));
+      gdouble vec[2];
+
+      vec[0] = x / r;
+      vec[1] = y / r;
+
+      rat = axis[0] * vec[0] + axis[1] * vec[1];
+
+      if (rat > 1.0)
+        rat = 1.0;
+      else if (rat < -1.0)
+        rat = -1.0;
+
+      rat = acos (rat) / G_PI;
+    }
+  else
+    {
+      gdouble ang = (atan2 (x, y) + G_PI) - (atan2 (axis[0], axis[1]) + G_PI);
+
+      if (ang < 0.0)
+        ang += (2.0 * G_PI);
+
+      rat = ang / (2.0 * G_PI);
+    }
+
+  rat = pow (rat, (offset / 10.0) + 1.0);
+
+  return CLAMP (rat, 0.0, 1.0);
+}
+
+static gdouble
+reference_spiral_factor (gdouble   dist,
+                         gdouble  *axis,
+                         gdouble   offset,
+                         gdouble   x,
+                         gdouble   y,
+                         gboolean  clockwise)
+{
+  gdouble ang0, ang1, ang;
+
+  if (dist == 0.0)
+    return 0.0;
+
+  if (x == 0.0 && y == 0.0)
+    return 0.5;
+
+  ang0 = atan2 (axis[0], axis[1]) + G_PI;
+  ang1 = atan2 (x, y) + G_PI;
+
+  ang = clockwise ? ang1 - ang0 : ang0 - ang1;
+
+  if (ang < 0.0)
+    ang += (2.0 * G_PI);
+
+  return fmod (ang / (2.0 * G_PI) +
+               sqrt (SQR (x) + SQR (y)) / dist + offset, 1.0);
+}
+
+static gdouble
+reference_factor (GimpGradientType  type,
+                  gint              size,
+                  gint              px,
+                  gint              py)
+{
+  gdouble dist  = sqrt (SQR (END_X - START_X) + SQR (END_Y - START_Y));
+  gdouble vec[2];
+  gdouble x     = px + 0.5 - START_X;
+  gdouble y     = py + 0.5 - START_Y;
+  gint    d     = MIN (MIN (px, size - 1 - px), MIN (py, size - 1 - py));
+  gfloat  value = 2.0 * d / (size - 1);
+
+  vec[0] = (END_X - START_X) / dist;
+  vec[1] = (END_Y - START_Y) / dist;
+
+  switch (type)
+    {
+    case GIMP_GRADIENT_LINEAR:
+      return reference_linear_factor (dist, vec, 0.0, x, y);
+
+    case GIMP_GRADIENT_BILINEAR:
+      return reference_bilinear_factor (dist, vec, 0.0, x, y);
+
+    case GIMP_GRADIENT_RADIAL:
+      return reference_radial_factor (dist, 0.0, sqrt (SQR (x) + SQR (y)));
+
+    case GIMP_GRADIENT_SQUARE:
+      return reference_radial_factor (MAX (fabs (END_X - START_X),
+                                           fabs (END_Y - START_Y)),
+                                      0.0, MAX (fabs (x), fabs (y)));
+
+    case GIMP_GRADIENT_CONICAL_SYMMETRIC:
+      return reference_conical_factor (dist, vec, 0.0, x, y, TRUE);
+
+    case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
+      return reference_conical_factor (dist, vec, 0.0, x, y, FALSE);
+
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+      return 1.0 - value;
+
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+      return 1.0 - sin (0.5 * G_PI * value);
+
+    case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
+      return cos (0.5 * G_PI * value);
+
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      return reference_spiral_factor (dist, vec, 0.0, x, y, TRUE);
+
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      return reference_spiral_factor (dist, vec, 0.0, x, y, FALSE);
+
+    default:
+      g_return_val_if_reached (0.0);
+    }
+}
+
+static gdouble
+reference_repeat (GimpRepeatMode repeat,
+                  gdouble        factor)
+{
+  switch (repeat)
+    {
+    case GIMP_REPEAT_NONE:
+      return CLAMP (factor, 0.0, 1.0);
+
+    case GIMP_REPEAT_SAWTOOTH:
+      return factor - floor (factor);
+
+    case GIMP_REPEAT_TRIANGULAR:
+      {
+        guint ifactor;
+
+        if (factor < 0.0)
+          factor = -factor;
+
+        ifactor = (guint) factor;
+        factor  = factor - floor (factor);
+
+        return (ifactor & 1) ? 1.0 - factor : factor;
+      }
+
+    case GIMP_REPEAT_TRUNCATE:
+      break;
+    }
+
+  return factor;
+}
+
+static void
+test_blend (gconstpointer data)
+{
+  const BlendTest *test = data;
+  GeglNode        *gegl;
+  GeglNode        *blend;
+  gfloat          *pixels;
+  gint             i;
+
+  gegl = create_blend_graph (test, SIZE, &blend);
+
+  pixels = g_new (gfloat, 4 * SIZE * SIZE);
+
+  gegl_node_blit (blend, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                  babl_format ("R'G'B'A float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (i = 0; i < 4 * SIZE * SIZE; i++)
+    {
+      if (! (pixels[i] >= 0.0f && pixels[i] <= 1.0f))
+        {
+          g_test_message ("pixel %d, component %d: %g",
+                          i / 4, i % 4, pixels[i]);
+          g_test_fail ();
+          break;
+        }
+    }
+
+  g_free (pixels);
+
+  if (g_test_perf ())
+    {
+      GeglBuffer *buffer;
+      GeglNode   *sink;
+
+      g_object_unref (gegl);
+
+      gegl = create_blend_graph (test, PERF_SIZE, &blend);
+
+      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, PERF_SIZE, PERF_SIZE),
+                                babl_format ("R'G'B'A float"));
+
+      sink = gegl_node_new_child (gegl,
+                                  "operation", "gegl:write-buffer",
+                                  "buffer",    buffer,
+                                  NULL);
+
+      gegl_node_connect_to (blend, "output",
+                            sink,  "input");
+
+      g_test_timer_start ();
+
+      gegl_node_process (sink);
+
+      g_test_minimized_result (g_test_timer_elapsed (),
+                               "%s, %dx%d: %.3f seconds",
+                               test->name, PERF_SIZE, PERF_SIZE,
+                               g_test_timer_last ());
+
+      g_object_unref (buffer);
+    }
+
+  g_object_unref (gegl);
+}
+
+/*  renders the blend without supersampling, for every repeat mode and
+ *  both directions, and compares each pixel to the color the gradient
+ *  has at the pixel's blending factor
+ */
+static void
+test_blend_reference (gconstpointer data)
+{
+  const BlendTest *test     = data;
+  GimpGradient    *gradient = create_gradient ();
+  GeglNode        *gegl;
+  GeglNode        *blend;
+  gfloat          *pixels;
+  gint             r;
+  gint             reverse;
+
+  gegl = create_blend_graph (test, SIZE, &blend);
+
+  gegl_node_set (blend,
+                 "gradient", gradient,
+                 NULL);
+
+  pixels = g_new (gfloat, 4 * SIZE * SIZE);
+
+  for (r = 0; r < G_N_ELEMENTS (repeat_modes); r++)
+    for (reverse = FALSE; reverse <= TRUE; reverse++)
+      {
+        GimpGradientSegment *seg = NULL;
+        gint                 x, y;
+
+        gegl_node_set (blend,
+                       "gradient-repeat",  repeat_modes[r],
+                       "gradient-reverse", reverse,
+                       NULL);
+
+        gegl_node_blit (blend, 1.0, GEGL_RECTANGLE (0, 0, SIZE, SIZE),
+                        babl_format ("R'G'B'A float"), pixels,
+                        GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+        for (y = 0; y < SIZE; y++)
+          for (x = 0; x < SIZE; x++)
+            {
+              const gfloat *pixel = pixels + 4 * (y * SIZE + x);
+              gdouble       factor;
+              GimpRGB       color = { 0.0, 0.0, 0.0, 0.0 };
+
+              factor = reference_repeat (repeat_modes[r],
+                                         reference_factor (test->type,
+                                                           SIZE, x, y));
+
+              if (factor >= 0.0 && factor <= 1.0)
+                seg = gimp_gradient_get_color_at (gradient, NULL, seg,
+                                                  factor, reverse, &color);
+
+              if (fabs (pixel[0] - color.r) > EPSILON ||
+                  fabs (pixel[1] - color.g) > EPSILON ||
+                  fabs (pixel[2] - color.b) > EPSILON ||
+                  fabs (pixel[3] - color.a) > EPSILON)
+                {
+                  g_test_message ("repeat %d, reverse %d, pixel (%d, %d): "
+                                  "(%g, %g, %g, %g), expected "
+                                  "(%g, %g, %g, %g)",
+                                  repeat_modes[r], reverse, x, y,
+                                  pixel[0], pixel[1], pixel[2], pixel[3],
+                                  color.r, color.g, color.b, color.a);
+                  g_test_fail ();
+
+                  goto out;
+                }
+            }
+      }
+
+ out:
+  g_free (pixels);
+
+  g_object_unref (gegl);
+  g_object_unref (gradient);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result;
+  gint i;
+
+  gegl_init (&argc, &argv);
+  g_test_init (&argc, &argv, NULL);
+
+  g_type_class_ref (GIMP_TYPE_OPERATION_BLEND);
+
+  for (i = 0; blend_tests[i].name; i++)
+    {
+      gchar *path = g_strdup_printf ("/blend/%s", blend_tests[i].name);
+
+      g_test_add_data_func (path, &blend_tests[i], test_blend);
+
+      g_free (path);
+
+      if (! blend_tests[i].supersample)
+        {
+          path = g_strdup_printf ("/blend/%s-reference", blend_tests[i].name);
+
+          g_test_add_data_func (path, &blend_tests[i], test_blend_reference);
+
+          g_free (path);
+        }
+    }
+
+  result = g_test_run ();
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,300 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  compares the SSE2 and AVX layer mode functions against the generic
+ *  versions they replace at runtime
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/operations/layer-modes/gimpoperationlayermode-blend.h"
+#include "app/operations/layer-modes/gimpoperationlayermode-composite.h"
+
+
+/*  odd, so that the AVX functions have to handle a trailing pixel  */
+#define N_PIXELS 1021
+#define EPSILON  1e-5
+
+
+typedef void (* CompositeFunc) (const gfloat *in,
+                                const gfloat *layer,
+                                const gfloat *comp,
+                                const gfloat *mask,
+                                gfloat        opacity,
+                                gfloat       *out,
+                                gint          samples);
+
+typedef struct
+{
+  const gchar            *name;
+  GimpCpuAccelFlags       accel;
+  GimpLayerModeBlendFunc  generic;
+  GimpLayerModeBlendFunc  accelerated;
+} BlendTest;
+
+typedef struct
+{
+  const gchar            *name;
+  GimpCpuAccelFlags       accel;
+  CompositeFunc           generic;
+  CompositeFunc           accelerated;
+} CompositeTest;
+
+
+#define BLEND_TEST(name, suffix, flag)                                  \
+  { #name "-" #suffix, GIMP_CPU_ACCEL_X86_##flag,                       \
+    gimp_operation_layer_mode_blend_##name,                             \
+    gimp_operation_layer_mode_blend_##name##_##suffix }
+
+#define BLEND_TESTS(suffix, flag)                                       \
+  BLEND_TEST (addition,      suffix, flag),                             \
+  BLEND_TEST (burn,          suffix, flag),                             \
+  BLEND_TEST (darken_only,   suffix, flag),                             \
+  BLEND_TEST (difference,    suffix, flag),                             \
+  BLEND_TEST (dodge,         suffix, flag),                             \
+  BLEND_TEST (exclusion,     suffix, flag),                             \
+  BLEND_TEST (grain_extract, suffix, flag),                             \
+  BLEND_TEST (grain_merge,   suffix, flag),                             \
+  BLEND_TEST (hard_mix,      suffix, flag),                             \
+  BLEND_TEST (hardlight,     suffix, flag),                             \
+  BLEND_TEST (lighten_only,  suffix, flag),                             \
+  BLEND_TEST (linear_burn,   suffix, flag),                             \
+  BLEND_TEST (multiply,      suffix, flag),                             \
+  BLEND_TEST (overlay,       suffix, flag),                             \
+  BLEND_TEST (screen,        suffix, flag),                             \
+  BLEND_TEST (softlight,     suffix, flag),                             \
+  BLEND_TEST (subtract,      suffix, flag)
+
+static const BlendTest blend_tests[] =
+{
+#if COMPILE_SSE2_INTRINISICS
+  BLEND_TESTS (sse2, SSE2),
+#endif
+#if COMPILE_AVX_INTRINISICS
+  BLEND_TESTS (avx, AVX),
+#endif
+  { NULL }
+};
+
+static const CompositeTest composite_tests[] =
+{
+#if COMPILE_SSE2_INTRINISICS
+  { "src-over-sse2", GIMP_CPU_ACCEL_X86_SSE2,
+    gimp_operation_layer_mode_composite_src_over,
+    gimp_operation_layer_mode_composite_src_over_sse2 },
+  { "src-atop-sse2", GIMP_CPU_ACCEL_X86_SSE2,
+    gimp_operation_layer_mode_composite_src_atop,
+    gimp_operation_layer_mode_composite_src_atop_sse2 },
+#endif
+  { NULL }
+};
+
+
+static gfloat
+random_value (void)
+{
+  /*  hit the branch points of the blend functions now and then  */
+  static const gfloat special[] = { 0.0f, 0.5f, 1.0f };
+
+  if (g_test_rand_int_range (0, 4) == 0)
+    return special[g_test_rand_int_range (0, G_N_ELEMENTS (special))];
+
+  return g_test_rand_double_range (-0.25, 1.25);
+}
+
+static gfloat *
+random_pixels (gint n_pixels)
+{
+  gfloat *pixels = g_new (gfloat, 4 * n_pixels);
+  gint    i;
+
+  for (i = 0; i < 4 * n_pixels; i++)
+    pixels[i] = random_value ();
+
+  for (i = 0; i < n_pixels; i++)
+    pixels[4 * i + ALPHA] = CLAMP (pixels[4 * i + ALPHA], 0.0f, 1.0f);
+
+  return pixels;
+}
+
+static gboolean
+values_match (gfloat a,
+              gfloat b)
+{
+  if (isnan (a) || isnan (b))
+    return isnan (a) && isnan (b);
+
+  if (a == b)
+    return TRUE;
+
+  return fabs (a - b) <= EPSILON * MAX (1.0, fabs (a));
+}
+
+static gboolean
+accel_supported (GimpCpuAccelFlags accel)
+{
+  if (gimp_cpu_accel_get_support () & accel)
+    return TRUE;
+
+  g_test_skip ("not supported by this CPU");
+
+  return FALSE;
+}
+
+static void
+test_blend (gconstpointer data)
+{
+  const BlendTest *test = data;
+  gfloat          *in;
+  gfloat          *layer;
+  gfloat          *generic;
+  gfloat          *accelerated;
+  gint             i;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  in          = random_pixels (N_PIXELS);
+  layer       = random_pixels (N_PIXELS);
+  generic     = g_new0 (gfloat, 4 * N_PIXELS);
+  accelerated = g_new0 (gfloat, 4 * N_PIXELS);
+
+  test->generic     (in, layer, generic,     N_PIXELS);
+  test->accelerated (in, layer, accelerated, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      gint c = RED;
+
+      /*  comp[RED..BLUE] is unconstrained when either alpha is zero  */
+      if (in[4 * i + ALPHA] == 0.0f || layer[4 * i + ALPHA] == 0.0f)
+        c = ALPHA;
+
+      for (; c <= ALPHA; c++)
+        {
+          gfloat a = generic[4 * i + c];
+          gfloat b = accelerated[4 * i + c];
+
+          if (! values_match (a, b))
+            {
+              g_test_message ("pixel %d, component %d: %g != %g",
+                              i, c, a, b);
+              g_test_fail ();
+            }
+        }
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (generic);
+  g_free (accelerated);
+}
+
+static void
+test_composite (gconstpointer data)
+{
+  const CompositeTest *test = data;
+  gfloat              *in;
+  gfloat              *layer;
+  gfloat              *comp;
+  gfloat              *mask;
+  gfloat              *generic;
+  gfloat              *accelerated;
+  gint                 i;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  /*  the SSE2 functions are faster for 16-byte aligned buffers, which
+   *  g_new() provides on the platforms they are compiled for
+   */
+  in          = random_pixels (N_PIXELS);
+  layer       = random_pixels (N_PIXELS);
+  comp        = random_pixels (N_PIXELS);
+  mask        = g_new (gfloat, N_PIXELS);
+  generic     = g_new0 (gfloat, 4 * N_PIXELS);
+  accelerated = g_new0 (gfloat, 4 * N_PIXELS);
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      mask[i] = g_test_rand_double_range (0.0, 1.0);
+
+      comp[4 * i + ALPHA] = layer[4 * i + ALPHA];
+    }
+
+  test->generic     (in, layer, comp, mask, 0.75f, generic,     N_PIXELS);
+  test->accelerated (in, layer, comp, mask, 0.75f, accelerated, N_PIXELS);
+
+  test->generic     (in, layer, comp, NULL, 0.5f,  generic,     N_PIXELS / 2);
+  test->accelerated (in, layer, comp, NULL, 0.5f,  accelerated, N_PIXELS / 2);
+
+  for (i = 0; i < 4 * N_PIXELS; i++)
+    {
+      if (! values_match (generic[i], accelerated[i]))
+        {
+          g_test_message ("pixel %d, component %d: %g != %g",
+                          i / 4, i % 4, generic[i], accelerated[i]);
+          g_test_fail ();
+        }
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (comp);
+  g_free (mask);
+  g_free (generic);
+  g_free (accelerated);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  for (i = 0; blend_tests[i].name; i++)
+    {
+      gchar *path = g_strdup_printf ("/layer-modes/blend/%s",
+                                     blend_tests[i].name);
+
+      g_test_add_data_func (path, &blend_tests[i], test_blend);
+
+      g_free (path);
+    }
+
+  for (i = 0; composite_tests[i].name; i++)
+    {
+      gchar *path = g_strdup_printf ("/layer-modes/composite/%s",
+                                     composite_tests[i].name);
+
+      g_test_add_data_func (path, &composite_tests[i], test_composite);
+
+      g_free (path);
+    }
+
+  return g_test_run ();
+}
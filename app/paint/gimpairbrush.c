@@ -28,6 +28,7 @@
 #include "core/gimpdynamics.h"
 #include "core/gimpgradient.h"
 #include "core/gimpimage.h"
+#include "core/gimpmarshal.h"
 #include "core/gimpsymmetry.h"
 
 #include "gimpairbrush.h"
@@ -36,6 +37,13 @@
 #include "gimp-intl.h"
 
 
+enum
+{
+  STAMP,
+  LAST_SIGNAL
+};
+
+
 static void       gimp_airbrush_finalize (GObject          *object);
 
 static void       gimp_airbrush_paint    (GimpPaintCore    *paint_core,
@@ -49,6 +57,8 @@ static void       gimp_airbrush_motion   (GimpPaintCore    *paint_core,
                                           GimpPaintOptions *paint_options,
                                           GimpSymmetry     *sym);
 
+static void       gimp_airbrush_remove_timeout
+                                         (GimpAirbrush     *airbrush);
 static gboolean   gimp_airbrush_timeout  (gpointer          data);
 
 
@@ -56,6 +66,8 @@ G_DEFINE_TYPE (GimpAirbrush, gimp_airbrush, GIMP_TYPE_PAINTBRUSH)
 
 #define parent_class gimp_airbrush_parent_class
 
+static guint airbrush_signals[LAST_SIGNAL] = { 0 };
+
 
 void
 gimp_airbrush_register (Gimp                      *gimp,
@@ -75,6 +87,15 @@ gimp_airbrush_class_init (GimpAirbrushClass *klass)
   GObjectClass       *object_class     = G_OBJECT_CLASS (klass);
   GimpPaintCoreClass *paint_core_class = GIMP_PAINT_CORE_CLASS (klass);
 
+  airbrush_signals[STAMP] =
+    g_signal_new ("stamp",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_FIRST,
+                  G_STRUCT_OFFSET (GimpAirbrushClass, stamp),
+                  NULL, NULL,
+                  gimp_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+
   object_class->finalize  = gimp_airbrush_finalize;
 
   paint_core_class->paint = gimp_airbrush_paint;
@@ -90,11 +111,7 @@ gimp_airbrush_finalize (GObject *object)
 {
   GimpAirbrush *airbrush = GIMP_AIRBRUSH (object);
 
-  if (airbrush->timeout_id)
-    {
-      g_source_remove (airbrush->timeout_id);
-      airbrush->timeout_id = 0;
-    }
+  gimp_airbrush_remove_timeout (airbrush);
 
   g_clear_object (&airbrush->sym);
 
@@ -113,11 +130,7 @@ gimp_airbrush_paint (GimpPaintCore    *paint_core,
   GimpAirbrushOptions *options  = GIMP_AIRBRUSH_OPTIONS (paint_options);
   GimpDynamics        *dynamics = GIMP_BRUSH_CORE (paint_core)->dynamics;
 
-  if (airbrush->timeout_id)
-    {
-      g_source_remove (airbrush->timeout_id);
-      airbrush->timeout_id = 0;
-    }
+  gimp_airbrush_remove_timeout (airbrush);
 
   switch (paint_state)
     {
@@ -160,9 +173,14 @@ gimp_airbrush_paint (GimpPaintCore    *paint_core,
 
           timeout = 10000 / (options->rate * dynamic_rate);
 
-          airbrush->timeout_id = g_timeout_add (timeout,
-                                                gimp_airbrush_timeout,
-                                                airbrush);
+          /*  this might run on the paint thread, so keep our own
+           *  reference on the source instead of its id, which the
+           *  main context might already have reused
+           */
+          airbrush->timeout_source = g_timeout_source_new (timeout);
+          g_source_set_callback (airbrush->timeout_source,
+                                 gimp_airbrush_timeout, airbrush, NULL);
+          g_source_attach (airbrush->timeout_source, NULL);
         }
       break;
 
@@ -173,6 +191,9 @@ gimp_airbrush_paint (GimpPaintCore    *paint_core,
                                                    paint_state, time);
 
       g_clear_object (&airbrush->sym);
+
+      airbrush->drawable      = NULL;
+      airbrush->paint_options = NULL;
       break;
     }
 }
@@ -207,18 +228,51 @@ gimp_airbrush_motion (GimpPaintCore    *paint_core,
                            sym, opacity);
 }
 
+static void
+gimp_airbrush_remove_timeout (GimpAirbrush *airbrush)
+{
+  if (airbrush->timeout_source)
+    {
+      g_source_destroy (airbrush->timeout_source);
+      g_source_unref (airbrush->timeout_source);
+      airbrush->timeout_source = NULL;
+    }
+}
+
+/*  runs on the main thread.  painting the stamp is up to whoever
+ *  paints the stroke, which might be a paint thread
+ */
 static gboolean
 gimp_airbrush_timeout (gpointer data)
 {
   GimpAirbrush *airbrush = GIMP_AIRBRUSH (data);
 
+  g_signal_emit (airbrush, airbrush_signals[STAMP], 0);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+/*  public functions  */
+
+/**
+ * gimp_airbrush_stamp:
+ * @airbrush: a #GimpAirbrush
+ *
+ * Paints the airbrush once more at the last position of the current
+ * stroke, as requested by the "stamp" signal.
+ **/
+void
+gimp_airbrush_stamp (GimpAirbrush *airbrush)
+{
+  g_return_if_fail (GIMP_IS_AIRBRUSH (airbrush));
+
+  if (! airbrush->drawable)
+    return;
+
   gimp_airbrush_paint (GIMP_PAINT_CORE (airbrush),
                        airbrush->drawable,
                        airbrush->paint_options,
                        airbrush->sym,
                        GIMP_PAINT_STATE_MOTION, 0);
-
-  gimp_image_flush (gimp_item_get_image (GIMP_ITEM (airbrush->drawable)));
-
-  return G_SOURCE_REMOVE;
 }
@@ -36,7 +36,7 @@ struct _GimpAirbrush
 {
   GimpPaintbrush    parent_instance;
 
-  guint             timeout_id;
+  GSource          *timeout_source;
 
   GimpSymmetry     *sym;
   GimpDrawable     *drawable;
@@ -46,6 +46,9 @@ struct _GimpAirbrush
 struct _GimpAirbrushClass
 {
   GimpPaintbrushClass  parent_class;
+
+  /*  signals  */
+  void (* stamp) (GimpAirbrush *airbrush);
 };
 
 
@@ -54,5 +57,7 @@ void    gimp_airbrush_register (Gimp                      *gimp,
 
 GType   gimp_airbrush_get_type (void) G_GNUC_CONST;
 
+void    gimp_airbrush_stamp    (GimpAirbrush              *airbrush);
+
 
 #endif  /*  __GIMP_AIRBRUSH_H__  */
@@ -42,6 +42,7 @@
 
 #include "gimpbrushcore.h"
 #include "gimpbrushcore-kernels.h"
+#include "gimppaintcore-rows.h"
 
 #include "gimppaintoptions.h"
 
@@ -1029,6 +1030,12 @@ static void
 gimp_brush_core_invalidate_cache (GimpBrush     *brush,
                                   GimpBrushCore *core)
 {
+  /* Editing the brush may happen while a stroke is painted on the
+   * paint thread, don't pull the caches from under it
+   */
+
+  gimp_drawable_paint_lock ();
+
   /* Make sure we don't cache data for a brush that has changed */
 
   core->subsample_cache_invalid = TRUE;
@@ -1037,6 +1044,8 @@ gimp_brush_core_invalidate_cache (GimpBrush     *brush,
   /* Notify of the brush change */
 
   g_signal_emit (core, core_signals[SET_BRUSH], 0, brush);
+
+  gimp_drawable_paint_unlock ();
 }
 
 
@@ -1045,11 +1054,11 @@ gimp_brush_core_invalidate_cache (GimpBrush     *brush,
  ************************************************************/
 
 static inline void
-rotate_pointers (gulong  **p,
+rotate_pointers (guint32 **p,
                  guint32   n)
 {
   guint32  i;
-  gulong  *tmp;
+  guint32 *tmp;
 
   tmp = p[0];
 
@@ -1065,24 +1074,26 @@ gimp_brush_core_subsample_mask (GimpBrushCore     *core,
                                 gdouble            x,
                                 gdouble            y)
 {
-  GimpTempBuf  *dest;
-  gdouble       left;
-  const guchar *m;
-  guchar       *d;
-  const gint   *k;
-  gint          index1;
-  gint          index2;
-  gint          dest_offset_x = 0;
-  gint          dest_offset_y = 0;
-  const gint   *kernel;
-  gint          i, j;
-  gint          r, s;
-  gulong       *accum[KERNEL_HEIGHT];
-  gint          offs;
-  gint          mask_width  = gimp_temp_buf_get_width  (mask);
-  gint          mask_height = gimp_temp_buf_get_height (mask);
-  gint          dest_width;
-  gint          dest_height;
+  const GimpPaintCoreRowFuncs *funcs = gimp_paint_core_rows_get_funcs ();
+  GimpTempBuf                 *dest;
+  gdouble                      left;
+  const guchar                *m;
+  guchar                      *d;
+  gint                         index1;
+  gint                         index2;
+  gint                         dest_offset_x = 0;
+  gint                         dest_offset_y = 0;
+  const gint                  *kernel;
+  gint                         i, j;
+  gint                         r;
+  guint32                     *accum[KERNEL_HEIGHT];
+  gint                         mask_width  = gimp_temp_buf_get_width  (mask);
+  gint                         mask_height = gimp_temp_buf_get_height (mask);
+  gint                         dest_width;
+  gint                         dest_height;
+
+  /*  the row functions divide by 256  */
+  G_STATIC_ASSERT (KERNEL_SUM == 256);
 
   while (x < 0)
     x += mask_width;
@@ -1148,42 +1159,34 @@ gimp_brush_core_subsample_mask (GimpBrushCore     *core,
 
   /* Allocate and initialize the accum buffer */
   for (i = 0; i < KERNEL_HEIGHT ; i++)
-    accum[i] = g_new0 (gulong, dest_width + 1);
+    accum[i] = g_new0 (guint32, dest_width + 1);
 
   core->subsample_brushes[index2][index1] = dest;
 
   m = gimp_temp_buf_get_data (mask);
   for (i = 0; i < mask_height; i++)
     {
-      for (j = 0; j < mask_width; j++)
+      for (r = 0; r < KERNEL_HEIGHT; r++)
         {
-          k = kernel;
-          for (r = 0; r < KERNEL_HEIGHT; r++)
-            {
-              offs = j + dest_offset_x;
-              s = KERNEL_WIDTH;
-              while (s--)
-                accum[r][offs++] += *m * *k++;
-            }
-          m++;
+          funcs->subsample (m, accum[r] + dest_offset_x, mask_width,
+                            kernel + r * KERNEL_WIDTH, KERNEL_WIDTH);
         }
+      m += mask_width;
 
       /* store the accum buffer into the destination mask */
       d = gimp_temp_buf_get_data (dest) + (i + dest_offset_y) * dest_width;
-      for (j = 0; j < dest_width; j++)
-        *d++ = (accum[0][j] + 127) / KERNEL_SUM;
+      funcs->subsample_store (accum[0], d, dest_width, 127);
 
       rotate_pointers (accum, KERNEL_HEIGHT);
 
-      memset (accum[KERNEL_HEIGHT - 1], 0, sizeof (gulong) * dest_width);
+      memset (accum[KERNEL_HEIGHT - 1], 0, sizeof (guint32) * dest_width);
     }
 
   /* store the rest of the accum buffer into the dest mask */
   while (i + dest_offset_y < dest_height)
     {
       d = gimp_temp_buf_get_data (dest) + (i + dest_offset_y) * dest_width;
-      for (j = 0; j < dest_width; j++)
-        *d++ = (accum[0][j] + (KERNEL_SUM / 2)) / KERNEL_SUM;
+      funcs->subsample_store (accum[0], d, dest_width, KERNEL_SUM / 2);
 
       rotate_pointers (accum, KERNEL_HEIGHT);
       i++;
@@ -1320,14 +1323,15 @@ gimp_brush_core_solidify_mask (GimpBrushCore     *core,
                                gdouble            x,
                                gdouble            y)
 {
-  GimpTempBuf  *dest;
-  const guchar *m;
-  gfloat       *d;
-  gint          dest_offset_x     = 0;
-  gint          dest_offset_y     = 0;
-  gint          brush_mask_width  = gimp_temp_buf_get_width  (brush_mask);
-  gint          brush_mask_height = gimp_temp_buf_get_height (brush_mask);
-  gint          i, j;
+  const GimpPaintCoreRowFuncs *funcs = gimp_paint_core_rows_get_funcs ();
+  GimpTempBuf                 *dest;
+  const guchar                *m;
+  gfloat                      *d;
+  gint                         dest_offset_x     = 0;
+  gint                         dest_offset_y     = 0;
+  gint                         brush_mask_width  = gimp_temp_buf_get_width  (brush_mask);
+  gint                         brush_mask_height = gimp_temp_buf_get_height (brush_mask);
+  gint                         i, j;
 
   if ((brush_mask_width % 2) == 0)
     {
@@ -1377,10 +1381,10 @@ gimp_brush_core_solidify_mask (GimpBrushCore     *core,
 
   for (i = 0; i < brush_mask_height; i++)
     {
-      for (j = 0; j < brush_mask_width; j++)
-        *d++ = (*m++) ? 1.0 : 0.0;
+      funcs->solidify (m, d, brush_mask_width);
 
-      d += 2;
+      m += brush_mask_width;
+      d += brush_mask_width + 2;
     }
 
   return dest;
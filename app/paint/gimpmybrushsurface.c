@@ -29,8 +29,30 @@
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include "libgimpcolor/gimpcolor.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpmybrushsurface.h"
+#include "gimppaintcore-rows.h"
+
+
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
 
+typedef struct _GimpMybrushDab GimpMybrushDab;
+
+struct _GimpMybrushDab
+{
+  GeglRectangle           rect;
+  GimpPaintCoreDabFalloff falloff;
+  gfloat                  radius;
+  gfloat                  r_aa_start;
+  gfloat                  color_r;
+  gfloat                  color_g;
+  gfloat                  color_b;
+  gfloat                  color_a;
+  gfloat                  normal_mode;
+  gfloat                  colorize;
+};
 
 struct _GimpMybrushSurface
 {
@@ -41,29 +63,32 @@ struct _GimpMybrushSurface
   gint        paint_mask_y;
   GeglRectangle dirty;
   GimpComponentMask component_mask;
+
+  /*  the dabs drawn since the last flush, and their bounding box.  inside
+   *  begin_atomic()/end_atomic(), dabs are only rendered when the stroke
+   *  segment ends, or when get_color() needs to see them.
+   */
+  GArray        *dabs;
+  GeglRectangle  dabs_bounds;
+  gint           atomic;
 };
 
-/* --- Taken from mypaint-tiled-surface.c --- */
-static inline float
-calculate_rr (int   xp,
-              int   yp,
-              float x,
-              float y,
-              float aspect_ratio,
-              float sn,
-              float cs,
-              float one_over_radius2)
+typedef struct
 {
-    /* code duplication, see brush::count_dabs_to() */
-    const float yy = (yp + 0.5f - y);
-    const float xx = (xp + 0.5f - x);
-    const float yyr=(yy*cs-xx*sn)*aspect_ratio;
-    const float xxr=yy*sn+xx*cs;
-    const float rr = (yyr*yyr + xxr*xxr) * one_over_radius2;
-    /* rr is in range 0.0..1.0*sqrt(2) */
-    return rr;
-}
+  GimpMybrushSurface *surface;
+  gfloat              x;
+  gfloat              y;
+  gfloat              one_over_radius2;
+  GMutex              mutex;
+  gfloat              sum_weight;
+  gfloat              sum_r;
+  gfloat              sum_g;
+  gfloat              sum_b;
+  gfloat              sum_a;
+} GetColorData;
+
 
+/* --- Taken from mypaint-tiled-surface.c --- */
 static inline float
 calculate_r_sample (float x,
                     float y,
@@ -228,6 +253,284 @@ calculate_dab_roi (float x,
   return *GEGL_RECTANGLE (x0, y0, x1 - x0, y1 - y0);
 }
 
+static void
+gimp_mypaint_surface_get_color_area (const GeglRectangle *area,
+                                     GetColorData        *data)
+{
+  GimpMybrushSurface *surface          = data->surface;
+  const float         x                = data->x;
+  const float         y                = data->y;
+  const float         one_over_radius2 = data->one_over_radius2;
+  float               sum_weight       = 0.0f;
+  float               sum_r            = 0.0f;
+  float               sum_g            = 0.0f;
+  float               sum_b            = 0.0f;
+  float               sum_a            = 0.0f;
+  GeglBufferIterator *iter;
+
+  /* Read in clamp mode to avoid transparency bleeding in at the edges */
+  iter = gegl_buffer_iterator_new (surface->buffer, area, 0,
+                                   babl_format ("R'aG'aB'aA float"),
+                                   GEGL_BUFFER_READ,
+                                   GEGL_ABYSS_CLAMP);
+  if (surface->paint_mask)
+    {
+      GeglRectangle mask_roi = *area;
+      mask_roi.x -= surface->paint_mask_x;
+      mask_roi.y -= surface->paint_mask_y;
+      gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      float *pixel = (float *)iter->data[0];
+      float *mask;
+      int iy, ix;
+
+      if (surface->paint_mask)
+        mask = iter->data[1];
+      else
+        mask = NULL;
+
+      for (iy = iter->roi[0].y; iy < iter->roi[0].y + iter->roi[0].height; iy++)
+        {
+          float yy = (iy + 0.5f - y);
+          for (ix = iter->roi[0].x; ix < iter->roi[0].x +  iter->roi[0].width; ix++)
+            {
+              /* pixel_weight == a standard dab with hardness = 0.5, aspect_ratio = 1.0, and angle = 0.0 */
+              float xx = (ix + 0.5f - x);
+              float rr = (yy * yy + xx * xx) * one_over_radius2;
+              float pixel_weight = 0.0f;
+              if (rr <= 1.0f)
+                pixel_weight = 1.0f - rr;
+              if (mask)
+                pixel_weight *= *mask;
+
+              sum_r += pixel_weight * pixel[RED];
+              sum_g += pixel_weight * pixel[GREEN];
+              sum_b += pixel_weight * pixel[BLUE];
+              sum_a += pixel_weight * pixel[ALPHA];
+              sum_weight += pixel_weight;
+
+              pixel += 4;
+              if (mask)
+                mask += 1;
+            }
+        }
+    }
+
+  g_mutex_lock (&data->mutex);
+
+  data->sum_weight += sum_weight;
+  data->sum_r      += sum_r;
+  data->sum_g      += sum_g;
+  data->sum_b      += sum_b;
+  data->sum_a      += sum_a;
+
+  g_mutex_unlock (&data->mutex);
+}
+
+static void
+gimp_mypaint_surface_draw_dabs_area (const GeglRectangle *area,
+                                     GimpMybrushSurface  *surface)
+{
+  const GimpPaintCoreRowFuncs *funcs;
+  GimpComponentMask            component_mask = surface->component_mask;
+  const GimpMybrushDab        *dabs;
+  gint                         n_dabs         = surface->dabs->len;
+  GeglRectangle                roi            = { 0, };
+  GeglBufferIterator          *iter;
+  gfloat                      *alpha_row;
+  gint                         i;
+
+  funcs = gimp_paint_core_rows_get_funcs ();
+  dabs  = (const GimpMybrushDab *) surface->dabs->data;
+
+  /*  only touch the part of the area the dabs actually cover  */
+  for (i = 0; i < n_dabs; i++)
+    {
+      GeglRectangle rect;
+
+      if (! gegl_rectangle_intersect (&rect, &dabs[i].rect, area))
+        continue;
+
+      if (roi.width > 0)
+        gegl_rectangle_bounding_box (&roi, &roi, &rect);
+      else
+        roi = rect;
+    }
+
+  if (roi.width <= 0 || roi.height <= 0)
+    return;
+
+  alpha_row = g_new (gfloat, roi.width);
+
+  iter = gegl_buffer_iterator_new (surface->buffer, &roi, 0,
+                                   babl_format ("R'G'B'A float"),
+                                   GEGL_BUFFER_READWRITE,
+                                   GEGL_ABYSS_NONE);
+  if (surface->paint_mask)
+    {
+      GeglRectangle mask_roi = roi;
+      mask_roi.x -= surface->paint_mask_x;
+      mask_roi.y -= surface->paint_mask_y;
+      gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
+                                babl_format ("Y float"),
+                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *iter_roi = &iter->roi[0];
+
+      /*  every pixel belongs to exactly one area, and within the area
+       *  the dabs are applied in the order they were drawn
+       */
+      for (i = 0; i < n_dabs; i++)
+        {
+          const GimpMybrushDab          *dab     = &dabs[i];
+          const GimpPaintCoreDabFalloff *falloff = &dab->falloff;
+          GeglRectangle                  rect;
+          int                            iy, ix;
+
+          if (! gegl_rectangle_intersect (&rect, &dab->rect, iter_roi))
+            continue;
+
+          for (iy = rect.y; iy < rect.y + rect.height; iy++)
+            {
+              gint   offset = ((iy - iter_roi->y) * iter_roi->width +
+                               (rect.x - iter_roi->x));
+              float *pixel  = (float *) iter->data[0] + 4 * offset;
+              float *mask;
+
+              if (surface->paint_mask)
+                mask = (float *) iter->data[1] + offset;
+              else
+                mask = NULL;
+
+              if (dab->radius < 3.0f)
+                {
+                  for (ix = 0; ix < rect.width; ix++)
+                    {
+                      float rr;
+
+                      rr = calculate_rr_antialiased (rect.x + ix, iy,
+                                                     falloff->x, falloff->y,
+                                                     falloff->aspect_ratio,
+                                                     falloff->sn, falloff->cs,
+                                                     falloff->one_over_radius2,
+                                                     dab->r_aa_start);
+                      alpha_row[ix] = calculate_alpha_for_rr (rr,
+                                                              falloff->hardness,
+                                                              falloff->slope1,
+                                                              falloff->slope2);
+                    }
+                }
+              else
+                {
+                  funcs->dab_falloff (falloff, rect.x, iy, rect.width,
+                                      alpha_row);
+                }
+
+              for (ix = 0; ix < rect.width; ix++)
+                {
+                  float base_alpha, alpha, dst_alpha, r, g, b, a;
+                  base_alpha = alpha_row[ix];
+                  alpha = base_alpha * dab->normal_mode;
+                  if (mask)
+                    alpha *= *mask;
+                  dst_alpha = pixel[ALPHA];
+                  /* a = alpha * color_a + dst_alpha * (1.0f - alpha);
+                   * which converts to: */
+                  a = alpha * (dab->color_a - dst_alpha) + dst_alpha;
+                  r = pixel[RED];
+                  g = pixel[GREEN];
+                  b = pixel[BLUE];
+
+                  if (a > 0.0f)
+                    {
+                      /* By definition the ratio between each color[] and pixel[] component in a non-pre-multipled blend always sums to 1.0f.
+                       * Originaly this would have been "(color[n] * alpha * color_a + pixel[n] * dst_alpha * (1.0f - alpha)) / a",
+                       * instead we only calculate the cheaper term. */
+                      float src_term = (alpha * dab->color_a) / a;
+                      float dst_term = 1.0f - src_term;
+                      r = dab->color_r * src_term + r * dst_term;
+                      g = dab->color_g * src_term + g * dst_term;
+                      b = dab->color_b * src_term + b * dst_term;
+                    }
+
+                  if (dab->colorize > 0.0f && base_alpha > 0.0f)
+                    {
+                      alpha = base_alpha * dab->colorize;
+                      a = alpha + dst_alpha - alpha * dst_alpha;
+                      if (a > 0.0f)
+                        {
+                          GimpHSL pixel_hsl, out_hsl;
+                          GimpRGB pixel_rgb = {dab->color_r, dab->color_g, dab->color_b};
+                          GimpRGB out_rgb   = {r, g, b};
+                          float src_term = alpha / a;
+                          float dst_term = 1.0f - src_term;
+
+                          gimp_rgb_to_hsl (&pixel_rgb, &pixel_hsl);
+                          gimp_rgb_to_hsl (&out_rgb, &out_hsl);
+
+                          out_hsl.h = pixel_hsl.h;
+                          out_hsl.s = pixel_hsl.s;
+                          gimp_hsl_to_rgb (&out_hsl, &out_rgb);
+
+                          r = (float)out_rgb.r * src_term + r * dst_term;
+                          g = (float)out_rgb.g * src_term + g * dst_term;
+                          b = (float)out_rgb.b * src_term + b * dst_term;
+                        }
+                    }
+
+                  if (component_mask != GIMP_COMPONENT_MASK_ALL)
+                    {
+                      if (component_mask & GIMP_COMPONENT_MASK_RED)
+                        pixel[RED]   = r;
+                      if (component_mask & GIMP_COMPONENT_MASK_GREEN)
+                        pixel[GREEN] = g;
+                      if (component_mask & GIMP_COMPONENT_MASK_BLUE)
+                        pixel[BLUE]  = b;
+                      if (component_mask & GIMP_COMPONENT_MASK_ALPHA)
+                        pixel[ALPHA] = a;
+                    }
+                  else
+                    {
+                      pixel[RED]   = r;
+                      pixel[GREEN] = g;
+                      pixel[BLUE]  = b;
+                      pixel[ALPHA] = a;
+                    }
+
+                  pixel += 4;
+                  if (mask)
+                    mask += 1;
+                }
+            }
+        }
+    }
+
+  g_free (alpha_row);
+}
+
+static void
+gimp_mypaint_surface_flush_dabs (GimpMybrushSurface *surface)
+{
+  if (surface->dabs->len == 0)
+    return;
+
+  gimp_parallel_distribute_area (&surface->dabs_bounds, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_mypaint_surface_draw_dabs_area,
+                                 surface);
+
+  g_array_set_size (surface->dabs, 0);
+  surface->dabs_bounds = *GEGL_RECTANGLE (0, 0, 0, 0);
+}
+
 static void
 gimp_mypaint_surface_get_color (MyPaintSurface *base_surface,
                                 float           x,
@@ -241,6 +544,9 @@ gimp_mypaint_surface_get_color (MyPaintSurface *base_surface,
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
   GeglRectangle dabRect;
 
+  /* the color has to include the dabs drawn so far */
+  gimp_mypaint_surface_flush_dabs (surface);
+
   if (radius < 1.0f)
     radius = 1.0f;
 
@@ -253,72 +559,28 @@ gimp_mypaint_surface_get_color (MyPaintSurface *base_surface,
 
   if (dabRect.width > 0 || dabRect.height > 0)
   {
-    const float one_over_radius2 = 1.0f / (radius * radius);
-    float sum_weight = 0.0f;
-    float sum_r = 0.0f;
-    float sum_g = 0.0f;
-    float sum_b = 0.0f;
-    float sum_a = 0.0f;
-
-     /* Read in clamp mode to avoid transparency bleeding in at the edges */
-    GeglBufferIterator *iter = gegl_buffer_iterator_new (surface->buffer, &dabRect, 0,
-                                                         babl_format ("R'aG'aB'aA float"),
-                                                         GEGL_BUFFER_READ,
-                                                         GEGL_ABYSS_CLAMP);
-    if (surface->paint_mask)
-      {
-        GeglRectangle mask_roi = dabRect;
-        mask_roi.x -= surface->paint_mask_x;
-        mask_roi.y -= surface->paint_mask_y;
-        gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
-                                  babl_format ("Y float"),
-                                  GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-      }
+    GetColorData data = { 0, };
 
-    while (gegl_buffer_iterator_next (iter))
-      {
-        float *pixel = (float *)iter->data[0];
-        float *mask;
-        int iy, ix;
-
-        if (surface->paint_mask)
-          mask = iter->data[1];
-        else
-          mask = NULL;
-
-        for (iy = iter->roi[0].y; iy < iter->roi[0].y + iter->roi[0].height; iy++)
-          {
-            float yy = (iy + 0.5f - y);
-            for (ix = iter->roi[0].x; ix < iter->roi[0].x +  iter->roi[0].width; ix++)
-              {
-                /* pixel_weight == a standard dab with hardness = 0.5, aspect_ratio = 1.0, and angle = 0.0 */
-                float xx = (ix + 0.5f - x);
-                float rr = (yy * yy + xx * xx) * one_over_radius2;
-                float pixel_weight = 0.0f;
-                if (rr <= 1.0f)
-                  pixel_weight = 1.0f - rr;
-                if (mask)
-                  pixel_weight *= *mask;
-
-                sum_r += pixel_weight * pixel[RED];
-                sum_g += pixel_weight * pixel[GREEN];
-                sum_b += pixel_weight * pixel[BLUE];
-                sum_a += pixel_weight * pixel[ALPHA];
-                sum_weight += pixel_weight;
-
-                pixel += 4;
-                if (mask)
-                  mask += 1;
-              }
-          }
-      }
+    data.surface          = surface;
+    data.x                = x;
+    data.y                = y;
+    data.one_over_radius2 = 1.0f / (radius * radius);
+
+    g_mutex_init (&data.mutex);
+
+    gimp_parallel_distribute_area (&dabRect, MIN_PARALLEL_SUB_AREA,
+                                   (GimpParallelDistributeAreaFunc)
+                                   gimp_mypaint_surface_get_color_area,
+                                   &data);
 
-    if (sum_a > 0.0f && sum_weight > 0.0f)
+    g_mutex_clear (&data.mutex);
+
+    if (data.sum_a > 0.0f && data.sum_weight > 0.0f)
       {
-        sum_r /= sum_weight;
-        sum_g /= sum_weight;
-        sum_b /= sum_weight;
-        sum_a /= sum_weight;
+        float sum_r = data.sum_r / data.sum_weight;
+        float sum_g = data.sum_g / data.sum_weight;
+        float sum_b = data.sum_b / data.sum_weight;
+        float sum_a = data.sum_a / data.sum_weight;
 
         sum_r /= sum_a;
         sum_g /= sum_a;
@@ -351,31 +613,19 @@ gimp_mypaint_surface_draw_dab (MyPaintSurface *base_surface,
                                float           colorize)
 {
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
-  GeglBufferIterator *iter;
+  GimpMybrushDab      dab;
   GeglRectangle       dabRect;
-  GimpComponentMask   component_mask = surface->component_mask;
 
-  const float one_over_radius2 = 1.0f / (radius * radius);
   const double angle_rad = angle / 360 * 2 * M_PI;
-  const float cs = cos(angle_rad);
-  const float sn = sin(angle_rad);
-  float normal_mode;
-  float segment1_slope;
-  float segment2_slope;
   float r_aa_start;
 
   hardness = CLAMP (hardness, 0.0f, 1.0f);
-  segment1_slope = -(1.0f / hardness - 1.0f);
-  segment2_slope = -hardness / (1.0f - hardness);
   aspect_ratio = MAX (1.0f, aspect_ratio);
 
   r_aa_start = radius - 1.0f;
   r_aa_start = MAX (r_aa_start, 0);
   r_aa_start = (r_aa_start * r_aa_start) / aspect_ratio;
 
-  normal_mode = opaque * (1.0f - colorize);
-  colorize = opaque * colorize;
-
   /* FIXME: This should use the real matrix values to trim aspect_ratio dabs */
   dabRect = calculate_dab_roi (x, y, radius);
   gegl_rectangle_intersect (&dabRect, &dabRect, gegl_buffer_get_extent (surface->buffer));
@@ -385,114 +635,35 @@ gimp_mypaint_surface_draw_dab (MyPaintSurface *base_surface,
 
   gegl_rectangle_bounding_box (&surface->dirty, &surface->dirty, &dabRect);
 
-  iter = gegl_buffer_iterator_new (surface->buffer, &dabRect, 0,
-                                   babl_format ("R'G'B'A float"),
-                                   GEGL_BUFFER_READWRITE,
-                                   GEGL_ABYSS_NONE);
-  if (surface->paint_mask)
-    {
-      GeglRectangle mask_roi = dabRect;
-      mask_roi.x -= surface->paint_mask_x;
-      mask_roi.y -= surface->paint_mask_y;
-      gegl_buffer_iterator_add (iter, surface->paint_mask, &mask_roi, 0,
-                                babl_format ("Y float"),
-                                GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
-    }
-
-  while (gegl_buffer_iterator_next (iter))
-    {
-      float *pixel = (float *)iter->data[0];
-      float *mask;
-      int iy, ix;
-
-      if (surface->paint_mask)
-        mask = iter->data[1];
-      else
-        mask = NULL;
-
-      for (iy = iter->roi[0].y; iy < iter->roi[0].y + iter->roi[0].height; iy++)
-        {
-          for (ix = iter->roi[0].x; ix < iter->roi[0].x +  iter->roi[0].width; ix++)
-            {
-              float rr, base_alpha, alpha, dst_alpha, r, g, b, a;
-              if (radius < 3.0f)
-                rr = calculate_rr_antialiased (ix, iy, x, y, aspect_ratio, sn, cs, one_over_radius2, r_aa_start);
-              else
-                rr = calculate_rr (ix, iy, x, y, aspect_ratio, sn, cs, one_over_radius2);
-              base_alpha = calculate_alpha_for_rr (rr, hardness, segment1_slope, segment2_slope);
-              alpha = base_alpha * normal_mode;
-              if (mask)
-                alpha *= *mask;
-              dst_alpha = pixel[ALPHA];
-              /* a = alpha * color_a + dst_alpha * (1.0f - alpha);
-               * which converts to: */
-              a = alpha * (color_a - dst_alpha) + dst_alpha;
-              r = pixel[RED];
-              g = pixel[GREEN];
-              b = pixel[BLUE];
-
-              if (a > 0.0f)
-                {
-                  /* By definition the ratio between each color[] and pixel[] component in a non-pre-multipled blend always sums to 1.0f.
-                   * Originaly this would have been "(color[n] * alpha * color_a + pixel[n] * dst_alpha * (1.0f - alpha)) / a",
-                   * instead we only calculate the cheaper term. */
-                  float src_term = (alpha * color_a) / a;
-                  float dst_term = 1.0f - src_term;
-                  r = color_r * src_term + r * dst_term;
-                  g = color_g * src_term + g * dst_term;
-                  b = color_b * src_term + b * dst_term;
-                }
-
-              if (colorize > 0.0f && base_alpha > 0.0f)
-                {
-                  alpha = base_alpha * colorize;
-                  a = alpha + dst_alpha - alpha * dst_alpha;
-                  if (a > 0.0f)
-                    {
-                      GimpHSL pixel_hsl, out_hsl;
-                      GimpRGB pixel_rgb = {color_r, color_g, color_b};
-                      GimpRGB out_rgb   = {r, g, b};
-                      float src_term = alpha / a;
-                      float dst_term = 1.0f - src_term;
-
-                      gimp_rgb_to_hsl (&pixel_rgb, &pixel_hsl);
-                      gimp_rgb_to_hsl (&out_rgb, &out_hsl);
-
-                      out_hsl.h = pixel_hsl.h;
-                      out_hsl.s = pixel_hsl.s;
-                      gimp_hsl_to_rgb (&out_hsl, &out_rgb);
-
-                      r = (float)out_rgb.r * src_term + r * dst_term;
-                      g = (float)out_rgb.g * src_term + g * dst_term;
-                      b = (float)out_rgb.b * src_term + b * dst_term;
-                    }
-                }
+  dab.rect                     = dabRect;
+  dab.falloff.x                = x;
+  dab.falloff.y                = y;
+  dab.falloff.aspect_ratio     = aspect_ratio;
+  dab.falloff.sn               = sin (angle_rad);
+  dab.falloff.cs               = cos (angle_rad);
+  dab.falloff.one_over_radius2 = 1.0f / (radius * radius);
+  dab.falloff.hardness         = hardness;
+  dab.falloff.slope1           = -(1.0f / hardness - 1.0f);
+  dab.falloff.slope2           = -hardness / (1.0f - hardness);
+  dab.radius                   = radius;
+  dab.r_aa_start               = r_aa_start;
+  dab.color_r                  = color_r;
+  dab.color_g                  = color_g;
+  dab.color_b                  = color_b;
+  dab.color_a                  = color_a;
+  dab.normal_mode              = opaque * (1.0f - colorize);
+  dab.colorize                 = opaque * colorize;
+
+  if (surface->dabs->len > 0)
+    gegl_rectangle_bounding_box (&surface->dabs_bounds,
+                                 &surface->dabs_bounds, &dabRect);
+  else
+    surface->dabs_bounds = dabRect;
 
-              if (component_mask != GIMP_COMPONENT_MASK_ALL)
-                {
-                  if (component_mask & GIMP_COMPONENT_MASK_RED)
-                    pixel[RED]   = r;
-                  if (component_mask & GIMP_COMPONENT_MASK_GREEN)
-                    pixel[GREEN] = g;
-                  if (component_mask & GIMP_COMPONENT_MASK_BLUE)
-                    pixel[BLUE]  = b;
-                  if (component_mask & GIMP_COMPONENT_MASK_ALPHA)
-                    pixel[ALPHA] = a;
-                }
-              else
-                {
-                  pixel[RED]   = r;
-                  pixel[GREEN] = g;
-                  pixel[BLUE]  = b;
-                  pixel[ALPHA] = a;
-                }
+  g_array_append_val (surface->dabs, dab);
 
-              pixel += 4;
-              if (mask)
-                mask += 1;
-            }
-        }
-    }
+  if (! surface->atomic)
+    gimp_mypaint_surface_flush_dabs (surface);
 
   return 1;
 }
@@ -500,7 +671,9 @@ gimp_mypaint_surface_draw_dab (MyPaintSurface *base_surface,
 static void
 gimp_mypaint_surface_begin_atomic (MyPaintSurface *base_surface)
 {
+  GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
 
+  surface->atomic++;
 }
 
 static void
@@ -509,6 +682,13 @@ gimp_mypaint_surface_end_atomic (MyPaintSurface   *base_surface,
 {
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
 
+  g_return_if_fail (surface->atomic > 0);
+
+  surface->atomic--;
+
+  if (! surface->atomic)
+    gimp_mypaint_surface_flush_dabs (surface);
+
   roi->x         = surface->dirty.x;
   roi->y         = surface->dirty.y;
   roi->width     = surface->dirty.width;
@@ -521,8 +701,12 @@ gimp_mypaint_surface_destroy (MyPaintSurface *base_surface)
 {
   GimpMybrushSurface *surface = (GimpMybrushSurface *)base_surface;
 
+  gimp_mypaint_surface_flush_dabs (surface);
+
   g_clear_object (&surface->buffer);
   g_clear_object (&surface->paint_mask);
+
+  g_array_free (surface->dabs, TRUE);
 }
 
 GimpMybrushSurface *
@@ -550,5 +734,8 @@ gimp_mypaint_surface_new (GeglBuffer        *buffer,
   surface->paint_mask_y         = paint_mask_y;
   surface->dirty                = *GEGL_RECTANGLE (0, 0, 0, 0);
 
+  surface->dabs                 = g_array_new (FALSE, FALSE,
+                                               sizeof (GimpMybrushDab));
+
   return surface;
 }
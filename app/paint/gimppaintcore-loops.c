@@ -29,6 +29,7 @@
 #include "operations/layer-modes/gimpoperationlayermode.h"
 
 #include "gimppaintcore-loops.h"
+#include "gimppaintcore-rows.h"
 
 
 void
@@ -44,142 +45,76 @@ combine_paint_mask_to_canvas_mask (const GimpTempBuf *paint_mask,
   GeglRectangle       roi;
   GeglBufferIterator *iter;
 
+  const GimpPaintCoreRowFuncs *funcs = gimp_paint_core_rows_get_funcs ();
   const gint   mask_stride       = gimp_temp_buf_get_width (paint_mask);
   const gint   mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
   const Babl  *mask_format       = gimp_temp_buf_get_format (paint_mask);
-  GimpTempBuf *modified_mask     = gimp_temp_buf_copy (paint_mask);
   gint         width;
   gint         height;
 
-  width  = gimp_temp_buf_get_width (modified_mask);
-  height = gimp_temp_buf_get_height (modified_mask);
+  width  = gimp_temp_buf_get_width (paint_mask);
+  height = gimp_temp_buf_get_height (paint_mask);
 
   roi.x = x_offset;
   roi.y = y_offset;
   roi.width  = width - mask_x_offset;
   roi.height = height - mask_y_offset;
 
+  if (mask_format != babl_format ("Y u8") &&
+      mask_format != babl_format ("Y float"))
+    {
+      g_warning("Mask format not supported: %s", babl_get_name (mask_format));
+      return;
+    }
+
   iter = gegl_buffer_iterator_new (canvas_buffer, &roi, 0,
                                    babl_format ("Y float"),
                                    GEGL_ACCESS_READWRITE, GEGL_ABYSS_NONE);
 
-  if (stipple)
+  if (mask_format == babl_format ("Y u8"))
     {
-      if (mask_format == babl_format ("Y u8"))
-        {
-          const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+      const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (paint_mask);
+      mask_data += mask_start_offset;
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const guint8 *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      out_pixel[0] += (1.0 - out_pixel[0]) * (*mask_pixel / 255.0f) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else if (mask_format == babl_format ("Y float"))
+      while (gegl_buffer_iterator_next (iter))
         {
-          const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+          gfloat *out_pixel = (gfloat *)iter->data[0];
+          int iy;
 
-          while (gegl_buffer_iterator_next (iter))
+          for (iy = 0; iy < iter->roi[0].height; iy++)
             {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const gfloat *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      out_pixel[0] += (1.0 - out_pixel[0]) * (*mask_pixel) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
+              int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
+              const guint8 *mask_pixel = &mask_data[mask_offset];
+
+              funcs->combine_u8 (out_pixel, mask_pixel, iter->roi[0].width,
+                                 opacity, stipple);
+
+              out_pixel += iter->roi[0].width;
             }
         }
-      else
-        {
-          g_warning("Mask format not supported: %s", babl_get_name (mask_format));
-        }
     }
   else
     {
-      if (mask_format == babl_format ("Y u8"))
-        {
-          const guint8 *mask_data = (const guint8 *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+      const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (paint_mask);
+      mask_data += mask_start_offset;
 
-          while (gegl_buffer_iterator_next (iter))
-            {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const guint8 *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      if (opacity > out_pixel[0])
-                        out_pixel[0] += (opacity - out_pixel[0]) * (*mask_pixel / 255.0f) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
-            }
-        }
-      else if (mask_format == babl_format ("Y float"))
+      while (gegl_buffer_iterator_next (iter))
         {
-          const gfloat *mask_data = (const gfloat *) gimp_temp_buf_get_data (modified_mask);
-          mask_data += mask_start_offset;
+          gfloat *out_pixel = (gfloat *)iter->data[0];
+          int iy;
 
-          while (gegl_buffer_iterator_next (iter))
+          for (iy = 0; iy < iter->roi[0].height; iy++)
             {
-              gfloat *out_pixel = (gfloat *)iter->data[0];
-              int iy, ix;
-
-              for (iy = 0; iy < iter->roi[0].height; iy++)
-                {
-                  int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
-                  const gfloat *mask_pixel = &mask_data[mask_offset];
-
-                  for (ix = 0; ix < iter->roi[0].width; ix++)
-                    {
-                      if (opacity > out_pixel[0])
-                        out_pixel[0] += (opacity - out_pixel[0]) * (*mask_pixel) * opacity;
-
-                      mask_pixel += 1;
-                      out_pixel  += 1;
-                    }
-                }
+              int mask_offset = (iy + iter->roi[0].y - roi.y) * mask_stride + iter->roi[0].x - roi.x;
+              const gfloat *mask_pixel = &mask_data[mask_offset];
+
+              funcs->combine_float (out_pixel, mask_pixel, iter->roi[0].width,
+                                    opacity, stipple);
+
+              out_pixel += iter->roi[0].width;
             }
         }
-      else
-        {
-          g_warning("Mask format not supported: %s", babl_get_name (mask_format));
-        }
     }
-  gimp_temp_buf_unref (modified_mask);
 }
 
 void
@@ -192,6 +127,7 @@ canvas_buffer_to_paint_buf_alpha (GimpTempBuf  *paint_buf,
   GeglRectangle roi;
   GeglBufferIterator *iter;
 
+  const GimpPaintCoreRowFuncs *funcs = gimp_paint_core_rows_get_funcs ();
   const guint paint_stride = gimp_temp_buf_get_width (paint_buf);
   gfloat *paint_data       = (gfloat *) gimp_temp_buf_get_data (paint_buf);
 
@@ -207,20 +143,18 @@ canvas_buffer_to_paint_buf_alpha (GimpTempBuf  *paint_buf,
   while (gegl_buffer_iterator_next (iter))
     {
       gfloat *canvas_pixel = (gfloat *)iter->data[0];
-      int iy, ix;
+      int iy;
 
       for (iy = 0; iy < iter->roi[0].height; iy++)
         {
           int paint_offset = (iy + iter->roi[0].y - roi.y) * paint_stride + iter->roi[0].x - roi.x;
           float *paint_pixel = &paint_data[paint_offset * 4];
 
-          for (ix = 0; ix < iter->roi[0].width; ix++)
-            {
-              paint_pixel[3] *= *canvas_pixel;
+          /*  alpha *= canvas * 1.0 is exactly alpha *= canvas  */
+          funcs->mask_alpha_float (paint_pixel, canvas_pixel,
+                                   iter->roi[0].width, 1.0f);
 
-              canvas_pixel += 1;
-              paint_pixel  += 4;
-            }
+          canvas_pixel += iter->roi[0].width;
         }
     }
 }
@@ -235,11 +169,12 @@ paint_mask_to_paint_buffer (const GimpTempBuf  *paint_mask,
   gint width  = gimp_temp_buf_get_width (paint_buf);
   gint height = gimp_temp_buf_get_height (paint_buf);
 
+  const GimpPaintCoreRowFuncs *funcs = gimp_paint_core_rows_get_funcs ();
   const gint mask_stride       = gimp_temp_buf_get_width (paint_mask);
   const gint mask_start_offset = mask_y_offset * mask_stride + mask_x_offset;
   const Babl *mask_format      = gimp_temp_buf_get_format (paint_mask);
 
-  int iy, ix;
+  int iy;
   gfloat *paint_pixel = (gfloat *)gimp_temp_buf_get_data (paint_buf);
 
   /* Validate that the paint buffer is withing the bounds of the paint mask */
@@ -256,13 +191,9 @@ paint_mask_to_paint_buffer (const GimpTempBuf  *paint_mask,
           int mask_offset = iy * mask_stride;
           const guint8 *mask_pixel = &mask_data[mask_offset];
 
-          for (ix = 0; ix < width; ix++)
-            {
-              paint_pixel[3] *= (((gfloat)*mask_pixel) / 255.0f) * paint_opacity;
+          funcs->mask_alpha_u8 (paint_pixel, mask_pixel, width, paint_opacity);
 
-              mask_pixel  += 1;
-              paint_pixel += 4;
-            }
+          paint_pixel += width * 4;
         }
     }
   else if (mask_format == babl_format ("Y float"))
@@ -275,13 +206,10 @@ paint_mask_to_paint_buffer (const GimpTempBuf  *paint_mask,
           int mask_offset = iy * mask_stride;
           const gfloat *mask_pixel = &mask_data[mask_offset];
 
-          for (ix = 0; ix < width; ix++)
-            {
-              paint_pixel[3] *= (*mask_pixel) * paint_opacity;
+          funcs->mask_alpha_float (paint_pixel, mask_pixel, width,
+                                   paint_opacity);
 
-              mask_pixel  += 1;
-              paint_pixel += 4;
-            }
+          paint_pixel += width * 4;
         }
     }
 }
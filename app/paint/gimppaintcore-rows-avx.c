@@ -0,0 +1,208 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppaintcore-rows-avx.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gimppaintcore-rows.h"
+
+
+#if COMPILE_AVX_INTRINISICS
+
+/* AVX */
+#include <immintrin.h>
+
+
+/*  like their SSE2 counterparts, 8 pixels at a time.  AVX lacks 256-bit
+ *  integer operations, so the bytes are widened in two 128-bit halves.
+ */
+
+
+static inline __m256i
+load_u8_epi32 (const guint8 *mask)
+{
+  __m128i m = _mm_loadl_epi64 ((const __m128i *) mask);
+
+  return _mm256_insertf128_si256 (
+    _mm256_castsi128_si256 (_mm_cvtepu8_epi32 (m)),
+    _mm_cvtepu8_epi32 (_mm_srli_si128 (m, 4)), 1);
+}
+
+static inline __m256
+combine_ps (__m256   canvas,
+            __m256   mask,
+            __m256   v_opacity,
+            gboolean stipple)
+{
+  if (stipple)
+    {
+      __m256 d = _mm256_sub_ps (_mm256_set1_ps (1.0f), canvas);
+
+      return _mm256_add_ps (canvas,
+                            _mm256_mul_ps (_mm256_mul_ps (d, mask),
+                                           v_opacity));
+    }
+  else
+    {
+      __m256 d    = _mm256_sub_ps (v_opacity, canvas);
+      __m256 sel  = _mm256_cmp_ps (v_opacity, canvas, _CMP_GT_OQ);
+      __m256 comb = _mm256_add_ps (canvas,
+                                   _mm256_mul_ps (_mm256_mul_ps (d, mask),
+                                                  v_opacity));
+
+      return _mm256_blendv_ps (canvas, comb, sel);
+    }
+}
+
+
+void
+gimp_paint_core_rows_solidify_avx (const guint8 *mask,
+                                   gfloat       *dest,
+                                   gint          width)
+{
+  const __m256 zero = _mm256_setzero_ps ();
+  const __m256 one  = _mm256_set1_ps (1.0f);
+  gint         j;
+
+  for (j = 0; j + 8 <= width; j += 8)
+    {
+      __m256 m = _mm256_cvtepi32_ps (load_u8_epi32 (mask + j));
+
+      _mm256_storeu_ps (dest + j,
+                        _mm256_and_ps (_mm256_cmp_ps (m, zero, _CMP_NEQ_OQ),
+                                       one));
+    }
+
+  for (; j < width; j++)
+    dest[j] = mask[j] ? 1.0f : 0.0f;
+}
+
+void
+gimp_paint_core_rows_combine_u8_avx (gfloat       *canvas,
+                                     const guint8 *mask,
+                                     gint          width,
+                                     gfloat        opacity,
+                                     gboolean      stipple)
+{
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+  const __m256 v_255     = _mm256_set1_ps (255.0f);
+  gint         j;
+
+  for (j = 0; j + 8 <= width; j += 8)
+    {
+      __m256 c = _mm256_loadu_ps (canvas + j);
+      __m256 m = _mm256_div_ps (_mm256_cvtepi32_ps (load_u8_epi32 (mask + j)),
+                                v_255);
+
+      _mm256_storeu_ps (canvas + j, combine_ps (c, m, v_opacity, stipple));
+    }
+
+  for (; j < width; j++)
+    {
+      if (stipple)
+        canvas[j] += (1.0f - canvas[j]) * (mask[j] / 255.0f) * opacity;
+      else if (opacity > canvas[j])
+        canvas[j] += (opacity - canvas[j]) * (mask[j] / 255.0f) * opacity;
+    }
+}
+
+void
+gimp_paint_core_rows_combine_float_avx (gfloat       *canvas,
+                                        const gfloat *mask,
+                                        gint          width,
+                                        gfloat        opacity,
+                                        gboolean      stipple)
+{
+  const __m256 v_opacity = _mm256_set1_ps (opacity);
+  gint         j;
+
+  for (j = 0; j + 8 <= width; j += 8)
+    {
+      __m256 c = _mm256_loadu_ps (canvas + j);
+
+      _mm256_storeu_ps (canvas + j,
+                        combine_ps (c, _mm256_loadu_ps (mask + j), v_opacity,
+                                    stipple));
+    }
+
+  for (; j < width; j++)
+    {
+      if (stipple)
+        canvas[j] += (1.0f - canvas[j]) * mask[j] * opacity;
+      else if (opacity > canvas[j])
+        canvas[j] += (opacity - canvas[j]) * mask[j] * opacity;
+    }
+}
+
+void
+gimp_paint_core_rows_dab_falloff_avx (const GimpPaintCoreDabFalloff *falloff,
+                                      gint                           x,
+                                      gint                           y,
+                                      gint                           width,
+                                      gfloat                        *alpha)
+{
+  const __m256 yy       = _mm256_set1_ps (y + 0.5f - falloff->y);
+  const __m256 half     = _mm256_set1_ps (0.5f);
+  const __m256 one      = _mm256_set1_ps (1.0f);
+  const __m256 center_x = _mm256_set1_ps (falloff->x);
+  const __m256 aspect   = _mm256_set1_ps (falloff->aspect_ratio);
+  const __m256 sn       = _mm256_set1_ps (falloff->sn);
+  const __m256 cs       = _mm256_set1_ps (falloff->cs);
+  const __m256 scale    = _mm256_set1_ps (falloff->one_over_radius2);
+  const __m256 hardness = _mm256_set1_ps (falloff->hardness);
+  const __m256 slope1   = _mm256_set1_ps (falloff->slope1);
+  const __m256 slope2   = _mm256_set1_ps (falloff->slope2);
+  const __m256 yy_cs    = _mm256_mul_ps (yy, cs);
+  const __m256 yy_sn    = _mm256_mul_ps (yy, sn);
+  const __m256 offsets  = _mm256_set_ps (7, 6, 5, 4, 3, 2, 1, 0);
+  gint         j;
+
+  for (j = 0; j + 8 <= width; j += 8)
+    {
+      __m256 xx, yyr, xxr, rr, soft, hard;
+
+      /*  x + j + 7 is exact in a float, like the integer conversion  */
+      xx  = _mm256_add_ps (_mm256_set1_ps (x + j), offsets);
+      xx  = _mm256_sub_ps (_mm256_add_ps (xx, half), center_x);
+      yyr = _mm256_mul_ps (_mm256_sub_ps (yy_cs, _mm256_mul_ps (xx, sn)),
+                           aspect);
+      xxr = _mm256_add_ps (yy_sn, _mm256_mul_ps (xx, cs));
+      rr  = _mm256_mul_ps (_mm256_add_ps (_mm256_mul_ps (yyr, yyr),
+                                          _mm256_mul_ps (xxr, xxr)),
+                           scale);
+
+      hard = _mm256_add_ps (one, _mm256_mul_ps (rr, slope1));
+      soft = _mm256_sub_ps (_mm256_mul_ps (rr, slope2), slope2);
+      soft = _mm256_blendv_ps (soft, hard,
+                               _mm256_cmp_ps (rr, hardness, _CMP_LE_OQ));
+
+      _mm256_storeu_ps (alpha + j,
+                        _mm256_andnot_ps (_mm256_cmp_ps (rr, one, _CMP_GT_OQ),
+                                          soft));
+    }
+
+  if (j < width)
+    {
+      gimp_paint_core_rows_generic.dab_falloff (falloff, x + j, y,
+                                                width - j, alpha + j);
+    }
+}
+
+#endif /* COMPILE_AVX_INTRINISICS */
@@ -0,0 +1,354 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppaintcore-rows-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "gimppaintcore-rows.h"
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+/* SSE2 */
+#include <emmintrin.h>
+
+
+/*  each function performs the same operations, in the same order, as
+ *  its generic counterpart, and finishes the row with scalar code
+ */
+
+
+void
+gimp_paint_core_rows_subsample_sse2 (const guint8 *mask,
+                                     guint32      *accum,
+                                     gint          width,
+                                     const gint   *kernel_row,
+                                     gint          kernel_width)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  gint          s;
+
+  for (s = 0; s < kernel_width; s++)
+    {
+      const guint32  k = kernel_row[s];
+      guint32       *a = accum + s;
+      const __m128i  v_k = _mm_set1_epi16 (k);
+      gint           j;
+
+      /*  mask[j] * k fits 16 bits, since kernel values are <= 256  */
+      for (j = 0; j + 8 <= width; j += 8)
+        {
+          __m128i m  = _mm_loadl_epi64 ((const __m128i *) (mask + j));
+          __m128i p  = _mm_mullo_epi16 (_mm_unpacklo_epi8 (m, zero), v_k);
+          __m128i a0 = _mm_loadu_si128 ((const __m128i *) (a + j));
+          __m128i a1 = _mm_loadu_si128 ((const __m128i *) (a + j + 4));
+
+          a0 = _mm_add_epi32 (a0, _mm_unpacklo_epi16 (p, zero));
+          a1 = _mm_add_epi32 (a1, _mm_unpackhi_epi16 (p, zero));
+
+          _mm_storeu_si128 ((__m128i *) (a + j),     a0);
+          _mm_storeu_si128 ((__m128i *) (a + j + 4), a1);
+        }
+
+      for (; j < width; j++)
+        a[j] += mask[j] * k;
+    }
+}
+
+void
+gimp_paint_core_rows_subsample_store_sse2 (const guint32 *accum,
+                                           guint8        *dest,
+                                           gint           width,
+                                           guint32        bias)
+{
+  const __m128i v_bias = _mm_set1_epi32 (bias);
+  gint          j;
+
+  /*  the accumulated values are <= 255 * 256, so their sum with the
+   *  bias, shifted, fits the signed 16-bit packing
+   */
+  for (j = 0; j + 16 <= width; j += 16)
+    {
+      __m128i a0 = _mm_loadu_si128 ((const __m128i *) (accum + j));
+      __m128i a1 = _mm_loadu_si128 ((const __m128i *) (accum + j + 4));
+      __m128i a2 = _mm_loadu_si128 ((const __m128i *) (accum + j + 8));
+      __m128i a3 = _mm_loadu_si128 ((const __m128i *) (accum + j + 12));
+
+      a0 = _mm_srli_epi32 (_mm_add_epi32 (a0, v_bias), 8);
+      a1 = _mm_srli_epi32 (_mm_add_epi32 (a1, v_bias), 8);
+      a2 = _mm_srli_epi32 (_mm_add_epi32 (a2, v_bias), 8);
+      a3 = _mm_srli_epi32 (_mm_add_epi32 (a3, v_bias), 8);
+
+      _mm_storeu_si128 ((__m128i *) (dest + j),
+                        _mm_packus_epi16 (_mm_packs_epi32 (a0, a1),
+                                          _mm_packs_epi32 (a2, a3)));
+    }
+
+  for (; j < width; j++)
+    dest[j] = (accum[j] + bias) >> 8;
+}
+
+void
+gimp_paint_core_rows_solidify_sse2 (const guint8 *mask,
+                                    gfloat       *dest,
+                                    gint          width)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128  one  = _mm_set1_ps (1.0f);
+  gint          j;
+
+  for (j = 0; j + 16 <= width; j += 16)
+    {
+      __m128i m  = _mm_loadu_si128 ((const __m128i *) (mask + j));
+      __m128i z  = _mm_cmpeq_epi8 (m, zero);
+      __m128i lo = _mm_unpacklo_epi8 (z, z);
+      __m128i hi = _mm_unpackhi_epi8 (z, z);
+
+      _mm_storeu_ps (dest + j,
+                     _mm_andnot_ps (_mm_castsi128_ps (_mm_unpacklo_epi16 (lo, lo)),
+                                    one));
+      _mm_storeu_ps (dest + j + 4,
+                     _mm_andnot_ps (_mm_castsi128_ps (_mm_unpackhi_epi16 (lo, lo)),
+                                    one));
+      _mm_storeu_ps (dest + j + 8,
+                     _mm_andnot_ps (_mm_castsi128_ps (_mm_unpacklo_epi16 (hi, hi)),
+                                    one));
+      _mm_storeu_ps (dest + j + 12,
+                     _mm_andnot_ps (_mm_castsi128_ps (_mm_unpackhi_epi16 (hi, hi)),
+                                    one));
+    }
+
+  for (; j < width; j++)
+    dest[j] = mask[j] ? 1.0f : 0.0f;
+}
+
+static inline __m128
+load_u8_ps (const guint8 *mask)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  gint32        bytes;
+  __m128i       m;
+
+  memcpy (&bytes, mask, sizeof (bytes));
+
+  m = _mm_cvtsi32_si128 (bytes);
+  m = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (m, zero), zero);
+
+  return _mm_div_ps (_mm_cvtepi32_ps (m), _mm_set1_ps (255.0f));
+}
+
+static inline __m128
+combine_ps (__m128   canvas,
+            __m128   mask,
+            __m128   v_opacity,
+            gboolean stipple)
+{
+  if (stipple)
+    {
+      __m128 d = _mm_sub_ps (_mm_set1_ps (1.0f), canvas);
+
+      return _mm_add_ps (canvas,
+                         _mm_mul_ps (_mm_mul_ps (d, mask), v_opacity));
+    }
+  else
+    {
+      __m128 d    = _mm_sub_ps (v_opacity, canvas);
+      __m128 sel  = _mm_cmpgt_ps (v_opacity, canvas);
+      __m128 comb = _mm_add_ps (canvas,
+                                _mm_mul_ps (_mm_mul_ps (d, mask), v_opacity));
+
+      return _mm_or_ps (_mm_and_ps (sel, comb), _mm_andnot_ps (sel, canvas));
+    }
+}
+
+void
+gimp_paint_core_rows_combine_u8_sse2 (gfloat       *canvas,
+                                      const guint8 *mask,
+                                      gint          width,
+                                      gfloat        opacity,
+                                      gboolean      stipple)
+{
+  const __m128 v_opacity = _mm_set1_ps (opacity);
+  gint         j;
+
+  for (j = 0; j + 4 <= width; j += 4)
+    {
+      __m128 c = _mm_loadu_ps (canvas + j);
+
+      _mm_storeu_ps (canvas + j,
+                     combine_ps (c, load_u8_ps (mask + j), v_opacity, stipple));
+    }
+
+  for (; j < width; j++)
+    {
+      if (stipple)
+        canvas[j] += (1.0f - canvas[j]) * (mask[j] / 255.0f) * opacity;
+      else if (opacity > canvas[j])
+        canvas[j] += (opacity - canvas[j]) * (mask[j] / 255.0f) * opacity;
+    }
+}
+
+void
+gimp_paint_core_rows_combine_float_sse2 (gfloat       *canvas,
+                                         const gfloat *mask,
+                                         gint          width,
+                                         gfloat        opacity,
+                                         gboolean      stipple)
+{
+  const __m128 v_opacity = _mm_set1_ps (opacity);
+  gint         j;
+
+  for (j = 0; j + 4 <= width; j += 4)
+    {
+      __m128 c = _mm_loadu_ps (canvas + j);
+
+      _mm_storeu_ps (canvas + j,
+                     combine_ps (c, _mm_loadu_ps (mask + j), v_opacity,
+                                 stipple));
+    }
+
+  for (; j < width; j++)
+    {
+      if (stipple)
+        canvas[j] += (1.0f - canvas[j]) * mask[j] * opacity;
+      else if (opacity > canvas[j])
+        canvas[j] += (opacity - canvas[j]) * mask[j] * opacity;
+    }
+}
+
+/*  multiplies the alpha of 4 RGBA pixels by the 4 factors in 'factor',
+ *  and their RGB by 1.0
+ */
+static inline void
+mask_alpha_ps (gfloat *paint,
+               __m128  factor)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       lo  = _mm_unpacklo_ps (one, factor); /* 1 f0 1 f1 */
+  __m128       hi  = _mm_unpackhi_ps (one, factor); /* 1 f2 1 f3 */
+
+  _mm_storeu_ps (paint,
+                 _mm_mul_ps (_mm_loadu_ps (paint),
+                             _mm_shuffle_ps (one, lo,
+                                             _MM_SHUFFLE (1, 0, 0, 0))));
+  _mm_storeu_ps (paint + 4,
+                 _mm_mul_ps (_mm_loadu_ps (paint + 4),
+                             _mm_shuffle_ps (one, lo,
+                                             _MM_SHUFFLE (3, 2, 0, 0))));
+  _mm_storeu_ps (paint + 8,
+                 _mm_mul_ps (_mm_loadu_ps (paint + 8),
+                             _mm_shuffle_ps (one, hi,
+                                             _MM_SHUFFLE (1, 0, 0, 0))));
+  _mm_storeu_ps (paint + 12,
+                 _mm_mul_ps (_mm_loadu_ps (paint + 12),
+                             _mm_shuffle_ps (one, hi,
+                                             _MM_SHUFFLE (3, 2, 0, 0))));
+}
+
+void
+gimp_paint_core_rows_mask_alpha_u8_sse2 (gfloat       *paint,
+                                         const guint8 *mask,
+                                         gint          width,
+                                         gfloat        opacity)
+{
+  const __m128 v_opacity = _mm_set1_ps (opacity);
+  gint         j;
+
+  for (j = 0; j + 4 <= width; j += 4)
+    mask_alpha_ps (paint + 4 * j,
+                   _mm_mul_ps (load_u8_ps (mask + j), v_opacity));
+
+  for (; j < width; j++)
+    paint[4 * j + 3] *= (mask[j] / 255.0f) * opacity;
+}
+
+void
+gimp_paint_core_rows_mask_alpha_float_sse2 (gfloat       *paint,
+                                            const gfloat *mask,
+                                            gint          width,
+                                            gfloat        opacity)
+{
+  const __m128 v_opacity = _mm_set1_ps (opacity);
+  gint         j;
+
+  for (j = 0; j + 4 <= width; j += 4)
+    mask_alpha_ps (paint + 4 * j,
+                   _mm_mul_ps (_mm_loadu_ps (mask + j), v_opacity));
+
+  for (; j < width; j++)
+    paint[4 * j + 3] *= mask[j] * opacity;
+}
+
+void
+gimp_paint_core_rows_dab_falloff_sse2 (const GimpPaintCoreDabFalloff *falloff,
+                                       gint                           x,
+                                       gint                           y,
+                                       gint                           width,
+                                       gfloat                        *alpha)
+{
+  const __m128 yy       = _mm_set1_ps (y + 0.5f - falloff->y);
+  const __m128 half     = _mm_set1_ps (0.5f);
+  const __m128 one      = _mm_set1_ps (1.0f);
+  const __m128 center_x = _mm_set1_ps (falloff->x);
+  const __m128 aspect   = _mm_set1_ps (falloff->aspect_ratio);
+  const __m128 sn       = _mm_set1_ps (falloff->sn);
+  const __m128 cs       = _mm_set1_ps (falloff->cs);
+  const __m128 scale    = _mm_set1_ps (falloff->one_over_radius2);
+  const __m128 hardness = _mm_set1_ps (falloff->hardness);
+  const __m128 slope1   = _mm_set1_ps (falloff->slope1);
+  const __m128 slope2   = _mm_set1_ps (falloff->slope2);
+  const __m128 yy_cs    = _mm_mul_ps (yy, cs);
+  const __m128 yy_sn    = _mm_mul_ps (yy, sn);
+  __m128i      ix       = _mm_add_epi32 (_mm_set1_epi32 (x),
+                                         _mm_set_epi32 (3, 2, 1, 0));
+  gint         j;
+
+  for (j = 0; j + 4 <= width; j += 4)
+    {
+      __m128 xx, yyr, xxr, rr, soft, hard, sel;
+
+      xx  = _mm_sub_ps (_mm_add_ps (_mm_cvtepi32_ps (ix), half), center_x);
+      yyr = _mm_mul_ps (_mm_sub_ps (yy_cs, _mm_mul_ps (xx, sn)), aspect);
+      xxr = _mm_add_ps (yy_sn, _mm_mul_ps (xx, cs));
+      rr  = _mm_mul_ps (_mm_add_ps (_mm_mul_ps (yyr, yyr),
+                                    _mm_mul_ps (xxr, xxr)),
+                        scale);
+
+      hard = _mm_add_ps (one, _mm_mul_ps (rr, slope1));
+      soft = _mm_sub_ps (_mm_mul_ps (rr, slope2), slope2);
+      sel  = _mm_cmple_ps (rr, hardness);
+      soft = _mm_or_ps (_mm_and_ps (sel, hard), _mm_andnot_ps (sel, soft));
+
+      _mm_storeu_ps (alpha + j,
+                     _mm_andnot_ps (_mm_cmpgt_ps (rr, one), soft));
+
+      ix = _mm_add_epi32 (ix, _mm_set1_epi32 (4));
+    }
+
+  if (j < width)
+    {
+      gimp_paint_core_rows_generic.dab_falloff (falloff, x + j, y,
+                                                width - j, alpha + j);
+    }
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -0,0 +1,246 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppaintcore-rows.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "gimppaintcore-rows.h"
+
+
+static void
+gimp_paint_core_rows_subsample (const guint8 *mask,
+                                guint32      *accum,
+                                gint          width,
+                                const gint   *kernel_row,
+                                gint          kernel_width)
+{
+  gint s;
+
+  for (s = 0; s < kernel_width; s++)
+    {
+      const guint32 k = kernel_row[s];
+      gint          j;
+
+      for (j = 0; j < width; j++)
+        accum[j + s] += mask[j] * k;
+    }
+}
+
+static void
+gimp_paint_core_rows_subsample_store (const guint32 *accum,
+                                      guint8        *dest,
+                                      gint           width,
+                                      guint32        bias)
+{
+  gint j;
+
+  for (j = 0; j < width; j++)
+    dest[j] = (accum[j] + bias) >> 8;
+}
+
+static void
+gimp_paint_core_rows_solidify (const guint8 *mask,
+                               gfloat       *dest,
+                               gint          width)
+{
+  gint j;
+
+  for (j = 0; j < width; j++)
+    dest[j] = mask[j] ? 1.0f : 0.0f;
+}
+
+static void
+gimp_paint_core_rows_combine_u8 (gfloat       *canvas,
+                                 const guint8 *mask,
+                                 gint          width,
+                                 gfloat        opacity,
+                                 gboolean      stipple)
+{
+  gint j;
+
+  if (stipple)
+    {
+      for (j = 0; j < width; j++)
+        canvas[j] += (1.0f - canvas[j]) * (mask[j] / 255.0f) * opacity;
+    }
+  else
+    {
+      for (j = 0; j < width; j++)
+        {
+          if (opacity > canvas[j])
+            canvas[j] += (opacity - canvas[j]) * (mask[j] / 255.0f) * opacity;
+        }
+    }
+}
+
+static void
+gimp_paint_core_rows_combine_float (gfloat       *canvas,
+                                    const gfloat *mask,
+                                    gint          width,
+                                    gfloat        opacity,
+                                    gboolean      stipple)
+{
+  gint j;
+
+  if (stipple)
+    {
+      for (j = 0; j < width; j++)
+        canvas[j] += (1.0f - canvas[j]) * mask[j] * opacity;
+    }
+  else
+    {
+      for (j = 0; j < width; j++)
+        {
+          if (opacity > canvas[j])
+            canvas[j] += (opacity - canvas[j]) * mask[j] * opacity;
+        }
+    }
+}
+
+static void
+gimp_paint_core_rows_mask_alpha_u8 (gfloat       *paint,
+                                    const guint8 *mask,
+                                    gint          width,
+                                    gfloat        opacity)
+{
+  gint j;
+
+  for (j = 0; j < width; j++)
+    paint[4 * j + 3] *= (mask[j] / 255.0f) * opacity;
+}
+
+static void
+gimp_paint_core_rows_mask_alpha_float (gfloat       *paint,
+                                       const gfloat *mask,
+                                       gint          width,
+                                       gfloat        opacity)
+{
+  gint j;
+
+  for (j = 0; j < width; j++)
+    paint[4 * j + 3] *= mask[j] * opacity;
+}
+
+static void
+gimp_paint_core_rows_dab_falloff (const GimpPaintCoreDabFalloff *falloff,
+                                  gint                           x,
+                                  gint                           y,
+                                  gint                           width,
+                                  gfloat                        *alpha)
+{
+  const gfloat yy = y + 0.5f - falloff->y;
+  gint         j;
+
+  for (j = 0; j < width; j++)
+    {
+      const gfloat xx  = (x + j) + 0.5f - falloff->x;
+      const gfloat yyr = (yy * falloff->cs - xx * falloff->sn) *
+                         falloff->aspect_ratio;
+      const gfloat xxr = yy * falloff->sn + xx * falloff->cs;
+      const gfloat rr  = (yyr * yyr + xxr * xxr) * falloff->one_over_radius2;
+
+      if (rr > 1.0f)
+        alpha[j] = 0.0f;
+      else if (rr <= falloff->hardness)
+        alpha[j] = 1.0f + rr * falloff->slope1;
+      else
+        alpha[j] = rr * falloff->slope2 - falloff->slope2;
+    }
+}
+
+
+const GimpPaintCoreRowFuncs gimp_paint_core_rows_generic =
+{
+  gimp_paint_core_rows_subsample,
+  gimp_paint_core_rows_subsample_store,
+  gimp_paint_core_rows_solidify,
+  gimp_paint_core_rows_combine_u8,
+  gimp_paint_core_rows_combine_float,
+  gimp_paint_core_rows_mask_alpha_u8,
+  gimp_paint_core_rows_mask_alpha_float,
+  gimp_paint_core_rows_dab_falloff
+};
+
+#if COMPILE_SSE2_INTRINISICS
+
+const GimpPaintCoreRowFuncs gimp_paint_core_rows_sse2 =
+{
+  gimp_paint_core_rows_subsample_sse2,
+  gimp_paint_core_rows_subsample_store_sse2,
+  gimp_paint_core_rows_solidify_sse2,
+  gimp_paint_core_rows_combine_u8_sse2,
+  gimp_paint_core_rows_combine_float_sse2,
+  gimp_paint_core_rows_mask_alpha_u8_sse2,
+  gimp_paint_core_rows_mask_alpha_float_sse2,
+  gimp_paint_core_rows_dab_falloff_sse2
+};
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+#if COMPILE_SSE2_INTRINISICS && COMPILE_AVX_INTRINISICS
+
+/*  the integer and the interleaved loops gain nothing from AVX without
+ *  AVX2, keep their SSE2 versions
+ */
+const GimpPaintCoreRowFuncs gimp_paint_core_rows_avx =
+{
+  gimp_paint_core_rows_subsample_sse2,
+  gimp_paint_core_rows_subsample_store_sse2,
+  gimp_paint_core_rows_solidify_avx,
+  gimp_paint_core_rows_combine_u8_avx,
+  gimp_paint_core_rows_combine_float_avx,
+  gimp_paint_core_rows_mask_alpha_u8_sse2,
+  gimp_paint_core_rows_mask_alpha_float_sse2,
+  gimp_paint_core_rows_dab_falloff_avx
+};
+
+#endif /* COMPILE_SSE2_INTRINISICS && COMPILE_AVX_INTRINISICS */
+
+
+const GimpPaintCoreRowFuncs *
+gimp_paint_core_rows_get_funcs (void)
+{
+  static const GimpPaintCoreRowFuncs *funcs = NULL;
+
+  if (g_once_init_enter (&funcs))
+    {
+      const GimpPaintCoreRowFuncs *result = &gimp_paint_core_rows_generic;
+
+#if COMPILE_SSE2_INTRINISICS
+      GimpCpuAccelFlags            accel  = gimp_cpu_accel_get_support ();
+
+      if (accel & GIMP_CPU_ACCEL_X86_SSE2)
+        {
+          result = &gimp_paint_core_rows_sse2;
+
+#if COMPILE_AVX_INTRINISICS
+          if (accel & GIMP_CPU_ACCEL_X86_AVX)
+            result = &gimp_paint_core_rows_avx;
+#endif
+        }
+#endif
+
+      g_once_init_leave (&funcs, result);
+    }
+
+  return funcs;
+}
@@ -0,0 +1,174 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppaintcore-rows.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PAINT_CORE_ROWS_H__
+#define __GIMP_PAINT_CORE_ROWS_H__
+
+
+/*  the per-row inner loops of the brush mask and paint mask functions
+ *  in gimpbrushcore.c and gimppaintcore-loops.c, which run for every
+ *  dab.  gimp_paint_core_rows_get_funcs() returns the fastest variant
+ *  supported by the CPU.
+ */
+
+typedef struct _GimpPaintCoreDabFalloff GimpPaintCoreDabFalloff;
+typedef struct _GimpPaintCoreRowFuncs   GimpPaintCoreRowFuncs;
+
+/*  the shape of a MyPaint dab, see gimpmybrushsurface.c  */
+struct _GimpPaintCoreDabFalloff
+{
+  gfloat x;
+  gfloat y;
+  gfloat aspect_ratio;
+  gfloat sn;
+  gfloat cs;
+  gfloat one_over_radius2;
+  gfloat hardness;
+  gfloat slope1;
+  gfloat slope2;
+};
+
+struct _GimpPaintCoreRowFuncs
+{
+  /*  accum[j + s] += mask[j] * kernel_row[s], for s < kernel_width  */
+  void (* subsample)        (const guint8  *mask,
+                             guint32       *accum,
+                             gint           width,
+                             const gint    *kernel_row,
+                             gint           kernel_width);
+  /*  dest[j] = (accum[j] + bias) / 256  */
+  void (* subsample_store)  (const guint32 *accum,
+                             guint8        *dest,
+                             gint           width,
+                             guint32        bias);
+  /*  dest[j] = mask[j] ? 1.0 : 0.0  */
+  void (* solidify)         (const guint8  *mask,
+                             gfloat        *dest,
+                             gint           width);
+
+  /*  combine a paint mask row into a "Y float" canvas row  */
+  void (* combine_u8)       (gfloat        *canvas,
+                             const guint8  *mask,
+                             gint           width,
+                             gfloat         opacity,
+                             gboolean       stipple);
+  void (* combine_float)    (gfloat        *canvas,
+                             const gfloat  *mask,
+                             gint           width,
+                             gfloat         opacity,
+                             gboolean       stipple);
+
+  /*  multiply the alpha of a "RGBA float" paint row by a mask row  */
+  void (* mask_alpha_u8)    (gfloat        *paint,
+                             const guint8  *mask,
+                             gint           width,
+                             gfloat         opacity);
+  void (* mask_alpha_float) (gfloat        *paint,
+                             const gfloat  *mask,
+                             gint           width,
+                             gfloat         opacity);
+
+  /*  alpha[j] = the opacity of a dab at pixel (x + j, y)  */
+  void (* dab_falloff)      (const GimpPaintCoreDabFalloff *falloff,
+                             gint                           x,
+                             gint                           y,
+                             gint                           width,
+                             gfloat                        *alpha);
+};
+
+
+extern const GimpPaintCoreRowFuncs gimp_paint_core_rows_generic;
+#if COMPILE_SSE2_INTRINISICS
+extern const GimpPaintCoreRowFuncs gimp_paint_core_rows_sse2;
+#endif
+#if COMPILE_SSE2_INTRINISICS && COMPILE_AVX_INTRINISICS
+extern const GimpPaintCoreRowFuncs gimp_paint_core_rows_avx;
+#endif
+
+
+const GimpPaintCoreRowFuncs * gimp_paint_core_rows_get_funcs (void);
+
+
+/*  the SSE2 and AVX variants, don't call directly  */
+
+#if COMPILE_SSE2_INTRINISICS
+
+void gimp_paint_core_rows_subsample_sse2        (const guint8  *mask,
+                                                 guint32       *accum,
+                                                 gint           width,
+                                                 const gint    *kernel_row,
+                                                 gint           kernel_width);
+void gimp_paint_core_rows_subsample_store_sse2  (const guint32 *accum,
+                                                 guint8        *dest,
+                                                 gint           width,
+                                                 guint32        bias);
+void gimp_paint_core_rows_solidify_sse2         (const guint8  *mask,
+                                                 gfloat        *dest,
+                                                 gint           width);
+void gimp_paint_core_rows_combine_u8_sse2       (gfloat        *canvas,
+                                                 const guint8  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity,
+                                                 gboolean       stipple);
+void gimp_paint_core_rows_combine_float_sse2    (gfloat        *canvas,
+                                                 const gfloat  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity,
+                                                 gboolean       stipple);
+void gimp_paint_core_rows_mask_alpha_u8_sse2    (gfloat        *paint,
+                                                 const guint8  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity);
+void gimp_paint_core_rows_mask_alpha_float_sse2 (gfloat        *paint,
+                                                 const gfloat  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity);
+void gimp_paint_core_rows_dab_falloff_sse2      (const GimpPaintCoreDabFalloff *falloff,
+                                                 gint                           x,
+                                                 gint                           y,
+                                                 gint                           width,
+                                                 gfloat                        *alpha);
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+#if COMPILE_AVX_INTRINISICS
+
+void gimp_paint_core_rows_solidify_avx          (const guint8  *mask,
+                                                 gfloat        *dest,
+                                                 gint           width);
+void gimp_paint_core_rows_combine_u8_avx        (gfloat        *canvas,
+                                                 const guint8  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity,
+                                                 gboolean       stipple);
+void gimp_paint_core_rows_combine_float_avx     (gfloat        *canvas,
+                                                 const gfloat  *mask,
+                                                 gint           width,
+                                                 gfloat         opacity,
+                                                 gboolean       stipple);
+void gimp_paint_core_rows_dab_falloff_avx       (const GimpPaintCoreDabFalloff *falloff,
+                                                 gint                           x,
+                                                 gint                           y,
+                                                 gint                           width,
+                                                 gfloat                        *alpha);
+
+#endif /* COMPILE_AVX_INTRINISICS */
+
+
+#endif /* __GIMP_PAINT_CORE_ROWS_H__ */
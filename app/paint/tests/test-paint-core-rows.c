@@ -0,0 +1,525 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  compares the SSE2 and AVX paint core row functions against the
+ *  generic versions, and, in perf mode, measures the dabs per second
+ *  each of them achieves for common brush sizes
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "app/paint/gimppaintcore-rows.h"
+
+
+/*  not a multiple of 16, so that the scalar tails are exercised  */
+#define WIDTH 1021
+
+/*  the 3x3 kernel the brush core uses for a centered subsample  */
+#define KERNEL_WIDTH  3
+#define KERNEL_HEIGHT 3
+
+#define BENCHMARK_SECONDS 0.5
+
+
+typedef struct
+{
+  const gchar                 *name;
+  GimpCpuAccelFlags            accel;
+  const GimpPaintCoreRowFuncs *funcs;
+} RowsTest;
+
+typedef struct
+{
+  gint            size;
+  const RowsTest *test;
+} BenchmarkTest;
+
+
+static const gint kernel[KERNEL_HEIGHT * KERNEL_WIDTH] =
+{
+  16, 32, 16,
+  32, 64, 32,
+  16, 32, 16
+};
+
+static const RowsTest rows_tests[] =
+{
+  { "generic", 0, &gimp_paint_core_rows_generic },
+#if COMPILE_SSE2_INTRINISICS
+  { "sse2", GIMP_CPU_ACCEL_X86_SSE2, &gimp_paint_core_rows_sse2 },
+#endif
+#if COMPILE_SSE2_INTRINISICS && COMPILE_AVX_INTRINISICS
+  { "avx", GIMP_CPU_ACCEL_X86_SSE2 | GIMP_CPU_ACCEL_X86_AVX,
+    &gimp_paint_core_rows_avx },
+#endif
+  { NULL }
+};
+
+static const gint benchmark_sizes[] = { 9, 19, 51, 101, 251 };
+
+
+static gboolean
+accel_supported (GimpCpuAccelFlags accel)
+{
+  if ((gimp_cpu_accel_get_support () & accel) == accel)
+    return TRUE;
+
+  g_test_skip ("not supported by this CPU");
+
+  return FALSE;
+}
+
+static guint8 *
+random_u8_mask (gint n)
+{
+  guint8 *mask = g_new (guint8, n);
+  gint    i;
+
+  /*  brush masks are mostly 0 and 255 at the edges  */
+  for (i = 0; i < n; i++)
+    {
+      switch (g_test_rand_int_range (0, 4))
+        {
+        case 0:  mask[i] = 0;                                  break;
+        case 1:  mask[i] = 255;                                break;
+        default: mask[i] = g_test_rand_int_range (0, 256);     break;
+        }
+    }
+
+  return mask;
+}
+
+static gfloat *
+random_floats (gint    n,
+               gdouble min,
+               gdouble max)
+{
+  gfloat *data = g_new (gfloat, n);
+  gint    i;
+
+  for (i = 0; i < n; i++)
+    data[i] = g_test_rand_double_range (min, max);
+
+  return data;
+}
+
+static void
+compare_floats (const gchar  *what,
+                const gfloat *expected,
+                const gfloat *actual,
+                gint          n)
+{
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      /*  the functions perform the same float operations, so the
+       *  results have to be identical
+       */
+      if (memcmp (&expected[i], &actual[i], sizeof (gfloat)))
+        {
+          g_test_message ("%s, value %d: %g != %g",
+                          what, i, expected[i], actual[i]);
+          g_test_fail ();
+          return;
+        }
+    }
+}
+
+static void
+test_subsample (gconstpointer data)
+{
+  const RowsTest *test    = data;
+  const RowsTest *generic = &rows_tests[0];
+  guint8         *mask;
+  guint32        *expected;
+  guint32        *actual;
+  guint8         *expected_dest;
+  guint8         *actual_dest;
+  gint            r;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  mask          = random_u8_mask (WIDTH);
+  expected      = g_new0 (guint32, WIDTH + KERNEL_WIDTH);
+  actual        = g_new0 (guint32, WIDTH + KERNEL_WIDTH);
+  expected_dest = g_new0 (guint8, WIDTH + KERNEL_WIDTH);
+  actual_dest   = g_new0 (guint8, WIDTH + KERNEL_WIDTH);
+
+  for (r = 0; r < KERNEL_HEIGHT; r++)
+    {
+      generic->funcs->subsample (mask, expected, WIDTH,
+                                 kernel + r * KERNEL_WIDTH, KERNEL_WIDTH);
+      test->funcs->subsample    (mask, actual, WIDTH,
+                                 kernel + r * KERNEL_WIDTH, KERNEL_WIDTH);
+    }
+
+  g_assert (memcmp (expected, actual,
+                    (WIDTH + KERNEL_WIDTH) * sizeof (guint32)) == 0);
+
+  generic->funcs->subsample_store (expected, expected_dest,
+                                   WIDTH + KERNEL_WIDTH, 127);
+  test->funcs->subsample_store    (actual, actual_dest,
+                                   WIDTH + KERNEL_WIDTH, 127);
+
+  g_assert (memcmp (expected_dest, actual_dest, WIDTH + KERNEL_WIDTH) == 0);
+
+  g_free (mask);
+  g_free (expected);
+  g_free (actual);
+  g_free (expected_dest);
+  g_free (actual_dest);
+}
+
+static void
+test_solidify (gconstpointer data)
+{
+  const RowsTest *test    = data;
+  const RowsTest *generic = &rows_tests[0];
+  guint8         *mask;
+  gfloat         *expected;
+  gfloat         *actual;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  mask     = random_u8_mask (WIDTH);
+  expected = g_new (gfloat, WIDTH);
+  actual   = g_new (gfloat, WIDTH);
+
+  generic->funcs->solidify (mask, expected, WIDTH);
+  test->funcs->solidify    (mask, actual,   WIDTH);
+
+  compare_floats ("solidify", expected, actual, WIDTH);
+
+  g_free (mask);
+  g_free (expected);
+  g_free (actual);
+}
+
+static void
+test_combine (gconstpointer data)
+{
+  const RowsTest *test    = data;
+  const RowsTest *generic = &rows_tests[0];
+  guint8         *mask_u8;
+  gfloat         *mask_float;
+  gfloat         *canvas;
+  gfloat         *expected;
+  gfloat         *actual;
+  gint            stipple;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  mask_u8    = random_u8_mask (WIDTH);
+  mask_float = random_floats (WIDTH, 0.0, 1.0);
+  canvas     = random_floats (WIDTH, 0.0, 1.0);
+  expected   = g_new (gfloat, WIDTH);
+  actual     = g_new (gfloat, WIDTH);
+
+  for (stipple = FALSE; stipple <= TRUE; stipple++)
+    {
+      memcpy (expected, canvas, WIDTH * sizeof (gfloat));
+      memcpy (actual,   canvas, WIDTH * sizeof (gfloat));
+
+      generic->funcs->combine_u8 (expected, mask_u8, WIDTH, 0.6f, stipple);
+      test->funcs->combine_u8    (actual,   mask_u8, WIDTH, 0.6f, stipple);
+
+      compare_floats ("combine_u8", expected, actual, WIDTH);
+
+      memcpy (expected, canvas, WIDTH * sizeof (gfloat));
+      memcpy (actual,   canvas, WIDTH * sizeof (gfloat));
+
+      generic->funcs->combine_float (expected, mask_float, WIDTH, 0.6f,
+                                     stipple);
+      test->funcs->combine_float    (actual,   mask_float, WIDTH, 0.6f,
+                                     stipple);
+
+      compare_floats ("combine_float", expected, actual, WIDTH);
+    }
+
+  g_free (mask_u8);
+  g_free (mask_float);
+  g_free (canvas);
+  g_free (expected);
+  g_free (actual);
+}
+
+static void
+test_mask_alpha (gconstpointer data)
+{
+  const RowsTest *test    = data;
+  const RowsTest *generic = &rows_tests[0];
+  guint8         *mask_u8;
+  gfloat         *mask_float;
+  gfloat         *paint;
+  gfloat         *expected;
+  gfloat         *actual;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  mask_u8    = random_u8_mask (WIDTH);
+  mask_float = random_floats (WIDTH, 0.0, 1.0);
+  paint      = random_floats (4 * WIDTH, -0.25, 1.25);
+  expected   = g_memdup (paint, 4 * WIDTH * sizeof (gfloat));
+  actual     = g_memdup (paint, 4 * WIDTH * sizeof (gfloat));
+
+  generic->funcs->mask_alpha_u8 (expected, mask_u8, WIDTH, 0.6f);
+  test->funcs->mask_alpha_u8    (actual,   mask_u8, WIDTH, 0.6f);
+
+  compare_floats ("mask_alpha_u8", expected, actual, 4 * WIDTH);
+
+  generic->funcs->mask_alpha_float (expected, mask_float, WIDTH, 0.6f);
+  test->funcs->mask_alpha_float    (actual,   mask_float, WIDTH, 0.6f);
+
+  compare_floats ("mask_alpha_float", expected, actual, 4 * WIDTH);
+
+  g_free (mask_u8);
+  g_free (mask_float);
+  g_free (paint);
+  g_free (expected);
+  g_free (actual);
+}
+
+static void
+test_dab_falloff (gconstpointer data)
+{
+  const RowsTest *test    = data;
+  const RowsTest *generic = &rows_tests[0];
+  gfloat         *expected;
+  gfloat         *actual;
+  gint            i;
+
+  if (! accel_supported (test->accel))
+    return;
+
+  expected = g_new (gfloat, WIDTH);
+  actual   = g_new (gfloat, WIDTH);
+
+  for (i = 0; i < 16; i++)
+    {
+      GimpPaintCoreDabFalloff falloff;
+      gdouble                 radius = g_test_rand_double_range (1.0, 500.0);
+      gfloat                  hardness;
+      gint                    x, y;
+
+      /*  include the hardness values that divide by zero  */
+      if (i < 2)
+        hardness = i;
+      else
+        hardness = g_test_rand_double_range (0.0, 1.0);
+
+      falloff.x                = g_test_rand_double_range (0.0, 8192.0);
+      falloff.y                = g_test_rand_double_range (0.0, 8192.0);
+      falloff.aspect_ratio     = g_test_rand_double_range (1.0, 5.0);
+      falloff.sn               = g_test_rand_double_range (-1.0, 1.0);
+      falloff.cs               = g_test_rand_double_range (-1.0, 1.0);
+      falloff.one_over_radius2 = 1.0f / (radius * radius);
+      falloff.hardness         = hardness;
+      falloff.slope1           = -(1.0f / hardness - 1.0f);
+      falloff.slope2           = -hardness / (1.0f - hardness);
+
+      x = falloff.x - WIDTH / 2;
+      y = falloff.y + g_test_rand_double_range (-radius, radius);
+
+      generic->funcs->dab_falloff (&falloff, x, y, WIDTH, expected);
+      test->funcs->dab_falloff    (&falloff, x, y, WIDTH, actual);
+
+      compare_floats ("dab_falloff", expected, actual, WIDTH);
+    }
+
+  g_free (expected);
+  g_free (actual);
+}
+
+/*  runs the row functions the way the brush core and the paint core
+ *  run them for one soft-brush dab of size x size pixels
+ */
+static void
+benchmark_dab (const GimpPaintCoreRowFuncs *funcs,
+               gint                         size,
+               const guint8                *brush,
+               guint32                    **accum,
+               guint8                      *mask,
+               gfloat                      *canvas,
+               gfloat                      *paint)
+{
+  gint dest_size = size + 2;
+  gint y;
+  gint r;
+
+  for (r = 0; r < KERNEL_HEIGHT; r++)
+    memset (accum[r], 0, (dest_size + 1) * sizeof (guint32));
+
+  for (y = 0; y < size; y++)
+    {
+      guint32 *tmp;
+
+      for (r = 0; r < KERNEL_HEIGHT; r++)
+        {
+          funcs->subsample (brush + y * size, accum[r], size,
+                            kernel + r * KERNEL_WIDTH, KERNEL_WIDTH);
+        }
+
+      funcs->subsample_store (accum[0], mask + y * dest_size, dest_size, 127);
+
+      tmp      = accum[0];
+      accum[0] = accum[1];
+      accum[1] = accum[2];
+      accum[2] = tmp;
+
+      memset (accum[2], 0, dest_size * sizeof (guint32));
+    }
+
+  for (y = 0; y < dest_size; y++)
+    {
+      funcs->combine_u8 (canvas + y * dest_size, mask + y * dest_size,
+                         dest_size, 0.8f, FALSE);
+      funcs->mask_alpha_float (paint + 4 * y * dest_size,
+                               canvas + y * dest_size,
+                               dest_size, 1.0f);
+    }
+}
+
+static void
+test_benchmark (gconstpointer data)
+{
+  const BenchmarkTest *benchmark = data;
+  gint                 size      = benchmark->size;
+  gint                 dest_size = size + 2;
+  guint8              *brush;
+  guint32             *accum[KERNEL_HEIGHT];
+  guint8              *mask;
+  gfloat              *canvas;
+  gfloat              *paint;
+  gint                 n_dabs    = 0;
+  gdouble              elapsed;
+  gint                 r;
+
+  if (! accel_supported (benchmark->test->accel))
+    return;
+
+  brush  = random_u8_mask (size * size);
+  mask   = g_new0 (guint8, dest_size * dest_size);
+  canvas = g_new0 (gfloat, dest_size * dest_size);
+  paint  = random_floats (4 * dest_size * dest_size, 0.0, 1.0);
+
+  for (r = 0; r < KERNEL_HEIGHT; r++)
+    accum[r] = g_new0 (guint32, dest_size + 1);
+
+  g_test_timer_start ();
+
+  do
+    {
+      gint i;
+
+      for (i = 0; i < 16; i++)
+        {
+          benchmark_dab (benchmark->test->funcs, size,
+                         brush, accum, mask, canvas, paint);
+        }
+
+      n_dabs += 16;
+    }
+  while ((elapsed = g_test_timer_elapsed ()) < BENCHMARK_SECONDS);
+
+  g_test_maximized_result (n_dabs / elapsed,
+                           "%s, %dx%d brush: %.0f dabs per second",
+                           benchmark->test->name, size, size,
+                           n_dabs / elapsed);
+
+  g_free (brush);
+  g_free (mask);
+  g_free (canvas);
+  g_free (paint);
+
+  for (r = 0; r < KERNEL_HEIGHT; r++)
+    g_free (accum[r]);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /*  the generic functions are the reference, don't compare them to
+   *  themselves
+   */
+  for (i = 1; rows_tests[i].name; i++)
+    {
+      const RowsTest *test = &rows_tests[i];
+      gchar          *path;
+
+      path = g_strdup_printf ("/paint-core-rows/%s/subsample", test->name);
+      g_test_add_data_func (path, test, test_subsample);
+      g_free (path);
+
+      path = g_strdup_printf ("/paint-core-rows/%s/solidify", test->name);
+      g_test_add_data_func (path, test, test_solidify);
+      g_free (path);
+
+      path = g_strdup_printf ("/paint-core-rows/%s/combine", test->name);
+      g_test_add_data_func (path, test, test_combine);
+      g_free (path);
+
+      path = g_strdup_printf ("/paint-core-rows/%s/mask-alpha", test->name);
+      g_test_add_data_func (path, test, test_mask_alpha);
+      g_free (path);
+
+      path = g_strdup_printf ("/paint-core-rows/%s/dab-falloff", test->name);
+      g_test_add_data_func (path, test, test_dab_falloff);
+      g_free (path);
+    }
+
+  if (g_test_perf ())
+    {
+      for (i = 0; rows_tests[i].name; i++)
+        {
+          gint j;
+
+          for (j = 0; j < G_N_ELEMENTS (benchmark_sizes); j++)
+            {
+              BenchmarkTest *benchmark = g_new (BenchmarkTest, 1);
+              gchar         *path;
+
+              benchmark->size = benchmark_sizes[j];
+              benchmark->test = &rows_tests[i];
+
+              path = g_strdup_printf ("/paint-core-rows/benchmark/%s/%d",
+                                      rows_tests[i].name,
+                                      benchmark_sizes[j]);
+              g_test_add_data_func_full (path, benchmark, test_benchmark,
+                                         g_free);
+              g_free (path);
+            }
+        }
+    }
+
+  return g_test_run ();
+}
@@ -57,6 +57,8 @@
 /*  local function prototypes  */
 
 static void gimp_plug_in_handle_quit             (GimpPlugIn      *plug_in);
+static gint gimp_plug_in_get_max_tiles           (GimpPlugIn      *plug_in,
+                                                  const Babl      *format);
 static void gimp_plug_in_handle_tile_request     (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
@@ -65,6 +67,8 @@ static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
+static void gimp_plug_in_handle_proc_run_batch   (GimpPlugIn      *plug_in,
+                                                  GPProcRunBatch  *batch);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
                                                   GPProcReturn    *proc_return);
 static void gimp_plug_in_handle_temp_proc_return (GimpPlugIn      *plug_in,
@@ -76,6 +80,9 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
 static void gimp_plug_in_handle_extension_ack    (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
 
+static GimpValueArray * gimp_plug_in_proc_run    (GimpPlugIn      *plug_in,
+                                                  GPProcRun       *proc_run);
+
 
 /*  public functions  */
 
@@ -160,6 +167,19 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_PROC_RUN_BATCH:
+      gimp_plug_in_handle_proc_run_batch (plug_in, msg->data);
+      break;
+
+    case GP_PROC_RETURN_BATCH:
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a PROC_RETURN_BATCH message.  This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      break;
     }
 }
 
@@ -172,6 +192,24 @@ gimp_plug_in_handle_quit (GimpPlugIn *plug_in)
   gimp_plug_in_close (plug_in, FALSE);
 }
 
+/*  returns the number of tiles of @format that fit into one transfer
+ */
+static gint
+gimp_plug_in_get_max_tiles (GimpPlugIn *plug_in,
+                            const Babl *format)
+{
+  gsize tile_size;
+
+  if (! plug_in->manager->shm)
+    return 1;
+
+  tile_size = (GIMP_PLUG_IN_TILE_WIDTH * GIMP_PLUG_IN_TILE_HEIGHT *
+               babl_format_get_bytes_per_pixel (format));
+
+  return MAX (1, gimp_plug_in_shm_get_size (plug_in->manager->shm) /
+                 tile_size);
+}
+
 static void
 gimp_plug_in_handle_tile_request (GimpPlugIn *plug_in,
                                   GPTileReq  *request)
@@ -194,10 +232,13 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
   GimpDrawable    *drawable;
   GeglBuffer      *buffer;
   const Babl      *format;
-  GeglRectangle    tile_rect;
+  const guchar    *data;
+  gint             bpp;
+  gint             i;
 
   tile_data.drawable_ID = -1;
   tile_data.tile_num    = 0;
+  tile_data.n_tiles     = 0;
   tile_data.shadow      = 0;
   tile_data.bpp         = 0;
   tile_data.width       = 0;
@@ -298,11 +339,17 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       buffer = gimp_drawable_get_buffer (drawable);
     }
 
-  if (! gimp_gegl_buffer_get_tile_rect (buffer,
-                                        GIMP_PLUG_IN_TILE_WIDTH,
-                                        GIMP_PLUG_IN_TILE_HEIGHT,
-                                        tile_info->tile_num,
-                                        &tile_rect))
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  if (tile_info->n_tiles < 1 ||
+      tile_info->n_tiles > gimp_plug_in_get_max_tiles (plug_in, format))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
                     "Plug-in \"%s\"\n(%s)\n\n"
@@ -313,24 +360,37 @@ gimp_plug_in_handle_tile_put (GimpPlugIn *plug_in,
       return;
     }
 
-  format = gegl_buffer_get_format (buffer);
-
-  if (! gimp_plug_in_precision_enabled (plug_in))
-    {
-      format = gimp_babl_compat_u8_format (format);
-    }
-
   if (tile_data.use_shm)
-    {
-      gegl_buffer_set (buffer, &tile_rect, 0, format,
-                       gimp_plug_in_shm_get_addr (plug_in->manager->shm),
-                       GEGL_AUTO_ROWSTRIDE);
-    }
+    data = gimp_plug_in_shm_get_addr (plug_in->manager->shm);
   else
+    data = tile_info->data;
+
+  /*  the tiles are packed one after the other, each one with its
+   *  own effective size
+   */
+  for (i = 0; i < tile_info->n_tiles; i++)
     {
-      gegl_buffer_set (buffer, &tile_rect, 0, format,
-                       tile_info->data,
+      GeglRectangle tile_rect;
+
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            tile_info->tile_num + i,
+                                            &tile_rect))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file));
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      gegl_buffer_set (buffer, &tile_rect, 0, format, data,
                        GEGL_AUTO_ROWSTRIDE);
+
+      data += tile_rect.width * tile_rect.height * bpp;
     }
 
   gimp_wire_destroy (&msg);
@@ -354,7 +414,9 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   GeglBuffer      *buffer;
   const Babl      *format;
   GeglRectangle    tile_rect;
-  gint             tile_size;
+  guchar          *data;
+  gint             bpp;
+  gint             i;
 
   drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
                                                    request->drawable_ID);
@@ -394,7 +456,18 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       buffer = gimp_drawable_get_buffer (drawable);
     }
 
-  if (! gimp_gegl_buffer_get_tile_rect (buffer,
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  if (request->n_tiles < 1 ||
+      request->n_tiles > gimp_plug_in_get_max_tiles (plug_in, format) ||
+      ! gimp_gegl_buffer_get_tile_rect (buffer,
                                         GIMP_PLUG_IN_TILE_WIDTH,
                                         GIMP_PLUG_IN_TILE_HEIGHT,
                                         request->tile_num,
@@ -409,47 +482,66 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
       return;
     }
 
-  format = gegl_buffer_get_format (buffer);
-
-  if (! gimp_plug_in_precision_enabled (plug_in))
-    {
-      format = gimp_babl_compat_u8_format (format);
-    }
-
-  tile_size = (babl_format_get_bytes_per_pixel (format) *
-               tile_rect.width * tile_rect.height);
-
   tile_data.drawable_ID = request->drawable_ID;
   tile_data.tile_num    = request->tile_num;
+  tile_data.n_tiles     = request->n_tiles;
   tile_data.shadow      = request->shadow;
-  tile_data.bpp         = babl_format_get_bytes_per_pixel (format);
+  tile_data.bpp         = bpp;
   tile_data.width       = tile_rect.width;
   tile_data.height      = tile_rect.height;
   tile_data.use_shm     = (plug_in->manager->shm != NULL);
+  tile_data.data        = NULL;
 
   if (tile_data.use_shm)
     {
-      gegl_buffer_get (buffer, &tile_rect, 1.0, format,
-                       gimp_plug_in_shm_get_addr (plug_in->manager->shm),
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      data = gimp_plug_in_shm_get_addr (plug_in->manager->shm);
     }
   else
     {
-      tile_data.data = g_malloc (tile_size);
+      tile_data.data = g_malloc (bpp * tile_rect.width * tile_rect.height);
+
+      data = tile_data.data;
+    }
+
+  /*  pack the requested tiles one after the other, each one with
+   *  its own effective size
+   */
+  for (i = 0; i < request->n_tiles; i++)
+    {
+      if (i > 0 &&
+          ! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            request->tile_num + i,
+                                            &tile_rect))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file));
+          g_free (tile_data.data);
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
 
-      gegl_buffer_get (buffer, &tile_rect, 1.0, format,
-                       tile_data.data,
+      gegl_buffer_get (buffer, &tile_rect, 1.0, format, data,
                        GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      data += tile_rect.width * tile_rect.height * bpp;
     }
 
   if (! gp_tile_data_write (plug_in->my_write, &tile_data, plug_in))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
                     "%s: ERROR", G_STRFUNC);
+      g_free (tile_data.data);
       gimp_plug_in_close (plug_in, TRUE);
       return;
     }
 
+  g_free (tile_data.data);
+
   if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
@@ -507,6 +599,102 @@ gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
 static void
 gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
                               GPProcRun  *proc_run)
+{
+  GimpValueArray *return_vals;
+
+  g_return_if_fail (proc_run != NULL);
+  g_return_if_fail (proc_run->name != NULL);
+
+  return_vals = gimp_plug_in_proc_run (plug_in, proc_run);
+
+  /*  Don't bother to send the return value if executing the procedure
+   *  closed the plug-in (e.g. if the procedure is gimp-quit)
+   */
+  if (plug_in->open)
+    {
+      GPProcReturn proc_return;
+
+      /*  Return the name we got called with, *not* proc_name or canonical,
+       *  since proc_name may have been remapped by gimp->procedural_compat_ht
+       *  and canonical may be different too.
+       */
+      proc_return.name    = proc_run->name;
+      proc_return.nparams = gimp_value_array_length (return_vals);
+      proc_return.params  = plug_in_args_to_params (return_vals, FALSE);
+
+      if (! gp_proc_return_write (plug_in->my_write, &proc_return, plug_in))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+
+      g_free (proc_return.params);
+    }
+
+  gimp_value_array_unref (return_vals);
+}
+
+/*  runs the procedures of a batch in order, as if they had been sent
+ *  one by one, and sends back all their return values at once
+ */
+static void
+gimp_plug_in_handle_proc_run_batch (GimpPlugIn     *plug_in,
+                                    GPProcRunBatch *batch)
+{
+  GPProcReturnBatch   return_batch;
+  GimpValueArray    **return_vals;
+  gint                i;
+
+  g_return_if_fail (batch != NULL);
+
+  return_vals = g_new0 (GimpValueArray *, batch->n_procs);
+
+  return_batch.n_procs = 0;
+  return_batch.procs   = g_new0 (GPProcReturn, batch->n_procs);
+
+  for (i = 0; i < batch->n_procs && plug_in->open; i++)
+    {
+      GPProcRun    *proc_run    = &batch->procs[i];
+      GPProcReturn *proc_return = &return_batch.procs[i];
+
+      if (! proc_run->name)
+        break;
+
+      return_vals[i] = gimp_plug_in_proc_run (plug_in, proc_run);
+
+      /*  see gimp_plug_in_handle_proc_run()  */
+      proc_return->name    = proc_run->name;
+      proc_return->nparams = gimp_value_array_length (return_vals[i]);
+      proc_return->params  = plug_in_args_to_params (return_vals[i], FALSE);
+
+      return_batch.n_procs++;
+    }
+
+  if (plug_in->open)
+    {
+      if (! gp_proc_return_batch_write (plug_in->my_write, &return_batch,
+                                        plug_in))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+        }
+    }
+
+  for (i = 0; i < return_batch.n_procs; i++)
+    {
+      g_free (return_batch.procs[i].params);
+      gimp_value_array_unref (return_vals[i]);
+    }
+
+  g_free (return_batch.procs);
+  g_free (return_vals);
+}
+
+static GimpValueArray *
+gimp_plug_in_proc_run (GimpPlugIn *plug_in,
+                       GPProcRun  *proc_run)
 {
   GimpPlugInProcFrame *proc_frame;
   gchar               *canonical;
@@ -516,9 +704,6 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
   GimpValueArray      *return_vals = NULL;
   GError              *error       = NULL;
 
-  g_return_if_fail (proc_run != NULL);
-  g_return_if_fail (proc_run->name != NULL);
-
   canonical = gimp_canonicalize_identifier (proc_run->name);
 
   proc_frame = gimp_plug_in_get_proc_frame (plug_in);
@@ -608,32 +793,7 @@ gimp_plug_in_handle_proc_run (GimpPlugIn *plug_in,
 
   g_free (canonical);
 
-  /*  Don't bother to send the return value if executing the procedure
-   *  closed the plug-in (e.g. if the procedure is gimp-quit)
-   */
-  if (plug_in->open)
-    {
-      GPProcReturn proc_return;
-
-      /*  Return the name we got called with, *not* proc_name or canonical,
-       *  since proc_name may have been remapped by gimp->procedural_compat_ht
-       *  and canonical may be different too.
-       */
-      proc_return.name    = proc_run->name;
-      proc_return.nparams = gimp_value_array_length (return_vals);
-      proc_return.params  = plug_in_args_to_params (return_vals, FALSE);
-
-      if (! gp_proc_return_write (plug_in->my_write, &proc_return, plug_in))
-        {
-          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
-                        "%s: ERROR", G_STRFUNC);
-          gimp_plug_in_close (plug_in, TRUE);
-        }
-
-      g_free (proc_return.params);
-    }
-
-  gimp_value_array_unref (return_vals);
+  return return_vals;
 }
 
 static void
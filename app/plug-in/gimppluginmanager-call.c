@@ -35,6 +35,7 @@
 #include "config/gimpguiconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpprogress.h"
 
 #include "pdb/gimppdbcontext.h"
@@ -61,32 +62,100 @@ gimp_allow_set_foreground_window (GimpPlugIn *plug_in)
 #endif
 }
 
-/*  public functions  */
-
-void
-gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
-                                 GimpContext       *context,
-                                 GimpPlugInDef     *plug_in_def)
+/*  Spawn the plug-ins of plug_in_defs in call_mode, keeping at most
+ *  n_parallel of them running at the same time.  The messages of all
+ *  running plug-ins are multiplexed here, and handled one at a time,
+ *  so the procedures they call see the same state as if the plug-ins
+ *  ran one after the other.
+ */
+static void
+gimp_plug_in_manager_call_query_or_init (GimpPlugInManager  *manager,
+                                         GimpContext        *context,
+                                         GSList             *plug_in_defs,
+                                         GimpPlugInCallMode  call_mode,
+                                         GFunc               started_func,
+                                         gpointer            user_data)
 {
-  GimpPlugIn *plug_in;
+  GimpPlugIn **plug_ins;
+  GPollFD     *fds;
+  gint         n_parallel;
+  gint         n_running = 0;
+  GSList      *list      = plug_in_defs;
+
+  /*  debug wrappers may want the terminal, don't run them side by side  */
+  if (manager->debug)
+    n_parallel = 1;
+  else
+    n_parallel = MAX (gimp_parallel_get_n_threads (), 1);
+
+  plug_ins = g_new0 (GimpPlugIn *, n_parallel);
+  fds      = g_new0 (GPollFD, n_parallel);
+
+  while (list || n_running > 0)
+    {
+      gint i;
 
-  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
-  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
+      /*  fill the free slots with the next plug-ins  */
+      while (list && n_running < n_parallel)
+        {
+          GimpPlugInDef *plug_in_def = list->data;
+          GimpPlugIn    *plug_in;
 
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->file);
+          list = g_slist_next (list);
 
-  if (plug_in)
-    {
-      plug_in->plug_in_def = plug_in_def;
+          if (started_func)
+            started_func (plug_in_def, user_data);
+
+          plug_in = gimp_plug_in_new (manager, context, NULL,
+                                      NULL, plug_in_def->file);
+
+          if (! plug_in)
+            continue;
+
+          plug_in->plug_in_def = plug_in_def;
+
+          if (! gimp_plug_in_open (plug_in, call_mode, TRUE))
+            {
+              g_object_unref (plug_in);
+              continue;
+            }
 
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_QUERY, TRUE))
+#ifdef G_OS_WIN32
+          g_io_channel_win32_make_pollfd (plug_in->my_read,
+                                          G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                          &fds[n_running]);
+#else
+          fds[n_running].fd     = g_io_channel_unix_get_fd (plug_in->my_read);
+          fds[n_running].events = G_IO_IN | G_IO_HUP | G_IO_ERR;
+#endif
+          fds[n_running].revents = 0;
+
+          plug_ins[n_running++] = plug_in;
+        }
+
+      if (n_running == 0)
+        break;
+
+      /*  a single plug-in doesn't need polling, just block on its pipe  */
+      if (n_running == 1)
+        fds[0].revents = G_IO_IN;
+      else if (g_poll (fds, n_running, -1) < 0)
+        continue;
+
+      for (i = 0; i < n_running; i++)
         {
-          while (plug_in->open)
+          GimpPlugIn *plug_in = plug_ins[i];
+
+          if (fds[i].revents)
             {
               GimpWireMessage msg;
 
+              fds[i].revents = 0;
+
+              /*  the plug-in writes whole messages, so once there is
+               *  data, reading the rest of the message won't block for
+               *  long
+               */
               if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
                 {
                   gimp_plug_in_close (plug_in, TRUE);
@@ -97,50 +166,56 @@ gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
                   gimp_wire_destroy (&msg);
                 }
             }
-        }
 
-      g_object_unref (plug_in);
+          if (! plug_in->open)
+            {
+              g_object_unref (plug_in);
+
+              n_running--;
+
+              plug_ins[i] = plug_ins[n_running];
+              fds[i]      = fds[n_running];
+
+              i--;
+            }
+        }
     }
+
+  g_free (plug_ins);
+  g_free (fds);
 }
 
+
+/*  public functions  */
+
 void
-gimp_plug_in_manager_call_init (GimpPlugInManager *manager,
-                                GimpContext       *context,
-                                GimpPlugInDef     *plug_in_def)
+gimp_plug_in_manager_call_query (GimpPlugInManager *manager,
+                                 GimpContext       *context,
+                                 GSList            *plug_in_defs,
+                                 GFunc              started_func,
+                                 gpointer           user_data)
 {
-  GimpPlugIn *plug_in;
-
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
-  g_return_if_fail (GIMP_IS_PLUG_IN_DEF (plug_in_def));
 
-  plug_in = gimp_plug_in_new (manager, context, NULL,
-                              NULL, plug_in_def->file);
-
-  if (plug_in)
-    {
-      plug_in->plug_in_def = plug_in_def;
-
-      if (gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_INIT, TRUE))
-        {
-          while (plug_in->open)
-            {
-              GimpWireMessage msg;
+  gimp_plug_in_manager_call_query_or_init (manager, context, plug_in_defs,
+                                           GIMP_PLUG_IN_CALL_QUERY,
+                                           started_func, user_data);
+}
 
-              if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
-                {
-                  gimp_plug_in_close (plug_in, TRUE);
-                }
-              else
-                {
-                  gimp_plug_in_handle_message (plug_in, &msg);
-                  gimp_wire_destroy (&msg);
-                }
-            }
-        }
+void
+gimp_plug_in_manager_call_init (GimpPlugInManager *manager,
+                                GimpContext       *context,
+                                GSList            *plug_in_defs,
+                                GFunc              started_func,
+                                gpointer           user_data)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
 
-      g_object_unref (plug_in);
-    }
+  gimp_plug_in_manager_call_query_or_init (manager, context, plug_in_defs,
+                                           GIMP_PLUG_IN_CALL_INIT,
+                                           started_func, user_data);
 }
 
 GimpValueArray *
@@ -206,7 +281,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
                                  gui_config->show_help_button);
       config.use_cpu_accel    = manager->gimp->use_cpu_accel;
       config.use_opencl       = gegl_config->use_opencl;
-      config.gimp_reserved_6  = 0;
+      config.shm_n_tiles      = (manager->shm ?
+                                 GIMP_PLUG_IN_SHM_N_TILES : 0);
       config.gimp_reserved_7  = 0;
       config.gimp_reserved_8  = 0;
       config.install_cmap     = FALSE;
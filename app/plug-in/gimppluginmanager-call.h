@@ -25,17 +25,22 @@
 #endif
 
 
-/*  Call the plug-in's query() function
+/*  Call the query() functions of a list of plug-ins, several at a time;
+ *  started_func is called with each plug-in def before it is spawned
  */
 void             gimp_plug_in_manager_call_query    (GimpPlugInManager      *manager,
                                                      GimpContext            *context,
-                                                     GimpPlugInDef          *plug_in_def);
+                                                     GSList                 *plug_in_defs,
+                                                     GFunc                   started_func,
+                                                     gpointer                user_data);
 
-/*  Call the plug-in's init() function
+/*  Call the init() functions of a list of plug-ins, several at a time
  */
 void             gimp_plug_in_manager_call_init     (GimpPlugInManager      *manager,
                                                      GimpContext            *context,
-                                                     GimpPlugInDef          *plug_in_def);
+                                                     GSList                 *plug_in_defs,
+                                                     GFunc                   started_func,
+                                                     gpointer                user_data);
 
 /*  Run a plug-in as if it were a procedure database procedure
  */
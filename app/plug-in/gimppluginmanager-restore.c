@@ -47,18 +47,33 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
 
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpInitStatusFunc  status_callback;
+  gint                nth;
+  gint                n_plugins;
+  gboolean            be_verbose;
+  const gchar        *verbose_action;
+} GimpPlugInCallStatus;
+
+
 static void    gimp_plug_in_manager_search            (GimpPlugInManager    *manager,
                                                        GimpInitStatusFunc    status_callback);
 static void    gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
                                                        GFile                *directory);
 static GFile * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
+static GFile * gimp_plug_in_manager_get_rc_cache      (GFile                *pluginrc);
+static gboolean gimp_plug_in_manager_read_pluginrc    (GimpPlugInManager    *manager,
                                                        GFile                *file,
+                                                       GFile                *cache,
                                                        GimpInitStatusFunc    status_callback);
+static void    gimp_plug_in_manager_call_started      (GimpPlugInDef        *plug_in_def,
+                                                       GimpPlugInCallStatus *status);
 static void    gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
                                                        GimpContext          *context,
                                                        GimpInitStatusFunc    status_callback);
@@ -89,10 +104,12 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                               GimpContext        *context,
                               GimpInitStatusFunc  status_callback)
 {
-  Gimp   *gimp;
-  GFile  *pluginrc;
-  GSList *list;
-  GError *error = NULL;
+  Gimp     *gimp;
+  GFile    *pluginrc;
+  GFile    *cache;
+  gboolean  cache_valid;
+  GSList   *list;
+  GError   *error = NULL;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -108,8 +125,10 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 
   /* read the pluginrc file for cached data */
   pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  cache    = gimp_plug_in_manager_get_rc_cache (pluginrc);
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  cache_valid = gimp_plug_in_manager_read_pluginrc (manager, pluginrc, cache,
+                                                    status_callback);
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -135,7 +154,11 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
       if (gimp->be_verbose)
         g_print ("Writing '%s'\n", gimp_file_get_utf8_name (pluginrc));
 
-      if (! plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+      if (plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+        {
+          cache_valid = FALSE;
+        }
+      else
         {
           gimp_message_literal (gimp,
                                 NULL, GIMP_MESSAGE_ERROR, error->message);
@@ -145,6 +168,23 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
       manager->write_pluginrc = FALSE;
     }
 
+  /* (re)create the binary cache of pluginrc, failing is harmless here */
+  if (! cache_valid && manager->plug_in_defs)
+    {
+      if (gimp->be_verbose)
+        g_print ("Writing '%s'\n", gimp_file_get_utf8_name (cache));
+
+      if (! plug_in_rc_cache_write (manager->plug_in_defs, cache, pluginrc,
+                                    &error))
+        {
+          if (gimp->be_verbose)
+            g_print ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+
+  g_object_unref (cache);
   g_object_unref (pluginrc);
 
   /* create locale and help domain lists */
@@ -383,22 +423,65 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
-/* read the pluginrc file for cached data */
-static void
+/* the binary copy of pluginrc lives next to it */
+static GFile *
+gimp_plug_in_manager_get_rc_cache (GFile *pluginrc)
+{
+  GFile *parent   = g_file_get_parent (pluginrc);
+  gchar *basename = g_file_get_basename (pluginrc);
+  gchar *name     = g_strconcat (basename, ".cache", NULL);
+  GFile *cache;
+
+  cache = g_file_get_child (parent, name);
+
+  g_free (name);
+  g_free (basename);
+  g_object_unref (parent);
+
+  return cache;
+}
+
+/* read the pluginrc file for cached data, returns TRUE if it could be
+ * loaded from its binary cache
+ */
+static gboolean
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
                                     GFile              *pluginrc,
+                                    GFile              *cache,
                                     GimpInitStatusFunc  status_callback)
 {
-  GSList *rc_defs;
-  GError *error = NULL;
+  GSList   *rc_defs;
+  gboolean  from_cache = FALSE;
+  GError   *error      = NULL;
 
   status_callback (_("Resource configuration"),
                    gimp_file_get_utf8_name (pluginrc), 0.0);
 
   if (manager->gimp->be_verbose)
-    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (cache));
+
+  rc_defs = plug_in_rc_cache_parse (manager->gimp, cache, pluginrc, &error);
+
+  if (rc_defs)
+    {
+      from_cache = TRUE;
+    }
+  else
+    {
+      if (error)
+        {
+          if (manager->gimp->be_verbose &&
+              error->code != GIMP_CONFIG_ERROR_OPEN_ENOENT)
+            g_print ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+
+      rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+    }
 
   if (rc_defs)
     {
@@ -417,6 +500,25 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
 
       g_clear_error (&error);
     }
+
+  return from_cache;
+}
+
+/* report a plug-in being queried or initialized */
+static void
+gimp_plug_in_manager_call_started (GimpPlugInDef        *plug_in_def,
+                                   GimpPlugInCallStatus *status)
+{
+  gchar *basename;
+
+  basename = g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
+  status->status_callback (NULL, basename,
+                           (gdouble) status->nth++ / (gdouble) status->n_plugins);
+  g_free (basename);
+
+  if (status->be_verbose)
+    g_print ("%s plug-in: '%s'\n", status->verbose_action,
+             gimp_file_get_utf8_name (plug_in_def->file));
 }
 
 /* query any plug-ins that changed since we last wrote out pluginrc */
@@ -426,45 +528,37 @@ gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
                                 GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GSList *query_defs = NULL;
 
   status_callback (_("Querying new Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->needs_query)
-        n_plugins++;
+        query_defs = g_slist_prepend (query_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (query_defs)
     {
-      gint nth;
-
-      manager->write_pluginrc = TRUE;
+      GimpPlugInCallStatus status;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
+      status.status_callback = status_callback;
+      status.nth             = 0;
+      status.n_plugins       = g_slist_length (query_defs);
+      status.be_verbose      = manager->gimp->be_verbose;
+      status.verbose_action  = "Querying";
 
-          if (plug_in_def->needs_query)
-            {
-              gchar *basename;
+      manager->write_pluginrc = TRUE;
 
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      query_defs = g_slist_reverse (query_defs);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
+      gimp_plug_in_manager_call_query (manager, context, query_defs,
+                                       (GFunc) gimp_plug_in_manager_call_started,
+                                       &status);
 
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (query_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -477,43 +571,35 @@ gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
                                     GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GSList *init_defs = NULL;
 
   status_callback (_("Initializing Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->has_init)
-        n_plugins++;
+        init_defs = g_slist_prepend (init_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (init_defs)
     {
-      gint nth;
-
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
+      GimpPlugInCallStatus status;
 
-          if (plug_in_def->has_init)
-            {
-              gchar *basename;
+      status.status_callback = status_callback;
+      status.nth             = 0;
+      status.n_plugins       = g_slist_length (init_defs);
+      status.be_verbose      = manager->gimp->be_verbose;
+      status.verbose_action  = "Initializing";
 
-              basename =
-                g_path_get_basename (gimp_file_get_utf8_name (plug_in_def->file));
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      init_defs = g_slist_reverse (init_defs);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Initializing plug-in: '%s'\n",
-                         gimp_file_get_utf8_name (plug_in_def->file));
+      gimp_plug_in_manager_call_init (manager, context, init_defs,
+                                      (GFunc) gimp_plug_in_manager_call_started,
+                                      &status);
 
-              gimp_plug_in_manager_call_init (manager, context, plug_in_def);
-            }
-        }
+      g_slist_free (init_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -21,11 +21,19 @@
 #define __GIMP_PLUG_IN_SHM_H__
 
 
+/*  the size of the shared memory segment, in tiles of the largest
+ *  possible pixel size.  passed to plug-ins as GPConfig.shm_n_tiles,
+ *  so they can transfer as many tiles per request as fit.
+ */
+#define GIMP_PLUG_IN_SHM_N_TILES 4
+
+
 GimpPlugInShm * gimp_plug_in_shm_new      (void);
 void            gimp_plug_in_shm_free     (GimpPlugInShm *shm);
 
 gint            gimp_plug_in_shm_get_ID   (GimpPlugInShm *shm);
 guchar        * gimp_plug_in_shm_get_addr (GimpPlugInShm *shm);
+gsize           gimp_plug_in_shm_get_size (GimpPlugInShm *shm);
 
 
 #endif /* __GIMP_PLUG_IN_SHM_H__ */
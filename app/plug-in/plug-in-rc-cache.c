@@ -0,0 +1,737 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-cache.h"
+
+#include "gimp-intl.h"
+
+
+/*  The cache is a flat, little-endian dump of the plug-in defs, in the
+ *  same order and with the same content as pluginrc.  Strings are stored
+ *  as a 32 bit length followed by the bytes, G_MAXUINT32 meaning NULL.
+ *  Bump the version whenever the layout changes.
+ */
+
+#define PLUG_IN_RC_CACHE_MAGIC   "GIMPPRC"
+#define PLUG_IN_RC_CACHE_VERSION 1
+#define PLUG_IN_RC_CACHE_NULL    G_MAXUINT32
+
+
+typedef struct
+{
+  const guint8 *data;
+  gsize         size;
+  gsize         offset;
+  gboolean      failed;
+} PlugInRcCacheReader;
+
+
+static gboolean        plug_in_rc_cache_get_stamp    (GFile               *pluginrc,
+                                                      guint64             *mtime,
+                                                      guint64             *size);
+
+static GimpPlugInDef * plug_in_rc_cache_read_def     (PlugInRcCacheReader *reader,
+                                                      Gimp                *gimp);
+static void            plug_in_rc_cache_read_proc    (PlugInRcCacheReader *reader,
+                                                      Gimp                *gimp,
+                                                      GimpPlugInDef       *plug_in_def);
+
+static const guint8  * plug_in_rc_cache_read         (PlugInRcCacheReader *reader,
+                                                      gsize                size);
+static guint32         plug_in_rc_cache_read_uint32  (PlugInRcCacheReader *reader);
+static guint64         plug_in_rc_cache_read_uint64  (PlugInRcCacheReader *reader);
+static guint8        * plug_in_rc_cache_read_data    (PlugInRcCacheReader *reader,
+                                                      gint                *length);
+static gchar         * plug_in_rc_cache_read_string  (PlugInRcCacheReader *reader);
+
+static void            plug_in_rc_cache_write_uint32 (GByteArray          *array,
+                                                      guint32              value);
+static void            plug_in_rc_cache_write_uint64 (GByteArray          *array,
+                                                      guint64              value);
+static void            plug_in_rc_cache_write_data   (GByteArray          *array,
+                                                      const guint8        *data,
+                                                      gint                 length);
+static void            plug_in_rc_cache_write_string (GByteArray          *array,
+                                                      const gchar         *string);
+static void            plug_in_rc_cache_write_proc   (GByteArray          *array,
+                                                      GimpPlugInProcedure *proc);
+
+
+GSList *
+plug_in_rc_cache_parse (Gimp    *gimp,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  PlugInRcCacheReader  reader = { 0, };
+  GSList              *plug_in_defs = NULL;
+  gchar               *contents;
+  gsize                length;
+  guint64              rc_mtime;
+  guint64              rc_size;
+  guint32              n_defs;
+  guint32              i;
+  GError              *my_error = NULL;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! g_file_load_contents (file, NULL, &contents, &length, NULL,
+                              &my_error))
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR,
+                   g_error_matches (my_error,
+                                    G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ?
+                   GIMP_CONFIG_ERROR_OPEN_ENOENT : GIMP_CONFIG_ERROR_OPEN,
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_file_get_utf8_name (file), my_error->message);
+      g_clear_error (&my_error);
+
+      return NULL;
+    }
+
+  reader.data = (const guint8 *) contents;
+  reader.size = length;
+
+  if (length < strlen (PLUG_IN_RC_CACHE_MAGIC) + 1                     ||
+      memcmp (plug_in_rc_cache_read (&reader,
+                                     strlen (PLUG_IN_RC_CACHE_MAGIC) + 1),
+              PLUG_IN_RC_CACHE_MAGIC, strlen (PLUG_IN_RC_CACHE_MAGIC) + 1) ||
+      plug_in_rc_cache_read_uint32 (&reader) != PLUG_IN_RC_CACHE_VERSION ||
+      plug_in_rc_cache_read_uint32 (&reader) != GIMP_PROTOCOL_VERSION)
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': wrong pluginrc cache format version."),
+                   gimp_file_get_utf8_name (file));
+      g_free (contents);
+
+      return NULL;
+    }
+
+  rc_mtime = plug_in_rc_cache_read_uint64 (&reader);
+  rc_size  = plug_in_rc_cache_read_uint64 (&reader);
+
+  /*  only use the cache if pluginrc wasn't touched since it was written  */
+  if (! plug_in_rc_cache_get_stamp (pluginrc, &rc_mtime, &rc_size))
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': it is out of date."),
+                   gimp_file_get_utf8_name (file));
+      g_free (contents);
+
+      return NULL;
+    }
+
+  n_defs = plug_in_rc_cache_read_uint32 (&reader);
+
+  for (i = 0; i < n_defs && ! reader.failed; i++)
+    {
+      GimpPlugInDef *plug_in_def = plug_in_rc_cache_read_def (&reader, gimp);
+
+      if (plug_in_def)
+        plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  if (reader.failed || reader.offset != reader.size)
+    {
+      g_set_error (error,
+                   GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   _("Skipping '%s': the file is corrupt."),
+                   gimp_file_get_utf8_name (file));
+
+      g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+      plug_in_defs = NULL;
+    }
+
+  g_free (contents);
+
+  return g_slist_reverse (plug_in_defs);
+}
+
+gboolean
+plug_in_rc_cache_write (GSList  *plug_in_defs,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  GByteArray *array;
+  GSList     *list;
+  guint64     rc_mtime;
+  guint64     rc_size;
+  guint       n_defs_offset;
+  guint32     n_defs = 0;
+  gboolean    success;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  rc_mtime = 0;
+  rc_size  = 0;
+
+  /*  only fetch pluginrc's stamp, there is nothing to compare yet  */
+  plug_in_rc_cache_get_stamp (pluginrc, &rc_mtime, &rc_size);
+
+  array = g_byte_array_new ();
+
+  g_byte_array_append (array, (const guint8 *) PLUG_IN_RC_CACHE_MAGIC,
+                       strlen (PLUG_IN_RC_CACHE_MAGIC) + 1);
+  plug_in_rc_cache_write_uint32 (array, PLUG_IN_RC_CACHE_VERSION);
+  plug_in_rc_cache_write_uint32 (array, GIMP_PROTOCOL_VERSION);
+  plug_in_rc_cache_write_uint64 (array, rc_mtime);
+  plug_in_rc_cache_write_uint64 (array, rc_size);
+
+  n_defs_offset = array->len;
+  plug_in_rc_cache_write_uint32 (array, 0);
+
+  for (list = plug_in_defs; list; list = list->next)
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+      GSList        *list2;
+      gchar         *path;
+      guint          n_procs_offset;
+      guint32        n_procs = 0;
+
+      /*  skip the same plug-in defs as plug_in_rc_write()  */
+      if (! plug_in_def->procedures)
+        continue;
+
+      path = gimp_file_get_config_path (plug_in_def->file, NULL);
+      if (! path)
+        continue;
+
+      plug_in_rc_cache_write_string (array, path);
+      plug_in_rc_cache_write_uint64 (array, plug_in_def->mtime);
+      g_free (path);
+
+      n_procs_offset = array->len;
+      plug_in_rc_cache_write_uint32 (array, 0);
+
+      for (list2 = plug_in_def->procedures; list2; list2 = list2->next)
+        {
+          GimpPlugInProcedure *proc = list2->data;
+
+          if (proc->installed_during_init)
+            continue;
+
+          plug_in_rc_cache_write_proc (array, proc);
+          n_procs++;
+        }
+
+      n_procs = GUINT32_TO_LE (n_procs);
+      memcpy (array->data + n_procs_offset, &n_procs, sizeof (n_procs));
+
+      plug_in_rc_cache_write_string (array, plug_in_def->locale_domain_name);
+      plug_in_rc_cache_write_string (array, plug_in_def->locale_domain_path);
+      plug_in_rc_cache_write_string (array, plug_in_def->help_domain_name);
+      plug_in_rc_cache_write_string (array, plug_in_def->help_domain_uri);
+      plug_in_rc_cache_write_uint32 (array, plug_in_def->has_init);
+
+      n_defs++;
+    }
+
+  n_defs = GUINT32_TO_LE (n_defs);
+  memcpy (array->data + n_defs_offset, &n_defs, sizeof (n_defs));
+
+  success = g_file_replace_contents (file,
+                                     (const gchar *) array->data, array->len,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, error);
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+/*  stores pluginrc's modification time and size in mtime and size, and
+ *  returns whether they were the same as the passed values
+ */
+static gboolean
+plug_in_rc_cache_get_stamp (GFile   *pluginrc,
+                            guint64 *mtime,
+                            guint64 *size)
+{
+  GFileInfo *info;
+  guint64    file_mtime;
+  guint64    file_size;
+  gboolean   match;
+
+  info = g_file_query_info (pluginrc,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, NULL);
+
+  if (! info)
+    return FALSE;
+
+  file_mtime = (g_file_info_get_attribute_uint64 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+                G_USEC_PER_SEC +
+                g_file_info_get_attribute_uint32 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC));
+  file_size  = g_file_info_get_size (info);
+
+  g_object_unref (info);
+
+  match = (file_mtime == *mtime && file_size == *size);
+
+  *mtime = file_mtime;
+  *size  = file_size;
+
+  return match;
+}
+
+static GimpPlugInDef *
+plug_in_rc_cache_read_def (PlugInRcCacheReader *reader,
+                           Gimp                *gimp)
+{
+  GimpPlugInDef *plug_in_def;
+  GFile         *file;
+  gchar         *path;
+  gchar         *domain_name;
+  gchar         *domain_path;
+  guint32        n_procs;
+  guint32        i;
+
+  path = plug_in_rc_cache_read_string (reader);
+  if (! path)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  file = gimp_file_new_for_config_path (path, NULL);
+  g_free (path);
+
+  if (! file)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (file);
+  g_object_unref (file);
+
+  plug_in_def->mtime = plug_in_rc_cache_read_uint64 (reader);
+
+  n_procs = plug_in_rc_cache_read_uint32 (reader);
+
+  for (i = 0; i < n_procs && ! reader->failed; i++)
+    plug_in_rc_cache_read_proc (reader, gimp, plug_in_def);
+
+  domain_name = plug_in_rc_cache_read_string (reader);
+  domain_path = plug_in_rc_cache_read_string (reader);
+
+  if (domain_name)
+    gimp_plug_in_def_set_locale_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  domain_name = plug_in_rc_cache_read_string (reader);
+  domain_path = plug_in_rc_cache_read_string (reader);
+
+  if (domain_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  if (plug_in_rc_cache_read_uint32 (reader))
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  if (reader->failed)
+    {
+      g_object_unref (plug_in_def);
+      return NULL;
+    }
+
+  return plug_in_def;
+}
+
+static void
+plug_in_rc_cache_read_proc (PlugInRcCacheReader *reader,
+                            Gimp                *gimp,
+                            GimpPlugInDef       *plug_in_def)
+{
+  GimpPlugInProcedure *proc;
+  GimpProcedure       *procedure;
+  gchar               *name;
+  gchar               *str;
+  GimpPDBProcType      proc_type;
+  GimpIconType         icon_type;
+  guint8              *icon_data;
+  gint                 icon_data_length;
+  guint32              n_menu_paths;
+  guint32              n_args;
+  guint32              n_return_vals;
+  guint32              i;
+
+  name      = plug_in_rc_cache_read_string (reader);
+  proc_type = plug_in_rc_cache_read_uint32 (reader);
+
+  if (! name || reader->failed)
+    {
+      g_free (name);
+      reader->failed = TRUE;
+      return;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, plug_in_def->file);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_take_name (GIMP_OBJECT (procedure),
+                         gimp_canonicalize_identifier (name));
+
+  procedure->original_name = name;
+
+  procedure->blurb     = plug_in_rc_cache_read_string (reader);
+  procedure->help      = plug_in_rc_cache_read_string (reader);
+  procedure->author    = plug_in_rc_cache_read_string (reader);
+  procedure->copyright = plug_in_rc_cache_read_string (reader);
+  procedure->date      = plug_in_rc_cache_read_string (reader);
+  proc->menu_label     = plug_in_rc_cache_read_string (reader);
+
+  n_menu_paths = plug_in_rc_cache_read_uint32 (reader);
+
+  for (i = 0; i < n_menu_paths && ! reader->failed; i++)
+    {
+      gchar *menu_path = plug_in_rc_cache_read_string (reader);
+
+      if (menu_path)
+        proc->menu_paths = g_list_append (proc->menu_paths, menu_path);
+    }
+
+  icon_type = plug_in_rc_cache_read_uint32 (reader);
+
+  switch (icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      icon_data_length = -1;
+      icon_data        = (guint8 *) plug_in_rc_cache_read_string (reader);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      icon_data = plug_in_rc_cache_read_data (reader, &icon_data_length);
+      break;
+
+    default:
+      reader->failed = TRUE;
+      g_object_unref (procedure);
+      return;
+    }
+
+  gimp_plug_in_procedure_take_icon (proc, icon_type,
+                                    icon_data, icon_data_length);
+
+  if (plug_in_rc_cache_read_uint32 (reader))
+    {
+      proc->file_proc  = TRUE;
+      proc->extensions = plug_in_rc_cache_read_string (reader);
+      proc->prefixes   = plug_in_rc_cache_read_string (reader);
+      proc->magics     = plug_in_rc_cache_read_string (reader);
+
+      str = plug_in_rc_cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_mime_types (proc, str);
+      g_free (str);
+
+      if (plug_in_rc_cache_read_uint32 (reader))
+        gimp_plug_in_procedure_set_handles_uri (proc);
+
+      if (plug_in_rc_cache_read_uint32 (reader))
+        gimp_plug_in_procedure_set_handles_raw (proc);
+
+      str = plug_in_rc_cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_thumb_loader (proc, str);
+      g_free (str);
+    }
+
+  str = plug_in_rc_cache_read_string (reader);
+  gimp_plug_in_procedure_set_image_types (proc, str);
+  g_free (str);
+
+  n_args        = plug_in_rc_cache_read_uint32 (reader);
+  n_return_vals = plug_in_rc_cache_read_uint32 (reader);
+
+  for (i = 0; i < n_args + n_return_vals && ! reader->failed; i++)
+    {
+      GParamSpec *pspec;
+      gint        arg_type;
+      gchar      *arg_name;
+      gchar      *arg_desc;
+
+      arg_type = plug_in_rc_cache_read_uint32 (reader);
+      arg_name = plug_in_rc_cache_read_string (reader);
+      arg_desc = plug_in_rc_cache_read_string (reader);
+
+      if (! reader->failed)
+        {
+          pspec = gimp_pdb_compat_param_spec (gimp, arg_type,
+                                              arg_name, arg_desc);
+
+          if (i < n_args)
+            gimp_procedure_add_argument (procedure, pspec);
+          else
+            gimp_procedure_add_return_value (procedure, pspec);
+        }
+
+      g_free (arg_name);
+      g_free (arg_desc);
+    }
+
+  if (! reader->failed)
+    gimp_plug_in_def_add_procedure (plug_in_def, proc);
+
+  g_object_unref (procedure);
+}
+
+static const guint8 *
+plug_in_rc_cache_read (PlugInRcCacheReader *reader,
+                       gsize                size)
+{
+  const guint8 *data;
+
+  if (reader->failed || size > reader->size - reader->offset)
+    {
+      reader->failed = TRUE;
+      return NULL;
+    }
+
+  data = reader->data + reader->offset;
+
+  reader->offset += size;
+
+  return data;
+}
+
+static guint32
+plug_in_rc_cache_read_uint32 (PlugInRcCacheReader *reader)
+{
+  const guint8 *data = plug_in_rc_cache_read (reader, sizeof (guint32));
+  guint32       value;
+
+  if (! data)
+    return 0;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static guint64
+plug_in_rc_cache_read_uint64 (PlugInRcCacheReader *reader)
+{
+  const guint8 *data = plug_in_rc_cache_read (reader, sizeof (guint64));
+  guint64       value;
+
+  if (! data)
+    return 0;
+
+  memcpy (&value, data, sizeof (value));
+
+  return GUINT64_FROM_LE (value);
+}
+
+static guint8 *
+plug_in_rc_cache_read_data (PlugInRcCacheReader *reader,
+                            gint                *length)
+{
+  const guint8 *data;
+  guint32       size;
+
+  *length = -1;
+
+  size = plug_in_rc_cache_read_uint32 (reader);
+
+  if (size == PLUG_IN_RC_CACHE_NULL || reader->failed)
+    return NULL;
+
+  data = plug_in_rc_cache_read (reader, size);
+
+  if (! data)
+    return NULL;
+
+  *length = size;
+
+  /*  binary data, like inline pixbufs, may contain nul bytes  */
+  return g_memdup (data, size);
+}
+
+static gchar *
+plug_in_rc_cache_read_string (PlugInRcCacheReader *reader)
+{
+  const guint8 *data;
+  guint32       size;
+
+  size = plug_in_rc_cache_read_uint32 (reader);
+
+  if (size == PLUG_IN_RC_CACHE_NULL || reader->failed)
+    return NULL;
+
+  data = plug_in_rc_cache_read (reader, size);
+
+  /*  pluginrc turns empty strings into NULL, so does the cache  */
+  if (! data || size == 0)
+    return NULL;
+
+  return g_strndup ((const gchar *) data, size);
+}
+
+static void
+plug_in_rc_cache_write_uint32 (GByteArray *array,
+                               guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+plug_in_rc_cache_write_uint64 (GByteArray *array,
+                               guint64     value)
+{
+  value = GUINT64_TO_LE (value);
+
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+plug_in_rc_cache_write_data (GByteArray   *array,
+                             const guint8 *data,
+                             gint          length)
+{
+  if (! data || length < 0)
+    {
+      plug_in_rc_cache_write_uint32 (array, PLUG_IN_RC_CACHE_NULL);
+      return;
+    }
+
+  plug_in_rc_cache_write_uint32 (array, length);
+  g_byte_array_append (array, data, length);
+}
+
+static void
+plug_in_rc_cache_write_string (GByteArray  *array,
+                               const gchar *string)
+{
+  plug_in_rc_cache_write_data (array, (const guint8 *) string,
+                               string ? strlen (string) : -1);
+}
+
+static void
+plug_in_rc_cache_write_proc (GByteArray          *array,
+                             GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  gint           i;
+
+  plug_in_rc_cache_write_string (array, procedure->original_name);
+  plug_in_rc_cache_write_uint32 (array, procedure->proc_type);
+  plug_in_rc_cache_write_string (array, procedure->blurb);
+  plug_in_rc_cache_write_string (array, procedure->help);
+  plug_in_rc_cache_write_string (array, procedure->author);
+  plug_in_rc_cache_write_string (array, procedure->copyright);
+  plug_in_rc_cache_write_string (array, procedure->date);
+  plug_in_rc_cache_write_string (array, proc->menu_label);
+
+  plug_in_rc_cache_write_uint32 (array, g_list_length (proc->menu_paths));
+  for (list = proc->menu_paths; list; list = list->next)
+    plug_in_rc_cache_write_string (array, list->data);
+
+  plug_in_rc_cache_write_uint32 (array, proc->icon_type);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      plug_in_rc_cache_write_string (array, (gchar *) proc->icon_data);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      plug_in_rc_cache_write_data (array, proc->icon_data,
+                                   proc->icon_data_length);
+      break;
+    }
+
+  plug_in_rc_cache_write_uint32 (array, proc->file_proc);
+
+  if (proc->file_proc)
+    {
+      plug_in_rc_cache_write_string (array, proc->extensions);
+      plug_in_rc_cache_write_string (array, proc->prefixes);
+      plug_in_rc_cache_write_string (array, proc->magics);
+      plug_in_rc_cache_write_string (array, proc->mime_types);
+      plug_in_rc_cache_write_uint32 (array, proc->handles_uri);
+      plug_in_rc_cache_write_uint32 (array,
+                                     proc->handles_raw && ! proc->image_types);
+      plug_in_rc_cache_write_string (array, proc->thumb_loader);
+    }
+
+  plug_in_rc_cache_write_string (array, proc->image_types);
+
+  plug_in_rc_cache_write_uint32 (array, procedure->num_args);
+  plug_in_rc_cache_write_uint32 (array, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args + procedure->num_values; i++)
+    {
+      GParamSpec *pspec;
+
+      if (i < procedure->num_args)
+        pspec = procedure->args[i];
+      else
+        pspec = procedure->values[i - procedure->num_args];
+
+      plug_in_rc_cache_write_uint32 (array,
+                                     gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_name (pspec));
+      plug_in_rc_cache_write_string (array, g_param_spec_get_blurb (pspec));
+    }
+}
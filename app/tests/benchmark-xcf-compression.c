@@ -0,0 +1,268 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the XCF tile compression modes on real images: every image
+ * given on the command line is saved to memory and loaded back with
+ * each mode, and the best save and load times of several runs are
+ * reported together with the size of the saved file.
+ *
+ *   make benchmark-xcf-compression
+ *   ./benchmark-xcf-compression [--runs=N] image.xcf photo.png ...
+ *
+ * Any file GIMP can open is accepted, loading files other than XCF
+ * needs GIMP_TESTING_PLUGINDIRS to point at the file plug-ins.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "core/core-types.h"
+
+#include "config/gimpcoreconfig.h"
+
+#include "core/gimp.h"
+#include "core/gimpimage.h"
+
+#include "plug-in/gimppluginmanager-file.h"
+
+#include "file/file-open.h"
+
+#include "xcf/xcf.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+typedef struct
+{
+  const gchar *name;
+  gboolean     compression;
+  gboolean     fast_compression;
+} CompressionMode;
+
+
+static const CompressionMode modes[] =
+{
+  { "RLE",  FALSE, FALSE },
+  { "zlib", TRUE,  FALSE },
+#ifdef HAVE_ZSTD
+  { "zstd", TRUE,  TRUE  }
+#endif
+};
+
+static gint runs = 3;
+
+static const GOptionEntry entries[] =
+{
+  { "runs", 0, 0, G_OPTION_ARG_INT, &runs,
+    "Number of runs per image and mode, the best time is reported", "N" },
+  { NULL }
+};
+
+
+static GimpImage *
+benchmark_open_image (Gimp   *gimp,
+                      GFile  *file,
+                      GError **error)
+{
+  GimpPlugInProcedure *proc;
+  GimpPDBStatusType    status;
+
+  proc = gimp_plug_in_manager_file_procedure_find (gimp->plug_in_manager,
+                                                   GIMP_FILE_PROCEDURE_GROUP_OPEN,
+                                                   file, error);
+  if (! proc)
+    return NULL;
+
+  return file_open_image (gimp, gimp_get_user_context (gimp), NULL,
+                          file, file, FALSE, proc,
+                          GIMP_RUN_NONINTERACTIVE, &status, NULL, error);
+}
+
+static gboolean
+benchmark_mode (Gimp                  *gimp,
+                GimpImage             *image,
+                const CompressionMode *mode,
+                gdouble               *save_time,
+                gdouble               *load_time,
+                gsize                 *size,
+                GError               **error)
+{
+  GTimer *timer = g_timer_new ();
+  gint    run;
+
+  g_object_set (gimp->config,
+                "xcf-fast-compression", mode->fast_compression,
+                NULL);
+  gimp_image_set_xcf_compression (image, mode->compression);
+
+  *save_time = G_MAXDOUBLE;
+  *load_time = G_MAXDOUBLE;
+
+  for (run = 0; run < runs; run++)
+    {
+      GOutputStream *output;
+      GInputStream  *input;
+      GimpImage     *loaded;
+      gboolean       success;
+
+      output = g_memory_output_stream_new_resizable ();
+
+      g_timer_start (timer);
+      success = xcf_save_stream (gimp, image, output, NULL, NULL, error);
+      g_timer_stop (timer);
+
+      *save_time = MIN (*save_time, g_timer_elapsed (timer, NULL));
+
+      g_output_stream_close (output, NULL, NULL);
+
+      if (! success)
+        {
+          g_object_unref (output);
+          g_timer_destroy (timer);
+          return FALSE;
+        }
+
+      *size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (output));
+
+      input = g_memory_input_stream_new_from_data (
+        g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (output)),
+        *size, NULL);
+
+      g_timer_start (timer);
+      loaded = xcf_load_stream (gimp, input, NULL, NULL, error);
+      g_timer_stop (timer);
+
+      *load_time = MIN (*load_time, g_timer_elapsed (timer, NULL));
+
+      g_object_unref (input);
+      g_object_unref (output);
+
+      if (! loaded)
+        {
+          g_timer_destroy (timer);
+          return FALSE;
+        }
+
+      g_object_unref (loaded);
+    }
+
+  g_timer_destroy (timer);
+
+  return TRUE;
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  Gimp           *gimp;
+  GError         *error  = NULL;
+  gint            result = EXIT_SUCCESS;
+  gint            i;
+
+  context = g_option_context_new ("IMAGE...");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error) ||
+      argc < 2 || runs < 1)
+    {
+      g_printerr ("%s\n", error ? error->message :
+                  "Usage: benchmark-xcf-compression [--runs=N] IMAGE...");
+      g_clear_error (&error);
+      g_option_context_free (context);
+
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  g_print ("%-32s %-5s %12s %8s %10s %10s\n",
+           "image", "mode", "bytes", "ratio", "save (s)", "load (s)");
+
+  for (i = 1; i < argc; i++)
+    {
+      GFile     *file  = g_file_new_for_commandline_arg (argv[i]);
+      GimpImage *image;
+      gchar     *basename;
+      gsize      raw_size;
+      gint       m;
+
+      basename = g_file_get_basename (file);
+
+      image = benchmark_open_image (gimp, file, &error);
+
+      if (! image)
+        {
+          g_printerr ("%s: %s\n", basename,
+                      error ? error->message : "could not be opened");
+          g_clear_error (&error);
+          result = EXIT_FAILURE;
+
+          g_free (basename);
+          g_object_unref (file);
+          continue;
+        }
+
+      raw_size = 0;
+
+      for (m = 0; m < G_N_ELEMENTS (modes); m++)
+        {
+          gdouble save_time;
+          gdouble load_time;
+          gsize   size;
+
+          if (! benchmark_mode (gimp, image, &modes[m],
+                                &save_time, &load_time, &size, &error))
+            {
+              g_printerr ("%s, %s: %s\n", basename, modes[m].name,
+                          error->message);
+              g_clear_error (&error);
+              result = EXIT_FAILURE;
+              continue;
+            }
+
+          /*  the ratio is relative to the first mode, RLE  */
+          if (m == 0)
+            raw_size = size;
+
+          g_print ("%-32s %-5s %12" G_GSIZE_FORMAT " %8.3f %10.3f %10.3f\n",
+                   basename, modes[m].name, size,
+                   raw_size ? (gdouble) size / raw_size : 0.0,
+                   save_time, load_time);
+        }
+
+      g_object_unref (image);
+      g_free (basename);
+      g_object_unref (file);
+    }
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,443 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpboundary.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  large enough to be split into several bands by gimp_boundary_find()  */
+#define MASK_SIZE 1024
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimpboundary/" #function, gimp, function);
+
+
+typedef struct
+{
+  GimpBoundaryType type;
+  GeglRectangle    region;
+  gint             x1, y1, x2, y2;
+} BoundaryParams;
+
+
+static const BoundaryParams params[] =
+{
+  { GIMP_BOUNDARY_WITHIN_BOUNDS, {   0,   0,    0,    0 },
+    0,  0, MASK_SIZE, MASK_SIZE },
+  { GIMP_BOUNDARY_WITHIN_BOUNDS, {   0,   0,    0,    0 },
+    100, 37, 900, 1001 },
+  { GIMP_BOUNDARY_IGNORE_BOUNDS, {   0,   0, MASK_SIZE, MASK_SIZE },
+    200, 200, 800, 800 },
+  { GIMP_BOUNDARY_IGNORE_BOUNDS, {  13, 255,  990,  700 },
+    0,  0, MASK_SIZE, MASK_SIZE }
+};
+
+
+/*  a mask with shapes of all sizes, with many of their edges exactly
+ *  on, or just next to, the rows where the bands of a parallel search
+ *  meet
+ */
+static GeglBuffer *
+create_mask (void)
+{
+  GeglBuffer *buffer;
+  GRand      *rand;
+  gint        i;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, MASK_SIZE, MASK_SIZE),
+                            babl_format ("Y float"));
+
+  rand = g_rand_new_with_seed (1234);
+
+  for (i = 0; i < 400; i++)
+    {
+      GeglColor *color;
+      gint       x = g_rand_int_range (rand, -32, MASK_SIZE);
+      gint       y;
+      gint       w = g_rand_int_range (rand, 1, 200);
+      gint       h = g_rand_int_range (rand, 1, 200);
+
+      if (i % 2)
+        y = g_rand_int_range (rand, -32, MASK_SIZE);
+      else
+        y = (MASK_SIZE / 8) * g_rand_int_range (rand, 1, 8) +
+            g_rand_int_range (rand, -2, 3) - h / 2;
+
+      color = gegl_color_new (i % 3 ? "white" : "black");
+
+      gegl_buffer_set_color (buffer, GEGL_RECTANGLE (x, y, w, h), color);
+
+      g_object_unref (color);
+    }
+
+  g_rand_free (rand);
+
+  return buffer;
+}
+
+static GimpBoundSeg *
+find_boundary (Gimp                 *gimp,
+               gint                  n_threads,
+               GeglBuffer           *buffer,
+               const BoundaryParams *p,
+               gint                 *num_segs)
+{
+  g_object_set (gimp->config,
+                "num-processors", n_threads,
+                NULL);
+
+  return gimp_boundary_find (buffer,
+                             p->region.width ? &p->region : NULL,
+                             babl_format ("Y float"),
+                             p->type,
+                             p->x1, p->y1, p->x2, p->y2,
+                             GIMP_BOUNDARY_HALF_WAY,
+                             num_segs);
+}
+
+static void
+assert_segs_equal (const GimpBoundSeg *segs1,
+                   gint                num_segs1,
+                   const GimpBoundSeg *segs2,
+                   gint                num_segs2)
+{
+  gint i;
+
+  g_assert_cmpint (num_segs1, ==, num_segs2);
+
+  for (i = 0; i < num_segs1; i++)
+    {
+      g_assert_cmpint (segs1[i].x1,   ==, segs2[i].x1);
+      g_assert_cmpint (segs1[i].y1,   ==, segs2[i].y1);
+      g_assert_cmpint (segs1[i].x2,   ==, segs2[i].x2);
+      g_assert_cmpint (segs1[i].y2,   ==, segs2[i].y2);
+      g_assert_cmpint (segs1[i].open, ==, segs2[i].open);
+    }
+}
+
+/**
+ * parallel_find_matches_serial:
+ * @data:
+ *
+ * Makes sure that a boundary search split into bands finds exactly
+ * the segments of a serial search, in the same order.
+ **/
+static void
+parallel_find_matches_serial (gconstpointer data)
+{
+  Gimp       *gimp   = GIMP (data);
+  GeglBuffer *buffer = create_mask ();
+  gint        i;
+
+  for (i = 0; i < G_N_ELEMENTS (params); i++)
+    {
+      GimpBoundSeg *serial_segs;
+      GimpBoundSeg *parallel_segs;
+      gint          num_serial_segs;
+      gint          num_parallel_segs;
+
+      serial_segs   = find_boundary (gimp, 1, buffer, &params[i],
+                                     &num_serial_segs);
+      parallel_segs = find_boundary (gimp, 4, buffer, &params[i],
+                                     &num_parallel_segs);
+
+      g_assert_cmpint (num_serial_segs, >, 0);
+
+      assert_segs_equal (serial_segs,   num_serial_segs,
+                         parallel_segs, num_parallel_segs);
+
+      g_free (serial_segs);
+      g_free (parallel_segs);
+    }
+
+  g_object_unref (buffer);
+}
+
+/**
+ * parallel_find_matches_serial_at_band_edges:
+ * @data:
+ *
+ * Makes sure that shapes starting or ending exactly on, or one row
+ * next to, the inner edges of the bands give the same segments as a
+ * serial search, for several numbers of bands.
+ **/
+static void
+parallel_find_matches_serial_at_band_edges (gconstpointer data)
+{
+  static const gint n_threads[] = { 2, 3, 4, 7 };
+
+  Gimp *gimp = GIMP (data);
+  gint  i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (params); i++)
+    for (j = 0; j < G_N_ELEMENTS (n_threads); j++)
+      {
+        const BoundaryParams *p = &params[i];
+        GeglBuffer           *buffer;
+        GeglColor            *white;
+        GimpBoundSeg         *serial_segs;
+        GimpBoundSeg         *parallel_segs;
+        gint                  num_serial_segs;
+        gint                  num_parallel_segs;
+        gint                  start;
+        gint                  end;
+        gint                  band;
+
+        if (p->type == GIMP_BOUNDARY_WITHIN_BOUNDS)
+          {
+            start = p->y1;
+            end   = p->y2;
+          }
+        else
+          {
+            start = p->region.y;
+            end   = p->region.y + p->region.height;
+          }
+
+        buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, MASK_SIZE, MASK_SIZE),
+                                  babl_format ("Y float"));
+
+        white = gegl_color_new ("white");
+
+        /*  the bands split the searched rows the same way  */
+        for (band = 1; band < n_threads[j]; band++)
+          {
+            gint edge = start + (gint64) (end - start) * band / n_threads[j];
+            gint k;
+
+            /*  shapes ending above, on and below the edge, starting
+             *  there, and one row high, side by side
+             */
+            for (k = -1; k <= 1; k++)
+              {
+                gint x = 200 + 120 * (k + 1) + 10 * band;
+
+                gegl_buffer_set_color (buffer,
+                                       GEGL_RECTANGLE (x, edge - 20,
+                                                       30, 20 + k),
+                                       white);
+                gegl_buffer_set_color (buffer,
+                                       GEGL_RECTANGLE (x + 40, edge + k,
+                                                       30, 20),
+                                       white);
+                gegl_buffer_set_color (buffer,
+                                       GEGL_RECTANGLE (x + 80, edge + k,
+                                                       30, 1),
+                                       white);
+              }
+          }
+
+        g_object_unref (white);
+
+        serial_segs   = find_boundary (gimp, 1, buffer, p,
+                                       &num_serial_segs);
+        parallel_segs = find_boundary (gimp, n_threads[j], buffer, p,
+                                       &num_parallel_segs);
+
+        g_assert_cmpint (num_serial_segs, >, 0);
+
+        assert_segs_equal (serial_segs,   num_serial_segs,
+                           parallel_segs, num_parallel_segs);
+
+        g_free (serial_segs);
+        g_free (parallel_segs);
+        g_object_unref (buffer);
+      }
+}
+
+/**
+ * cache_find_matches_find:
+ * @data:
+ *
+ * Makes sure that a #GimpBoundaryCache finds exactly the segments of
+ * gimp_boundary_find(), both when searched from scratch and after
+ * parts of the mask were changed and invalidated.
+ **/
+static void
+cache_find_matches_find (gconstpointer data)
+{
+  static const GeglRectangle changes[] =
+  {
+    {  40,  63, 100,   1 },
+    { 500, 128,  30, 300 },
+    {   0, 700, MASK_SIZE, 2 },
+    { 900, 959,  50,  65 }
+  };
+
+  Gimp              *gimp   = GIMP (data);
+  GeglBuffer        *buffer = create_mask ();
+  GimpBoundaryCache *cache  = gimp_boundary_cache_new ();
+  gint               i;
+
+  g_object_set (gimp->config,
+                "num-processors", 4,
+                NULL);
+
+  for (i = 0; i <= G_N_ELEMENTS (changes); i++)
+    {
+      GimpBoundSeg *segs;
+      GimpBoundSeg *cached_segs;
+      gint          num_segs;
+      gint          num_cached_segs;
+
+      if (i > 0)
+        {
+          const GeglRectangle *change = &changes[i - 1];
+          GeglColor           *color;
+
+          color = gegl_color_new (i % 2 ? "white" : "black");
+
+          gegl_buffer_set_color (buffer, change, color);
+          gimp_boundary_cache_invalidate (cache, change);
+
+          g_object_unref (color);
+        }
+
+      segs        = find_boundary (gimp, 4, buffer, &params[0], &num_segs);
+      cached_segs = gimp_boundary_cache_find (cache, buffer,
+                                              babl_format ("Y float"),
+                                              0, 0, MASK_SIZE, MASK_SIZE,
+                                              GIMP_BOUNDARY_HALF_WAY,
+                                              GEGL_RECTANGLE (0, 0,
+                                                              MASK_SIZE,
+                                                              MASK_SIZE),
+                                              &num_cached_segs);
+
+      assert_segs_equal (segs,        num_segs,
+                         cached_segs, num_cached_segs);
+
+      g_free (segs);
+      g_free (cached_segs);
+    }
+
+  gimp_boundary_cache_free (cache);
+  g_object_unref (buffer);
+}
+
+/**
+ * cache_find_within_bounds:
+ * @data:
+ *
+ * Makes sure that a #GimpBoundaryCache, which only searches the
+ * columns of the given bounds, still finds the segments of
+ * gimp_boundary_find() after the bounds grew sideways.
+ **/
+static void
+cache_find_within_bounds (gconstpointer data)
+{
+  static const GeglRectangle shapes[] =
+  {
+    { 100, 100,  50,  50 },
+    { 800,  90, 100,  30 },
+    {   0, 500,  20, 200 }
+  };
+
+  Gimp              *gimp   = GIMP (data);
+  GeglBuffer        *buffer;
+  GimpBoundaryCache *cache  = gimp_boundary_cache_new ();
+  GeglColor         *white  = gegl_color_new ("white");
+  GeglRectangle      bounds = { 0, };
+  gint               i;
+
+  g_object_set (gimp->config,
+                "num-processors", 4,
+                NULL);
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, MASK_SIZE, MASK_SIZE),
+                            babl_format ("Y float"));
+
+  for (i = 0; i < G_N_ELEMENTS (shapes); i++)
+    {
+      GimpBoundSeg *segs;
+      GimpBoundSeg *cached_segs;
+      gint          num_segs;
+      gint          num_cached_segs;
+
+      gegl_buffer_set_color (buffer, &shapes[i], white);
+      gimp_boundary_cache_invalidate (cache, &shapes[i]);
+
+      if (i == 0)
+        bounds = shapes[i];
+      else
+        gegl_rectangle_bounding_box (&bounds, &bounds, &shapes[i]);
+
+      segs        = find_boundary (gimp, 4, buffer, &params[0], &num_segs);
+      cached_segs = gimp_boundary_cache_find (cache, buffer,
+                                              babl_format ("Y float"),
+                                              0, 0, MASK_SIZE, MASK_SIZE,
+                                              GIMP_BOUNDARY_HALF_WAY,
+                                              &bounds,
+                                              &num_cached_segs);
+
+      g_assert_cmpint (num_segs, >, 0);
+
+      assert_segs_equal (segs,        num_segs,
+                         cached_segs, num_cached_segs);
+
+      g_free (segs);
+      g_free (cached_segs);
+    }
+
+  g_object_unref (white);
+  gimp_boundary_cache_free (cache);
+  g_object_unref (buffer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (parallel_find_matches_serial);
+  ADD_TEST (parallel_find_matches_serial_at_band_edges);
+  ADD_TEST (cache_find_matches_find);
+  ADD_TEST (cache_find_within_bounds);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,565 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpcolor/gimpcolor.h"
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "core/gimp.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimppickable.h"
+#include "core/gimppickable-contiguous-region.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  not a multiple of the fill's tiles, so the last ones are partial  */
+#define IMAGE_WIDTH  300
+#define IMAGE_HEIGHT 260
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-contiguous-region/" #function, \
+                        gimp, function);
+
+
+typedef struct
+{
+  gint     x, y;
+  gboolean select_transparent;
+} Seed;
+
+
+/*  the seed fill as it was before it was made to work on tiles,
+ *  limited to the composite criterion, to compare the new one against
+ */
+
+static gfloat
+reference_pixel_difference (const gfloat *col1,
+                            const gfloat *col2,
+                            gboolean      antialias,
+                            gfloat        threshold,
+                            gboolean      select_transparent)
+{
+  gfloat max = 0.0;
+
+  if (! select_transparent && col2[3] == 0.0)
+    return 0.0;
+
+  if (select_transparent)
+    {
+      max = fabs (col1[3] - col2[3]);
+    }
+  else
+    {
+      gint b;
+
+      for (b = 0; b < 3; b++)
+        max = MAX (max, fabs (col1[b] - col2[b]));
+    }
+
+  if (antialias && threshold > 0.0)
+    {
+      gfloat aa = 1.5 - (max / threshold);
+
+      if (aa <= 0.0)
+        return 0.0;
+      else if (aa < 0.5)
+        return aa * 2.0;
+      else
+        return 1.0;
+    }
+  else
+    {
+      if (max > threshold)
+        return 0.0;
+      else
+        return 1.0;
+    }
+}
+
+static void
+reference_push_segment (GQueue *segment_queue,
+                        gint    y,
+                        gint    old_y,
+                        gint    start,
+                        gint    end,
+                        gint    new_y,
+                        gint    new_start,
+                        gint    new_end)
+{
+  if (new_y != old_y)
+    {
+      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
+      g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
+      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
+      g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+    }
+  else
+    {
+      if (new_start < start)
+        {
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_start));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (start + 1));
+        }
+
+      if (new_end > end)
+        {
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_y));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (y));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (end - 1));
+          g_queue_push_tail (segment_queue, GINT_TO_POINTER (new_end));
+        }
+    }
+}
+
+static void
+reference_pop_segment (GQueue *segment_queue,
+                       gint   *y,
+                       gint   *old_y,
+                       gint   *start,
+                       gint   *end)
+{
+  *y     = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
+  *old_y = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
+  *start = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
+  *end   = GPOINTER_TO_INT (g_queue_pop_head (segment_queue));
+}
+
+static gboolean
+reference_find_contiguous_segment (const gfloat *col,
+                                   GeglBuffer   *src_buffer,
+                                   GeglBuffer   *mask_buffer,
+                                   gboolean      select_transparent,
+                                   gboolean      antialias,
+                                   gfloat        threshold,
+                                   gint          initial_x,
+                                   gint          initial_y,
+                                   gint         *start,
+                                   gint         *end)
+{
+  const Babl *format = babl_format ("R'G'B'A float");
+  gfloat      mask_row[IMAGE_WIDTH];
+  gfloat      s[4];
+  gfloat      diff;
+
+  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, format,
+                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+
+  diff = reference_pixel_difference (col, s, antialias, threshold,
+                                     select_transparent);
+
+  if (! diff)
+    return FALSE;
+
+  mask_row[initial_x] = diff;
+
+  for (*start = initial_x - 1; *start >= 0; (*start)--)
+    {
+      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, format,
+                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+
+      diff = reference_pixel_difference (col, s, antialias, threshold,
+                                         select_transparent);
+      if (diff == 0.0)
+        break;
+
+      mask_row[*start] = diff;
+    }
+
+  for (*end = initial_x + 1; *end < IMAGE_WIDTH; (*end)++)
+    {
+      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, format,
+                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+
+      diff = reference_pixel_difference (col, s, antialias, threshold,
+                                         select_transparent);
+      if (diff == 0.0)
+        break;
+
+      mask_row[*end] = diff;
+    }
+
+  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start + 1, initial_y,
+                                                *end - *start - 1, 1),
+                   0, babl_format ("Y float"), &mask_row[*start + 1],
+                   GEGL_AUTO_ROWSTRIDE);
+
+  return TRUE;
+}
+
+static GeglBuffer *
+reference_contiguous_region_by_seed (GeglBuffer *src_buffer,
+                                     gboolean    antialias,
+                                     gfloat      threshold,
+                                     gboolean    select_transparent,
+                                     gboolean    diagonal_neighbors,
+                                     gint        x,
+                                     gint        y)
+{
+  GeglBuffer *mask_buffer;
+  GQueue     *segment_queue;
+  gfloat      col[4];
+  gint        old_y;
+  gint        start, end;
+  gint        new_start, new_end;
+
+  gegl_buffer_sample (src_buffer, x, y, NULL, col,
+                      babl_format ("R'G'B'A float"),
+                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+
+  if (col[3] > 0)
+    select_transparent = FALSE;
+
+  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
+                                 babl_format ("Y float"));
+
+  segment_queue = g_queue_new ();
+
+  reference_push_segment (segment_queue,
+                          y, -1, 0, 0,
+                          y, x - 1, x + 1);
+
+  do
+    {
+      reference_pop_segment (segment_queue,
+                             &y, &old_y, &start, &end);
+
+      for (x = start + 1; x < end; x++)
+        {
+          gfloat val;
+
+          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
+                              babl_format ("Y float"),
+                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+          if (val != 0.0)
+            {
+              x++;
+              continue;
+            }
+
+          if (! reference_find_contiguous_segment (col,
+                                                   src_buffer, mask_buffer,
+                                                   select_transparent,
+                                                   antialias, threshold,
+                                                   x, y,
+                                                   &new_start, &new_end))
+            continue;
+
+          x = new_end;
+
+          if (diagonal_neighbors)
+            {
+              if (new_start >= 0)
+                new_start--;
+
+              if (new_end < IMAGE_WIDTH)
+                new_end++;
+            }
+
+          if (y + 1 < IMAGE_HEIGHT)
+            reference_push_segment (segment_queue,
+                                    y, old_y, start, end,
+                                    y + 1, new_start, new_end);
+
+          if (y - 1 >= 0)
+            reference_push_segment (segment_queue,
+                                    y, old_y, start, end,
+                                    y - 1, new_start, new_end);
+        }
+    }
+  while (! g_queue_is_empty (segment_queue));
+
+  g_queue_free (segment_queue);
+
+  return mask_buffer;
+}
+
+static GimpImage *
+test_image_new (Gimp *gimp)
+{
+  GimpImage *image;
+  GimpLayer *layer;
+  guchar    *data;
+  GRand     *rand;
+  gint       i;
+
+  image = gimp_image_new (gimp, IMAGE_WIDTH, IMAGE_HEIGHT,
+                          GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image, IMAGE_WIDTH, IMAGE_HEIGHT,
+                          gimp_image_get_layer_format (image, TRUE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  /*  random grays, which make ragged regions that spread over many
+   *  tiles at the thresholds below, and some transparent pixels
+   */
+  data = g_malloc (IMAGE_WIDTH * IMAGE_HEIGHT * 4);
+  rand = g_rand_new_with_seed (4242);
+
+  for (i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    {
+      guchar gray = g_rand_int_range (rand, 0, 256);
+
+      data[i * 4 + 0] = gray;
+      data[i * 4 + 1] = gray;
+      data[i * 4 + 2] = gray;
+      data[i * 4 + 3] = g_rand_int_range (rand, 0, 20) ? 255 : 0;
+    }
+
+  /*  the seeds below: one transparent pixel, two opaque ones  */
+  data[3] = 0;
+  data[((IMAGE_HEIGHT / 2) * IMAGE_WIDTH + IMAGE_WIDTH / 2) * 4 + 3] = 255;
+  data[(IMAGE_HEIGHT * IMAGE_WIDTH - 1) * 4 + 3] = 255;
+
+  gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)), NULL, 0,
+                   babl_format ("R'G'B'A u8"), data, GEGL_AUTO_ROWSTRIDE);
+
+  g_rand_free (rand);
+  g_free (data);
+
+  return image;
+}
+
+static void
+test_assert_masks_equal (GeglBuffer *expected,
+                         GeglBuffer *actual)
+{
+  const GeglRectangle *rect = gegl_buffer_get_extent (expected);
+  gfloat              *expected_data;
+  gfloat              *actual_data;
+  gint                 n_selected = 0;
+  gint                 i;
+
+  g_assert (actual != NULL);
+  g_assert (gegl_rectangle_equal (rect, gegl_buffer_get_extent (actual)));
+
+  expected_data = g_new (gfloat, rect->width * rect->height);
+  actual_data   = g_new (gfloat, rect->width * rect->height);
+
+  gegl_buffer_get (expected, rect, 1.0, babl_format ("Y float"),
+                   expected_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (actual, rect, 1.0, babl_format ("Y float"),
+                   actual_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < rect->width * rect->height; i++)
+    {
+      g_assert_cmpfloat (expected_data[i], ==, actual_data[i]);
+
+      n_selected += expected_data[i] != 0.0;
+    }
+
+  /*  the seed pixel at least  */
+  g_assert_cmpint (n_selected, >, 0);
+
+  g_free (expected_data);
+  g_free (actual_data);
+}
+
+/**
+ * by_seed_matches_serial_fill:
+ * @data:
+ *
+ * Makes sure the tiled seed fill selects exactly what the serial
+ * scanline fill it replaced did, for several seeds and thresholds,
+ * with and without antialiasing and diagonal neighbors.
+ **/
+static void
+by_seed_matches_serial_fill (gconstpointer data)
+{
+  Gimp         *gimp    = GIMP (data);
+  const Seed    seeds[] = { { IMAGE_WIDTH / 2, IMAGE_HEIGHT / 2, FALSE },
+                            { IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1, FALSE },
+                            { 0,               0,                TRUE  } };
+  const gfloat  thresholds[] = { 0.2, 0.35 };
+  GimpImage    *image;
+  GimpPickable *pickable;
+  GeglBuffer   *src_buffer;
+  gint          i, j, antialias, diagonal;
+
+  image    = test_image_new (gimp);
+  pickable = GIMP_PICKABLE (gimp_image_get_layer_iter (image)->data);
+
+  src_buffer = gimp_pickable_get_buffer (pickable);
+
+  g_object_set (gimp->config,
+                "num-processors", 4,
+                NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (seeds); i++)
+    for (j = 0; j < G_N_ELEMENTS (thresholds); j++)
+      for (antialias = 0; antialias < 2; antialias++)
+        for (diagonal = 0; diagonal < 2; diagonal++)
+          {
+            GeglBuffer *expected;
+            GeglBuffer *actual;
+
+            expected =
+              reference_contiguous_region_by_seed (src_buffer,
+                                                   antialias,
+                                                   thresholds[j],
+                                                   seeds[i].select_transparent,
+                                                   diagonal,
+                                                   seeds[i].x, seeds[i].y);
+
+            actual =
+              gimp_pickable_contiguous_region_by_seed (pickable,
+                                                       antialias,
+                                                       thresholds[j],
+                                                       seeds[i].select_transparent,
+                                                       GIMP_SELECT_CRITERION_COMPOSITE,
+                                                       diagonal,
+                                                       seeds[i].x, seeds[i].y,
+                                                       NULL);
+
+            test_assert_masks_equal (expected, actual);
+
+            g_object_unref (expected);
+            g_object_unref (actual);
+          }
+
+  g_object_unref (image);
+}
+
+/**
+ * by_color_matches_serial_compare:
+ * @data:
+ *
+ * Makes sure selecting by color in bands of tiles gives every pixel
+ * the same value as comparing all of them one by one.
+ **/
+static void
+by_color_matches_serial_compare (gconstpointer data)
+{
+  Gimp         *gimp         = GIMP (data);
+  const gfloat  thresholds[] = { 0.2, 0.35 };
+  GimpImage    *image;
+  GimpPickable *pickable;
+  GeglBuffer   *src_buffer;
+  GimpRGB       color;
+  gfloat        col[4];
+  gint          j, antialias;
+
+  image    = test_image_new (gimp);
+  pickable = GIMP_PICKABLE (gimp_image_get_layer_iter (image)->data);
+
+  src_buffer = gimp_pickable_get_buffer (pickable);
+
+  g_object_set (gimp->config,
+                "num-processors", 4,
+                NULL);
+
+  gimp_rgba_set (&color, 0.5, 0.5, 0.5, 1.0);
+  gimp_rgba_get_pixel (&color, babl_format ("R'G'B'A float"), col);
+
+  for (j = 0; j < G_N_ELEMENTS (thresholds); j++)
+    for (antialias = 0; antialias < 2; antialias++)
+      {
+        GeglBufferIterator *iter;
+        GeglBuffer         *expected;
+        GeglBuffer         *actual;
+
+        expected = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
+                                    babl_format ("Y float"));
+
+        iter = gegl_buffer_iterator_new (src_buffer, NULL, 0,
+                                         babl_format ("R'G'B'A float"),
+                                         GEGL_ACCESS_READ, GEGL_ABYSS_NONE);
+
+        gegl_buffer_iterator_add (iter, expected, NULL, 0,
+                                  babl_format ("Y float"),
+                                  GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+        while (gegl_buffer_iterator_next (iter))
+          {
+            const gfloat *src   = iter->data[0];
+            gfloat       *dest  = iter->data[1];
+            gint          count = iter->length;
+
+            while (count--)
+              {
+                *dest++ = reference_pixel_difference (col, src, antialias,
+                                                      thresholds[j], FALSE);
+                src += 4;
+              }
+          }
+
+        actual =
+          gimp_pickable_contiguous_region_by_color (pickable,
+                                                    antialias,
+                                                    thresholds[j],
+                                                    FALSE,
+                                                    GIMP_SELECT_CRITERION_COMPOSITE,
+                                                    &color,
+                                                    NULL);
+
+        test_assert_masks_equal (expected, actual);
+
+        g_object_unref (expected);
+        g_object_unref (actual);
+      }
+
+  g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (by_seed_matches_serial_fill);
+  ADD_TEST (by_color_matches_serial_compare);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
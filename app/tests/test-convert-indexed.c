@@ -0,0 +1,308 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "core/gimp.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-colormap.h"
+#include "core/gimpimage-convert-indexed.h"
+#include "core/gimplayer.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  several bands of the banded dithering, and a partial one  */
+#define IMAGE_WIDTH  300
+#define IMAGE_HEIGHT 700
+
+#define N_COLORS 16
+
+/*  how far the share of white pixels of a row of a flat gray image
+ *  may be off the share of the whole image
+ */
+#define TONE_TOLERANCE 0.05
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-convert-indexed/" #function, \
+                        gimp, function);
+
+
+static GimpImage *
+test_image_new (Gimp   *gimp,
+                gint    seed,
+                guchar  gray)
+{
+  GimpImage  *image;
+  GimpLayer  *layer;
+  GeglBuffer *buffer;
+  guchar     *data;
+  gint        i;
+
+  image = gimp_image_new (gimp, IMAGE_WIDTH, IMAGE_HEIGHT,
+                          GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image, IMAGE_WIDTH, IMAGE_HEIGHT,
+                          gimp_image_get_layer_format (image, FALSE),
+                          "Test Layer",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_LAYER_MODE_NORMAL);
+
+  gimp_image_add_layer (image, layer, GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+
+  data = g_malloc (IMAGE_WIDTH * IMAGE_HEIGHT * 3);
+
+  if (seed)
+    {
+      GRand *rand = g_rand_new_with_seed (seed);
+
+      for (i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT * 3; i++)
+        data[i] = g_rand_int_range (rand, 0, 256);
+
+      g_rand_free (rand);
+    }
+  else
+    {
+      memset (data, gray, IMAGE_WIDTH * IMAGE_HEIGHT * 3);
+    }
+
+  gegl_buffer_set (buffer, NULL, 0, babl_format ("R'G'B' u8"),
+                   data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return image;
+}
+
+static guchar *
+test_image_convert (Gimp                   *gimp,
+                    GimpImage              *image,
+                    GimpConvertPaletteType  palette_type,
+                    GimpConvertDitherType   dither_type,
+                    gint                    n_threads)
+{
+  GimpLayer *layer;
+  guchar    *indices;
+  GError    *error = NULL;
+
+  g_object_set (gimp->config,
+                "num-processors", n_threads,
+                NULL);
+
+  g_assert (gimp_image_convert_indexed (image, palette_type, N_COLORS,
+                                        FALSE, dither_type, FALSE, FALSE,
+                                        NULL, NULL, &error));
+  g_assert_no_error (error);
+
+  layer = GIMP_LAYER (gimp_image_get_layer_iter (image)->data);
+
+  indices = g_malloc (IMAGE_WIDTH * IMAGE_HEIGHT);
+
+  /*  read the raw colormap indices  */
+  gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   GEGL_RECTANGLE (0, 0, IMAGE_WIDTH, IMAGE_HEIGHT), 1.0,
+                   NULL, indices,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  return indices;
+}
+
+static void
+test_assert_colormaps_equal (GimpImage *expected,
+                             GimpImage *actual)
+{
+  g_assert_cmpint (gimp_image_get_colormap_size (expected),
+                   ==, gimp_image_get_colormap_size (actual));
+
+  g_assert (memcmp (gimp_image_get_colormap (expected),
+                    gimp_image_get_colormap (actual),
+                    gimp_image_get_colormap_size (expected) * 3) == 0);
+}
+
+/**
+ * fs_banded_is_thread_independent:
+ * @data:
+ *
+ * Makes sure banded Floyd-Steinberg dithering gives the same image
+ * no matter how many threads share the bands.
+ **/
+static void
+fs_banded_is_thread_independent (gconstpointer data)
+{
+  Gimp      *gimp = GIMP (data);
+  GimpImage *expected_image;
+  GimpImage *actual_image;
+  guchar    *expected;
+  guchar    *actual;
+
+  expected_image = test_image_new (gimp, 4242, 0);
+  actual_image   = test_image_new (gimp, 4242, 0);
+
+  expected = test_image_convert (gimp, expected_image,
+                                 GIMP_CONVERT_PALETTE_GENERATE,
+                                 GIMP_CONVERT_DITHER_FS_BANDED, 1);
+  actual   = test_image_convert (gimp, actual_image,
+                                 GIMP_CONVERT_PALETTE_GENERATE,
+                                 GIMP_CONVERT_DITHER_FS_BANDED, 4);
+
+  test_assert_colormaps_equal (expected_image, actual_image);
+
+  g_assert (memcmp (expected, actual, IMAGE_WIDTH * IMAGE_HEIGHT) == 0);
+
+  g_free (expected);
+  g_free (actual);
+  g_object_unref (expected_image);
+  g_object_unref (actual_image);
+}
+
+/**
+ * fs_banded_matches_fs_in_first_band:
+ * @data:
+ *
+ * Makes sure the first band of banded Floyd-Steinberg dithering, which
+ * starts without error like the serial dithering does, gives the same
+ * rows as the serial dithering, so the bands dither like it.
+ **/
+static void
+fs_banded_matches_fs_in_first_band (gconstpointer data)
+{
+  Gimp      *gimp = GIMP (data);
+  GimpImage *expected_image;
+  GimpImage *actual_image;
+  guchar    *expected;
+  guchar    *actual;
+
+  expected_image = test_image_new (gimp, 4242, 0);
+  actual_image   = test_image_new (gimp, 4242, 0);
+
+  expected = test_image_convert (gimp, expected_image,
+                                 GIMP_CONVERT_PALETTE_GENERATE,
+                                 GIMP_CONVERT_DITHER_FS, 4);
+  actual   = test_image_convert (gimp, actual_image,
+                                 GIMP_CONVERT_PALETTE_GENERATE,
+                                 GIMP_CONVERT_DITHER_FS_BANDED, 4);
+
+  test_assert_colormaps_equal (expected_image, actual_image);
+
+  g_assert (memcmp (expected, actual,
+                    IMAGE_WIDTH * MIN (FS_DITHER_BAND_HEIGHT,
+                                       IMAGE_HEIGHT)) == 0);
+
+  g_free (expected);
+  g_free (actual);
+  g_object_unref (expected_image);
+  g_object_unref (actual_image);
+}
+
+/**
+ * fs_banded_seams_keep_tone:
+ * @data:
+ *
+ * Dithers a flat gray image to black and white in bands and makes
+ * sure every row, including the ones where bands meet, has about as
+ * many white pixels as the whole image.
+ **/
+static void
+fs_banded_seams_keep_tone (gconstpointer data)
+{
+  Gimp         *gimp = GIMP (data);
+  GimpImage    *image;
+  guchar       *indices;
+  const guchar *colormap;
+  gint          n_white = 0;
+  gdouble       tone;
+  gint          row;
+  gint          i;
+
+  image = test_image_new (gimp, 0, 0x60);
+
+  indices = test_image_convert (gimp, image,
+                                GIMP_CONVERT_PALETTE_MONO,
+                                GIMP_CONVERT_DITHER_FS_BANDED, 4);
+
+  colormap = gimp_image_get_colormap (image);
+
+  for (i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    n_white += colormap[indices[i] * 3] > 127;
+
+  tone = (gdouble) n_white / (IMAGE_WIDTH * IMAGE_HEIGHT);
+
+  g_assert_cmpfloat (tone, >, 0.0);
+  g_assert_cmpfloat (tone, <, 1.0);
+
+  for (row = 0; row < IMAGE_HEIGHT; row++)
+    {
+      gint n_row_white = 0;
+
+      for (i = 0; i < IMAGE_WIDTH; i++)
+        n_row_white += colormap[indices[row * IMAGE_WIDTH + i] * 3] > 127;
+
+      g_assert_cmpfloat (fabs ((gdouble) n_row_white / IMAGE_WIDTH - tone),
+                         <=, TONE_TOLERANCE);
+    }
+
+  g_free (indices);
+  g_object_unref (image);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (fs_banded_is_thread_independent);
+  ADD_TEST (fs_banded_matches_fs_in_first_band);
+  ADD_TEST (fs_banded_seams_keep_tone);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
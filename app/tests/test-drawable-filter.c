@@ -0,0 +1,505 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawablefilter.h"
+#include "core/gimpimage.h"
+#include "core/gimplayer.h"
+#include "core/gimppickable.h"
+#include "core/gimpprojection.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  large enough for an update of the whole image to get a coarse pass  */
+#define GIMP_TEST_IMAGE_SIZE 600
+
+#define ADD_IMAGE_TEST(function) \
+  g_test_add ("/gimpdrawablefilter/" #function, \
+              GimpTestFixture, \
+              gimp, \
+              gimp_test_filter_setup, \
+              function, \
+              gimp_test_filter_teardown);
+
+
+typedef struct
+{
+  GimpImage          *image;
+  GimpLayer          *layer;
+  GimpDrawableFilter *filter;
+  GArray             *updates;
+  GArray             *renders;
+} GimpTestFixture;
+
+
+static void gimp_test_filter_setup    (GimpTestFixture *fixture,
+                                       gconstpointer    data);
+static void gimp_test_filter_teardown (GimpTestFixture *fixture,
+                                       gconstpointer    data);
+
+
+static void
+gimp_test_drawable_update (GimpDrawable    *drawable,
+                           gint             x,
+                           gint             y,
+                           gint             width,
+                           gint             height,
+                           GimpTestFixture *fixture)
+{
+  GeglRectangle rect = { x, y, width, height };
+
+  g_array_append_val (fixture->updates, rect);
+}
+
+/*  records for each area the projection renders, whether it is the
+ *  filter's full resolution result, the inverted stripes
+ */
+static void
+gimp_test_projection_update (GimpProjection  *projection,
+                             gboolean         now,
+                             gint             x,
+                             gint             y,
+                             gint             width,
+                             gint             height,
+                             GimpTestFixture *fixture)
+{
+  GeglBuffer *buffer;
+  guchar     *data;
+  gboolean    full = TRUE;
+  gint        i;
+
+  if (! now)
+    return;
+
+  buffer = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
+  data   = g_new (guchar, width * height * 4);
+
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (x, y, width, height), 1.0,
+                   babl_format ("R'G'B'A u8"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < width * height; i++)
+    {
+      guchar expected = ((x + i % width) % 4 < 2) ? 0 : 255;
+
+      if (data[i * 4] != expected)
+        {
+          full = FALSE;
+          break;
+        }
+    }
+
+  g_free (data);
+
+  g_array_append_val (fixture->renders, full);
+}
+
+static void
+gimp_test_filter_flush (GimpDrawableFilter *filter,
+                        GimpTestFixture    *fixture)
+{
+  gimp_projection_flush (gimp_image_get_projection (fixture->image));
+}
+
+/*  fills @buffer with white vertical stripes, two pixels wide, on
+ *  black, which a downscaled copy can't reproduce
+ */
+static void
+gimp_test_fill_stripes (GeglBuffer *buffer)
+{
+  GeglColor *black = gegl_color_new ("black");
+  GeglColor *white = gegl_color_new ("white");
+  gint       x;
+
+  gegl_buffer_set_color (buffer, gegl_buffer_get_extent (buffer), black);
+
+  for (x = 0; x < GIMP_TEST_IMAGE_SIZE; x += 4)
+    {
+      gegl_buffer_set_color (buffer,
+                             GEGL_RECTANGLE (x, 0, 2, GIMP_TEST_IMAGE_SIZE),
+                             white);
+    }
+
+  g_object_unref (black);
+  g_object_unref (white);
+}
+
+/*  dispatches everything pending in the main context, i.e. the
+ *  filter's updates and the projection's chunk renderer they start,
+ *  until neither has anything left to do
+ */
+static void
+gimp_test_run_pending (void)
+{
+  while (g_main_context_iteration (NULL, FALSE));
+}
+
+static void
+gimp_test_clear_updates (GimpTestFixture *fixture)
+{
+  g_array_set_size (fixture->updates, 0);
+  g_array_set_size (fixture->renders, 0);
+}
+
+/**
+ * gimp_test_filter_setup:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture setup for a filter on the striped layer of an image,
+ * whose first update was drawn, and with the layer's updates and the
+ * projection's renders recorded.
+ **/
+static void
+gimp_test_filter_setup (GimpTestFixture *fixture,
+                        gconstpointer    data)
+{
+  Gimp     *gimp = GIMP (data);
+  GeglNode *operation;
+
+  fixture->image = gimp_image_new (gimp,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_RGB,
+                                   GIMP_PRECISION_FLOAT_LINEAR);
+
+  fixture->layer = gimp_layer_new (fixture->image,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   GIMP_TEST_IMAGE_SIZE,
+                                   babl_format ("R'G'B'A u8"),
+                                   "Test Layer",
+                                   GIMP_OPACITY_OPAQUE,
+                                   GIMP_LAYER_MODE_NORMAL);
+
+  gimp_test_fill_stripes (gimp_drawable_get_buffer (GIMP_DRAWABLE (fixture->layer)));
+
+  gimp_image_add_layer (fixture->image, fixture->layer,
+                        GIMP_IMAGE_ACTIVE_PARENT, 0, FALSE);
+
+  /*  the projection only renders once it has a buffer  */
+  gimp_pickable_get_buffer (GIMP_PICKABLE (gimp_image_get_projection (fixture->image)));
+
+  operation = gegl_node_new_child (NULL,
+                                   "operation", "gegl:invert-linear",
+                                   NULL);
+
+  fixture->filter = gimp_drawable_filter_new (GIMP_DRAWABLE (fixture->layer),
+                                              "Test Filter", operation, NULL);
+
+  g_object_unref (operation);
+
+  g_signal_connect (fixture->filter, "flush",
+                    G_CALLBACK (gimp_test_filter_flush),
+                    fixture);
+
+  fixture->updates = g_array_new (FALSE, FALSE, sizeof (GeglRectangle));
+  fixture->renders = g_array_new (FALSE, FALSE, sizeof (gboolean));
+
+  g_signal_connect (fixture->layer, "update",
+                    G_CALLBACK (gimp_test_drawable_update),
+                    fixture);
+  g_signal_connect (gimp_image_get_projection (fixture->image), "update",
+                    G_CALLBACK (gimp_test_projection_update),
+                    fixture);
+
+  gimp_drawable_filter_apply (fixture->filter, NULL);
+
+  gimp_test_run_pending ();
+
+  gimp_test_clear_updates (fixture);
+}
+
+/**
+ * gimp_test_filter_teardown:
+ * @fixture:
+ * @data:
+ *
+ * Test fixture teardown for a filter on the layer of an image.
+ **/
+static void
+gimp_test_filter_teardown (GimpTestFixture *fixture,
+                           gconstpointer    data)
+{
+  g_signal_handlers_disconnect_by_func (gimp_image_get_projection (fixture->image),
+                                        gimp_test_projection_update,
+                                        fixture);
+  g_signal_handlers_disconnect_by_func (fixture->layer,
+                                        gimp_test_drawable_update,
+                                        fixture);
+
+  gimp_drawable_filter_abort (fixture->filter);
+
+  g_object_unref (fixture->filter);
+  g_object_unref (fixture->image);
+
+  g_array_free (fixture->updates, TRUE);
+  g_array_free (fixture->renders, TRUE);
+}
+
+/**
+ * apply_merges_areas:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that several gimp_drawable_filter_apply() calls in a row
+ * result in a single update of the drawable, covering all of their
+ * areas.
+ **/
+static void
+apply_merges_areas (GimpTestFixture *fixture,
+                    gconstpointer    data)
+{
+  GeglRectangle *update;
+
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (10, 10, 10, 10));
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (50, 60, 10, 10));
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (30, 20,  5,  5));
+
+  g_assert_cmpuint (fixture->updates->len, ==, 0);
+
+  gimp_test_run_pending ();
+
+  g_assert_cmpuint (fixture->updates->len, ==, 1);
+
+  update = &g_array_index (fixture->updates, GeglRectangle, 0);
+
+  g_assert_cmpint (update->x,      ==, 10);
+  g_assert_cmpint (update->y,      ==, 10);
+  g_assert_cmpint (update->width,  ==, 50);
+  g_assert_cmpint (update->height, ==, 60);
+}
+
+/**
+ * apply_after_update:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that the areas applied after an update are merged into
+ * the next update, which doesn't include the earlier areas.
+ **/
+static void
+apply_after_update (GimpTestFixture *fixture,
+                    gconstpointer    data)
+{
+  GeglRectangle *update;
+
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (10, 10, 10, 10));
+
+  gimp_test_run_pending ();
+
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (70, 70, 10, 10));
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (80, 80, 10, 10));
+
+  gimp_test_run_pending ();
+
+  g_assert_cmpuint (fixture->updates->len, ==, 2);
+
+  update = &g_array_index (fixture->updates, GeglRectangle, 1);
+
+  g_assert_cmpint (update->x,      ==, 70);
+  g_assert_cmpint (update->y,      ==, 70);
+  g_assert_cmpint (update->width,  ==, 20);
+  g_assert_cmpint (update->height, ==, 20);
+}
+
+/**
+ * abort_drops_pending_apply:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that aborting the filter drops an update which was
+ * applied but not made yet.
+ **/
+static void
+abort_drops_pending_apply (GimpTestFixture *fixture,
+                           gconstpointer    data)
+{
+  guint n_updates;
+
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (10, 10, 10, 10));
+
+  gimp_drawable_filter_abort (fixture->filter);
+
+  /*  the update of the whole filter area, without the filter  */
+  n_updates = fixture->updates->len;
+
+  gimp_test_run_pending ();
+
+  g_assert_cmpuint (fixture->updates->len, ==, n_updates);
+}
+
+/**
+ * commit_drops_pending_apply:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that committing the filter drops an update which was
+ * applied but not made yet.
+ **/
+static void
+commit_drops_pending_apply (GimpTestFixture *fixture,
+                            gconstpointer    data)
+{
+  guint n_updates;
+
+  gimp_drawable_filter_apply (fixture->filter,
+                              GEGL_RECTANGLE (10, 10, 10, 10));
+
+  g_assert (gimp_drawable_filter_commit (fixture->filter, NULL, FALSE));
+
+  /*  the updates of merging the filter  */
+  n_updates = fixture->updates->len;
+
+  gimp_test_run_pending ();
+
+  g_assert_cmpuint (fixture->updates->len, ==, n_updates);
+}
+
+/**
+ * coarse_update_before_full:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that a large update is drawn from a downscaled version of
+ * the filter first, and refined to the full resolution result after
+ * that, with nothing coarse drawn after the refinement.
+ **/
+static void
+coarse_update_before_full (GimpTestFixture *fixture,
+                           gconstpointer    data)
+{
+  gboolean full = FALSE;
+  guint    i;
+
+  gimp_drawable_filter_apply (fixture->filter, NULL);
+
+  gimp_test_run_pending ();
+
+  /*  the coarse update and its refinement  */
+  g_assert_cmpuint (fixture->updates->len, ==, 2);
+
+  g_assert_cmpuint (fixture->renders->len, >, 1);
+  g_assert (! g_array_index (fixture->renders, gboolean, 0));
+
+  for (i = 0; i < fixture->renders->len; i++)
+    {
+      if (full)
+        g_assert (g_array_index (fixture->renders, gboolean, i));
+      else
+        full = g_array_index (fixture->renders, gboolean, i);
+    }
+
+  g_assert (full);
+}
+
+/**
+ * apply_drops_pending_refinement:
+ * @fixture:
+ * @data:
+ *
+ * Makes sure that a parameter change after a coarse update was drawn
+ * drops its pending refinement, and that the next update is coarse
+ * again, refined only once.
+ **/
+static void
+apply_drops_pending_refinement (GimpTestFixture *fixture,
+                                gconstpointer    data)
+{
+  GimpProjection *projection = gimp_image_get_projection (fixture->image);
+  guint           i;
+
+  gimp_drawable_filter_apply (fixture->filter, NULL);
+
+  /*  make the coarse update, and draw it  */
+  while (fixture->updates->len == 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  gimp_projection_finish_draw (projection);
+
+  g_assert_cmpuint (fixture->updates->len, ==, 1);
+  g_assert_cmpuint (fixture->renders->len, >, 0);
+
+  for (i = 0; i < fixture->renders->len; i++)
+    g_assert (! g_array_index (fixture->renders, gboolean, i));
+
+  /*  its refinement is pending now  */
+  gimp_test_clear_updates (fixture);
+
+  gimp_drawable_filter_apply (fixture->filter, NULL);
+
+  gimp_test_run_pending ();
+
+  g_assert_cmpuint (fixture->updates->len, ==, 2);
+  g_assert_cmpuint (fixture->renders->len, >, 1);
+
+  g_assert (! g_array_index (fixture->renders, gboolean, 0));
+  g_assert (g_array_index (fixture->renders, gboolean,
+                           fixture->renders->len - 1));
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_IMAGE_TEST (apply_merges_areas);
+  ADD_IMAGE_TEST (apply_after_update);
+  ADD_IMAGE_TEST (abort_drops_pending_apply);
+  ADD_IMAGE_TEST (commit_drops_pending_apply);
+  ADD_IMAGE_TEST (coarse_update_before_full);
+  ADD_IMAGE_TEST (apply_drops_pending_refinement);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit properly so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,267 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "core/gimp.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-nodes.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  large enough to be rendered in strips by several threads  */
+#define BUFFER_SIZE 640
+
+/*  the strips and the single graph may round differently  */
+#define TOLERANCE   1
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-gegl-apply-operation/" #function, \
+                        gimp, function);
+
+
+static GeglBuffer *
+test_buffer_new (void)
+{
+  const Babl *format = babl_format ("R'G'B'A u8");
+  GeglBuffer *buffer;
+  guchar     *data;
+  GRand      *rand;
+  gint        i;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, BUFFER_SIZE, BUFFER_SIZE),
+                            format);
+
+  data = g_malloc (BUFFER_SIZE * BUFFER_SIZE * 4);
+  rand = g_rand_new_with_seed (4242);
+
+  for (i = 0; i < BUFFER_SIZE * BUFFER_SIZE * 4; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+
+  gegl_buffer_set (buffer, NULL, 0, format, data, GEGL_AUTO_ROWSTRIDE);
+
+  g_rand_free (rand);
+  g_free (data);
+
+  return buffer;
+}
+
+static void
+test_assert_buffers_equal (GeglBuffer *expected,
+                           GeglBuffer *actual)
+{
+  const Babl          *format = babl_format ("R'G'B'A u8");
+  const GeglRectangle *rect   = gegl_buffer_get_extent (expected);
+  guchar              *expected_data;
+  guchar              *actual_data;
+  gsize                size;
+  gsize                i;
+
+  g_assert (gegl_rectangle_equal (rect, gegl_buffer_get_extent (actual)));
+
+  size          = (gsize) rect->width * rect->height * 4;
+  expected_data = g_malloc (size);
+  actual_data   = g_malloc (size);
+
+  gegl_buffer_get (expected, rect, 1.0, format, expected_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_get (actual, rect, 1.0, format, actual_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < size; i++)
+    g_assert_cmpint (abs (expected_data[i] - actual_data[i]), <=, TOLERANCE);
+
+  g_free (expected_data);
+  g_free (actual_data);
+}
+
+static void
+test_set_n_threads (Gimp *gimp,
+                    gint  n_threads)
+{
+  g_object_set (gimp->config,
+                "num-processors", n_threads,
+                NULL);
+}
+
+/**
+ * scale_matches_single_node:
+ * @data:
+ *
+ * Makes sure gimp_gegl_apply_scale(), which renders strips through
+ * per-thread copies of its node, gives the same result as processing
+ * a single scale node.
+ **/
+static void
+scale_matches_single_node (gconstpointer data)
+{
+  Gimp                  *gimp = GIMP (data);
+  GimpInterpolationType  interpolations[] = { GIMP_INTERPOLATION_NONE,
+                                              GIMP_INTERPOLATION_LINEAR,
+                                              GIMP_INTERPOLATION_CUBIC };
+  GeglBuffer            *src_buffer;
+  gint                   width  = BUFFER_SIZE * 3 / 4;
+  gint                   height = BUFFER_SIZE * 5 / 4;
+  gint                   i;
+
+  src_buffer = test_buffer_new ();
+
+  test_set_n_threads (gimp, 4);
+
+  for (i = 0; i < G_N_ELEMENTS (interpolations); i++)
+    {
+      GeglBuffer *expected;
+      GeglBuffer *actual;
+      GeglNode   *node;
+
+      expected = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                                  gegl_buffer_get_format (src_buffer));
+      actual   = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                                  gegl_buffer_get_format (src_buffer));
+
+      node = gegl_node_new_child (NULL,
+                                  "operation", "gegl:scale-ratio",
+                                  "origin-x",  0.0,
+                                  "origin-y",  0.0,
+                                  "sampler",   interpolations[i],
+                                  "x",         (gdouble) width  / BUFFER_SIZE,
+                                  "y",         (gdouble) height / BUFFER_SIZE,
+                                  NULL);
+
+      gimp_gegl_apply_operation (src_buffer, NULL, NULL,
+                                 node, expected, NULL);
+
+      g_object_unref (node);
+
+      gimp_gegl_apply_scale (src_buffer, NULL, NULL, actual,
+                             interpolations[i],
+                             (gdouble) width  / BUFFER_SIZE,
+                             (gdouble) height / BUFFER_SIZE);
+
+      test_assert_buffers_equal (expected, actual);
+
+      g_object_unref (expected);
+      g_object_unref (actual);
+    }
+
+  g_object_unref (src_buffer);
+}
+
+/**
+ * transform_matches_single_node:
+ * @data:
+ *
+ * Makes sure gimp_gegl_apply_transform() gives the same result as
+ * processing a single transform node, in particular that the matrix
+ * survives copying the node for every thread.
+ **/
+static void
+transform_matches_single_node (gconstpointer data)
+{
+  Gimp        *gimp = GIMP (data);
+  GeglBuffer  *src_buffer;
+  GeglBuffer  *expected;
+  GeglBuffer  *actual;
+  GeglNode    *node;
+  GimpMatrix3  matrix;
+
+  src_buffer = test_buffer_new ();
+
+  test_set_n_threads (gimp, 4);
+
+  gimp_matrix3_identity (&matrix);
+  gimp_matrix3_translate (&matrix, -BUFFER_SIZE / 2.0, -BUFFER_SIZE / 2.0);
+  gimp_matrix3_rotate (&matrix, G_PI / 7.0);
+  gimp_matrix3_scale (&matrix, 0.9, 1.1);
+  gimp_matrix3_translate (&matrix, BUFFER_SIZE / 2.0, BUFFER_SIZE / 2.0);
+
+  expected = gegl_buffer_new (GEGL_RECTANGLE (0, 0, BUFFER_SIZE, BUFFER_SIZE),
+                              gegl_buffer_get_format (src_buffer));
+  actual   = gegl_buffer_new (GEGL_RECTANGLE (0, 0, BUFFER_SIZE, BUFFER_SIZE),
+                              gegl_buffer_get_format (src_buffer));
+
+  node = gegl_node_new_child (NULL,
+                              "operation",     "gegl:transform",
+                              "sampler",       GIMP_INTERPOLATION_CUBIC,
+                              "clip-to-input", TRUE,
+                              NULL);
+
+  gimp_gegl_node_set_matrix (node, &matrix);
+
+  gimp_gegl_apply_operation (src_buffer, NULL, NULL,
+                             node, expected, NULL);
+
+  g_object_unref (node);
+
+  gimp_gegl_apply_transform (src_buffer, NULL, NULL, actual,
+                             GIMP_INTERPOLATION_CUBIC,
+                             GIMP_TRANSFORM_RESIZE_CLIP,
+                             &matrix);
+
+  test_assert_buffers_equal (expected, actual);
+
+  g_object_unref (expected);
+  g_object_unref (actual);
+  g_object_unref (src_buffer);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (scale_matches_single_node);
+  ADD_TEST (transform_matches_single_node);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,327 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gdk-pixbuf/gdk-pixdata.h>
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "plug-in/plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "plug-in/gimpplugindef.h"
+#include "plug-in/gimppluginprocedure.h"
+#include "plug-in/plug-in-rc.h"
+#include "plug-in/plug-in-rc-cache.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/plug-in-rc/" #function, gimp, function);
+
+
+static guint8 *
+test_icon_new (gint *length)
+{
+  GdkPixbuf *pixbuf;
+  GdkPixdata pixdata;
+  guint      data_length;
+  guint8    *data;
+
+  /*  a transparent black icon, which is full of nul bytes  */
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 16, 16);
+  gdk_pixbuf_fill (pixbuf, 0x00000000);
+
+  G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  gdk_pixdata_from_pixbuf (&pixdata, pixbuf, FALSE);
+  data = gdk_pixdata_serialize (&pixdata, &data_length);
+  G_GNUC_END_IGNORE_DEPRECATIONS
+
+  g_object_unref (pixbuf);
+
+  *length = data_length;
+
+  return data;
+}
+
+static GimpPlugInDef *
+test_plug_in_def_new (Gimp *gimp)
+{
+  GimpPlugInDef       *plug_in_def;
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  GFile               *file;
+  guint8              *icon_data;
+  gint                 icon_data_length;
+
+  file = g_file_new_for_path ("/test/plug-ins/test-plug-in");
+
+  plug_in_def = gimp_plug_in_def_new (file);
+  gimp_plug_in_def_set_mtime (plug_in_def, 1234567890);
+  gimp_plug_in_def_set_locale_domain (plug_in_def,
+                                      "gimp20-test", "/test/locale");
+  gimp_plug_in_def_set_help_domain (plug_in_def,
+                                    "org.gimp.test", "/test/help");
+
+  procedure = gimp_plug_in_procedure_new (GIMP_PLUGIN, file);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), "plug-in-test");
+  gimp_procedure_set_strings (procedure,
+                              "plug-in-test",
+                              "Test blurb",
+                              "Test help",
+                              "Test author",
+                              "Test copyright",
+                              "2017",
+                              NULL);
+
+  proc->menu_label = g_strdup ("_Test...");
+  gimp_plug_in_procedure_add_menu_path (proc, "<Image>/Filters/Misc", NULL);
+  gimp_plug_in_procedure_set_image_types (proc, "RGB*, GRAY*");
+
+  icon_data = test_icon_new (&icon_data_length);
+  gimp_plug_in_procedure_take_icon (proc, GIMP_ICON_TYPE_INLINE_PIXBUF,
+                                    icon_data, icon_data_length);
+
+  gimp_procedure_add_argument (procedure,
+                               gimp_pdb_compat_param_spec (gimp,
+                                                           GIMP_PDB_INT32,
+                                                           "run-mode",
+                                                           "The run mode"));
+  gimp_procedure_add_argument (procedure,
+                               gimp_pdb_compat_param_spec (gimp,
+                                                           GIMP_PDB_IMAGE,
+                                                           "image",
+                                                           "Input image"));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_pdb_compat_param_spec (gimp,
+                                                               GIMP_PDB_STRING,
+                                                               "result",
+                                                               NULL));
+
+  gimp_plug_in_def_add_procedure (plug_in_def, proc);
+
+  g_object_unref (procedure);
+  g_object_unref (file);
+
+  return plug_in_def;
+}
+
+static void
+test_assert_procs_equal (GimpPlugInProcedure *expected,
+                         GimpPlugInProcedure *actual)
+{
+  GimpProcedure *expected_procedure = GIMP_PROCEDURE (expected);
+  GimpProcedure *actual_procedure   = GIMP_PROCEDURE (actual);
+  GList         *expected_list;
+  GList         *actual_list;
+  gint           i;
+
+  g_assert_cmpstr (gimp_object_get_name (expected),
+                   ==, gimp_object_get_name (actual));
+
+  g_assert_cmpstr (expected_procedure->blurb,     ==, actual_procedure->blurb);
+  g_assert_cmpstr (expected_procedure->help,      ==, actual_procedure->help);
+  g_assert_cmpstr (expected_procedure->author,    ==, actual_procedure->author);
+  g_assert_cmpstr (expected_procedure->copyright, ==, actual_procedure->copyright);
+  g_assert_cmpstr (expected_procedure->date,      ==, actual_procedure->date);
+  g_assert_cmpint (expected_procedure->proc_type, ==, actual_procedure->proc_type);
+
+  g_assert_cmpstr (expected->menu_label,  ==, actual->menu_label);
+  g_assert_cmpstr (expected->image_types, ==, actual->image_types);
+  g_assert_cmpint (expected->mtime,       ==, actual->mtime);
+
+  g_assert_cmpint (g_list_length (expected->menu_paths),
+                   ==, g_list_length (actual->menu_paths));
+
+  for (expected_list = expected->menu_paths, actual_list = actual->menu_paths;
+       expected_list;
+       expected_list = g_list_next (expected_list),
+       actual_list   = g_list_next (actual_list))
+    {
+      g_assert_cmpstr (expected_list->data, ==, actual_list->data);
+    }
+
+  g_assert_cmpint (expected->icon_type,        ==, actual->icon_type);
+  g_assert_cmpint (expected->icon_data_length, ==, actual->icon_data_length);
+  g_assert (memcmp (expected->icon_data, actual->icon_data,
+                    expected->icon_data_length) == 0);
+
+  g_assert_cmpint (expected_procedure->num_args,
+                   ==, actual_procedure->num_args);
+  g_assert_cmpint (expected_procedure->num_values,
+                   ==, actual_procedure->num_values);
+
+  for (i = 0; i < expected_procedure->num_args; i++)
+    {
+      GParamSpec *expected_pspec = expected_procedure->args[i];
+      GParamSpec *actual_pspec   = actual_procedure->args[i];
+
+      g_assert_cmpstr (expected_pspec->name, ==, actual_pspec->name);
+      g_assert (G_PARAM_SPEC_TYPE (expected_pspec) ==
+                G_PARAM_SPEC_TYPE (actual_pspec));
+    }
+
+  for (i = 0; i < expected_procedure->num_values; i++)
+    {
+      GParamSpec *expected_pspec = expected_procedure->values[i];
+      GParamSpec *actual_pspec   = actual_procedure->values[i];
+
+      g_assert_cmpstr (expected_pspec->name, ==, actual_pspec->name);
+      g_assert (G_PARAM_SPEC_TYPE (expected_pspec) ==
+                G_PARAM_SPEC_TYPE (actual_pspec));
+    }
+}
+
+static void
+test_assert_defs_equal (GimpPlugInDef *expected,
+                        GimpPlugInDef *actual)
+{
+  GSList *expected_list;
+  GSList *actual_list;
+
+  g_assert (g_file_equal (expected->file, actual->file));
+
+  g_assert_cmpstr (expected->locale_domain_name, ==, actual->locale_domain_name);
+  g_assert_cmpstr (expected->locale_domain_path, ==, actual->locale_domain_path);
+  g_assert_cmpstr (expected->help_domain_name,   ==, actual->help_domain_name);
+  g_assert_cmpstr (expected->help_domain_uri,    ==, actual->help_domain_uri);
+  g_assert_cmpint (expected->mtime,              ==, actual->mtime);
+  g_assert_cmpint (expected->has_init,           ==, actual->has_init);
+
+  g_assert_cmpint (g_slist_length (expected->procedures),
+                   ==, g_slist_length (actual->procedures));
+
+  for (expected_list = expected->procedures, actual_list = actual->procedures;
+       expected_list;
+       expected_list = g_slist_next (expected_list),
+       actual_list   = g_slist_next (actual_list))
+    {
+      test_assert_procs_equal (expected_list->data, actual_list->data);
+    }
+}
+
+/**
+ * cache_matches_pluginrc:
+ * @data:
+ *
+ * Writes pluginrc and its binary cache for the same plug-in, whose
+ * inline pixbuf icon contains nul bytes, and makes sure parsing the
+ * cache gives the same plug-in as parsing pluginrc.
+ **/
+static void
+cache_matches_pluginrc (gconstpointer data)
+{
+  Gimp          *gimp = GIMP (data);
+  GimpPlugInDef *plug_in_def;
+  GSList        *plug_in_defs;
+  GSList        *rc_defs;
+  GSList        *cache_defs;
+  gchar         *dir;
+  gchar         *path;
+  GFile         *pluginrc;
+  GFile         *cache;
+  GError        *error = NULL;
+
+  dir = g_dir_make_tmp ("test-plug-in-rc-XXXXXX", &error);
+  g_assert_no_error (error);
+
+  path = g_build_filename (dir, "pluginrc", NULL);
+  pluginrc = g_file_new_for_path (path);
+  g_free (path);
+
+  path = g_build_filename (dir, "pluginrc.cache", NULL);
+  cache = g_file_new_for_path (path);
+  g_free (path);
+
+  plug_in_def  = test_plug_in_def_new (gimp);
+  plug_in_defs = g_slist_prepend (NULL, plug_in_def);
+
+  g_assert (plug_in_rc_write (plug_in_defs, pluginrc, &error));
+  g_assert_no_error (error);
+
+  g_assert (plug_in_rc_cache_write (plug_in_defs, cache, pluginrc, &error));
+  g_assert_no_error (error);
+
+  rc_defs = plug_in_rc_parse (gimp, pluginrc, &error);
+  g_assert_no_error (error);
+
+  cache_defs = plug_in_rc_cache_parse (gimp, cache, pluginrc, &error);
+  g_assert_no_error (error);
+
+  g_assert_cmpint (g_slist_length (rc_defs),    ==, 1);
+  g_assert_cmpint (g_slist_length (cache_defs), ==, 1);
+
+  test_assert_defs_equal (plug_in_def,   rc_defs->data);
+  test_assert_defs_equal (rc_defs->data, cache_defs->data);
+
+  g_slist_free_full (cache_defs,   (GDestroyNotify) g_object_unref);
+  g_slist_free_full (rc_defs,      (GDestroyNotify) g_object_unref);
+  g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+
+  g_file_delete (cache, NULL, NULL);
+  g_file_delete (pluginrc, NULL, NULL);
+  g_rmdir (dir);
+
+  g_object_unref (cache);
+  g_object_unref (pluginrc);
+  g_free (dir);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (cache_matches_pluginrc);
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
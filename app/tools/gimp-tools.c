@@ -35,6 +35,7 @@
 #include "core/gimptooloptions.h"
 
 #include "gimp-tools.h"
+#include "gimppainttool-paint.h"
 #include "gimptooloptions-gui.h"
 #include "tool_manager.h"
 
@@ -233,6 +234,8 @@ gimp_tools_exit (Gimp *gimp)
 
   tool_manager_exit (gimp);
 
+  gimp_paint_tool_paint_exit ();
+
   for (list = gimp_get_tool_info_iter (gimp);
        list;
        list = g_list_next (list))
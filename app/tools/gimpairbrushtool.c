@@ -24,6 +24,7 @@
 
 #include "tools-types.h"
 
+#include "paint/gimpairbrush.h"
 #include "paint/gimpairbrushoptions.h"
 
 #include "widgets/gimphelp-ids.h"
@@ -31,16 +32,26 @@
 
 #include "gimpairbrushtool.h"
 #include "gimppaintoptions-gui.h"
+#include "gimppainttool-paint.h"
 #include "gimptoolcontrol.h"
 
 #include "gimp-intl.h"
 
 
-static GtkWidget * gimp_airbrush_options_gui (GimpToolOptions *tool_options);
+static void        gimp_airbrush_tool_constructed    (GObject          *object);
+
+static void        gimp_airbrush_tool_airbrush_stamp (GimpAirbrush     *airbrush,
+                                                      GimpAirbrushTool *airbrush_tool);
+static void        gimp_airbrush_tool_stamp          (GimpPaintTool    *paint_tool,
+                                                      gpointer          data);
+
+static GtkWidget * gimp_airbrush_options_gui         (GimpToolOptions  *tool_options);
 
 
 G_DEFINE_TYPE (GimpAirbrushTool, gimp_airbrush_tool, GIMP_TYPE_PAINTBRUSH_TOOL)
 
+#define parent_class gimp_airbrush_tool_parent_class
+
 
 void
 gimp_airbrush_tool_register (GimpToolRegisterCallback  callback,
@@ -63,6 +74,9 @@ gimp_airbrush_tool_register (GimpToolRegisterCallback  callback,
 static void
 gimp_airbrush_tool_class_init (GimpAirbrushToolClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = gimp_airbrush_tool_constructed;
 }
 
 static void
@@ -73,6 +87,36 @@ gimp_airbrush_tool_init (GimpAirbrushTool *airbrush)
   gimp_tool_control_set_tool_cursor (tool->control, GIMP_TOOL_CURSOR_AIRBRUSH);
 }
 
+static void
+gimp_airbrush_tool_constructed (GObject *object)
+{
+  GimpPaintTool *paint_tool = GIMP_PAINT_TOOL (object);
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  g_signal_connect_object (paint_tool->core, "stamp",
+                           G_CALLBACK (gimp_airbrush_tool_airbrush_stamp),
+                           object, 0);
+}
+
+static void
+gimp_airbrush_tool_airbrush_stamp (GimpAirbrush     *airbrush,
+                                   GimpAirbrushTool *airbrush_tool)
+{
+  GimpPaintTool *paint_tool = GIMP_PAINT_TOOL (airbrush_tool);
+
+  /*  the stroke might have ended since the stamp was scheduled  */
+  if (gimp_paint_tool_paint_is_active (paint_tool))
+    gimp_paint_tool_paint_push (paint_tool, gimp_airbrush_tool_stamp, NULL);
+}
+
+static void
+gimp_airbrush_tool_stamp (GimpPaintTool *paint_tool,
+                          gpointer       data)
+{
+  gimp_airbrush_stamp (GIMP_AIRBRUSH (paint_tool->core));
+}
+
 
 /*  tool options stuff  */
 
@@ -31,6 +31,7 @@
 #include "core/gimp.h"
 #include "core/gimpbezierdesc.h"
 #include "core/gimpbrush.h"
+#include "core/gimpdrawable.h"
 #include "core/gimpimage.h"
 #include "core/gimptoolinfo.h"
 
@@ -43,6 +44,7 @@
 #include "display/gimpdisplayshell.h"
 
 #include "gimpbrushtool.h"
+#include "gimppainttool-paint.h"
 #include "gimptoolcontrol.h"
 
 
@@ -66,6 +68,7 @@ static GimpCanvasItem *
                                                GimpDisplay       *display,
                                                gdouble            x,
                                                gdouble            y);
+static void   gimp_brush_tool_paint_end       (GimpPaintTool     *paint_tool);
 
 static void   gimp_brush_tool_brush_changed   (GimpContext       *context,
                                                GimpBrush         *brush,
@@ -94,6 +97,7 @@ gimp_brush_tool_class_init (GimpBrushToolClass *klass)
   tool_class->options_notify    = gimp_brush_tool_options_notify;
 
   paint_tool_class->get_outline = gimp_brush_tool_get_outline;
+  paint_tool_class->paint_end   = gimp_brush_tool_paint_end;
 }
 
 static void
@@ -153,7 +157,9 @@ gimp_brush_tool_oper_update (GimpTool         *tool,
 
   drawable = gimp_image_get_active_drawable (gimp_display_get_image (display));
 
-  if (! gimp_color_tool_is_enabled (GIMP_COLOR_TOOL (tool)) &&
+  /*  the brush core belongs to the paint thread while it paints  */
+  if (! gimp_color_tool_is_enabled (GIMP_COLOR_TOOL (tool))      &&
+      ! gimp_paint_tool_paint_is_active (GIMP_PAINT_TOOL (tool)) &&
       drawable && proximity)
     {
       GimpContext   *context    = GIMP_CONTEXT (paint_options);
@@ -189,7 +195,15 @@ gimp_brush_tool_cursor_update (GimpTool         *tool,
 
   if (! gimp_color_tool_is_enabled (GIMP_COLOR_TOOL (tool)))
     {
-      if (! brush_core->main_brush || ! brush_core->dynamics)
+      gboolean usable;
+
+      gimp_drawable_paint_lock ();
+
+      usable = brush_core->main_brush && brush_core->dynamics;
+
+      gimp_drawable_paint_unlock ();
+
+      if (! usable)
         {
           gimp_tool_set_cursor (tool, display,
                                 gimp_tool_control_get_cursor (tool->control),
@@ -216,8 +230,14 @@ gimp_brush_tool_options_notify (GimpTool         *tool,
       GimpPaintTool *paint_tool = GIMP_PAINT_TOOL (tool);
       GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
 
-      g_signal_emit_by_name (brush_core, "set-brush",
-                             brush_core->main_brush);
+      /*  the stroke paints with its own copy of the options, pick up
+       *  the change once it is done
+       */
+      if (gimp_paint_tool_paint_is_active (paint_tool))
+        GIMP_BRUSH_TOOL (tool)->set_brush_pending = TRUE;
+      else
+        g_signal_emit_by_name (brush_core, "set-brush",
+                               brush_core->main_brush);
     }
 }
 
@@ -235,8 +255,15 @@ gimp_brush_tool_get_outline (GimpPaintTool *paint_tool,
   if (! item)
     {
       GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
+      gboolean       usable;
+
+      gimp_drawable_paint_lock ();
+
+      usable = brush_core->main_brush && brush_core->dynamics;
+
+      gimp_drawable_paint_unlock ();
 
-      if (brush_core->main_brush && brush_core->dynamics)
+      if (usable)
         {
           /*  if an outline was expected, but got scaled away by
            *  transform/dynamics, draw a circle in the "normal" size.
@@ -265,6 +292,7 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
   const GimpBezierDesc *boundary = NULL;
   gint                  width    = 0;
   gint                  height   = 0;
+  GimpCanvasItem       *item     = NULL;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_TOOL (brush_tool), NULL);
   g_return_val_if_fail (GIMP_IS_DISPLAY (display), NULL);
@@ -276,8 +304,17 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
   options    = GIMP_PAINT_TOOL_GET_OPTIONS (brush_tool);
   shell      = gimp_display_get_shell (display);
 
+  /*  the paint thread changes the brush core's transform with every
+   *  dab, and may replace its brush
+   */
+  gimp_drawable_paint_lock ();
+
   if (! brush_core->main_brush || ! brush_core->dynamics)
-    return NULL;
+    {
+      gimp_drawable_paint_unlock ();
+
+      return NULL;
+    }
 
   if (brush_core->scale > 0.0)
     boundary = gimp_brush_transform_boundary (brush_core->main_brush,
@@ -308,11 +345,35 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
 #undef EPSILON
         }
 
-      return gimp_canvas_path_new (shell, boundary, x, y, FALSE,
+      item = gimp_canvas_path_new (shell, boundary, x, y, FALSE,
                                    GIMP_PATH_STYLE_OUTLINE);
     }
 
-  return NULL;
+  gimp_drawable_paint_unlock ();
+
+  return item;
+}
+
+static void
+gimp_brush_tool_paint_end (GimpPaintTool *paint_tool)
+{
+  GimpBrushTool *brush_tool = GIMP_BRUSH_TOOL (paint_tool);
+  GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
+  GimpContext   *context;
+  GimpBrush     *brush;
+
+  if (! brush_tool->set_brush_pending)
+    return;
+
+  brush_tool->set_brush_pending = FALSE;
+
+  context = GIMP_CONTEXT (GIMP_PAINT_TOOL_GET_OPTIONS (paint_tool));
+  brush   = gimp_context_get_brush (context);
+
+  if (brush != brush_core->main_brush)
+    gimp_brush_core_set_brush (brush_core, brush);
+  else
+    g_signal_emit_by_name (brush_core, "set-brush", brush);
 }
 
 static void
@@ -323,8 +384,13 @@ gimp_brush_tool_brush_changed (GimpContext   *context,
   GimpPaintTool *paint_tool = GIMP_PAINT_TOOL (brush_tool);
   GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
 
-  gimp_brush_core_set_brush (brush_core, brush);
-
+  /*  replacing the brush frees the mask caches the paint thread is
+   *  using, wait for the end of the stroke
+   */
+  if (gimp_paint_tool_paint_is_active (paint_tool))
+    brush_tool->set_brush_pending = TRUE;
+  else
+    gimp_brush_core_set_brush (brush_core, brush);
 }
 
 static void
@@ -332,17 +398,32 @@ gimp_brush_tool_set_brush (GimpBrushCore *brush_core,
                            GimpBrush     *brush,
                            GimpBrushTool *brush_tool)
 {
-  gimp_draw_tool_pause (GIMP_DRAW_TOOL (brush_tool));
+  GimpPaintTool *paint_tool = GIMP_PAINT_TOOL (brush_tool);
+  gboolean       painting   = gimp_paint_tool_paint_is_active (paint_tool);
+
+  /*  during a stroke, this is called from the paint thread, which must
+   *  not touch the canvas; the outline is redrawn on the next motion
+   */
+  if (! painting)
+    gimp_draw_tool_pause (GIMP_DRAW_TOOL (brush_tool));
 
   if (GIMP_BRUSH_CORE_GET_CLASS (brush_core)->handles_transforming_brush)
     {
-      GimpPaintCore *paint_core = GIMP_PAINT_CORE (brush_core);
+      GimpPaintCore    *paint_core = GIMP_PAINT_CORE (brush_core);
+      GimpPaintOptions *options;
+
+      /*  the paint thread only reads the stroke's copy of the options  */
+      if (painting)
+        options = paint_tool->paint_options;
+      else
+        options = GIMP_PAINT_TOOL_GET_OPTIONS (paint_tool);
 
       gimp_brush_core_eval_transform_dynamics (brush_core,
                                                NULL,
-                                               GIMP_PAINT_TOOL_GET_OPTIONS (brush_tool),
+                                               options,
                                                &paint_core->cur_coords);
     }
 
-  gimp_draw_tool_resume (GIMP_DRAW_TOOL (brush_tool));
+  if (! painting)
+    gimp_draw_tool_resume (GIMP_DRAW_TOOL (brush_tool));
 }
@@ -35,6 +35,8 @@ typedef struct _GimpBrushToolClass GimpBrushToolClass;
 struct _GimpBrushTool
 {
   GimpPaintTool  parent_instance;
+
+  gboolean       set_brush_pending; /* brush changed during the stroke */
 };
 
 struct _GimpBrushToolClass
@@ -33,6 +33,7 @@
 #include "core/gimpitem.h"
 #include "core/gimppickable.h"
 #include "core/gimppickable-contiguous-region.h"
+#include "core/gimpprogress.h"
 
 #include "widgets/gimphelp-ids.h"
 
@@ -136,7 +137,8 @@ gimp_by_color_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                                        options->threshold / 255.0,
                                                        options->select_transparent,
                                                        options->select_criterion,
-                                                       &color);
+                                                       &color,
+                                                       GIMP_PROGRESS (display));
     }
 
   return NULL;
@@ -32,6 +32,7 @@
 #include "core/gimpitem.h"
 #include "core/gimppickable.h"
 #include "core/gimppickable-contiguous-region.h"
+#include "core/gimpprogress.h"
 
 #include "widgets/gimphelp-ids.h"
 
@@ -128,5 +129,6 @@ gimp_fuzzy_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                                   options->select_transparent,
                                                   options->select_criterion,
                                                   options->diagonal_neighbors,
-                                                  x, y);
+                                                  x, y,
+                                                  GIMP_PROGRESS (display));
 }
@@ -0,0 +1,412 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppainttool-paint.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "libgimpconfig/gimpconfig.h"
+
+#include "tools-types.h"
+
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimpprojection.h"
+
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintoptions.h"
+#include "paint/gimpsourcecore.h"
+#include "paint/gimpsourceoptions.h"
+
+#include "display/gimpdisplay.h"
+
+#include "gimppainttool.h"
+#include "gimppainttool-paint.h"
+
+
+/*  the interval, in milliseconds, at which the display is updated while
+ *  the paint thread is painting
+ */
+#define DISPLAY_UPDATE_INTERVAL 16
+
+
+typedef enum
+{
+  PAINT_ITEM_INTERPOLATE,
+  PAINT_ITEM_SET_CURRENT_COORDS,
+  PAINT_ITEM_FUNC
+} PaintItemType;
+
+typedef struct
+{
+  PaintItemType           type;
+  GimpPaintTool          *paint_tool;
+  GimpCoords              coords;
+  guint32                 time;
+  GimpPaintToolPaintFunc  func;
+  gpointer                data;
+} PaintItem;
+
+
+/*  local function prototypes  */
+
+static gboolean   gimp_paint_tool_paint_use_thread (GimpPaintTool *paint_tool);
+static gpointer   gimp_paint_tool_paint_thread     (gpointer       data);
+static gboolean   gimp_paint_tool_paint_timeout    (GimpPaintTool *paint_tool);
+
+static void       gimp_paint_tool_paint_queue      (PaintItem     *item);
+static void       gimp_paint_tool_paint_item       (PaintItem     *item);
+static void       gimp_paint_tool_paint_flush      (GimpPaintTool *paint_tool,
+                                                    gboolean       force);
+
+
+/*  local variables  */
+
+static GThread  *paint_thread;
+
+static GMutex    paint_queue_mutex;
+static GCond     paint_queue_cond;
+static GQueue    paint_queue = G_QUEUE_INIT;
+static gboolean  paint_queue_busy;
+static gboolean  paint_queue_quit;
+
+
+/*  public functions  */
+
+/*  stops the paint thread, once it painted the items left in the queue  */
+void
+gimp_paint_tool_paint_exit (void)
+{
+  if (! paint_thread)
+    return;
+
+  g_mutex_lock (&paint_queue_mutex);
+
+  paint_queue_quit = TRUE;
+
+  g_cond_broadcast (&paint_queue_cond);
+
+  g_mutex_unlock (&paint_queue_mutex);
+
+  g_thread_join (paint_thread);
+  paint_thread = NULL;
+
+  paint_queue_quit = FALSE;
+}
+
+void
+gimp_paint_tool_paint_start (GimpPaintTool *paint_tool,
+                             GimpDrawable  *drawable)
+{
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+  g_return_if_fail (paint_tool->paint_drawable == NULL);
+
+  paint_tool->paint_drawable = drawable;
+
+  /*  the paint thread works on a copy of the options, which the user
+   *  can't change halfway through a dab
+   */
+  paint_tool->paint_options =
+    gimp_config_duplicate (GIMP_CONFIG (GIMP_PAINT_TOOL_GET_OPTIONS (paint_tool)));
+
+  /*  collect the drawable's updates, and emit them from the main thread
+   *  in gimp_paint_tool_paint_flush()
+   */
+  gimp_drawable_start_paint (drawable);
+
+  if (gimp_paint_tool_paint_use_thread (paint_tool))
+    {
+      if (! paint_thread)
+        paint_thread = g_thread_new ("paint",
+                                     gimp_paint_tool_paint_thread, NULL);
+
+      paint_tool->paint_timeout_id =
+        g_timeout_add_full (G_PRIORITY_HIGH_IDLE,
+                            DISPLAY_UPDATE_INTERVAL,
+                            (GSourceFunc) gimp_paint_tool_paint_timeout,
+                            paint_tool, NULL);
+    }
+}
+
+void
+gimp_paint_tool_paint_end (GimpPaintTool *paint_tool)
+{
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
+  g_return_if_fail (paint_tool->paint_drawable != NULL);
+
+  if (paint_tool->paint_timeout_id)
+    {
+      /*  wait for the paint thread to finish the queued items  */
+      g_mutex_lock (&paint_queue_mutex);
+
+      while (! g_queue_is_empty (&paint_queue) || paint_queue_busy)
+        g_cond_wait (&paint_queue_cond, &paint_queue_mutex);
+
+      g_mutex_unlock (&paint_queue_mutex);
+
+      g_source_remove (paint_tool->paint_timeout_id);
+      paint_tool->paint_timeout_id = 0;
+    }
+
+  gimp_drawable_end_paint (paint_tool->paint_drawable);
+
+  paint_tool->paint_drawable = NULL;
+
+  g_clear_object (&paint_tool->paint_options);
+
+  if (GIMP_PAINT_TOOL_GET_CLASS (paint_tool)->paint_end)
+    GIMP_PAINT_TOOL_GET_CLASS (paint_tool)->paint_end (paint_tool);
+}
+
+gboolean
+gimp_paint_tool_paint_is_active (GimpPaintTool *paint_tool)
+{
+  g_return_val_if_fail (GIMP_IS_PAINT_TOOL (paint_tool), FALSE);
+
+  return paint_tool->paint_drawable != NULL;
+}
+
+void
+gimp_paint_tool_paint_interpolate (GimpPaintTool    *paint_tool,
+                                   const GimpCoords *coords,
+                                   guint32           time)
+{
+  PaintItem *item;
+
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
+  g_return_if_fail (paint_tool->paint_drawable != NULL);
+  g_return_if_fail (coords != NULL);
+
+  item = g_slice_new (PaintItem);
+
+  item->type       = PAINT_ITEM_INTERPOLATE;
+  item->paint_tool = paint_tool;
+  item->coords     = *coords;
+  item->time       = time;
+
+  gimp_paint_tool_paint_queue (item);
+}
+
+void
+gimp_paint_tool_paint_set_current_coords (GimpPaintTool    *paint_tool,
+                                          const GimpCoords *coords)
+{
+  PaintItem *item;
+
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
+  g_return_if_fail (paint_tool->paint_drawable != NULL);
+  g_return_if_fail (coords != NULL);
+
+  item = g_slice_new (PaintItem);
+
+  item->type       = PAINT_ITEM_SET_CURRENT_COORDS;
+  item->paint_tool = paint_tool;
+  item->coords     = *coords;
+  item->time       = 0;
+
+  gimp_paint_tool_paint_queue (item);
+}
+
+/**
+ * gimp_paint_tool_paint_push:
+ * @paint_tool: a #GimpPaintTool
+ * @func:       the function to call
+ * @data:       user data for @func
+ *
+ * Calls @func from the paint thread, in order with the stroke's
+ * motion, holding the paint lock.  Everything that paints on the
+ * stroke's drawable, other than the motion itself, has to go through
+ * here.
+ **/
+void
+gimp_paint_tool_paint_push (GimpPaintTool          *paint_tool,
+                            GimpPaintToolPaintFunc  func,
+                            gpointer                data)
+{
+  PaintItem *item;
+
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (paint_tool));
+  g_return_if_fail (paint_tool->paint_drawable != NULL);
+  g_return_if_fail (func != NULL);
+
+  item = g_slice_new0 (PaintItem);
+
+  item->type       = PAINT_ITEM_FUNC;
+  item->paint_tool = paint_tool;
+  item->func       = func;
+  item->data       = data;
+
+  gimp_paint_tool_paint_queue (item);
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_paint_tool_paint_use_thread (GimpPaintTool *paint_tool)
+{
+  static gint use_thread = -1;
+
+  /*  painting synchronously makes strokes reproducible, event by event,
+   *  which is what the tests want
+   */
+  if (use_thread < 0)
+    use_thread = ! g_getenv ("GIMP_TESTING_NO_PAINT_THREAD");
+
+  if (! use_thread)
+    return FALSE;
+
+  /*  a source core sampling merged reads, and flushes, the source
+   *  image's projection, which may only be touched from the main thread
+   */
+  if (GIMP_IS_SOURCE_CORE (paint_tool->core))
+    {
+      GimpSourceOptions *options =
+        GIMP_SOURCE_OPTIONS (paint_tool->paint_options);
+
+      if (options->sample_merged &&
+          gimp_source_core_use_source (GIMP_SOURCE_CORE (paint_tool->core),
+                                       options))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gpointer
+gimp_paint_tool_paint_thread (gpointer data)
+{
+  g_mutex_lock (&paint_queue_mutex);
+
+  while (TRUE)
+    {
+      PaintItem *item;
+
+      while (! (item = g_queue_pop_head (&paint_queue)) && ! paint_queue_quit)
+        g_cond_wait (&paint_queue_cond, &paint_queue_mutex);
+
+      if (! item)
+        break;
+
+      paint_queue_busy = TRUE;
+
+      g_mutex_unlock (&paint_queue_mutex);
+
+      gimp_drawable_paint_lock ();
+
+      gimp_paint_tool_paint_item (item);
+
+      gimp_drawable_paint_unlock ();
+
+      g_slice_free (PaintItem, item);
+
+      g_mutex_lock (&paint_queue_mutex);
+
+      paint_queue_busy = FALSE;
+
+      g_cond_broadcast (&paint_queue_cond);
+    }
+
+  g_mutex_unlock (&paint_queue_mutex);
+
+  return NULL;
+}
+
+static gboolean
+gimp_paint_tool_paint_timeout (GimpPaintTool *paint_tool)
+{
+  gimp_drawable_paint_lock ();
+
+  gimp_paint_tool_paint_flush (paint_tool, FALSE);
+
+  gimp_drawable_paint_unlock ();
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gimp_paint_tool_paint_queue (PaintItem *item)
+{
+  GimpPaintTool *paint_tool = item->paint_tool;
+
+  if (paint_tool->paint_timeout_id)
+    {
+      g_mutex_lock (&paint_queue_mutex);
+
+      g_queue_push_tail (&paint_queue, item);
+
+      g_cond_broadcast (&paint_queue_cond);
+
+      g_mutex_unlock (&paint_queue_mutex);
+    }
+  else
+    {
+      gboolean flush = (item->type != PAINT_ITEM_SET_CURRENT_COORDS);
+
+      gimp_paint_tool_paint_item (item);
+
+      g_slice_free (PaintItem, item);
+
+      if (flush)
+        gimp_paint_tool_paint_flush (paint_tool, TRUE);
+    }
+}
+
+static void
+gimp_paint_tool_paint_item (PaintItem *item)
+{
+  GimpPaintTool *paint_tool = item->paint_tool;
+  GimpPaintCore *core       = paint_tool->core;
+
+  switch (item->type)
+    {
+    case PAINT_ITEM_INTERPOLATE:
+      gimp_paint_core_interpolate (core,
+                                   paint_tool->paint_drawable,
+                                   paint_tool->paint_options,
+                                   &item->coords, item->time);
+      break;
+
+    case PAINT_ITEM_SET_CURRENT_COORDS:
+      gimp_paint_core_set_current_coords (core, &item->coords);
+      break;
+
+    case PAINT_ITEM_FUNC:
+      item->func (paint_tool, item->data);
+      break;
+    }
+}
+
+static void
+gimp_paint_tool_paint_flush (GimpPaintTool *paint_tool,
+                             gboolean       force)
+{
+  GimpTool  *tool = GIMP_TOOL (paint_tool);
+  GimpImage *image;
+
+  if (! gimp_drawable_flush_paint (paint_tool->paint_drawable) && ! force)
+    return;
+
+  image = gimp_display_get_image (tool->display);
+
+  gimp_projection_flush_now (gimp_image_get_projection (image));
+  gimp_display_flush_now (tool->display);
+}
@@ -48,6 +48,7 @@
 
 #include "gimpcoloroptions.h"
 #include "gimppainttool.h"
+#include "gimppainttool-paint.h"
 #include "gimptoolcontrol.h"
 
 #include "gimp-intl.h"
@@ -229,6 +230,9 @@ gimp_paint_tool_control (GimpTool       *tool,
       break;
 
     case GIMP_TOOL_ACTION_HALT:
+      if (gimp_paint_tool_paint_is_active (paint_tool))
+        gimp_paint_tool_paint_end (paint_tool);
+
       gimp_paint_core_cleanup (paint_tool->core);
       break;
 
@@ -365,6 +369,9 @@ gimp_paint_tool_button_press (GimpTool            *tool,
   gimp_projection_flush_now (gimp_image_get_projection (image));
   gimp_display_flush_now (display);
 
+  /*  the rest of the stroke is painted by the paint thread  */
+  gimp_paint_tool_paint_start (paint_tool, drawable);
+
   gimp_draw_tool_start (draw_tool, display);
 
   gimp_tool_control_activate (tool->control);
@@ -397,6 +404,9 @@ gimp_paint_tool_button_release (GimpTool              *tool,
 
   gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
 
+  /*  wait for the paint thread to finish the stroke  */
+  gimp_paint_tool_paint_end (paint_tool);
+
   /*  Let the specific painting function finish up  */
   gimp_paint_core_paint (core, drawable, paint_options,
                          GIMP_PAINT_STATE_FINISH, time);
@@ -446,17 +456,13 @@ gimp_paint_tool_motion (GimpTool         *tool,
   /*  don't paint while the Shift key is pressed for line drawing  */
   if (paint_tool->draw_line)
     {
-      gimp_paint_core_set_current_coords (core, &curr_coords);
+      gimp_paint_tool_paint_set_current_coords (paint_tool, &curr_coords);
       return;
     }
 
   gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
 
-  gimp_paint_core_interpolate (core, drawable, paint_options,
-                               &curr_coords, time);
-
-  gimp_projection_flush_now (gimp_image_get_projection (image));
-  gimp_display_flush_now (display);
+  gimp_paint_tool_paint_interpolate (paint_tool, &curr_coords, time);
 
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
 }
@@ -56,6 +56,10 @@ struct _GimpPaintTool
   const gchar   *status_ctrl;  /* additional message for the ctrl modifier */
 
   GimpPaintCore *core;
+
+  GimpDrawable     *paint_drawable;   /* the drawable of the current stroke */
+  GimpPaintOptions *paint_options;    /* the options the stroke started with */
+  guint             paint_timeout_id; /* display updates of the paint thread */
 };
 
 struct _GimpPaintToolClass
@@ -66,6 +70,9 @@ struct _GimpPaintToolClass
                                     GimpDisplay   *display,
                                     gdouble        x,
                                     gdouble        y);
+
+  /*  called on the main thread once the paint thread finished the stroke  */
+  void             (* paint_end)   (GimpPaintTool *paint_tool);
 };
 
 
@@ -32,6 +32,7 @@
 #include "core/gimpchannel-select.h"
 #include "core/gimpimage.h"
 #include "core/gimplayer-floating-selection.h"
+#include "core/gimpprogress.h"
 
 #include "display/gimpdisplay.h"
 #include "display/gimpdisplayshell.h"
@@ -46,6 +47,9 @@
 
 static void   gimp_region_select_tool_finalize       (GObject               *object);
 
+static void   gimp_region_select_tool_control        (GimpTool              *tool,
+                                                      GimpToolAction         action,
+                                                      GimpDisplay           *display);
 static void   gimp_region_select_tool_button_press   (GimpTool              *tool,
                                                       const GimpCoords      *coords,
                                                       guint32                time,
@@ -70,7 +74,11 @@ static void   gimp_region_select_tool_cursor_update  (GimpTool              *too
 
 static void   gimp_region_select_tool_draw           (GimpDrawTool          *draw_tool);
 
-static void   gimp_region_select_tool_get_mask       (GimpRegionSelectTool  *region_sel,
+static void   gimp_region_select_tool_halt           (GimpRegionSelectTool  *region_sel,
+                                                      GimpDisplay           *display);
+static gboolean gimp_region_select_tool_get_mask     (GimpRegionSelectTool  *region_sel,
+                                                      GimpDisplay           *display);
+static void   gimp_region_select_tool_flush_release  (GimpRegionSelectTool  *region_sel,
                                                       GimpDisplay           *display);
 
 
@@ -89,6 +97,7 @@ gimp_region_select_tool_class_init (GimpRegionSelectToolClass *klass)
 
   object_class->finalize     = gimp_region_select_tool_finalize;
 
+  tool_class->control        = gimp_region_select_tool_control;
   tool_class->button_press   = gimp_region_select_tool_button_press;
   tool_class->button_release = gimp_region_select_tool_button_release;
   tool_class->motion         = gimp_region_select_tool_motion;
@@ -111,6 +120,9 @@ gimp_region_select_tool_init (GimpRegionSelectTool *region_select)
   region_select->region_mask     = NULL;
   region_select->segs            = NULL;
   region_select->n_segs          = 0;
+
+  region_select->computing       = FALSE;
+  region_select->release_pending = FALSE;
 }
 
 static void
@@ -126,6 +138,30 @@ gimp_region_select_tool_finalize (GObject *object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gimp_region_select_tool_control (GimpTool       *tool,
+                                 GimpToolAction  action,
+                                 GimpDisplay    *display)
+{
+  GimpRegionSelectTool *region_sel = GIMP_REGION_SELECT_TOOL (tool);
+
+  switch (action)
+    {
+    case GIMP_TOOL_ACTION_PAUSE:
+    case GIMP_TOOL_ACTION_RESUME:
+      break;
+
+    case GIMP_TOOL_ACTION_HALT:
+      gimp_region_select_tool_halt (region_sel, display);
+      break;
+
+    case GIMP_TOOL_ACTION_COMMIT:
+      break;
+    }
+
+  GIMP_TOOL_CLASS (parent_class)->control (tool, action, display);
+}
+
 static void
 gimp_region_select_tool_button_press (GimpTool            *tool,
                                       const GimpCoords    *coords,
@@ -153,9 +189,19 @@ gimp_region_select_tool_button_press (GimpTool            *tool,
   gimp_tool_push_status (tool, display,
                          _("Move the mouse to change threshold"));
 
-  gimp_region_select_tool_get_mask (region_sel, display);
+  /*  the tool can be halted, and dropped by the tool manager, while
+   *  the mask is computed
+   */
+  g_object_ref (tool);
+
+  if (gimp_region_select_tool_get_mask (region_sel, display))
+    {
+      gimp_draw_tool_start (GIMP_DRAW_TOOL (tool), display);
+
+      gimp_region_select_tool_flush_release (region_sel, display);
+    }
 
-  gimp_draw_tool_start (GIMP_DRAW_TOOL (tool), display);
+  g_object_unref (tool);
 }
 
 static void
@@ -171,6 +217,20 @@ gimp_region_select_tool_button_release (GimpTool              *tool,
   GimpRegionSelectOptions *options     = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (tool);
   GimpImage               *image       = gimp_display_get_image (display);
 
+  /*  the mask is computed while events are processed, so that it can
+   *  be canceled; finish it before acting on the release
+   */
+  if (region_sel->computing)
+    {
+      region_sel->release_pending = TRUE;
+      region_sel->release_coords  = *coords;
+      region_sel->release_time    = time;
+      region_sel->release_state   = state;
+      region_sel->release_type    = release_type;
+
+      return;
+    }
+
   gimp_tool_pop_status (tool, display);
 
   gimp_draw_tool_stop (GIMP_DRAW_TOOL (tool));
@@ -247,9 +307,13 @@ gimp_region_select_tool_motion (GimpTool         *tool,
   GimpRegionSelectOptions *options    = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (tool);
   gint                     diff_x, diff_y;
   gdouble                  diff;
+  gboolean                 active;
 
   static guint32 last_time = 0;
 
+  if (region_sel->computing)
+    return;
+
   /* don't let the events come in too fast, ignore below a delay of 100 ms */
   if (time - last_time < 100)
     return;
@@ -265,11 +329,18 @@ gimp_region_select_tool_motion (GimpTool         *tool,
                 "threshold", CLAMP (region_sel->saved_threshold + diff, 0, 255),
                 NULL);
 
+  g_object_ref (tool);
+
   gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
 
-  gimp_region_select_tool_get_mask (region_sel, display);
+  active = gimp_region_select_tool_get_mask (region_sel, display);
 
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
+
+  if (active)
+    gimp_region_select_tool_flush_release (region_sel, display);
+
+  g_object_unref (tool);
 }
 
 static void
@@ -338,24 +409,102 @@ gimp_region_select_tool_draw (GimpDrawTool *draw_tool)
 }
 
 static void
+gimp_region_select_tool_halt (GimpRegionSelectTool *region_sel,
+                              GimpDisplay          *display)
+{
+  GimpTool                *tool    = GIMP_TOOL (region_sel);
+  GimpRegionSelectOptions *options = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (region_sel);
+
+  /*  halted from an event processed while the mask is computed  */
+  if (region_sel->computing && tool->display)
+    gimp_progress_cancel (GIMP_PROGRESS (tool->display));
+
+  region_sel->release_pending = FALSE;
+
+  if (gimp_tool_control_is_active (tool->control))
+    {
+      if (options->draw_mask && tool->display &&
+          gimp_display_get_shell (tool->display))
+        {
+          gimp_display_shell_set_mask (gimp_display_get_shell (tool->display),
+                                       NULL, 0, 0, NULL, FALSE);
+        }
+
+      /*  Restore the original threshold  */
+      g_object_set (options,
+                    "threshold", region_sel->saved_threshold,
+                    NULL);
+    }
+
+  g_clear_object (&region_sel->region_mask);
+
+  g_clear_pointer (&region_sel->segs, g_free);
+  region_sel->n_segs = 0;
+}
+
+/*  returns FALSE if the tool was halted, or its display or image went
+ *  away, while the mask was computed, and the tool must not go on
+ */
+static gboolean
 gimp_region_select_tool_get_mask (GimpRegionSelectTool *region_sel,
                                   GimpDisplay          *display)
 {
-  GimpRegionSelectOptions *options = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (region_sel);
-  GimpDisplayShell        *shell   = gimp_display_get_shell (display);
+  GimpTool                *tool     = GIMP_TOOL (region_sel);
+  GimpRegionSelectOptions *options  = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (region_sel);
+  GimpDisplayShell        *shell    = gimp_display_get_shell (display);
+  GimpImage               *image    = gimp_display_get_image (display);
+  GimpDrawable            *drawable = gimp_image_get_active_drawable (image);
+  GeglBuffer              *region_mask;
+  gboolean                 active;
 
   gimp_display_shell_set_override_cursor (shell, (GimpCursorType) GDK_WATCH);
 
   g_clear_pointer (&region_sel->segs, g_free);
   region_sel->n_segs = 0;
 
-  if (region_sel->region_mask)
-    g_object_unref (region_sel->region_mask);
+  g_clear_object (&region_sel->region_mask);
+
+  /*  events are processed while the mask is computed, which can close
+   *  the display, halt the tool or change the image
+   */
+  g_object_ref (display);
+  g_object_ref (shell);
+
+  region_sel->computing = TRUE;
 
-  region_sel->region_mask =
+  region_mask =
     GIMP_REGION_SELECT_TOOL_GET_CLASS (region_sel)->get_mask (region_sel,
                                                               display);
 
+  region_sel->computing = FALSE;
+
+  active = (tool->display == display                     &&
+            gimp_tool_control_is_active (tool->control)  &&
+            gimp_display_get_shell (display) == shell    &&
+            gimp_display_get_image (display) == image    &&
+            gimp_image_get_active_drawable (image) == drawable);
+
+  if (gimp_display_get_shell (display) == shell)
+    gimp_display_shell_unset_override_cursor (shell);
+
+  g_object_unref (shell);
+  g_object_unref (display);
+
+  if (! active)
+    {
+      if (region_mask)
+        g_object_unref (region_mask);
+
+      if (gimp_tool_control_is_active (tool->control))
+        gimp_tool_control (tool, GIMP_TOOL_ACTION_HALT, tool->display);
+      else
+        region_sel->release_pending = FALSE;
+
+      return FALSE;
+    }
+
+  region_sel->region_mask = region_mask;
+
   if (options->draw_mask)
     {
       if (region_sel->region_mask)
@@ -381,5 +530,22 @@ gimp_region_select_tool_get_mask (GimpRegionSelectTool *region_sel,
         }
     }
 
-  gimp_display_shell_unset_override_cursor (shell);
+  return TRUE;
+}
+
+static void
+gimp_region_select_tool_flush_release (GimpRegionSelectTool *region_sel,
+                                       GimpDisplay          *display)
+{
+  if (region_sel->release_pending)
+    {
+      region_sel->release_pending = FALSE;
+
+      gimp_region_select_tool_button_release (GIMP_TOOL (region_sel),
+                                              &region_sel->release_coords,
+                                              region_sel->release_time,
+                                              region_sel->release_state,
+                                              region_sel->release_type,
+                                              display);
+    }
 }
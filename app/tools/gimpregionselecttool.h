@@ -47,6 +47,14 @@ struct _GimpRegionSelectTool
   GeglBuffer        *region_mask;
   GimpBoundSeg      *segs;
   gint               n_segs;
+
+  /*  a button release that arrived while the mask was computed  */
+  gboolean              computing;
+  gboolean              release_pending;
+  GimpCoords            release_coords;
+  guint32               release_time;
+  GdkModifierType       release_state;
+  GimpButtonReleaseType release_type;
 };
 
 struct _GimpRegionSelectToolClass
@@ -383,12 +383,29 @@ gimp_image_prop_view_label_set_undo (GtkWidget     *label,
 
   if (steps > 0)
     {
-      GimpObject *object = GIMP_OBJECT (stack);
+      GimpObject *object  = GIMP_OBJECT (stack);
+      gint64      swapped = gimp_undo_stack_get_swapped_size (stack);
       gchar      *str;
       gchar       buf[256];
 
       str = g_format_size (gimp_object_get_memsize (object, NULL));
-      g_snprintf (buf, sizeof (buf), "%d (%s)", steps, str);
+
+      if (swapped > 0)
+        {
+          gchar *swapped_str = g_format_size (swapped);
+
+          /*  %d is the number of undo steps, followed by the memory
+           *  and the disk space they use
+           */
+          g_snprintf (buf, sizeof (buf), _("%d (%s, %s on disk)"),
+                      steps, str, swapped_str);
+          g_free (swapped_str);
+        }
+      else
+        {
+          g_snprintf (buf, sizeof (buf), "%d (%s)", steps, str);
+        }
+
       g_free (str);
 
       gtk_label_set_text (GTK_LABEL (label), buf);
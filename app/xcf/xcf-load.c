@@ -20,6 +20,10 @@
 #include <string.h>
 #include <zlib.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -34,6 +38,7 @@
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpdrawable-private.h" /* eek */
 #include "core/gimpgrid.h"
@@ -108,21 +113,31 @@ static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
                                                GeglBuffer    *buffer);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
-static gboolean        xcf_load_tile          (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format);
-static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
                                                GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
-static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
+                                               GError       **error);
+static void            xcf_load_tiles_func    (gint           i,
+                                               gint           n,
+                                               gpointer       user_data);
+static gboolean        xcf_load_tile_rle      (const guchar  *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gint           bpp,
+                                               gint           n_pixels,
+                                               GError       **error);
+static gboolean        xcf_load_tile_zlib     (z_stream      *strm,
+                                               const guchar  *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gint           tile_size,
+                                               GError       **error);
+#ifdef HAVE_ZSTD
+static gboolean        xcf_load_tile_zstd     (ZSTD_DCtx     *dctx,
+                                               const guchar  *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gint           tile_size,
+                                               GError       **error);
+#endif
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -144,6 +159,43 @@ static gboolean        xcf_skip_unknown_prop  (XcfInfo       *info,
   } G_STMT_END
 
 
+/* the number of tiles each thread decodes per batch in
+ * xcf_load_level().  the compressed data of a whole batch is read
+ * into memory before decoding starts.
+ */
+#define XCF_LOAD_TILES_PER_THREAD 8
+
+
+typedef struct
+{
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  gint                bpp;
+  XcfCompressionType  compression;
+
+  gint                first_tile;
+  gint                n_tiles;
+  volatile gint       next_tile;
+
+  goffset             max_data_length;
+  guchar             *data;       /* n_tiles * max_data_length bytes */
+  const guchar      **data_src;   /* file data per tile, in data or mapped */
+  gint               *data_size;  /* bytes of file data per tile */
+  GError            **errors;     /* per tile, set when decoding failed */
+
+  volatile gint       failed;
+
+  /* one inflate state per thread, reused for all tiles of the level */
+  z_stream            zstreams[GIMP_PARALLEL_MAX_THREADS];
+  gboolean            zstreams_init[GIMP_PARALLEL_MAX_THREADS];
+
+#ifdef HAVE_ZSTD
+  /* likewise, one zstd context per thread */
+  ZSTD_DCtx          *zstd_dctxs[GIMP_PARALLEL_MAX_THREADS];
+#endif
+} XcfLoadTiles;
+
+
 GimpImage *
 xcf_load_image (Gimp     *gimp,
                 XcfInfo  *info,
@@ -687,7 +739,8 @@ xcf_load_image_props (XcfInfo   *info,
             if ((compression != COMPRESS_NONE) &&
                 (compression != COMPRESS_RLE) &&
                 (compression != COMPRESS_ZLIB) &&
-                (compression != COMPRESS_FRACTAL))
+                (compression != COMPRESS_FRACTAL) &&
+                (compression != COMPRESS_ZSTD))
               {
                 gimp_message (info->gimp, G_OBJECT (info->progress),
                               GIMP_MESSAGE_ERROR,
@@ -696,6 +749,18 @@ xcf_load_image_props (XcfInfo   *info,
                 return FALSE;
               }
 
+#ifndef HAVE_ZSTD
+            if (compression == COMPRESS_ZSTD)
+              {
+                gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                      GIMP_MESSAGE_ERROR,
+                                      "This XCF file uses zstd compression, "
+                                      "but GIMP was built without zstd "
+                                      "support.");
+                return FALSE;
+              }
+#endif
+
             info->compression = compression;
 
             gimp_image_set_xcf_compression (image,
@@ -1858,6 +1923,7 @@ xcf_load_buffer (XcfInfo    *info,
   gint        width;
   gint        height;
   gint        bpp;
+  GError     *error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1880,8 +1946,17 @@ xcf_load_buffer (XcfInfo    *info,
     return FALSE;
 
   /* read in the level */
-  if (! xcf_load_level (info, buffer))
-    return FALSE;
+  if (! xcf_load_level (info, buffer, &error))
+    {
+      if (error)
+        {
+          gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                GIMP_MESSAGE_ERROR, error->message);
+          g_clear_error (&error);
+        }
+
+      return FALSE;
+    }
 
   /* discard levels below first.
    */
@@ -1891,22 +1966,23 @@ xcf_load_buffer (XcfInfo    *info,
 
 
 static gboolean
-xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+xcf_load_level (XcfInfo     *info,
+                GeglBuffer  *buffer,
+                GError     **error)
 {
-  const Babl *format;
-  gint        bpp;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     offset2;
-  goffset     max_data_length;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        width;
-  gint        height;
-  gint        i;
-  gint        fail;
+  const Babl   *format;
+  XcfLoadTiles *tiles;
+  gint          bpp;
+  goffset      *offsets;
+  goffset       max_data_length;
+  gint          n_tile_rows;
+  gint          n_tile_cols;
+  guint         ntiles;
+  gint          width;
+  gint          height;
+  gint          batch_size;
+  gint          i, j;
+  gboolean      success = TRUE;
 
   format = gegl_buffer_get_format (buffer);
   bpp    = babl_format_get_bytes_per_pixel (format);
@@ -1925,184 +2001,387 @@ xcf_load_level (XcfInfo    *info,
   max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
                     XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
 
-  /* read in the first tile offset.
-   *  if it is '0', then this tile level is empty
-   *  and we can simply return.
-   */
-  xcf_read_offset (info, &offset, 1);
-  if (offset == 0)
-    return TRUE;
-
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
-  for (i = 0; i < ntiles; i++)
+
+  /* read in the whole offset table, including the terminating '0'.
+   *  if the first offset is '0', then this tile level is empty
+   *  and we can simply return.
+   */
+  offsets = g_new0 (goffset, ntiles + 1);
+
+  xcf_read_offset (info, offsets, 1);
+  if (offsets[0] == 0)
     {
-      GeglRectangle rect;
+      g_free (offsets);
+      return TRUE;
+    }
 
-      fail = FALSE;
+  xcf_read_offset (info, offsets + 1, ntiles);
 
-      if (offset == 0)
+  switch (info->compression)
+    {
+    case COMPRESS_NONE:
+    case COMPRESS_RLE:
+    case COMPRESS_ZLIB:
+#ifdef HAVE_ZSTD
+    case COMPRESS_ZSTD:
+#endif
+      break;
+    case COMPRESS_FRACTAL:
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Fractal compression unimplemented. "
+                             "Possibly corrupt XCF file."));
+      g_free (offsets);
+      return FALSE;
+    default:
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Unknown compression. "
+                             "Possibly corrupt XCF file."));
+      g_free (offsets);
+      return FALSE;
+    }
+
+  for (i = 0; i < ntiles; i++)
+    {
+      if (offsets[i] == 0)
         {
           gimp_message_literal (info->gimp, G_OBJECT (info->progress),
                                 GIMP_MESSAGE_ERROR,
                                 "not enough tiles found in level");
+          g_free (offsets);
           return FALSE;
         }
+    }
 
-      /* save the current position as it is where the
-       *  next tile offset is stored.
-       */
-      saved_pos = info->cp;
+  if (offsets[ntiles] != 0)
+    {
+      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
+                    "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
+                    offsets[ntiles]);
+      g_free (offsets);
+      return FALSE;
+    }
 
-      /* read in the offset of the next tile so we can calculate the amount
-       * of data needed for this tile
-       */
-      xcf_read_offset (info, &offset2, 1);
+  /* read the tile data in batches and decode each batch spread
+   * across all threads.  reading stays sequential, only decoding
+   * and storing the pixels happens concurrently.
+   */
+  batch_size = MIN (ntiles,
+                    gimp_parallel_get_n_threads () * XCF_LOAD_TILES_PER_THREAD);
+
+  tiles = g_new0 (XcfLoadTiles, 1);
+
+  tiles->buffer          = buffer;
+  tiles->format          = format;
+  tiles->bpp             = bpp;
+  tiles->compression     = info->compression;
+  tiles->max_data_length = max_data_length;
+  tiles->data            = g_malloc (batch_size * max_data_length);
+  tiles->data_src        = g_new (const guchar *, batch_size);
+  tiles->data_size       = g_new (gint, batch_size);
+  tiles->errors          = g_new0 (GError *, batch_size);
+
+  for (i = 0; success && i < ntiles; i += batch_size)
+    {
+      tiles->first_tile = i;
+      tiles->n_tiles    = MIN (batch_size, ntiles - i);
+      tiles->next_tile  = 0;
 
-      /* if the offset is 0 then we need to read in the maximum possible
-       * allowing for negative compression
-       */
-      if (offset2 == 0)
-        offset2 = offset + max_data_length;
+      for (j = 0; j < tiles->n_tiles; j++)
+        {
+          goffset offset  = offsets[i + j];
+          goffset offset2 = offsets[i + j + 1];
+          goffset data_length;
+          gsize   bytes_read;
+
+          /* if the next offset is 0 then we need to read in the maximum
+           * possible allowing for negative compression
+           */
+          if (offset2 == 0)
+            offset2 = offset + max_data_length;
+
+          if (offset2 < offset || offset2 - offset > max_data_length)
+            {
+              gimp_message (info->gimp, G_OBJECT (info->progress),
+                            GIMP_MESSAGE_ERROR,
+                            "invalid tile data length: %" G_GOFFSET_FORMAT,
+                            offset2 - offset);
+              success = FALSE;
+              break;
+            }
 
-      /* seek to the tile offset */
-      if (! xcf_seek_pos (info, offset, NULL))
-        return FALSE;
+          if (info->compression == COMPRESS_NONE)
+            {
+              GeglRectangle rect;
+
+              gimp_gegl_buffer_get_tile_rect (buffer,
+                                              XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                              i + j, &rect);
+
+              data_length = rect.width * rect.height * bpp;
+            }
+          else
+            {
+              data_length = offset2 - offset;
+            }
+
+          tiles->data_src[j]  = tiles->data + j * max_data_length;
+          tiles->data_size[j] = 0;
+
+          /* if the file is mapped, decode the tile right from the
+           * mapping, unless it is truncated by the end of the file
+           * and would be read past the mapping
+           */
+          if (info->mapped_data && offset >= 0 &&
+              offset + data_length <= info->mapped_size)
+            {
+              tiles->data_src[j]  = info->mapped_data + offset;
+              tiles->data_size[j] = MAX (data_length, 0);
 
-      if (offset2 < offset || offset2 - offset > max_data_length)
+              continue;
+            }
+
+          /* seek to the tile offset */
+          if (! xcf_seek_pos (info, offset, error))
+            {
+              success = FALSE;
+              break;
+            }
+
+          /* Workaround for bug #357809: a tile with no data is
+           * skipped as if it did not contain any data, see
+           * xcf_load_tiles_func().
+           */
+          if (data_length <= 0)
+            continue;
+
+          /* we have to read directly instead of xcf_read_* because we may be
+           * reading past the end of the file here
+           */
+          g_input_stream_read_all (info->input,
+                                   tiles->data + j * max_data_length,
+                                   data_length,
+                                   &bytes_read, NULL, NULL);
+          info->cp += bytes_read;
+
+          tiles->data_size[j] = bytes_read;
+        }
+
+      if (! success)
+        break;
+
+      GIMP_LOG (XCF, "loading tiles %d-%d/%d",
+                i + 1, i + tiles->n_tiles, ntiles);
+
+      gimp_parallel_distribute (tiles->n_tiles, xcf_load_tiles_func, tiles);
+
+      /* the workers can't report errors themselves, pass the first
+       * one on
+       */
+      if (tiles->failed)
         {
-          gimp_message (info->gimp, G_OBJECT (info->progress),
-                        GIMP_MESSAGE_ERROR,
-                        "invalid tile data length: %" G_GOFFSET_FORMAT,
-                        offset2 - offset);
-          return FALSE;
+          for (j = 0; j < tiles->n_tiles; j++)
+            {
+              if (tiles->errors[j])
+                {
+                  g_propagate_error (error, tiles->errors[j]);
+                  tiles->errors[j] = NULL;
+                  break;
+                }
+            }
+
+          success = FALSE;
         }
+    }
+
+  for (i = 0; i < GIMP_PARALLEL_MAX_THREADS; i++)
+    {
+      if (tiles->zstreams_init[i])
+        inflateEnd (&tiles->zstreams[i]);
+
+#ifdef HAVE_ZSTD
+      if (tiles->zstd_dctxs[i])
+        ZSTD_freeDCtx (tiles->zstd_dctxs[i]);
+#endif
+    }
+
+  for (i = 0; i < batch_size; i++)
+    g_clear_error (&tiles->errors[i]);
 
-      /* get the tile from the tile manager */
-      gimp_gegl_buffer_get_tile_rect (buffer,
+  g_free (tiles->errors);
+  g_free (tiles->data_size);
+  g_free (tiles->data_src);
+  g_free (tiles->data);
+  g_free (tiles);
+  g_free (offsets);
+
+  if (success)
+    {
+      info->n_tiles     += ntiles;
+      info->n_raw_bytes += (goffset) width * height * bpp;
+    }
+
+  return success;
+}
+
+/* decodes and stores tiles of the current batch until there are none
+ * left.  runs concurrently, @i identifies the thread.
+ */
+static void
+xcf_load_tiles_func (gint     i,
+                     gint     n,
+                     gpointer user_data)
+{
+  XcfLoadTiles *tiles     = user_data;
+  gint          tile_size = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * tiles->bpp;
+  guchar       *tile_data = NULL;
+  gint          j;
+
+  if (tiles->compression != COMPRESS_NONE)
+    tile_data = g_alloca (tile_size);
+
+  while ((j = g_atomic_int_add (&tiles->next_tile, 1)) < tiles->n_tiles)
+    {
+      const guchar  *data = tiles->data_src[j];
+      gint           size = tiles->data_size[j];
+      GeglRectangle  rect;
+      gint           n_pixels;
+
+      if (g_atomic_int_get (&tiles->failed))
+        break;
+
+      /* Workaround for bug #357809: avoid crashing on g_malloc() and
+       * skip this tile (without storing data) as if it did not contain
+       * any data.  It is better than failing, which would skip the
+       * whole hierarchy while there may still be some valid tiles in
+       * the file.
+       */
+      if (size <= 0)
+        continue;
+
+      gimp_gegl_buffer_get_tile_rect (tiles->buffer,
                                       XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+                                      tiles->first_tile + j, &rect);
 
-      GIMP_LOG (XCF, "loading tile %d/%d", i + 1, ntiles);
+      n_pixels = rect.width * rect.height;
 
-      /* read in the tile */
-      switch (info->compression)
+      switch (tiles->compression)
         {
         case COMPRESS_NONE:
-          if (!xcf_load_tile (info, buffer, &rect, format))
-            fail = TRUE;
+          gegl_buffer_set (tiles->buffer, &rect, 0, tiles->format, data,
+                           GEGL_AUTO_ROWSTRIDE);
           break;
+
         case COMPRESS_RLE:
-          if (!xcf_load_tile_rle (info, buffer, &rect, format,
-                                  offset2 - offset))
-            fail = TRUE;
+          if (! xcf_load_tile_rle (data, size, tile_data,
+                                   tiles->bpp, n_pixels, &tiles->errors[j]))
+            {
+              g_atomic_int_set (&tiles->failed, TRUE);
+              break;
+            }
+
+          gegl_buffer_set (tiles->buffer, &rect, 0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
           break;
+
         case COMPRESS_ZLIB:
-          if (!xcf_load_tile_zlib (info, buffer, &rect, format,
-                                   offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_FRACTAL:
-          g_printerr ("xcf: fractal compression unimplemented. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
-        default:
-          g_printerr ("xcf: unknown compression. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
-        }
+          if (! tiles->zstreams_init[i])
+            {
+              z_stream *strm = &tiles->zstreams[i];
 
-      if (fail)
-        return FALSE;
+              strm->zalloc   = Z_NULL;
+              strm->zfree    = Z_NULL;
+              strm->opaque   = Z_NULL;
+              strm->next_in  = Z_NULL;
+              strm->avail_in = 0;
 
-      GIMP_LOG (XCF, "loaded tile %d/%d", i + 1, ntiles);
+              /* Initialize the stream decompression. */
+              if (inflateInit (strm) != Z_OK)
+                {
+                  g_set_error (&tiles->errors[j],
+                               G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                               _("Could not initialize tile "
+                                 "decompression: %s"),
+                               strm->msg ? strm->msg : "");
+                  g_atomic_int_set (&tiles->failed, TRUE);
+                  break;
+                }
 
-      /* restore the saved position so we'll be ready to
-       *  read the next offset.
-       */
-      if (!xcf_seek_pos (info, saved_pos, NULL))
-        return FALSE;
+              tiles->zstreams_init[i] = TRUE;
+            }
 
-      /* read in the offset of the next tile */
-      xcf_read_offset (info, &offset, 1);
-    }
+          if (! xcf_load_tile_zlib (&tiles->zstreams[i], data, size,
+                                    tile_data, n_pixels * tiles->bpp,
+                                    &tiles->errors[j]))
+            {
+              g_atomic_int_set (&tiles->failed, TRUE);
+              break;
+            }
 
-  if (offset != 0)
-    {
-      gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
-                    "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
-                    offset);
-      return FALSE;
-    }
+          gegl_buffer_set (tiles->buffer, &rect, 0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
+          break;
 
-  return TRUE;
-}
+#ifdef HAVE_ZSTD
+        case COMPRESS_ZSTD:
+          if (! tiles->zstd_dctxs[i])
+            {
+              tiles->zstd_dctxs[i] = ZSTD_createDCtx ();
 
-static gboolean
-xcf_load_tile (XcfInfo       *info,
-               GeglBuffer    *buffer,
-               GeglRectangle *tile_rect,
-               const Babl    *format)
-{
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
+              if (! tiles->zstd_dctxs[i])
+                {
+                  g_set_error_literal (&tiles->errors[j],
+                                       G_FILE_ERROR, G_FILE_ERROR_NOMEM,
+                                       _("Could not initialize tile "
+                                         "decompression"));
+                  g_atomic_int_set (&tiles->failed, TRUE);
+                  break;
+                }
+            }
 
-  xcf_read_int8 (info, tile_data, tile_size);
+          if (! xcf_load_tile_zstd (tiles->zstd_dctxs[i], data, size,
+                                    tile_data, n_pixels * tiles->bpp,
+                                    &tiles->errors[j]))
+            {
+              g_atomic_int_set (&tiles->failed, TRUE);
+              break;
+            }
 
-  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE);
+          gegl_buffer_set (tiles->buffer, &rect, 0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
+          break;
+#endif
 
-  return TRUE;
+        default:
+          g_set_error (&tiles->errors[j], G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Unsupported tile compression: %d"),
+                       tiles->compression);
+          g_atomic_int_set (&tiles->failed, TRUE);
+          break;
+        }
+    }
 }
 
 static gboolean
-xcf_load_tile_rle (XcfInfo       *info,
-                   GeglBuffer    *buffer,
-                   GeglRectangle *tile_rect,
-                   const Babl    *format,
-                   gint           data_length)
+xcf_load_tile_rle (const guchar  *xcfdata,
+                   gint           data_length,
+                   guchar        *tile_data,
+                   gint           bpp,
+                   gint           n_pixels,
+                   GError       **error)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gsize   bytes_read;
-  gint    i;
-  guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
-
-  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
-   * this tile (return TRUE without storing data) as if it did not
-   * contain any data.  It is better than returning FALSE, which would
-   * skip the whole hierarchy while there may still be some valid
-   * tiles in the file.
-   */
-  if (data_length <= 0)
-    return TRUE;
-
-  xcfdata = xcfodata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
+  const guchar *xcfdatalimit;
+  gint          i;
 
-  xcfdatalimit = &xcfodata[bytes_read - 1];
+  xcfdatalimit = &xcfdata[data_length - 1];
 
   for (i = 0; i < bpp; i++)
     {
       guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
+      gint    size  = n_pixels;
       gint    count = 0;
       guchar  val;
       gint    length;
@@ -2189,76 +2468,52 @@ xcf_load_tile_rle (XcfInfo       *info,
         }
     }
 
-  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE);
-
   return TRUE;
 
  bogus_rle:
+  g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Invalid RLE tile data. "
+                         "Possibly corrupt XCF file."));
   return FALSE;
 }
 
+/* decompresses @xcfdata into @tile_data using @strm, which is reset
+ * first so that it can be reused for any number of tiles.
+ */
 static gboolean
-xcf_load_tile_zlib (XcfInfo       *info,
-                    GeglBuffer    *buffer,
-                    GeglRectangle *tile_rect,
-                    const Babl    *format,
-                    gint           data_length)
+xcf_load_tile_zlib (z_stream      *strm,
+                    const guchar  *xcfdata,
+                    gint           data_length,
+                    guchar        *tile_data,
+                    gint           tile_size,
+                    GError       **error)
 {
-  z_stream  strm;
-  int       action;
-  int       status;
-  gint      bpp       = babl_format_get_bytes_per_pixel (format);
-  gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  gsize     bytes_read;
-  guchar   *xcfdata;
-
-  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
-   * this tile (return TRUE without storing data) as if it did not
-   * contain any data.  It is better than returning FALSE, which would
-   * skip the whole hierarchy while there may still be some valid
-   * tiles in the file.
-   */
-  if (data_length <= 0)
-    return TRUE;
-
-  xcfdata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
+  int action;
+  int status;
 
-  if (bytes_read == 0)
-    return TRUE;
-
-  strm.next_out  = tile_data;
-  strm.avail_out = tile_size;
-
-  strm.zalloc    = Z_NULL;
-  strm.zfree     = Z_NULL;
-  strm.opaque    = Z_NULL;
-  strm.next_in   = xcfdata;
-  strm.avail_in  = bytes_read;
-
-  /* Initialize the stream decompression. */
-  status = inflateInit (&strm);
+  status = inflateReset (strm);
   if (status != Z_OK)
-    return FALSE;
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Tile decompression failed: %s"), zError (status));
+      return FALSE;
+    }
+
+  strm->next_out  = tile_data;
+  strm->avail_out = tile_size;
+  strm->next_in   = (Bytef *) xcfdata;
+  strm->avail_in  = data_length;
 
   action = Z_NO_FLUSH;
 
   while (status == Z_OK)
     {
-      if (strm.avail_in == 0)
+      if (strm->avail_in == 0)
         {
           action = Z_FINISH;
         }
 
-      status = inflate (&strm, action);
+      status = inflate (strm, action);
 
       if (status == Z_STREAM_END)
         {
@@ -2267,24 +2522,74 @@ xcf_load_tile_zlib (XcfInfo       *info,
         }
       else if (status == Z_BUF_ERROR)
         {
-          g_printerr ("xcf: decompressed tile bigger than the expected size.");
-          inflateEnd (&strm);
+          g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                               _("Decompressed tile bigger than the "
+                                 "expected size."));
           return FALSE;
         }
       else if (status != Z_OK)
         {
-          g_printerr ("xcf: tile decompression failed: %s", zError (status));
-          inflateEnd (&strm);
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Tile decompression failed: %s"), zError (status));
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+#ifdef HAVE_ZSTD
+/* decompresses the zstd frame at the start of @xcfdata into
+ * @tile_data.  the streaming API is used because for the last tile of
+ * a level, @xcfdata extends past the end of the frame.
+ */
+static gboolean
+xcf_load_tile_zstd (ZSTD_DCtx     *dctx,
+                    const guchar  *xcfdata,
+                    gint           data_length,
+                    guchar        *tile_data,
+                    gint           tile_size,
+                    GError       **error)
+{
+  ZSTD_inBuffer  input  = { xcfdata,   data_length, 0 };
+  ZSTD_outBuffer output = { tile_data, tile_size,   0 };
+  size_t         status;
+
+  status = ZSTD_initDStream (dctx);
+
+  while (! ZSTD_isError (status))
+    {
+      size_t in_pos  = input.pos;
+      size_t out_pos = output.pos;
+
+      status = ZSTD_decompressStream (dctx, &output, &input);
+
+      if (status == 0)
+        {
+          /* All the data was successfully decoded. */
+          break;
+        }
+      else if (! ZSTD_isError (status) &&
+               input.pos == in_pos && output.pos == out_pos)
+        {
+          g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                               _("Decompressed tile bigger than the "
+                                 "expected size, or truncated tile data."));
           return FALSE;
         }
     }
 
-  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE);
+  if (ZSTD_isError (status))
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Tile decompression failed: %s"),
+                   ZSTD_getErrorName (status));
+      return FALSE;
+    }
 
-  inflateEnd (&strm);
   return TRUE;
 }
+#endif
 
 static GimpParasite *
 xcf_load_parasite (XcfInfo *info)
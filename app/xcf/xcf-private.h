@@ -22,6 +22,7 @@
 #define XCF_TILE_WIDTH                  64
 #define XCF_TILE_HEIGHT                 64
 #define XCF_TILE_MAX_DATA_LENGTH_FACTOR 1.5
+#define XCF_ZSTD_COMPRESSION_LEVEL      1
 
 typedef enum
 {
@@ -70,8 +71,9 @@ typedef enum
 {
   COMPRESS_NONE              =  0,
   COMPRESS_RLE               =  1,
-  COMPRESS_ZLIB              =  2,  /* unused */
-  COMPRESS_FRACTAL           =  3   /* unused */
+  COMPRESS_ZLIB              =  2,
+  COMPRESS_FRACTAL           =  3,  /* unused */
+  COMPRESS_ZSTD              =  4   /* needs HAVE_ZSTD */
 } XcfCompressionType;
 
 typedef enum
@@ -111,6 +113,16 @@ struct _XcfInfo
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
   gint                file_version;
+
+  /* the whole file, if it is memory-mapped; tile data is then decoded
+   * straight from here instead of being read from the stream
+   */
+  const guchar       *mapped_data;
+  gsize               mapped_size;
+
+  /* statistics, see GIMP_LOG=xcf */
+  gint64              n_tiles;
+  goffset             n_raw_bytes;
 };
 
 
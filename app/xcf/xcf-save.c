@@ -20,6 +20,11 @@
 #include <string.h>
 #include <zlib.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <zstd_errors.h>
+#endif
+
 #include <cairo.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -33,6 +38,7 @@
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
@@ -101,22 +107,28 @@ static gboolean xcf_save_buffer        (XcfInfo           *info,
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
+static void     xcf_save_tiles_func    (gint               i,
+                                        gint               n,
+                                        gpointer           user_data);
+static gint     xcf_save_tile_rle      (const guchar      *tile_data,
+                                        gint               bpp,
+                                        gint               n_pixels,
                                         guchar            *rlebuf,
                                         GError           **error);
-static gboolean xcf_save_tile_zlib     (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
+static gint     xcf_save_tile_zlib     (z_stream          *strm,
+                                        const guchar      *tile_data,
+                                        gint               tile_size,
+                                        guchar            *buf,
+                                        gint               buf_size,
                                         GError           **error);
+#ifdef HAVE_ZSTD
+static gint     xcf_save_tile_zstd     (ZSTD_CCtx         *cctx,
+                                        const guchar      *tile_data,
+                                        gint               tile_size,
+                                        guchar            *buf,
+                                        gint               buf_size,
+                                        GError           **error);
+#endif
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
                                         GError           **error);
@@ -131,6 +143,40 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
                                         GError           **error);
 
 
+/* the number of tiles each thread compresses per batch in
+ * xcf_save_level().  the compressed data of a whole batch is kept in
+ * memory until it is written out in order.
+ */
+#define XCF_SAVE_TILES_PER_THREAD 8
+
+
+typedef struct
+{
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  gint                bpp;
+  XcfCompressionType  compression;
+
+  gint                first_tile;
+  gint                n_tiles;
+  volatile gint       next_tile;
+
+  goffset             max_data_length;
+  guchar             *data;       /* n_tiles * max_data_length bytes */
+  gint               *data_size;  /* compressed size per tile, or -1 */
+  GError            **errors;     /* per tile, set when data_size is -1 */
+
+  /* one deflate state per thread, reused for all tiles of the level */
+  z_stream            zstreams[GIMP_PARALLEL_MAX_THREADS];
+  gboolean            zstreams_init[GIMP_PARALLEL_MAX_THREADS];
+
+#ifdef HAVE_ZSTD
+  /* likewise, one zstd context per thread */
+  ZSTD_CCtx          *zstd_cctxs[GIMP_PARALLEL_MAX_THREADS];
+#endif
+} XcfSaveTiles;
+
+
 /* private convenience macros */
 #define xcf_write_int32_check_error(info, data, count) G_STMT_START { \
   xcf_write_int32 (info, data, count, &tmp_error);                    \
@@ -1496,21 +1542,29 @@ xcf_save_level (XcfInfo     *info,
                 GeglBuffer  *buffer,
                 GError     **error)
 {
-  const Babl *format;
-  goffset    *offset_table;
-  goffset    *next_offset;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     max_data_length;
-  guint32     width;
-  guint32     height;
-  gint        bpp;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        i;
-  guchar     *rlebuf    = NULL;
-  GError     *tmp_error = NULL;
+  const Babl   *format;
+  XcfSaveTiles *tiles;
+  goffset      *offset_table;
+  goffset      *next_offset;
+  goffset       saved_pos;
+  goffset       offset;
+  goffset       max_data_length;
+  guint32       width;
+  guint32       height;
+  gint          bpp;
+  gint          n_tile_rows;
+  gint          n_tile_cols;
+  guint         ntiles;
+  gint          batch_size;
+  gint          i, j;
+  gboolean      success   = TRUE;
+  GError       *tmp_error = NULL;
+
+  if (info->compression == COMPRESS_FRACTAL)
+    {
+      g_warning ("xcf: fractal compression unimplemented");
+      return FALSE;
+    }
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1530,12 +1584,6 @@ xcf_save_level (XcfInfo     *info,
   max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
                     XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
 
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
-   */
-  if (info->compression == COMPRESS_RLE)
-    rlebuf = g_alloca (max_data_length);
-
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
@@ -1558,51 +1606,102 @@ xcf_save_level (XcfInfo     *info,
   /* 'offset' is where we will write the next tile */
   offset = info->cp;
 
-  for (i = 0; i < ntiles; i++)
-    {
-      GeglRectangle rect;
+  /* fetch and compress the tiles in batches, spread across all
+   * threads, and write each batch out in order once it's done.  the
+   * written data is identical to compressing the tiles one by one.
+   */
+  batch_size = MIN (ntiles,
+                    gimp_parallel_get_n_threads () * XCF_SAVE_TILES_PER_THREAD);
 
-      /* store the offset in the table and increment the next pointer */
-      *next_offset++ = offset;
+  tiles = g_new0 (XcfSaveTiles, 1);
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+  tiles->buffer          = buffer;
+  tiles->format          = format;
+  tiles->bpp             = bpp;
+  tiles->compression     = info->compression;
+  tiles->max_data_length = max_data_length;
+  tiles->data            = g_malloc (batch_size * max_data_length);
+  tiles->data_size       = g_new (gint, batch_size);
+  tiles->errors          = g_new0 (GError *, batch_size);
 
-      /* write out the tile. */
-      switch (info->compression)
-        {
-        case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
-          break;
-        case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
-          break;
-        case COMPRESS_ZLIB:
-          xcf_check_error (xcf_save_tile_zlib (info, buffer, &rect, format,
-                                               error));
-          break;
-        case COMPRESS_FRACTAL:
-          g_warning ("xcf: fractal compression unimplemented");
-          return FALSE;
-        }
+  for (i = 0; success && i < ntiles; i += batch_size)
+    {
+      tiles->first_tile = i;
+      tiles->n_tiles    = MIN (batch_size, ntiles - i);
+      tiles->next_tile  = 0;
 
-      /* make sure the on-disk tile data didn't end up being too big.
-       * xcf_load_level() would refuse to load the file if it did.
-       */
-      if (info->cp < offset || info->cp - offset > max_data_length)
+      gimp_parallel_distribute (tiles->n_tiles, xcf_save_tiles_func, tiles);
+
+      for (j = 0; j < tiles->n_tiles; j++)
         {
-          g_message ("xcf: invalid tile data length: %" G_GOFFSET_FORMAT,
-                     info->cp - offset);
-          return FALSE;
+          gint size = tiles->data_size[j];
+
+          /* store the offset in the table and increment the next pointer */
+          *next_offset++ = offset;
+
+          /* the workers can't report errors themselves, pass the
+           * first one on
+           */
+          if (size < 0)
+            {
+              g_propagate_error (error, tiles->errors[j]);
+              tiles->errors[j] = NULL;
+              success = FALSE;
+              break;
+            }
+
+          /* make sure the on-disk tile data didn't end up being too big.
+           * xcf_load_level() would refuse to load the file if it did.
+           */
+          if (size > max_data_length)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Invalid tile data length: %d"), size);
+              success = FALSE;
+              break;
+            }
+
+          /* write out the tile. */
+          xcf_write_int8 (info, tiles->data + j * max_data_length, size,
+                          &tmp_error);
+
+          if (tmp_error)
+            {
+              g_propagate_error (error, tmp_error);
+              success = FALSE;
+              break;
+            }
+
+          /* the next tile's offset is after the tile we just wrote */
+          offset = info->cp;
         }
+    }
 
-      /* the next tile's offset is after the tile we just wrote */
-      offset = info->cp;
+  for (i = 0; i < GIMP_PARALLEL_MAX_THREADS; i++)
+    {
+      if (tiles->zstreams_init[i])
+        deflateEnd (&tiles->zstreams[i]);
+
+#ifdef HAVE_ZSTD
+      if (tiles->zstd_cctxs[i])
+        ZSTD_freeCCtx (tiles->zstd_cctxs[i]);
+#endif
     }
 
+  for (i = 0; i < batch_size; i++)
+    g_clear_error (&tiles->errors[i]);
+
+  g_free (tiles->errors);
+  g_free (tiles->data_size);
+  g_free (tiles->data);
+  g_free (tiles);
+
+  if (! success)
+    return FALSE;
+
+  info->n_tiles     += ntiles;
+  info->n_raw_bytes += (goffset) width * height * bpp;
+
   /* seek back to the offset table and write it  */
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
   xcf_write_offset_check_error (info, offset_table, ntiles + 1);
@@ -1613,43 +1712,134 @@ xcf_save_level (XcfInfo     *info,
   return TRUE;
 }
 
-static gboolean
-xcf_save_tile (XcfInfo        *info,
-               GeglBuffer     *buffer,
-               GeglRectangle  *tile_rect,
-               const Babl     *format,
-               GError        **error)
+/* fetches and compresses tiles of the current batch until there are
+ * none left.  runs concurrently, @i identifies the thread.
+ */
+static void
+xcf_save_tiles_func (gint     i,
+                     gint     n,
+                     gpointer user_data)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  XcfSaveTiles *tiles     = user_data;
+  gint          tile_size = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * tiles->bpp;
+  guchar       *tile_data = NULL;
+  gint          j;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  if (tiles->compression != COMPRESS_NONE)
+    tile_data = g_alloca (tile_size);
 
-  xcf_write_int8_check_error (info, tile_data, tile_size);
+  while ((j = g_atomic_int_add (&tiles->next_tile, 1)) < tiles->n_tiles)
+    {
+      guchar        *data = tiles->data + j * tiles->max_data_length;
+      GeglRectangle  rect;
+      gint           n_pixels;
 
-  return TRUE;
+      gimp_gegl_buffer_get_tile_rect (tiles->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      tiles->first_tile + j, &rect);
+
+      n_pixels = rect.width * rect.height;
+
+      switch (tiles->compression)
+        {
+        case COMPRESS_NONE:
+          gegl_buffer_get (tiles->buffer, &rect, 1.0, tiles->format, data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          tiles->data_size[j] = n_pixels * tiles->bpp;
+          break;
+
+        case COMPRESS_RLE:
+          gegl_buffer_get (tiles->buffer, &rect, 1.0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          tiles->data_size[j] = xcf_save_tile_rle (tile_data, tiles->bpp,
+                                                   n_pixels, data,
+                                                   &tiles->errors[j]);
+          break;
+
+        case COMPRESS_ZLIB:
+          if (! tiles->zstreams_init[i])
+            {
+              z_stream *strm = &tiles->zstreams[i];
+
+              /* allocate deflate state */
+              strm->zalloc = Z_NULL;
+              strm->zfree  = Z_NULL;
+              strm->opaque = Z_NULL;
+
+              if (deflateInit (strm, Z_DEFAULT_COMPRESSION) != Z_OK)
+                {
+                  g_set_error (&tiles->errors[j],
+                               G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                               _("Could not initialize tile compression: %s"),
+                               strm->msg ? strm->msg : "");
+                  tiles->data_size[j] = -1;
+                  break;
+                }
+
+              tiles->zstreams_init[i] = TRUE;
+            }
+
+          gegl_buffer_get (tiles->buffer, &rect, 1.0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          tiles->data_size[j] = xcf_save_tile_zlib (&tiles->zstreams[i],
+                                                    tile_data,
+                                                    n_pixels * tiles->bpp,
+                                                    data,
+                                                    tiles->max_data_length,
+                                                    &tiles->errors[j]);
+          break;
+
+#ifdef HAVE_ZSTD
+        case COMPRESS_ZSTD:
+          if (! tiles->zstd_cctxs[i])
+            {
+              tiles->zstd_cctxs[i] = ZSTD_createCCtx ();
+
+              if (! tiles->zstd_cctxs[i])
+                {
+                  g_set_error_literal (&tiles->errors[j],
+                                       G_FILE_ERROR, G_FILE_ERROR_NOMEM,
+                                       _("Could not initialize tile "
+                                         "compression"));
+                  tiles->data_size[j] = -1;
+                  break;
+                }
+            }
+
+          gegl_buffer_get (tiles->buffer, &rect, 1.0, tiles->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          tiles->data_size[j] = xcf_save_tile_zstd (tiles->zstd_cctxs[i],
+                                                    tile_data,
+                                                    n_pixels * tiles->bpp,
+                                                    data,
+                                                    tiles->max_data_length,
+                                                    &tiles->errors[j]);
+          break;
+#endif
+
+        default:
+          g_set_error (&tiles->errors[j], G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Unsupported tile compression: %d"),
+                       tiles->compression);
+          tiles->data_size[j] = -1;
+          break;
+        }
+    }
 }
 
-static gboolean
-xcf_save_tile_rle (XcfInfo        *info,
-                   GeglBuffer     *buffer,
-                   GeglRectangle  *tile_rect,
-                   const Babl     *format,
-                   guchar         *rlebuf,
-                   GError        **error)
+static gint
+xcf_save_tile_rle (const guchar  *tile_data,
+                   gint           bpp,
+                   gint           n_pixels,
+                   guchar        *rlebuf,
+                   GError       **error)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gint    len       = 0;
-  gint    i, j;
-  GError *tmp_error  = NULL;
-
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gint len = 0;
+  gint i, j;
 
   for (i = 0; i < bpp; i++)
     {
@@ -1657,7 +1847,7 @@ xcf_save_tile_rle (XcfInfo        *info,
       gint          state  = 0;
       gint          length = 0;
       gint          count  = 0;
-      gint          size   = tile_rect->width * tile_rect->height;
+      gint          size   = n_pixels;
       guint         last   = -1;
 
       while (size > 0)
@@ -1750,82 +1940,99 @@ xcf_save_tile_rle (XcfInfo        *info,
             }
         }
 
-      if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
+      if (count != n_pixels)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("RLE tile compression failed: %d of %d pixels"),
+                       count, n_pixels);
+          return -1;
+        }
     }
 
-  xcf_write_int8_check_error (info, rlebuf, len);
-
-  return TRUE;
+  return len;
 }
 
-static gboolean
-xcf_save_tile_zlib (XcfInfo        *info,
-                    GeglBuffer     *buffer,
-                    GeglRectangle  *tile_rect,
-                    const Babl     *format,
-                    GError        **error)
+/* compresses @tile_data into @buf using @strm, which is reset first
+ * so that it can be reused for any number of tiles.  returns the
+ * compressed size, or -1 on failure, setting @error.
+ */
+static gint
+xcf_save_tile_zlib (z_stream      *strm,
+                    const guchar  *tile_data,
+                    gint           tile_size,
+                    guchar        *buf,
+                    gint           buf_size,
+                    GError       **error)
 {
-  gint      bpp       = babl_format_get_bytes_per_pixel (format);
-  gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  /* The buffer for compressed data. */
-  guchar   *buf       = g_alloca (tile_size);
-  GError   *tmp_error = NULL;
-  z_stream  strm;
-  int       action;
-  int       status;
-
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-  /* allocate deflate state */
-  strm.zalloc = Z_NULL;
-  strm.zfree  = Z_NULL;
-  strm.opaque = Z_NULL;
-
-  status = deflateInit (&strm, Z_DEFAULT_COMPRESSION);
+  int status;
+
+  status = deflateReset (strm);
   if (status != Z_OK)
-    return FALSE;
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Tile compression failed: %s"), zError (status));
+      return -1;
+    }
 
-  strm.next_in   = tile_data;
-  strm.avail_in  = tile_size;
-  strm.next_out  = buf;
-  strm.avail_out = tile_size;
+  strm->next_in   = (Bytef *) tile_data;
+  strm->avail_in  = tile_size;
+  strm->next_out  = buf;
+  strm->avail_out = buf_size;
 
-  action = Z_NO_FLUSH;
+  status = deflate (strm, Z_FINISH);
 
-  while (status == Z_OK || status == Z_BUF_ERROR)
+  if (status == Z_OK || status == Z_BUF_ERROR)
     {
-      if (strm.avail_in == 0)
-        {
-          /* Finish the encoding. */
-          action = Z_FINISH;
-        }
+      /* the output didn't fit into buf_size, let xcf_save_level()
+       * complain about the tile data length
+       */
+      return buf_size + 1;
+    }
+  else if (status != Z_STREAM_END)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Tile compression failed: %s"), zError (status));
+      return -1;
+    }
 
-      status = deflate (&strm, action);
+  return buf_size - strm->avail_out;
+}
 
-      if (status == Z_STREAM_END || status == Z_BUF_ERROR)
-        {
-          size_t write_size = tile_size - strm.avail_out;
+#ifdef HAVE_ZSTD
+/* compresses @tile_data into @buf as a single zstd frame, reusing
+ * @cctx.  returns the compressed size, or -1 on failure, setting
+ * @error.
+ */
+static gint
+xcf_save_tile_zstd (ZSTD_CCtx     *cctx,
+                    const guchar  *tile_data,
+                    gint           tile_size,
+                    guchar        *buf,
+                    gint           buf_size,
+                    GError       **error)
+{
+  size_t size;
 
-          xcf_write_int8_check_error (info, buf, write_size);
+  size = ZSTD_compressCCtx (cctx, buf, buf_size, tile_data, tile_size,
+                            XCF_ZSTD_COMPRESSION_LEVEL);
 
-          /* Reset next_out and avail_out. */
-          strm.next_out  = buf;
-          strm.avail_out = tile_size;
-        }
-      else if (status != Z_OK)
-        {
-          g_printerr ("xcf: tile compression failed: %s", zError (status));
-          deflateEnd (&strm);
-          return FALSE;
-        }
+  if (ZSTD_isError (size))
+    {
+      /* most likely the output didn't fit into buf_size, let
+       * xcf_save_level() complain about the tile data length
+       */
+      if (ZSTD_getErrorCode (size) == ZSTD_error_dstSize_tooSmall)
+        return buf_size + 1;
+
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("Tile compression failed: %s"),
+                   ZSTD_getErrorName (size));
+      return -1;
     }
 
-  deflateEnd (&strm);
-  return TRUE;
+  return size;
 }
+#endif
 
 static gboolean
 xcf_save_parasite (XcfInfo       *info,
@@ -29,6 +29,8 @@
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
 #include "core/gimpimage.h"
 #include "core/gimpparamspecs.h"
@@ -43,6 +45,7 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 
+#include "gimp-log.h"
 #include "gimp-intl.h"
 
 
@@ -51,6 +54,14 @@ typedef GimpImage * GimpXcfLoaderFunc (Gimp     *gimp,
                                        GError  **error);
 
 
+static GimpImage      * xcf_load_stream_real (Gimp                  *gimp,
+                                              GInputStream          *input,
+                                              const guchar          *mapped_data,
+                                              gsize                  mapped_size,
+                                              GFile                 *input_file,
+                                              GimpProgress          *progress,
+                                              GError               **error);
+
 static GimpValueArray * xcf_load_invoker (GimpProcedure         *procedure,
                                           Gimp                  *gimp,
                                           GimpContext           *context,
@@ -78,7 +89,8 @@ static GimpXcfLoaderFunc * const xcf_loaders[] =
   xcf_load_image,   /* version  8 */
   xcf_load_image,   /* version  9 */
   xcf_load_image,   /* version 10 */
-  xcf_load_image    /* version 11 */
+  xcf_load_image,   /* version 11 */
+  xcf_load_image    /* version 12 */
 };
 
 
@@ -252,18 +264,77 @@ xcf_load_stream (Gimp          *gimp,
                  GimpProgress  *progress,
                  GError       **error)
 {
-  XcfInfo      info  = { 0, };
-  const gchar *filename;
-  GimpImage   *image = NULL;
-  gchar        id[14];
-  gboolean     success;
-
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
   g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
   g_return_val_if_fail (input_file == NULL || G_IS_FILE (input_file), NULL);
   g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+  return xcf_load_stream_real (gimp, input, NULL, 0,
+                               input_file, progress, error);
+}
+
+/**
+ * xcf_load_mapped_file:
+ * @gimp:       a #Gimp
+ * @mapped:     a #GMappedFile of the XCF file
+ * @input_file: the mapped file
+ * @progress:   a #GimpProgress, or %NULL
+ * @error:      return location for errors
+ *
+ * Loads an XCF file from a memory mapping.  Unlike xcf_load_stream(),
+ * the tile data is decoded directly from the mapping, without reading
+ * it into intermediate buffers first.
+ *
+ * Return value: the loaded image, or %NULL.
+ **/
+GimpImage *
+xcf_load_mapped_file (Gimp          *gimp,
+                      GMappedFile   *mapped,
+                      GFile         *input_file,
+                      GimpProgress  *progress,
+                      GError       **error)
+{
+  GBytes       *bytes;
+  GInputStream *input;
+  GimpImage    *image;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (mapped != NULL, NULL);
+  g_return_val_if_fail (G_IS_FILE (input_file), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  bytes = g_mapped_file_get_bytes (mapped);
+  input = g_memory_input_stream_new_from_bytes (bytes);
+
+  image = xcf_load_stream_real (gimp, input,
+                                g_bytes_get_data (bytes, NULL),
+                                g_bytes_get_size (bytes),
+                                input_file, progress, error);
+
+  g_object_unref (input);
+  g_bytes_unref (bytes);
+
+  return image;
+}
+
+static GimpImage *
+xcf_load_stream_real (Gimp          *gimp,
+                      GInputStream  *input,
+                      const guchar  *mapped_data,
+                      gsize          mapped_size,
+                      GFile         *input_file,
+                      GimpProgress  *progress,
+                      GError       **error)
+{
+  XcfInfo      info  = { 0, };
+  const gchar *filename;
+  GimpImage   *image = NULL;
+  gchar        id[14];
+  GTimer      *timer;
+  gboolean     success;
+
   if (input_file)
     filename = gimp_file_get_utf8_name (input_file);
   else
@@ -276,6 +347,8 @@ xcf_load_stream (Gimp          *gimp,
   info.progress         = progress;
   info.file             = input_file;
   info.compression      = COMPRESS_NONE;
+  info.mapped_data      = mapped_data;
+  info.mapped_size      = mapped_size;
 
   if (progress)
     gimp_progress_start (progress, FALSE, _("Opening '%s'"), filename);
@@ -309,8 +382,21 @@ xcf_load_stream (Gimp          *gimp,
       if (info.file_version >= 0 &&
           info.file_version < G_N_ELEMENTS (xcf_loaders))
         {
+          timer = g_timer_new ();
+
           image = (*(xcf_loaders[info.file_version])) (gimp, &info, error);
 
+          GIMP_LOG (XCF, "loaded %" G_GINT64_FORMAT " tiles, "
+                    "%" G_GOFFSET_FORMAT " bytes "
+                    "in %f seconds (%.1f MB/s uncompressed%s)",
+                    info.n_tiles, info.n_raw_bytes,
+                    g_timer_elapsed (timer, NULL),
+                    info.n_raw_bytes / 1048576.0 /
+                    MAX (g_timer_elapsed (timer, NULL), 1e-6),
+                    info.mapped_data ? ", mapped" : "");
+
+          g_timer_destroy (timer);
+
           if (! image)
             success = FALSE;
 
@@ -341,6 +427,7 @@ xcf_save_stream (Gimp           *gimp,
 {
   XcfInfo      info     = { 0, };
   const gchar *filename;
+  GTimer      *timer;
   gboolean     success  = FALSE;
   GError      *my_error = NULL;
 
@@ -364,12 +451,21 @@ xcf_save_stream (Gimp           *gimp,
   info.file             = output_file;
 
   if (gimp_image_get_xcf_compression (image))
-    info.compression = COMPRESS_ZLIB;
+    {
+#ifdef HAVE_ZSTD
+      if (gimp->config->xcf_fast_compression)
+        info.compression = COMPRESS_ZSTD;
+      else
+#endif
+        info.compression = COMPRESS_ZLIB;
+    }
   else
-    info.compression = COMPRESS_RLE;
+    {
+      info.compression = COMPRESS_RLE;
+    }
 
   info.file_version = gimp_image_get_xcf_version (image,
-                                                  info.compression ==
+                                                  info.compression >=
                                                   COMPRESS_ZLIB,
                                                   NULL, NULL);
 
@@ -379,8 +475,20 @@ xcf_save_stream (Gimp           *gimp,
   if (progress)
     gimp_progress_start (progress, FALSE, _("Saving '%s'"), filename);
 
+  timer = g_timer_new ();
+
   success = xcf_save_image (&info, image, &my_error);
 
+  GIMP_LOG (XCF, "saved %" G_GINT64_FORMAT " tiles, "
+            "%" G_GOFFSET_FORMAT " -> %" G_GOFFSET_FORMAT " bytes "
+            "in %f seconds (%.1f MB/s uncompressed)",
+            info.n_tiles, info.n_raw_bytes, info.cp,
+            g_timer_elapsed (timer, NULL),
+            info.n_raw_bytes / 1048576.0 /
+            MAX (g_timer_elapsed (timer, NULL), 1e-6));
+
+  g_timer_destroy (timer);
+
   if (success)
     {
       if (progress)
@@ -414,6 +522,8 @@ xcf_load_invoker (GimpProcedure         *procedure,
   GimpImage      *image = NULL;
   const gchar    *uri;
   GFile          *file;
+  gchar          *path;
+  GMappedFile    *mapped = NULL;
   GInputStream   *input;
   GError         *my_error = NULL;
 
@@ -422,19 +532,40 @@ xcf_load_invoker (GimpProcedure         *procedure,
   uri  = g_value_get_string (gimp_value_array_index (args, 1));
   file = g_file_new_for_uri (uri);
 
-  input = G_INPUT_STREAM (g_file_read (file, NULL, &my_error));
+  /*  map local files, so the tile data doesn't have to be copied
+   *  around; fall back to reading the file as a stream otherwise
+   */
+  path = g_file_get_path (file);
 
-  if (input)
+  if (path)
     {
-      image = xcf_load_stream (gimp, input, file, progress, error);
+      mapped = g_mapped_file_new (path, FALSE, NULL);
 
-      g_object_unref (input);
+      g_free (path);
+    }
+
+  if (mapped)
+    {
+      image = xcf_load_mapped_file (gimp, mapped, file, progress, error);
+
+      g_mapped_file_unref (mapped);
     }
   else
     {
-      g_propagate_prefixed_error (error, my_error,
-                                  _("Could not open '%s' for reading: "),
-                                  gimp_file_get_utf8_name (file));
+      input = G_INPUT_STREAM (g_file_read (file, NULL, &my_error));
+
+      if (input)
+        {
+          image = xcf_load_stream (gimp, input, file, progress, error);
+
+          g_object_unref (input);
+        }
+      else
+        {
+          g_propagate_prefixed_error (error, my_error,
+                                      _("Could not open '%s' for reading: "),
+                                      gimp_file_get_utf8_name (file));
+        }
     }
 
   g_object_unref (file);
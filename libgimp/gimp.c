@@ -125,7 +125,7 @@
  **/
 
 
-#define TILE_MAP_SIZE (_tile_width * _tile_height * 32)
+#define TILE_MAP_SIZE (_tile_width * _tile_height * 32 * MAX (_shm_n_tiles, 1))
 
 #define ERRMSG_SHM_FAILED "Could not attach to gimp shared memory segment"
 
@@ -144,8 +144,9 @@ typedef enum
 
 #define WRITE_BUFFER_SIZE  1024
 
-void gimp_read_expect_msg   (GimpWireMessage *msg,
+void  gimp_read_expect_msg  (GimpWireMessage *msg,
                              gint             type);
+gsize _gimp_shm_size        (void);
 
 
 static void       gimp_close                   (void);
@@ -180,6 +181,13 @@ static void       gimp_set_pdb_error           (const GimpParam *return_vals,
                                                 gint             n_return_vals);
 
 
+struct _GimpProcBatch
+{
+  GArray            *procs;    /* of GPProcRun */
+  GPProcReturnBatch *returns;  /* set by gimp_proc_batch_run() */
+};
+
+
 static GIOChannel *_readchannel  = NULL;
 GIOChannel *_writechannel = NULL;
 
@@ -190,6 +198,7 @@ static HANDLE shm_handle;
 static gint           _tile_width        = -1;
 static gint           _tile_height       = -1;
 static gint           _shm_ID            = -1;
+static gint           _shm_n_tiles       = 0;
 static guchar        *_shm_addr          = NULL;
 static const gdouble  _gamma_val         = 2.2;
 static gboolean       _install_cmap      = FALSE;
@@ -1139,6 +1148,171 @@ gimp_run_procedure2 (const gchar     *name,
   return return_vals;
 }
 
+/**
+ * gimp_proc_batch_new:
+ *
+ * Creates a new, empty batch of procedure calls.
+ *
+ * Procedure calls added to the batch with gimp_proc_batch_add() are
+ * not run until gimp_proc_batch_run() is called, which sends all of
+ * them to the GIMP core at once and waits only once for their return
+ * values.  This saves a round-trip per call for plug-ins that run many
+ * procedures whose results they don't need immediately.
+ *
+ * Return value: a new #GimpProcBatch, to be freed with
+ *               gimp_proc_batch_free().
+ *
+ * Since: 2.10
+ **/
+GimpProcBatch *
+gimp_proc_batch_new (void)
+{
+  GimpProcBatch *batch = g_slice_new0 (GimpProcBatch);
+
+  batch->procs = g_array_new (FALSE, TRUE, sizeof (GPProcRun));
+
+  return batch;
+}
+
+/**
+ * gimp_proc_batch_add:
+ * @batch:    a #GimpProcBatch
+ * @name:     the name of the procedure to run
+ * @n_params: the number of parameters the procedure takes.
+ * @params:   the procedure's parameters array.
+ *
+ * Adds a procedure call to @batch.  The procedures of a batch are run
+ * in the order they were added.  @params is not copied and has to
+ * stay valid until gimp_proc_batch_run() returns.
+ *
+ * Return value: the index of the call within @batch, to be passed to
+ *               gimp_proc_batch_get_return_values().
+ *
+ * Since: 2.10
+ **/
+gint
+gimp_proc_batch_add (GimpProcBatch   *batch,
+                     const gchar     *name,
+                     gint             n_params,
+                     const GimpParam *params)
+{
+  GPProcRun proc_run;
+
+  g_return_val_if_fail (batch != NULL, -1);
+  g_return_val_if_fail (batch->returns == NULL, -1);
+  g_return_val_if_fail (name != NULL, -1);
+  g_return_val_if_fail (n_params == 0 || params != NULL, -1);
+
+  proc_run.name    = g_strdup (name);
+  proc_run.nparams = n_params;
+  proc_run.params  = (GPParam *) params;
+
+  g_array_append_val (batch->procs, proc_run);
+
+  return batch->procs->len - 1;
+}
+
+/**
+ * gimp_proc_batch_run:
+ * @batch: a #GimpProcBatch
+ *
+ * Runs all procedure calls added to @batch, in one round-trip to the
+ * GIMP core.  A batch can only be run once.
+ *
+ * Since: 2.10
+ **/
+void
+gimp_proc_batch_run (GimpProcBatch *batch)
+{
+  GPProcRunBatch  proc_run_batch;
+  GimpWireMessage msg;
+
+  g_return_if_fail (batch != NULL);
+  g_return_if_fail (batch->returns == NULL);
+
+  proc_run_batch.n_procs = batch->procs->len;
+  proc_run_batch.procs   = (GPProcRun *) batch->procs->data;
+
+  gp_lock ();
+  if (! gp_proc_run_batch_write (_writechannel, &proc_run_batch, NULL))
+    gimp_quit ();
+
+  gimp_read_expect_msg (&msg, GP_PROC_RETURN_BATCH);
+  gp_unlock ();
+
+  batch->returns = msg.data;
+}
+
+/**
+ * gimp_proc_batch_get_return_values:
+ * @batch:         a #GimpProcBatch that has been run
+ * @index:         the index of a call, as returned by gimp_proc_batch_add()
+ * @n_return_vals: return location for the number of return values
+ *
+ * Returns the return values of one call of @batch, like
+ * gimp_run_procedure2() would, and makes gimp_get_pdb_error() refer
+ * to that call.
+ *
+ * Return value: the procedure's return values.  They belong to
+ *               @batch and must not be freed.
+ *
+ * Since: 2.10
+ **/
+const GimpParam *
+gimp_proc_batch_get_return_values (GimpProcBatch *batch,
+                                   gint           index,
+                                   gint          *n_return_vals)
+{
+  GPProcReturn *proc_return;
+
+  g_return_val_if_fail (batch != NULL, NULL);
+  g_return_val_if_fail (batch->returns != NULL, NULL);
+  g_return_val_if_fail (index >= 0 && index < batch->returns->n_procs, NULL);
+  g_return_val_if_fail (n_return_vals != NULL, NULL);
+
+  proc_return = &batch->returns->procs[index];
+
+  *n_return_vals = proc_return->nparams;
+
+  gimp_set_pdb_error ((GimpParam *) proc_return->params,
+                      proc_return->nparams);
+
+  return (GimpParam *) proc_return->params;
+}
+
+/**
+ * gimp_proc_batch_free:
+ * @batch: a #GimpProcBatch
+ *
+ * Frees @batch, including all return values of its calls.
+ *
+ * Since: 2.10
+ **/
+void
+gimp_proc_batch_free (GimpProcBatch *batch)
+{
+  gint i;
+
+  g_return_if_fail (batch != NULL);
+
+  for (i = 0; i < batch->procs->len; i++)
+    g_free (g_array_index (batch->procs, GPProcRun, i).name);
+
+  g_array_free (batch->procs, TRUE);
+
+  if (batch->returns)
+    {
+      GimpWireMessage msg;
+
+      msg.type = GP_PROC_RETURN_BATCH;
+      msg.data = batch->returns;
+
+      gimp_wire_destroy (&msg);
+    }
+
+  g_slice_free (GimpProcBatch, batch);
+}
+
 /**
  * gimp_destroy_params:
  * @params:   the #GimpParam array to destroy
@@ -1284,6 +1458,18 @@ gimp_shm_addr (void)
   return _shm_addr;
 }
 
+/*  the size of the shared memory segment, which may hold several
+ *  tiles, see GPConfig.shm_n_tiles
+ */
+gsize
+_gimp_shm_size (void)
+{
+  if (_shm_ID == -1 || ! _shm_addr)
+    return 0;
+
+  return TILE_MAP_SIZE;
+}
+
 /**
  * gimp_gamma:
  *
@@ -2049,6 +2235,7 @@ gimp_config (GPConfig *config)
   _tile_width       = config->tile_width;
   _tile_height      = config->tile_height;
   _shm_ID           = config->shm_ID;
+  _shm_n_tiles      = config->shm_n_tiles;
   _check_size       = config->check_size;
   _check_type       = config->check_type;
   _install_cmap     = config->install_cmap     ? TRUE : FALSE;
@@ -299,6 +299,21 @@ GimpParam    * gimp_run_procedure2      (const gchar     *name,
                                          gint             n_params,
                                          const GimpParam *params);
 
+/* Run many procedures in the procedure database at once. The calls
+ *  are queued in a 'GimpProcBatch' and sent in one go, their return
+ *  values can be collected afterwards.
+ */
+GimpProcBatch   * gimp_proc_batch_new               (void);
+gint              gimp_proc_batch_add               (GimpProcBatch   *batch,
+                                                     const gchar     *name,
+                                                     gint             n_params,
+                                                     const GimpParam *params);
+void              gimp_proc_batch_run               (GimpProcBatch   *batch);
+const GimpParam * gimp_proc_batch_get_return_values (GimpProcBatch   *batch,
+                                                     gint             index,
+                                                     gint            *n_return_vals);
+void              gimp_proc_batch_free              (GimpProcBatch   *batch);
+
 /* Destroy the an array of parameters. This is useful for
  *  destroying the return values returned by a call to
  *  'gimp_run_procedure'.
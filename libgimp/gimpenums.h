@@ -44,7 +44,8 @@ typedef enum
   GIMP_CONVERT_DITHER_NONE,
   GIMP_CONVERT_DITHER_FS,
   GIMP_CONVERT_DITHER_FS_LOWBLEED,
-  GIMP_CONVERT_DITHER_FIXED
+  GIMP_CONVERT_DITHER_FIXED,
+  GIMP_CONVERT_DITHER_FS_BANDED
 } GimpConvertDitherType;
 
 
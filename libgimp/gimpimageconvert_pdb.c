@@ -120,7 +120,10 @@ gimp_image_convert_grayscale (gint32 image_ID)
  * dithering to use. '0' means no dithering, '1' means standard
  * Floyd-Steinberg error diffusion, '2' means Floyd-Steinberg error
  * diffusion with reduced bleeding, '3' means dithering based on pixel
- * location ('Fixed' dithering).
+ * location ('Fixed' dithering), '4' means standard Floyd-Steinberg
+ * error diffusion done in bands of rows on all processors, which is
+ * faster on large images but can differ slightly from '1' where the
+ * bands meet.
  *
  * Returns: TRUE on success.
  **/
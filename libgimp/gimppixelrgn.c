@@ -367,6 +367,9 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
   g_return_if_fail (width >= 0);
   g_return_if_fail (height >= 0);
 
+  if (width == 0 || height == 0)
+    return;
+
   bpp = pr->bpp;
   bufstride = bpp * width;
 
@@ -378,8 +381,19 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
 
   while (y < yend)
     {
+      GimpTile *row_tiles;
+      gint      n_row_tiles;
+
       x = xstart;
 
+      /*  transfer the whole row of tiles at once, the tiles are only
+       *  referenced again below
+       */
+      row_tiles   = gimp_drawable_get_tile2 (pr->drawable, pr->shadow, x, y);
+      n_row_tiles = (xend - 1) / TILE_WIDTH - xstart / TILE_WIDTH + 1;
+
+      _gimp_tiles_ref (row_tiles, n_row_tiles);
+
       while (x < xend)
         {
           GimpTile *tile;
@@ -410,6 +424,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
           x += xstep;
         }
 
+      _gimp_tiles_unref (row_tiles, n_row_tiles, FALSE);
+
       y += ystep;
     }
 }
@@ -601,6 +617,9 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
   g_return_if_fail (width >= 0);
   g_return_if_fail (height >= 0);
 
+  if (width == 0 || height == 0)
+    return;
+
   bpp = pr->bpp;
   bufstride = bpp * width;
 
@@ -612,8 +631,19 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
 
   while (y < yend)
     {
+      GimpTile *row_tiles;
+      gint      n_row_tiles;
+
       x = xstart;
 
+      /*  transfer the whole row of tiles at once, the tiles are only
+       *  referenced again below
+       */
+      row_tiles   = gimp_drawable_get_tile2 (pr->drawable, pr->shadow, x, y);
+      n_row_tiles = (xend - 1) / TILE_WIDTH - xstart / TILE_WIDTH + 1;
+
+      _gimp_tiles_ref (row_tiles, n_row_tiles);
+
       while (x < xend)
         {
           GimpTile *tile;
@@ -644,6 +674,8 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
           x += xstep;
         }
 
+      _gimp_tiles_unref (row_tiles, n_row_tiles, FALSE);
+
       y += ystep;
     }
 }
@@ -49,13 +49,17 @@
 #define FREE_QUANTUM 0.1
 
 
-void         gimp_read_expect_msg   (GimpWireMessage *msg,
-                                     gint             type);
+void         gimp_read_expect_msg    (GimpWireMessage *msg,
+                                      gint             type);
+gsize        _gimp_shm_size          (void);
 
-static void  gimp_tile_get          (GimpTile        *tile);
-static void  gimp_tile_put          (GimpTile        *tile);
-static void  gimp_tile_cache_insert (GimpTile        *tile);
-static void  gimp_tile_cache_flush  (GimpTile        *tile);
+static gint  gimp_tile_get_max_tiles (GimpTile        *tile);
+static void  gimp_tile_get           (GimpTile        *tiles,
+                                      gint             n_tiles);
+static void  gimp_tile_put           (GimpTile        *tiles,
+                                      gint             n_tiles);
+static void  gimp_tile_cache_insert  (GimpTile        *tile);
+static void  gimp_tile_cache_flush   (GimpTile        *tile);
 
 
 /*  private variables  */
@@ -79,7 +83,7 @@ gimp_tile_ref (GimpTile *tile)
 
   if (tile->ref_count == 1)
     {
-      gimp_tile_get (tile);
+      gimp_tile_get (tile, 1);
       tile->dirty = FALSE;
     }
 
@@ -124,7 +128,7 @@ gimp_tile_flush (GimpTile *tile)
 
   if (tile->data && tile->dirty)
     {
-      gimp_tile_put (tile);
+      gimp_tile_put (tile, 1);
       tile->dirty = FALSE;
     }
 }
@@ -165,6 +169,110 @@ gimp_tile_cache_ntiles (gulong ntiles)
                          gimp_tile_height () * 4 + 1023) / 1024);
 }
 
+/*  references @n_tiles consecutive tiles of a drawable, starting at
+ *  @tiles, like gimp_tile_ref().  tiles that need to be fetched are
+ *  transferred as many at a time as the shared memory segment allows.
+ */
+void
+_gimp_tiles_ref (GimpTile *tiles,
+                 gint      n_tiles)
+{
+  gint max_tiles;
+  gint i, j, k;
+
+  g_return_if_fail (tiles != NULL);
+
+  if (n_tiles < 1)
+    return;
+
+  max_tiles = gimp_tile_get_max_tiles (tiles);
+
+  for (i = 0; i < n_tiles; i = j)
+    {
+      j = i;
+
+      while (j < n_tiles && j - i < max_tiles && tiles[j].ref_count == 0)
+        j++;
+
+      if (j > i)
+        {
+          gimp_tile_get (tiles + i, j - i);
+
+          for (k = i; k < j; k++)
+            tiles[k].dirty = FALSE;
+        }
+      else
+        {
+          j = i + 1;
+        }
+
+      for (k = i; k < j; k++)
+        {
+          tiles[k].ref_count++;
+
+          gimp_tile_cache_insert (&tiles[k]);
+        }
+    }
+}
+
+/*  releases @n_tiles consecutive tiles referenced by _gimp_tiles_ref(),
+ *  like gimp_tile_unref().  dirty tiles that are no longer referenced
+ *  are transferred back as many at a time as possible.
+ */
+void
+_gimp_tiles_unref (GimpTile *tiles,
+                   gint      n_tiles,
+                   gboolean  dirty)
+{
+  gint max_tiles;
+  gint i, j;
+
+  g_return_if_fail (tiles != NULL);
+
+  if (n_tiles < 1)
+    return;
+
+  max_tiles = gimp_tile_get_max_tiles (tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    g_return_if_fail (tiles[i].ref_count > 0);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      tiles[i].ref_count--;
+      tiles[i].dirty |= dirty;
+    }
+
+#define TILE_NEEDS_PUT(tile) \
+  ((tile)->ref_count == 0 && (tile)->dirty && (tile)->data)
+
+  for (i = 0; i < n_tiles; i = j)
+    {
+      j = i;
+
+      while (j < n_tiles && j - i < max_tiles && TILE_NEEDS_PUT (&tiles[j]))
+        j++;
+
+      if (j > i)
+        gimp_tile_put (tiles + i, j - i);
+      else
+        j = i + 1;
+    }
+
+#undef TILE_NEEDS_PUT
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      if (tiles[i].ref_count == 0)
+        {
+          tiles[i].dirty = FALSE;
+
+          g_free (tiles[i].data);
+          tiles[i].data = NULL;
+        }
+    }
+}
+
 void
 _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
 {
@@ -187,8 +295,26 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
 
 /*  private functions  */
 
+/*  the number of tiles of @tile's size that fit into one transfer
+ */
+static gint
+gimp_tile_get_max_tiles (GimpTile *tile)
+{
+  gsize shm_size  = _gimp_shm_size ();
+  gsize tile_size = gimp_tile_width () * gimp_tile_height () * tile->bpp;
+
+  if (shm_size == 0)
+    return 1;
+
+  return MAX (1, shm_size / tile_size);
+}
+
+/*  fetches @n_tiles consecutive tiles, more than one only if they
+ *  fit into shared memory, see gimp_tile_get_max_tiles()
+ */
 static void
-gimp_tile_get (GimpTile *tile)
+gimp_tile_get (GimpTile *tiles,
+               gint      n_tiles)
 {
   extern GIOChannel *_writechannel;
 
@@ -196,9 +322,10 @@ gimp_tile_get (GimpTile *tile)
   GPTileData      *tile_data;
   GimpWireMessage  msg;
 
-  tile_req.drawable_ID = tile->drawable->drawable_id;
-  tile_req.tile_num    = tile->tile_num;
-  tile_req.shadow      = tile->shadow;
+  tile_req.drawable_ID = tiles->drawable->drawable_id;
+  tile_req.tile_num    = tiles->tile_num;
+  tile_req.n_tiles     = n_tiles;
+  tile_req.shadow      = tiles->shadow;
 
   gp_lock ();
   if (! gp_tile_req_write (_writechannel, &tile_req, NULL))
@@ -207,12 +334,13 @@ gimp_tile_get (GimpTile *tile)
   gimp_read_expect_msg (&msg, GP_TILE_DATA);
 
   tile_data = msg.data;
-  if (tile_data->drawable_ID != tile->drawable->drawable_id ||
-      tile_data->tile_num    != tile->tile_num              ||
-      tile_data->shadow      != tile->shadow                ||
-      tile_data->width       != tile->ewidth                ||
-      tile_data->height      != tile->eheight               ||
-      tile_data->bpp         != tile->bpp)
+  if (tile_data->drawable_ID != tiles->drawable->drawable_id ||
+      tile_data->tile_num    != tiles->tile_num              ||
+      tile_data->n_tiles     != n_tiles                      ||
+      tile_data->shadow      != tiles->shadow                ||
+      tile_data->width       != tiles->ewidth                ||
+      tile_data->height      != tiles->eheight               ||
+      tile_data->bpp         != tiles->bpp)
     {
       g_message ("received tile info did not match computed tile info");
       gimp_quit ();
@@ -220,12 +348,22 @@ gimp_tile_get (GimpTile *tile)
 
   if (tile_data->use_shm)
     {
-      tile->data = g_memdup (gimp_shm_addr (),
-                             tile->ewidth * tile->eheight * tile->bpp);
+      const guchar *data = gimp_shm_addr ();
+      gint          i;
+
+      for (i = 0; i < n_tiles; i++)
+        {
+          GimpTile *tile = &tiles[i];
+          gsize     size = tile->ewidth * tile->eheight * tile->bpp;
+
+          tile->data = g_memdup (data, size);
+
+          data += size;
+        }
     }
   else
     {
-      tile->data = tile_data->data;
+      tiles->data = tile_data->data;
       tile_data->data = NULL;
     }
 
@@ -236,8 +374,11 @@ gimp_tile_get (GimpTile *tile)
   gimp_wire_destroy (&msg);
 }
 
+/*  writes back @n_tiles consecutive tiles, see gimp_tile_get()
+ */
 static void
-gimp_tile_put (GimpTile *tile)
+gimp_tile_put (GimpTile *tiles,
+               gint      n_tiles)
 {
   extern GIOChannel *_writechannel;
 
@@ -248,6 +389,7 @@ gimp_tile_put (GimpTile *tile)
 
   tile_req.drawable_ID = -1;
   tile_req.tile_num    = 0;
+  tile_req.n_tiles     = 0;
   tile_req.shadow      = 0;
 
   gp_lock ();
@@ -258,21 +400,35 @@ gimp_tile_put (GimpTile *tile)
 
   tile_info = msg.data;
 
-  tile_data.drawable_ID = tile->drawable->drawable_id;
-  tile_data.tile_num    = tile->tile_num;
-  tile_data.shadow      = tile->shadow;
-  tile_data.bpp         = tile->bpp;
-  tile_data.width       = tile->ewidth;
-  tile_data.height      = tile->eheight;
+  tile_data.drawable_ID = tiles->drawable->drawable_id;
+  tile_data.tile_num    = tiles->tile_num;
+  tile_data.n_tiles     = n_tiles;
+  tile_data.shadow      = tiles->shadow;
+  tile_data.bpp         = tiles->bpp;
+  tile_data.width       = tiles->ewidth;
+  tile_data.height      = tiles->eheight;
   tile_data.use_shm     = tile_info->use_shm;
   tile_data.data        = NULL;
 
   if (tile_info->use_shm)
-    memcpy (gimp_shm_addr (),
-            tile->data,
-            tile->ewidth * tile->eheight * tile->bpp);
+    {
+      guchar *data = gimp_shm_addr ();
+      gint    i;
+
+      for (i = 0; i < n_tiles; i++)
+        {
+          GimpTile *tile = &tiles[i];
+          gsize     size = tile->ewidth * tile->eheight * tile->bpp;
+
+          memcpy (data, tile->data, size);
+
+          data += size;
+        }
+    }
   else
-    tile_data.data = tile->data;
+    {
+      tile_data.data = tiles->data;
+    }
 
   if (! gp_tile_data_write (_writechannel, &tile_data, NULL))
     gimp_quit ();
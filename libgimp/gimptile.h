@@ -60,7 +60,13 @@ GIMP_DEPRECATED
 void    gimp_tile_cache_ntiles (gulong     ntiles);
 
 
-/*  private function  */
+/*  private functions  */
+
+G_GNUC_INTERNAL void _gimp_tiles_ref   (GimpTile     *tiles,
+                                        gint          n_tiles);
+G_GNUC_INTERNAL void _gimp_tiles_unref (GimpTile     *tiles,
+                                        gint          n_tiles,
+                                        gboolean      dirty);
 
 G_GNUC_INTERNAL void _gimp_tile_cache_flush_drawable (GimpDrawable *drawable);
 
@@ -161,6 +161,7 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
   gint                          tile_size;
   gint                          u, v;
   gint                          mul = priv->mul;
+  gint                          n_cols;
   guchar                       *tile_data;
 
   x *= mul;
@@ -170,20 +171,25 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
   tile       = gegl_tile_new (tile_size);
   tile_data  = gegl_tile_get_data (tile);
 
-  for (u = 0; u < mul; u++)
+  n_cols = MIN (mul, (gint) priv->drawable->ntile_cols - x);
+
+  /*  fetch each row of tiles at once
+   */
+  for (v = 0; v < mul && n_cols > 0; v++)
     {
-      for (v = 0; v < mul; v++)
-        {
-          GimpTile *gimp_tile;
+      GimpTile *gimp_tiles;
+
+      if (y + v >= priv->drawable->ntile_rows)
+        break;
 
-          if (x + u >= priv->drawable->ntile_cols ||
-              y + v >= priv->drawable->ntile_rows)
-            continue;
+      gimp_tiles = gimp_drawable_get_tile (priv->drawable,
+                                           priv->shadow,
+                                           y + v, x);
+      _gimp_tiles_ref (gimp_tiles, n_cols);
 
-          gimp_tile = gimp_drawable_get_tile (priv->drawable,
-                                              priv->shadow,
-                                              y + v, x + u);
-          gimp_tile_ref (gimp_tile);
+      for (u = 0; u < n_cols; u++)
+        {
+          GimpTile *gimp_tile = &gimp_tiles[u];
 
           {
             gint ewidth           = gimp_tile->ewidth;
@@ -201,9 +207,9 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
                         gimp_tile_stride);
               }
           }
-
-          gimp_tile_unref (gimp_tile, FALSE);
         }
+
+      _gimp_tiles_unref (gimp_tiles, n_cols, FALSE);
     }
 
   return tile;
@@ -218,24 +224,30 @@ gimp_tile_write_mul (GimpTileBackendPlugin *backend_plugin,
   GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
   gint                          u, v;
   gint                          mul = priv->mul;
+  gint                          n_cols;
 
   x *= mul;
   y *= mul;
 
-  for (v = 0; v < mul; v++)
+  n_cols = MIN (mul, (gint) priv->drawable->ntile_cols - x);
+
+  /*  transfer each row of tiles at once
+   */
+  for (v = 0; v < mul && n_cols > 0; v++)
     {
-      for (u = 0; u < mul; u++)
-        {
-          GimpTile *gimp_tile;
+      GimpTile *gimp_tiles;
+
+      if (y + v >= priv->drawable->ntile_rows)
+        break;
 
-          if (x + u >= priv->drawable->ntile_cols ||
-              y + v >= priv->drawable->ntile_rows)
-            continue;
+      gimp_tiles = gimp_drawable_get_tile (priv->drawable,
+                                           priv->shadow,
+                                           y + v, x);
+      _gimp_tiles_ref (gimp_tiles, n_cols);
 
-          gimp_tile = gimp_drawable_get_tile (priv->drawable,
-                                              priv->shadow,
-                                              y+v, x+u);
-          gimp_tile_ref (gimp_tile);
+      for (u = 0; u < n_cols; u++)
+        {
+          GimpTile *gimp_tile = &gimp_tiles[u];
 
           {
             gint ewidth           = gimp_tile->ewidth;
@@ -251,9 +263,9 @@ gimp_tile_write_mul (GimpTileBackendPlugin *backend_plugin,
                       tile_stride + u * TILE_WIDTH * bpp,
                       gimp_tile_stride);
           }
-
-          gimp_tile_unref (gimp_tile, TRUE);
         }
+
+      _gimp_tiles_unref (gimp_tiles, n_cols, TRUE);
     }
 }
 
@@ -36,6 +36,7 @@ typedef struct _GimpParamDef    GimpParamDef;
 typedef struct _GimpParamRegion GimpParamRegion;
 typedef union  _GimpParamData   GimpParamData;
 typedef struct _GimpParam       GimpParam;
+typedef struct _GimpProcBatch   GimpProcBatch;
 
 
 #ifndef GIMP_DISABLE_DEPRECATED
@@ -127,6 +127,7 @@ enum
   ARCH_X86_INTEL_FEATURE_SSSE3    = 1 << 9,
   ARCH_X86_INTEL_FEATURE_SSE4_1   = 1 << 19,
   ARCH_X86_INTEL_FEATURE_SSE4_2   = 1 << 20,
+  ARCH_X86_INTEL_FEATURE_OSXSAVE  = 1 << 27,
   ARCH_X86_INTEL_FEATURE_AVX      = 1 << 28
 };
 
@@ -389,6 +390,28 @@ arch_accel_sse_os_support (void)
 
   return TRUE;
 }
+
+static gboolean
+arch_accel_avx_os_support (void)
+{
+  guint32 eax, ebx, ecx, edx;
+
+  /*  the OS has to save the YMM registers on context switches, check
+   *  that it enabled XSAVE and the SSE and AVX state in XCR0
+   */
+  cpuid (1, eax, ebx, ecx, edx);
+
+  if (! (ecx & ARCH_X86_INTEL_FEATURE_OSXSAVE))
+    return FALSE;
+
+  /* xgetbv, not known to older assemblers */
+  __asm__ (".byte 0x0f, 0x01, 0xd0"
+           : "=a" (eax),
+             "=d" (edx)
+           : "c" (0));
+
+  return (eax & 0x6) == 0x6;
+}
 #endif /* USE_SSE */
 
 static guint32
@@ -427,6 +450,9 @@ arch_accel (void)
 #ifdef USE_SSE
   if ((caps & GIMP_CPU_ACCEL_X86_SSE) && !arch_accel_sse_os_support ())
     caps &= ~(GIMP_CPU_ACCEL_X86_SSE | GIMP_CPU_ACCEL_X86_SSE2);
+
+  if ((caps & GIMP_CPU_ACCEL_X86_AVX) && !arch_accel_avx_os_support ())
+    caps &= ~GIMP_CPU_ACCEL_X86_AVX;
 #endif
 
   return caps;
@@ -77,19 +77,25 @@ void
 gimp_pixpipe_params_parse (const gchar       *string,
                            GimpPixPipeParams *params)
 {
-  gchar *copy;
-  gchar *p, *q, *r;
-  gint   i;
+  gchar **tokens;
+  gchar  *p, *r;
+  gint    i, t;
 
   g_return_if_fail (string != NULL);
   g_return_if_fail (params != NULL);
 
-  copy = g_strdup (string);
+  /*  not strtok(), which keeps its state in a global, so brush pipes
+   *  can be parsed on several threads at once
+   */
+  tokens = g_strsplit_set (string, " \r\n", -1);
 
-  q = copy;
-  while ((p = strtok (q, " \r\n")) != NULL)
+  for (t = 0; tokens[t]; t++)
     {
-      q = NULL;
+      p = tokens[t];
+
+      if (! *p)
+        continue;
+
       r = strchr (p, ':');
       if (r)
         *r = 0;
@@ -161,11 +167,9 @@ gimp_pixpipe_params_parse (const gchar       *string,
                 }
             }
         }
-      if (r)
-        *r = ':';
     }
 
-  g_free (copy);
+  g_strfreev (tokens);
 }
 
 gchar *
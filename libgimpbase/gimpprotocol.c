@@ -141,6 +141,22 @@ static void _gp_has_init_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_has_init_destroy         (GimpWireMessage  *msg);
 
+static void _gp_proc_run_batch_read      (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_run_batch_write     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_run_batch_destroy   (GimpWireMessage  *msg);
+
+static void _gp_proc_return_batch_read   (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_return_batch_write  (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_proc_return_batch_destroy (GimpWireMessage *msg);
+
 
 
 void
@@ -198,6 +214,14 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_PROC_RUN_BATCH,
+                      _gp_proc_run_batch_read,
+                      _gp_proc_run_batch_write,
+                      _gp_proc_run_batch_destroy);
+  gimp_wire_register (GP_PROC_RETURN_BATCH,
+                      _gp_proc_return_batch_read,
+                      _gp_proc_return_batch_write,
+                      _gp_proc_return_batch_destroy);
 }
 
 gboolean
@@ -443,6 +467,44 @@ gp_has_init_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_proc_run_batch_write (GIOChannel     *channel,
+                         GPProcRunBatch *proc_run_batch,
+                         gpointer        user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_RUN_BATCH;
+  msg.data = proc_run_batch;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_proc_return_batch_write (GIOChannel        *channel,
+                            GPProcReturnBatch *proc_return_batch,
+                            gpointer           user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PROC_RETURN_BATCH;
+  msg.data = proc_return_batch;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 /*  quit  */
 
 static void
@@ -504,7 +566,7 @@ _gp_config_read (GIOChannel      *channel,
                               user_data))
     goto cleanup;
   if (! _gimp_wire_read_int8 (channel,
-                              (guint8 *) &config->gimp_reserved_6, 1,
+                              (guint8 *) &config->shm_n_tiles, 1,
                               user_data))
     goto cleanup;
   if (! _gimp_wire_read_int8 (channel,
@@ -596,7 +658,7 @@ _gp_config_write (GIOChannel      *channel,
                                user_data))
     return;
   if (! _gimp_wire_write_int8 (channel,
-                               (const guint8 *) &config->gimp_reserved_6, 1,
+                               (const guint8 *) &config->shm_n_tiles, 1,
                                user_data))
     return;
   if (! _gimp_wire_write_int8 (channel,
@@ -672,6 +734,9 @@ _gp_tile_req_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &tile_req->tile_num, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_req->n_tiles, 1, user_data))
+    goto cleanup;
   if (! _gimp_wire_read_int32 (channel,
                                &tile_req->shadow, 1, user_data))
     goto cleanup;
@@ -698,6 +763,9 @@ _gp_tile_req_write (GIOChannel      *channel,
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_req->tile_num, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_req->n_tiles, 1, user_data))
+    return;
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_req->shadow, 1, user_data))
     return;
@@ -749,6 +817,9 @@ _gp_tile_data_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &tile_data->tile_num, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_data->n_tiles, 1, user_data))
+    goto cleanup;
   if (! _gimp_wire_read_int32 (channel,
                                &tile_data->shadow, 1, user_data))
     goto cleanup;
@@ -765,6 +836,11 @@ _gp_tile_data_read (GIOChannel      *channel,
                                &tile_data->use_shm, 1, user_data))
     goto cleanup;
 
+  /*  multiple tiles are only ever transferred through shared memory
+   */
+  if (tile_data->n_tiles > 1 && ! tile_data->use_shm)
+    goto cleanup;
+
   if (!tile_data->use_shm)
     {
       guint length = tile_data->width * tile_data->height * tile_data->bpp;
@@ -800,6 +876,9 @@ _gp_tile_data_write (GIOChannel      *channel,
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_data->tile_num, 1, user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_data->n_tiles, 1, user_data))
+    return;
   if (! _gimp_wire_write_int32 (channel,
                                 &tile_data->shadow, 1, user_data))
     return;
@@ -1881,3 +1960,169 @@ static void
 _gp_has_init_destroy (GimpWireMessage *msg)
 {
 }
+
+/*  proc_run_batch  */
+
+static void
+_gp_proc_run_batch_read (GIOChannel      *channel,
+                         GimpWireMessage *msg,
+                         gpointer         user_data)
+{
+  GPProcRunBatch *batch = g_slice_new0 (GPProcRunBatch);
+  guint32         n_procs;
+  gint            i;
+
+  if (! _gimp_wire_read_int32 (channel, &n_procs, 1, user_data))
+    goto cleanup;
+
+  batch->procs = g_new0 (GPProcRun, n_procs);
+
+  for (i = 0; i < n_procs; i++)
+    {
+      GPProcRun *proc_run = &batch->procs[i];
+
+      if (! _gimp_wire_read_string (channel, &proc_run->name, 1, user_data))
+        goto cleanup;
+
+      batch->n_procs++;
+
+      _gp_params_read (channel,
+                       &proc_run->params, (guint *) &proc_run->nparams,
+                       user_data);
+    }
+
+  msg->data = batch;
+  return;
+
+ cleanup:
+  msg->data = batch;
+  _gp_proc_run_batch_destroy (msg);
+  msg->data = NULL;
+}
+
+static void
+_gp_proc_run_batch_write (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPProcRunBatch *batch = msg->data;
+  gint            i;
+
+  if (! _gimp_wire_write_int32 (channel, &batch->n_procs, 1, user_data))
+    return;
+
+  for (i = 0; i < batch->n_procs; i++)
+    {
+      GPProcRun *proc_run = &batch->procs[i];
+
+      if (! _gimp_wire_write_string (channel, &proc_run->name, 1, user_data))
+        return;
+
+      _gp_params_write (channel,
+                        proc_run->params, proc_run->nparams, user_data);
+    }
+}
+
+static void
+_gp_proc_run_batch_destroy (GimpWireMessage *msg)
+{
+  GPProcRunBatch *batch = msg->data;
+
+  if (batch)
+    {
+      gint i;
+
+      for (i = 0; i < batch->n_procs; i++)
+        {
+          gp_params_destroy (batch->procs[i].params, batch->procs[i].nparams);
+
+          g_free (batch->procs[i].name);
+        }
+
+      g_free (batch->procs);
+      g_slice_free (GPProcRunBatch, batch);
+    }
+}
+
+/*  proc_return_batch  */
+
+static void
+_gp_proc_return_batch_read (GIOChannel      *channel,
+                            GimpWireMessage *msg,
+                            gpointer         user_data)
+{
+  GPProcReturnBatch *batch = g_slice_new0 (GPProcReturnBatch);
+  guint32            n_procs;
+  gint               i;
+
+  if (! _gimp_wire_read_int32 (channel, &n_procs, 1, user_data))
+    goto cleanup;
+
+  batch->procs = g_new0 (GPProcReturn, n_procs);
+
+  for (i = 0; i < n_procs; i++)
+    {
+      GPProcReturn *proc_return = &batch->procs[i];
+
+      if (! _gimp_wire_read_string (channel, &proc_return->name, 1, user_data))
+        goto cleanup;
+
+      batch->n_procs++;
+
+      _gp_params_read (channel,
+                       &proc_return->params, (guint *) &proc_return->nparams,
+                       user_data);
+    }
+
+  msg->data = batch;
+  return;
+
+ cleanup:
+  msg->data = batch;
+  _gp_proc_return_batch_destroy (msg);
+  msg->data = NULL;
+}
+
+static void
+_gp_proc_return_batch_write (GIOChannel      *channel,
+                             GimpWireMessage *msg,
+                             gpointer         user_data)
+{
+  GPProcReturnBatch *batch = msg->data;
+  gint               i;
+
+  if (! _gimp_wire_write_int32 (channel, &batch->n_procs, 1, user_data))
+    return;
+
+  for (i = 0; i < batch->n_procs; i++)
+    {
+      GPProcReturn *proc_return = &batch->procs[i];
+
+      if (! _gimp_wire_write_string (channel, &proc_return->name, 1, user_data))
+        return;
+
+      _gp_params_write (channel,
+                        proc_return->params, proc_return->nparams, user_data);
+    }
+}
+
+static void
+_gp_proc_return_batch_destroy (GimpWireMessage *msg)
+{
+  GPProcReturnBatch *batch = msg->data;
+
+  if (batch)
+    {
+      gint i;
+
+      for (i = 0; i < batch->n_procs; i++)
+        {
+          gp_params_destroy (batch->procs[i].params, batch->procs[i].nparams);
+
+          g_free (batch->procs[i].name);
+        }
+
+      g_free (batch->procs);
+      g_slice_free (GPProcReturnBatch, batch);
+    }
+}
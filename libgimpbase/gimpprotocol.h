@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0015
+#define GIMP_PROTOCOL_VERSION  0x0017
 
 
 enum
@@ -43,7 +43,9 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_PROC_RUN_BATCH,
+  GP_PROC_RETURN_BATCH
 };
 
 
@@ -57,6 +59,8 @@ typedef struct _GPProcRun       GPProcRun;
 typedef struct _GPProcReturn    GPProcReturn;
 typedef struct _GPProcInstall   GPProcInstall;
 typedef struct _GPProcUninstall GPProcUninstall;
+typedef struct _GPProcRunBatch    GPProcRunBatch;
+typedef struct _GPProcReturnBatch GPProcReturnBatch;
 
 
 struct _GPConfig
@@ -70,7 +74,7 @@ struct _GPConfig
   gint8    show_help_button;
   gint8    use_cpu_accel;
   gint8    use_opencl;
-  gint8    gimp_reserved_6;
+  gint8    shm_n_tiles;
   gint8    gimp_reserved_7;
   gint8    gimp_reserved_8;
   gint8    install_cmap;
@@ -88,6 +92,7 @@ struct _GPTileReq
 {
   gint32   drawable_ID;
   guint32  tile_num;
+  guint32  n_tiles;
   guint32  shadow;
 };
 
@@ -95,6 +100,7 @@ struct _GPTileData
 {
   gint32   drawable_ID;
   guint32  tile_num;
+  guint32  n_tiles;
   guint32  shadow;
   guint32  bpp;
   guint32  width;
@@ -186,6 +192,18 @@ struct _GPProcUninstall
   gchar *name;
 };
 
+struct _GPProcRunBatch
+{
+  guint32    n_procs;
+  GPProcRun *procs;
+};
+
+struct _GPProcReturnBatch
+{
+  guint32       n_procs;
+  GPProcReturn *procs;
+};
+
 
 void      gp_init                   (void);
 
@@ -224,6 +242,12 @@ gboolean  gp_extension_ack_write    (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_has_init_write         (GIOChannel      *channel,
                                      gpointer         user_data);
+gboolean  gp_proc_run_batch_write   (GIOChannel      *channel,
+                                     GPProcRunBatch  *proc_run_batch,
+                                     gpointer         user_data);
+gboolean  gp_proc_return_batch_write (GIOChannel        *channel,
+                                      GPProcReturnBatch *proc_return_batch,
+                                      gpointer           user_data);
 
 void      gp_params_destroy         (GPParam         *params,
                                      gint             nparams);
@@ -225,6 +225,8 @@ ts_interpret_stdin (void)
 gint
 ts_interpret_string (const gchar *expr)
 {
+  gint64 start = g_get_monotonic_time ();
+
 #if DEBUG_SCRIPTS
   sc.print_output = 1;
   sc.tracing = 1;
@@ -232,6 +234,12 @@ ts_interpret_string (const gchar *expr)
 
   sc.vptr->load_string (&sc, (char *) expr);
 
+  /*  run with G_MESSAGES_DEBUG=Script-Fu to see how long every command
+   *  takes, both loading the scripts and running them
+   */
+  g_log ("Script-Fu", G_LOG_LEVEL_DEBUG, "%.3f seconds: %.80s",
+         (g_get_monotonic_time () - start) / 1000000.0, expr);
+
   return sc.retcode;
 }
 
@@ -81,6 +81,7 @@ typedef short sa_family_t;	/* Not defined by winsock */
 #define COMMAND_HEADER  3
 #define RESPONSE_HEADER 4
 #define MAGIC           'G'
+#define MAGIC_TIMED     'T'
 
 #ifndef HAVE_DIFFTIME
 #define difftime(a,b) (((gdouble)(a)) - ((gdouble)(b)))
@@ -112,6 +113,21 @@ typedef short sa_family_t;	/* Not defined by winsock */
  *           MAGIC      ERROR?     RSP_LEN_H  RSP_LEN_L
  */
 
+/*  A command sent with MAGIC_TIMED instead of MAGIC is answered with
+ *  MAGIC_TIMED, and its response starts with a line holding the
+ *  seconds the command waited in the queue and the seconds it ran:
+ *    "<wait> <run>\n<response>"
+ */
+
+/*  Commands are not run concurrently.  The server lives in a single
+ *  Script-Fu plug-in process, with one TinyScheme interpreter and one
+ *  wire connection to the core, and every command is evaluated by that
+ *  interpreter, in the same global environment, one after the other.
+ *  Clients only get their queued commands run in turns, see
+ *  next_command().  Running commands in parallel needs one server
+ *  process per worker.
+ */
+
 #define MAGIC_BYTE      0
 
 #define CMD_LEN_H_BYTE  1
@@ -127,9 +143,12 @@ typedef short sa_family_t;	/* Not defined by winsock */
 
 typedef struct
 {
-  gchar *command;
-  gint   filedes;
-  gint   request_no;
+  gchar   *command;
+  gint     filedes;
+  gint     request_no;
+  gint     round;       /*  the client's turn this command is run in  */
+  gboolean timed;       /*  report the timing in the response         */
+  gint64   received;    /*  when the command was read                 */
 } SFCommand;
 
 typedef struct
@@ -161,7 +180,12 @@ typedef union
 static void      server_start       (const gchar *listen_ip,
                                      gint         port,
                                      const gchar *logfile);
+static gboolean  server_select      (struct timeval *tvp);
+static SFCommand * next_command     (void);
 static gboolean  execute_command    (SFCommand   *cmd);
+static gboolean  send_to_client     (gint         filedes,
+                                     const gchar *buffer,
+                                     gsize        length);
 static gint      read_from_client   (gint         filedes);
 static gint      make_socket        (const struct addrinfo
                                                  *ai);
@@ -187,6 +211,8 @@ static gint         queue_length    = 0;
 static gint         request_no      = 0;
 static FILE        *server_log_file = NULL;
 static GHashTable  *clients         = NULL;
+static GHashTable  *client_rounds   = NULL;
+static gint         current_round   = 0;
 static gboolean     script_fu_done  = FALSE;
 static gboolean     server_mode     = FALSE;
 
@@ -299,11 +325,13 @@ script_fu_server_read_fd (gpointer key,
 
           CLOSESOCKET (fd);
 
+          g_hash_table_remove (client_rounds, key);
+
           /*  Invalidate the file descriptor for pending commands
               from the disconnected client.  */
           for (list = command_queue; list; list = list->next)
             {
-              SFCommand *cmd = (SFCommand *) command_queue->data;
+              SFCommand *cmd = (SFCommand *) list->data;
 
               if (cmd->filedes == fd)
                 cmd->filedes = -1;
@@ -321,8 +349,6 @@ script_fu_server_listen (gint timeout)
 {
   struct timeval  tv;
   struct timeval *tvp = NULL;
-  SELECT_MASK     fds;
-  gint            sockno;
 
   /*  Set time struct  */
   if (timeout)
@@ -332,6 +358,20 @@ script_fu_server_listen (gint timeout)
       tvp = &tv;
     }
 
+  server_select (tvp);
+}
+
+/*  Waits for input on the server and client sockets, accepts new
+ *  connections and reads one command from each client with input.
+ *  Returns whether there was any input.
+ */
+static gboolean
+server_select (struct timeval *tvp)
+{
+  SELECT_MASK     fds;
+  gint            sockno;
+  gint            n_ready;
+
   FD_ZERO (&fds);
   for (sockno = 0; sockno < server_socks_used; sockno++)
     {
@@ -342,12 +382,17 @@ script_fu_server_listen (gint timeout)
   /* Block until input arrives on one or more active sockets
      or timeout occurs. */
 
-  if (select (FD_SETSIZE, &fds, NULL, NULL, tvp) < 0)
+  n_ready = select (FD_SETSIZE, &fds, NULL, NULL, tvp);
+
+  if (n_ready < 0)
     {
       print_socket_api_error ("select");
-      return;
+      return FALSE;
     }
 
+  if (n_ready == 0)
+    return FALSE;
+
   /* Service the server sockets if any has input pending. */
   for (sockno = 0; sockno < server_socks_used; sockno++)
     {
@@ -369,7 +414,7 @@ script_fu_server_listen (gint timeout)
       if (new < 0)
         {
           print_socket_api_error ("accept");
-          return;
+          return FALSE;
         }
 
       /*  Associate the client address with the socket  */
@@ -403,6 +448,8 @@ script_fu_server_listen (gint timeout)
 
   /* Service the client sockets. */
   g_hash_table_foreach_remove (clients, script_fu_server_read_fd, &fds);
+
+  return TRUE;
 }
 
 static void
@@ -513,6 +560,9 @@ server_start (const gchar *listen_ip,
   clients = g_hash_table_new_full (g_direct_hash, NULL,
                                    NULL, (GDestroyNotify) g_free);
 
+  /*  and the table of the next turn of each client  */
+  client_rounds = g_hash_table_new (g_direct_hash, NULL);
+
   progress = server_progress_install ();
 
   server_log ("Script-Fu server initialized and listening...\n");
@@ -520,23 +570,39 @@ server_start (const gchar *listen_ip,
   /*  Loop until the server is finished  */
   while (! script_fu_done)
     {
-      script_fu_server_listen (0);
-
-      while (command_queue)
+      struct timeval  tv = { 0, 0 };
+      SFCommand      *cmd;
+
+      /*  Wait for requests if there is nothing to do  */
+      if (! command_queue)
+        server_select (NULL);
+
+      /*  Read every request that is already pending on any connection
+       *  before picking the next command, so that all clients that
+       *  are waiting get their turn before any of them gets a second
+       *  one
+       */
+      while (server_select (&tv))
         {
-          SFCommand *cmd = (SFCommand *) command_queue->data;
+          tv.tv_sec  = 0;
+          tv.tv_usec = 0;
+        }
+
+      if (! command_queue)
+        continue;
 
-          /*  Process the command  */
-          execute_command (cmd);
+      cmd = next_command ();
 
-          /*  Remove the command from the list  */
-          command_queue = g_list_remove (command_queue, cmd);
-          queue_length--;
+      /*  Process the command  */
+      execute_command (cmd);
 
-          /*  Free the request  */
-          g_free (cmd->command);
-          g_free (cmd);
-      }
+      /*  Remove the command from the list  */
+      command_queue = g_list_remove (command_queue, cmd);
+      queue_length--;
+
+      /*  Free the request  */
+      g_free (cmd->command);
+      g_free (cmd);
     }
 
   server_progress_uninstall (progress);
@@ -544,6 +610,29 @@ server_start (const gchar *listen_ip,
   server_quit ();
 }
 
+/*  Pick the queued command to run next.  Each client gets one command
+ *  per turn, so one client pipelining many requests over its connection
+ *  doesn't starve the others.
+ */
+static SFCommand *
+next_command (void)
+{
+  SFCommand *next = NULL;
+  GList     *list;
+
+  for (list = command_queue; list; list = list->next)
+    {
+      SFCommand *cmd = list->data;
+
+      if (! next || cmd->round < next->round)
+        next = cmd;
+    }
+
+  current_round = next->round;
+
+  return next;
+}
+
 static gboolean
 execute_command (SFCommand *cmd)
 {
@@ -551,11 +640,12 @@ execute_command (SFCommand *cmd)
   GString    *response;
   time_t      clocknow;
   gboolean    error;
-  gint        i;
+  gdouble     wait_time;
   gdouble     total_time;
   GTimer     *timer;
 
   server_log ("Processing request #%d\n", cmd->request_no);
+  wait_time = (g_get_monotonic_time () - cmd->received) / 1000000.0;
   timer = g_timer_new ();
 
   response = g_string_new (NULL);
@@ -574,41 +664,76 @@ execute_command (SFCommand *cmd)
 
       if (response->len == 0)
         g_string_assign (response, ts_get_success_msg ());
+    }
 
-      total_time = g_timer_elapsed (timer, NULL);
+  total_time = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  if (! error)
+    {
       time (&clocknow);
       server_log ("Request #%d processed in %.3f seconds, finishing on %s",
                   cmd->request_no, total_time, ctime (&clocknow));
     }
-  g_timer_destroy (timer);
 
-  buffer[MAGIC_BYTE]     = MAGIC;
+  if (cmd->timed)
+    {
+      gchar timing[G_ASCII_DTOSTR_BUF_SIZE * 2 + 2];
+      gchar wait_str[G_ASCII_DTOSTR_BUF_SIZE];
+      gchar run_str[G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_ascii_formatd (wait_str, sizeof (wait_str), "%.6f", wait_time);
+      g_ascii_formatd (run_str,  sizeof (run_str),  "%.6f", total_time);
+
+      g_snprintf (timing, sizeof (timing), "%s %s\n", wait_str, run_str);
+
+      g_string_prepend (response, timing);
+    }
+
+  buffer[MAGIC_BYTE]     = cmd->timed ? MAGIC_TIMED : MAGIC;
   buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
   buffer[RSP_LEN_H_BYTE] = (guchar) (response->len >> 8);
   buffer[RSP_LEN_L_BYTE] = (guchar) (response->len & 0xFF);
 
   /*  Write the response to the client  */
-  for (i = 0; i < RESPONSE_HEADER; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, buffer + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
-
-  for (i = 0; i < response->len; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, response->str + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
+  if (cmd->filedes > 0 &&
+      send_to_client (cmd->filedes, (const gchar *) buffer, RESPONSE_HEADER))
+    {
+      send_to_client (cmd->filedes, response->str, response->len);
+    }
 
   g_string_free (response, TRUE);
 
   return FALSE;
 }
 
+static gboolean
+send_to_client (gint         filedes,
+                const gchar *buffer,
+                gsize        length)
+{
+  while (length > 0)
+    {
+      gint nbytes = send (filedes, buffer, length, 0);
+
+      if (nbytes < 0)
+        {
+#ifndef G_OS_WIN32
+          if (errno == EINTR)
+            continue;
+#endif
+          /*  Write error  */
+          print_socket_api_error ("send");
+          return FALSE;
+        }
+
+      buffer += nbytes;
+      length -= nbytes;
+    }
+
+  return TRUE;
+}
+
 static gint
 read_from_client (gint filedes)
 {
@@ -618,6 +743,7 @@ read_from_client (gint filedes)
   gchar     *clientaddr;
   time_t     clock;
   gint       command_len;
+  gint       round;
   gint       nbytes;
   gint       i;
 
@@ -641,7 +767,8 @@ read_from_client (gint filedes)
       i += nbytes;
     }
 
-  if (buffer[MAGIC_BYTE] != MAGIC)
+  if (buffer[MAGIC_BYTE] != MAGIC &&
+      buffer[MAGIC_BYTE] != MAGIC_TIMED)
     {
       server_log ("Error in script-fu command transmission.\n");
       return -1;
@@ -675,6 +802,15 @@ read_from_client (gint filedes)
   cmd->filedes    = filedes;
   cmd->command    = command;
   cmd->request_no = request_no ++;
+  cmd->timed      = (buffer[MAGIC_BYTE] == MAGIC_TIMED);
+  cmd->received   = g_get_monotonic_time ();
+  /*  Queue the command for the client's next turn  */
+  round = GPOINTER_TO_INT (g_hash_table_lookup (client_rounds,
+                                                GINT_TO_POINTER (filedes)));
+  cmd->round = MAX (round, current_round);
+
+  g_hash_table_insert (client_rounds, GINT_TO_POINTER (filedes),
+                       GINT_TO_POINTER (cmd->round + 1));
 
   /*  Add the command to the queue  */
   command_queue = g_list_append (command_queue, cmd);
@@ -792,6 +928,9 @@ server_quit (void)
       g_hash_table_foreach (clients, script_fu_server_shutdown_fd, NULL);
       g_hash_table_destroy (clients);
       clients = NULL;
+
+      g_hash_table_destroy (client_rounds);
+      client_rounds = NULL;
     }
 
   while (command_queue)
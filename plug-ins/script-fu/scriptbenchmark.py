@@ -0,0 +1,88 @@
+#!/usr/bin/env python
+
+# Benchmark for Script-Fu: runs a number of the bundled scripts in a
+# headless GIMP, on a new image filled with plasma, and reports how
+# long each one takes.  The time GIMP needs to start up and to quit,
+# measured by running the same batch without a script, is subtracted.
+#
+# Run with G_MESSAGES_DEBUG=Script-Fu in the environment to also get
+# the time Script-Fu spends on each command.
+
+from __future__ import print_function
+
+import subprocess, sys, time
+
+if len(sys.argv) > 5:
+   print("Usage: %s <gimp> <runs> <width> <height>" % sys.argv[0],
+         file=sys.stderr)
+   print("       (defaults: gimp-2.9, 3 runs, 1024x768)", file=sys.stderr)
+   sys.exit(1)
+
+GIMP   = "gimp-2.9"
+RUNS   = 3
+WIDTH  = 1024
+HEIGHT = 768
+
+args = sys.argv[1:]
+
+if len(args) > 0: GIMP   = args[0]
+if len(args) > 1: RUNS   = int(args[1])
+if len(args) > 2: WIDTH  = int(args[2])
+if len(args) > 3: HEIGHT = int(args[3])
+
+# the scripts, with their arguments after the image and drawable
+SCRIPTS = [
+   ("script-fu-add-bevel",     "5 FALSE FALSE"),
+   ("script-fu-circuit",       "17 3 FALSE TRUE TRUE"),
+   ("script-fu-clothify",      "9 9 135 45 3"),
+   ("script-fu-drop-shadow",   "4 4 15 '(0 0 0) 60 TRUE"),
+   ("script-fu-fuzzy-border",  "'(255 255 255) 16 TRUE 4 FALSE 100 FALSE TRUE"),
+   ("script-fu-lava",          "10 10 7 \"German flag smooth\" TRUE TRUE FALSE"),
+   ("script-fu-old-photo",     "TRUE 20 TRUE FALSE FALSE"),
+   ("script-fu-predator",      "2 TRUE 3 TRUE TRUE"),
+   ("script-fu-round-corners", "15 TRUE 8 8 15 TRUE FALSE"),
+   ("script-fu-weave",         "30 10 75 75 200 50 100"),
+]
+
+SETUP = """
+(let* ((image (car (gimp-image-new %d %d RGB)))
+       (layer (car (gimp-layer-new image %d %d RGB-IMAGE "Background"
+                                   100 LAYER-MODE-NORMAL))))
+  (gimp-image-insert-layer image layer 0 0)
+  (plug-in-plasma RUN-NONINTERACTIVE image layer 1 2.0)
+  %s)
+"""
+
+def run_batch(call):
+   batch = SETUP % (WIDTH, HEIGHT, WIDTH, HEIGHT, call)
+
+   start = time.time()
+   result = subprocess.call([GIMP, "-i", "-d", "-f",
+                             "-b", batch,
+                             "-b", "(gimp-quit 0)"])
+   elapsed = time.time() - start
+
+   if result != 0:
+      raise RuntimeError("%s exited with status %d" % (GIMP, result))
+
+   return elapsed
+
+def best_time(call):
+   return min(run_batch(call) for i in range(RUNS))
+
+baseline = best_time("#t")
+
+print("%dx%d, best of %d runs, %.3f seconds for startup and quit" %
+      (WIDTH, HEIGHT, RUNS, baseline))
+print()
+
+total = 0.0
+
+for name, arguments in SCRIPTS:
+   elapsed = best_time("(%s image layer %s)" % (name, arguments)) - baseline
+   total  += elapsed
+
+   print("%-24s %8.3f seconds" % (name, elapsed))
+
+print()
+print("%-24s %8.3f seconds" % ("total", total))
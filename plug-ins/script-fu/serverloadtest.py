@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+
+# Load test for the Script-Fu server: opens several connections, each
+# sending a number of pipelined requests, and reports response times,
+# along with the time each request waited and ran on the server.
+
+from __future__ import print_function
+
+import socket, struct, sys, threading, time
+
+if len(sys.argv) > 6:
+   print("Usage: %s <host> <port> <clients> <requests> <command>" % sys.argv[0],
+         file=sys.stderr)
+   print("       (defaults: localhost, port 10008, 4 clients, 25 requests, "
+         "'(gimp-version)')", file=sys.stderr)
+   sys.exit(1)
+
+HOST     = "localhost"
+PORT     = 10008
+CLIENTS  = 4
+REQUESTS = 25
+COMMAND  = "(gimp-version)"
+
+args = sys.argv[1:]
+
+if len(args) > 0: HOST     = args[0]
+if len(args) > 1: PORT     = int(args[1])
+if len(args) > 2: CLIENTS  = int(args[2])
+if len(args) > 3: REQUESTS = int(args[3])
+if len(args) > 4: COMMAND  = args[4]
+
+def recv_all(sock, length):
+   data = b""
+   while len(data) < length:
+      chunk = sock.recv(length - len(data))
+      if not chunk:
+         raise IOError("connection closed by the server")
+      data += chunk
+   return data
+
+def run_client(n, results):
+   sock = socket.create_connection((HOST, PORT))
+   cmd  = COMMAND.encode("utf-8")
+
+   # pipeline all requests over the one connection, then collect the
+   # responses, which arrive in the order the requests were sent
+   sent = []
+   for i in range(REQUESTS):
+      # "T" asks the server to report the request's timing
+      sock.sendall(b"T" + struct.pack(">H", len(cmd)) + cmd)
+      sent.append(time.time())
+
+   errors = 0
+   for i in range(REQUESTS):
+      magic, error, length = struct.unpack(">cBH", recv_all(sock, 4))
+      if magic != b"T":
+         raise IOError("invalid magic: %r" % magic)
+      timing = recv_all(sock, length).split(b"\n", 1)[0].split()
+      if error:
+         errors += 1
+      results.append(time.time() - sent[i])
+      waits.append(float(timing[0]))
+      runs.append(float(timing[1]))
+
+   sock.close()
+
+   if errors:
+      print("client %d: %d of %d requests failed" % (n, errors, REQUESTS))
+
+results = []
+waits   = []
+runs    = []
+threads = [threading.Thread(target=run_client, args=(i, results))
+           for i in range(CLIENTS)]
+
+start = time.time()
+
+for thread in threads:
+   thread.start()
+for thread in threads:
+   thread.join()
+
+total = time.time() - start
+
+if results:
+   results.sort()
+   print("%d requests from %d clients in %.3f seconds (%.1f requests/s)" %
+         (len(results), CLIENTS, total, len(results) / total))
+   print("response time: min %.3f, median %.3f, max %.3f seconds" %
+         (results[0], results[len(results) // 2], results[-1]))
+
+   for name, times in (("queue wait", waits), ("run time", runs)):
+      times.sort()
+      print("%s: min %.3f, median %.3f, max %.3f seconds" %
+            (name, times[0], times[len(times) // 2], times[-1]))
@@ -68,11 +68,12 @@ int tracing;
 #define CELL_SEGSIZE    25000 /* # of cells in one segment */
 #endif
 #ifndef CELL_NSEGMENT
-#define CELL_NSEGMENT   50    /* # of segments for cells */
+#define CELL_NSEGMENT   50    /* initial # of segments for cells, grows as needed */
 #endif
-char *alloc_seg[CELL_NSEGMENT];
-pointer cell_seg[CELL_NSEGMENT];
-int     last_cell_seg;
+char    **alloc_seg;
+pointer  *cell_seg;
+int       last_cell_seg;
+int       n_cell_segs;        /* room in alloc_seg and cell_seg */
 
 /* We use 5 registers. */
 pointer args;            /* register for arguments of function */
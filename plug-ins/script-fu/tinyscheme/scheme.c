@@ -375,6 +375,7 @@ static int file_push(scheme *sc, const char *fname);
 static void file_pop(scheme *sc);
 static int file_interactive(scheme *sc);
 static INLINE int is_one_of(char *s, gunichar c);
+static int grow_cellseg_table(scheme *sc);
 static int alloc_cellseg(scheme *sc, int n);
 static long binary_decode(const char *s);
 static INLINE pointer get_cell(scheme *sc, pointer a, pointer b);
@@ -606,6 +607,34 @@ static long binary_decode(const char *s) {
  return x;
 }
 
+/* make room for twice as many cell segments, so that the heap is only
+   limited by memory */
+static int grow_cellseg_table(scheme *sc) {
+     int n = sc->n_cell_segs ? 2 * sc->n_cell_segs : CELL_NSEGMENT;
+     char **alloc_seg;
+     pointer *cell_seg;
+
+     alloc_seg = (char **) sc->malloc(n * sizeof(char *));
+     cell_seg = (pointer *) sc->malloc(n * sizeof(pointer));
+     if (alloc_seg == 0 || cell_seg == 0) {
+          if (alloc_seg != 0)
+               sc->free(alloc_seg);
+          if (cell_seg != 0)
+               sc->free(cell_seg);
+          return 0;
+     }
+     if (sc->n_cell_segs > 0) {
+          memcpy(alloc_seg, sc->alloc_seg, sc->n_cell_segs * sizeof(char *));
+          memcpy(cell_seg, sc->cell_seg, sc->n_cell_segs * sizeof(pointer));
+          sc->free(sc->alloc_seg);
+          sc->free(sc->cell_seg);
+     }
+     sc->alloc_seg = alloc_seg;
+     sc->cell_seg = cell_seg;
+     sc->n_cell_segs = n;
+     return 1;
+}
+
 /* allocate new cell segment */
 static int alloc_cellseg(scheme *sc, int n) {
      pointer newp;
@@ -621,7 +650,8 @@ static int alloc_cellseg(scheme *sc, int n) {
      }
 
      for (k = 0; k < n; k++) {
-          if (sc->last_cell_seg >= CELL_NSEGMENT - 1)
+          if (sc->last_cell_seg >= sc->n_cell_segs - 1
+              && !grow_cellseg_table(sc))
                return k;
           cp = (char*) sc->malloc(CELL_SEGSIZE * sizeof(struct cell)+adj);
           if (cp == 0)
@@ -662,6 +692,26 @@ static int alloc_cellseg(scheme *sc, int n) {
      return n;
 }
 
+/* number of segments to add after a gc, so that at least min_free
+   cells, and at least a quarter of the heap, are free.  growing the
+   heap in proportion keeps scripts holding on to a lot of data from
+   spending most of their time marking it over and over for a few
+   free cells */
+static int cellsegs_to_grow(scheme *sc, long min_free) {
+     long total = (long) (sc->last_cell_seg + 1) * CELL_SEGSIZE;
+     long short_by = total - 4 * sc->fcells;
+     long n = 0;
+
+     /* (fcells + n * SEGSIZE) * 4 >= total + n * SEGSIZE */
+     if (short_by > 0) {
+          n = (short_by + 3 * CELL_SEGSIZE - 1) / (3 * CELL_SEGSIZE);
+     }
+     if (sc->fcells + n * CELL_SEGSIZE < min_free) {
+          n = (min_free - sc->fcells + CELL_SEGSIZE - 1) / CELL_SEGSIZE;
+     }
+     return (int) n;
+}
+
 static INLINE pointer get_cell_x(scheme *sc, pointer a, pointer b) {
   if (sc->free_cell != sc->NIL) {
     pointer x = sc->free_cell;
@@ -682,12 +732,12 @@ static pointer _get_cell(scheme *sc, pointer a, pointer b) {
   }
 
   if (sc->free_cell == sc->NIL) {
-    const int min_to_be_recovered = sc->last_cell_seg*8;
+    int n;
     gc(sc,a, b);
-    if (sc->fcells < min_to_be_recovered
-        || sc->free_cell == sc->NIL) {
+    n = cellsegs_to_grow(sc, 1);
+    if (n > 0) {
       /* if only a few recovered, get more to avoid fruitless gc's */
-      if (!alloc_cellseg(sc,1) && sc->free_cell == sc->NIL) {
+      if (!alloc_cellseg(sc,n) && sc->free_cell == sc->NIL) {
         sc->no_memory=1;
         return sc->sink;
       }
@@ -708,10 +758,12 @@ static pointer reserve_cells(scheme *sc, int n) {
        /* Are there enough cells available? */
        if (sc->fcells < n) {
                /* If not, try gc'ing some */
+               int segs;
                gc(sc, sc->NIL, sc->NIL);
-               if (sc->fcells < n) {
+               segs = cellsegs_to_grow(sc, n);
+               if (segs > 0) {
                        /* If there still aren't, try getting more heap */
-                       if (!alloc_cellseg(sc,1)) {
+                       if (!alloc_cellseg(sc,segs) && sc->fcells < n) {
                                sc->no_memory=1;
                                return sc->NIL;
                        }
@@ -4950,7 +5002,10 @@ int scheme_init_custom_alloc(scheme *sc, func_alloc malloc, func_dealloc free) {
   sc->gensym_cnt=0;
   sc->malloc=malloc;
   sc->free=free;
+  sc->alloc_seg = 0;
+  sc->cell_seg = 0;
   sc->last_cell_seg = -1;
+  sc->n_cell_segs = 0;
   sc->sink = &sc->_sink;
   sc->NIL = &sc->_NIL;
   sc->T = &sc->_HASHT;
@@ -5091,6 +5146,10 @@ void scheme_deinit(scheme *sc) {
   for(i=0; i<=sc->last_cell_seg; i++) {
     sc->free(sc->alloc_seg[i]);
   }
+  if (sc->n_cell_segs > 0) {
+    sc->free(sc->alloc_seg);
+    sc->free(sc->cell_seg);
+  }
 
 #if SHOW_ERROR_LINE
   for(i=0; i<sc->file_i; i++) {
@@ -826,11 +826,13 @@ package Gimp::CodeGen::enums;
 	  header => 'core/core-enums.h',
 	  symbols => [ qw(GIMP_CONVERT_DITHER_NONE GIMP_CONVERT_DITHER_FS
 			  GIMP_CONVERT_DITHER_FS_LOWBLEED
-			  GIMP_CONVERT_DITHER_FIXED) ],
+			  GIMP_CONVERT_DITHER_FIXED
+			  GIMP_CONVERT_DITHER_FS_BANDED) ],
 	  mapping => { GIMP_CONVERT_DITHER_NONE => '0',
 		       GIMP_CONVERT_DITHER_FS => '1',
 		       GIMP_CONVERT_DITHER_FS_LOWBLEED => '2',
-		       GIMP_CONVERT_DITHER_FIXED => '3' }
+		       GIMP_CONVERT_DITHER_FIXED => '3',
+		       GIMP_CONVERT_DITHER_FS_BANDED => '4' }
 	},
     GimpHistogramChannel =>
 	{ contig => 1,